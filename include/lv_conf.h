@@ -35,7 +35,7 @@
 #define LV_USE_ARC 1
 #define LV_USE_ARCLABEL 0
 #define LV_USE_CALENDAR 0
-#define LV_USE_CANVAS 0
+#define LV_USE_CANVAS 1 /* offscreen target for launcher icon rasters */
 #define LV_USE_CHART 0
 #define LV_USE_CHECKBOX 0
 #define LV_USE_DROPDOWN 0
@@ -67,8 +67,13 @@
 #define LV_USE_FLEX 1
 #define LV_USE_GRID 0
 
-/* File system/image decoders for SD media preview */
+/* File system/image decoders for SD media preview (the host simulator build
+ * has no Arduino SD library) */
+#ifdef UI_SIMULATOR
+#define LV_USE_FS_ARDUINO_SD 0
+#else
 #define LV_USE_FS_ARDUINO_SD 1
+#endif
 #define LV_FS_ARDUINO_SD_LETTER 'S'
 #define LV_FS_ARDUINO_SD_PATH "/sd"
 
@@ -26,6 +26,9 @@
 // --- APPMarket ---
 #define USER_APPMARKET_GITHUB_REPO "HITEYY/AI-cc1101"
 #define USER_APPMARKET_RELEASE_ASSET "openclaw-t-embed-cc1101-latest.bin"
+// Firmware "Update Now": 0 = stream the image straight into the OTA partition
+// (no SD card needed), 1 = download to SD first and flash from the file.
+#define USER_OTA_STAGE_TO_SD 0
 
 // --- OpenClaw Node Identity ---
 // These defaults adapt to the active board via HAL_BOARD_NAME at runtime.
@@ -36,6 +39,25 @@
 #define USER_MESSENGER_ENABLE_LEGACY_MEDIA_FALLBACK 0
 #define USER_MESSENGER_BINARY_ATTACH_MAX_BYTES 524288U
 #define USER_MESSENGER_TEXT_FALLBACK_PREVIEW_MAX_CHARS 4000U
+// Voice note encoding: 0=PCM16 WAV, 1=IMA-ADPCM WAV (format 0x11, ~4:1).
+#define USER_MESSENGER_VOICE_ADPCM 0
+// Upload voice notes while recording (agent.request frames, checksum in END).
+// With SD spool on, the recorded file is still kept and re-sent if the live
+// stream breaks; with it off, recording needs no SD card.
+#define USER_MESSENGER_VOICE_STREAM_UPLOAD 0
+#define USER_MESSENGER_VOICE_SD_SPOOL 1
+// Attachment chunks in flight before waiting for gateway acks, how long a
+// chunk may stay unacked before it is resent (also how long the BEGIN frame
+// waits for an answer before a connection is treated as never acking),
+// attempts per chunk, and how long to wait for the gateway to come back
+// before giving up mid-transfer.
+#define USER_MESSENGER_ATTACH_WINDOW 4U
+#define USER_MESSENGER_ATTACH_ACK_TIMEOUT_MS 8000U
+#define USER_MESSENGER_ATTACH_MAX_ATTEMPTS 4U
+#define USER_MESSENGER_ATTACH_RECONNECT_WAIT_MS 20000U
+// SHA-256 (attachment checksums, device id): 1 = mbedTLS on the SHA
+// peripheral, 0 = rweather software implementation (for speed comparison).
+#define USER_SHA256_HARDWARE 1
 
 // --- CC1101 defaults ---
 #define USER_DEFAULT_RF_FREQUENCY_MHZ 433.92f
@@ -54,10 +76,16 @@
   #define USER_MIC_PDM_CLK_PIN HAL_PIN_MIC_PDM_CLK
 #endif
 #define USER_MIC_SAMPLE_RATE 8000U
+// ADC mics are sampled by the continuous (DMA) ADC driver, so they can run
+// faster than PDM/BLE capture without software timing jitter.
+#define USER_MIC_ADC_SAMPLE_RATE 16000U
 #define USER_MIC_DEFAULT_SECONDS 5U
 #define USER_MIC_MAX_SECONDS 30U
 #define USER_BLE_AUDIO_SERVICE_UUID ""
 #define USER_BLE_AUDIO_CHAR_UUID ""
+// BLE audio notification ring (rounded up to a power of two). Allocated from
+// PSRAM when available, and only while a BLE recording is running.
+#define USER_BLE_AUDIO_RING_BYTES 16384U
 
 // --- Audio playback (I2S) ---
 #ifndef HAL_PIN_I2S_BCLK
@@ -131,10 +159,52 @@
 
 // --- Display ---
 #define USER_DISPLAY_BRIGHTNESS_PERCENT 100
+// Korean UI font pack on SD (build it with scripts/make_font_pack.py). Glyphs
+// are read on demand into an LRU cache of this size.
+#define USER_KOREAN_FONT_PACK_PATH "/fonts/korean_ui_14.zxf"
+#define USER_KOREAN_FONT_CACHE_BYTES 65536U
+// Cache size on boards without PSRAM (taken from internal RAM).
+#define USER_KOREAN_FONT_CACHE_INTERNAL_BYTES 16384U
+// Keep the compiled-in Korean font (~1 MB flash) as a fallback for when the
+// pack is missing. 0 drops it from the image.
+#define USER_KOREAN_FONT_BUILTIN 1
+// File explorer image viewer: decoded images kept in PSRAM for reopening, and
+// the largest decoded size (RGB565, 2 bytes per pixel). Boards without PSRAM
+// keep one screen-sized image only.
+#define USER_IMAGE_VIEWER_CACHE_ENTRIES 3
+#define USER_IMAGE_VIEWER_MAX_PIXELS 307200U
+// File explorer directory listings: fully read directories kept in PSRAM
+// (boards without PSRAM keep the current one only), and the entry arena limit
+// per directory on boards without PSRAM (~50 bytes per entry).
+#define USER_FILE_EXPLORER_CACHED_DIRS 4
+#define USER_FILE_EXPLORER_LIST_INTERNAL_BYTES 65536U
+// SD benchmark (File Explorer > SD Card Info, gateway sd.bench): test file size
+// per pass, and the limits below which a card is reported as slow. A 16 KB
+// BLE audio ring at 32 KB/s rides out ~500 ms of stall; half that is the budget.
+#define USER_SD_BENCH_FILE_KB 512U
+#define USER_SD_BENCH_MAX_STALL_MS 250U
+#define USER_SD_BENCH_MIN_WRITE_KBPS 128U
+
+// --- Power ---
+// Let the chip enter automatic light sleep while the UI is idle. Off by
+// default: it only engages on an IDF build with CONFIG_PM_ENABLE and
+// CONFIG_FREERTOS_USE_TICKLESS_IDLE (the stock Arduino core has neither, so
+// only CPU frequency scaling would apply), and USB-CDC serial drops while
+// the chip sleeps.
+#define USER_POWER_LIGHT_SLEEP 0
+// Wi-Fi modem sleep (DTIM power save). Needed for light sleep while
+// connected, but adds up to one beacon interval of latency to gateway
+// traffic, so it stays off (WiFi.setSleep(false)) unless light sleep is on.
+#define USER_WIFI_MODEM_SLEEP 0
 
 // --- Debug ---
 #define USER_MEM_TRACE_ENABLED 0
 #define USER_INPUT_TRACE_ENABLED 0
+// Logs LVGL frame/flush timings every 5 s (compare DMA vs blocking flush).
+#define USER_UI_FRAME_TRACE_ENABLED 0
+// Per-component timing histograms and top stalls (Setting > Diagnostics and
+// the gateway system.perf command). 0 compiles the probes out.
+#define USER_PERF_PROFILER_ENABLED 1
 
 // --- Input pins (encoder defaults from HAL, override here if needed) ---
 #ifndef HAL_PIN_ENCODER_A
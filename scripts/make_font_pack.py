@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""Convert an lv_font_conv C font (``--format lvgl``) into a ZXF1 font pack.
+
+The pack is read glyph by glyph from SD by src/ui/sd_font.cpp, so bitmaps are
+stored already decompressed as 8-bit alpha (A8) and located through a fixed
+size glyph table.
+
+Layout (little endian):
+  header   32 B  magic "ZXF1", version, header size, line height, base line,
+                 underline position/thickness, max glyph bytes, range count,
+                 glyph count and the offsets of the three tables below
+  ranges   12 B  each: first code point, length, first glyph id
+  glyphs   12 B  each: bitmap offset, advance (1/16 px), box w/h, offset x/y
+  bitmaps        A8 rows, box_w bytes per row, no padding
+
+Usage:
+  scripts/make_font_pack.py src/ui/fonts/lv_font_korean_ui_14.c korean_ui_14.zxf
+Copy the output to /fonts/korean_ui_14.zxf on the SD card.
+"""
+
+import re
+import struct
+import sys
+
+MAGIC = b"ZXF1"
+VERSION = 1
+HEADER = struct.Struct("<4sHHBBbBHHIIII")
+RANGE = struct.Struct("<III")
+GLYPH = struct.Struct("<IHBBbbH")
+assert HEADER.size == 32 and RANGE.size == 12 and GLYPH.size == 12
+
+OPA_TABLES = {
+    1: [0, 255],
+    2: [0, 85, 170, 255],
+    4: [0, 17, 34, 51, 68, 85, 102, 119, 136, 153, 170, 187, 204, 221, 238, 255],
+    8: list(range(256)),
+}
+
+
+def fail(message):
+    sys.exit("make_font_pack: " + message)
+
+
+def c_block(source, pattern):
+    match = re.search(pattern + r"\s*=\s*\{(.*?)\n\};", source, re.S)
+    if not match:
+        fail("cannot find " + pattern)
+    return re.sub(r"/\*.*?\*/", "", match.group(1), flags=re.S)
+
+
+def c_int(source, field):
+    match = re.search(r"\." + field + r"\s*=\s*(-?\d+)", source)
+    if not match:
+        fail("cannot find ." + field)
+    return int(match.group(1))
+
+
+def parse_font(source):
+    bitmap = bytes(int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+",
+                                                  c_block(source, r"glyph_bitmap\[\]")))
+    glyphs = []
+    for entry in re.findall(r"\{([^{}]*)\}", c_block(source, r"glyph_dsc\[\]")):
+        fields = dict(re.findall(r"\.(\w+)\s*=\s*(-?\d+)", entry))
+        glyphs.append({k: int(v) for k, v in fields.items()})
+
+    ranges = []
+    for entry in re.findall(r"\{([^{}]*)\}", c_block(source, r"cmaps\[\]")):
+        kind = re.search(r"\.type\s*=\s*(\w+)", entry).group(1)
+        if kind != "LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY":
+            fail("only FORMAT0_TINY cmaps are supported, found " + kind)
+        fields = dict(re.findall(r"\.(range_start|range_length|glyph_id_start)\s*=\s*(\d+)", entry))
+        ranges.append((int(fields["range_start"]), int(fields["range_length"]),
+                       int(fields["glyph_id_start"])))
+
+    meta = {
+        "bpp": c_int(source, "bpp"),
+        "bitmap_format": c_int(source, "bitmap_format"),
+        "line_height": c_int(source, "line_height"),
+        "base_line": c_int(source, "base_line"),
+        "underline_position": c_int(source, "underline_position"),
+        "underline_thickness": c_int(source, "underline_thickness"),
+    }
+    return bitmap, glyphs, ranges, meta
+
+
+def get_bits(data, bit_pos, length):
+    byte_pos = bit_pos >> 3
+    bit_pos &= 7
+    mask = (1 << length) - 1
+    if bit_pos + length >= 8:
+        word = (data[byte_pos] << 8) | (data[byte_pos + 1] if byte_pos + 1 < len(data) else 0)
+        return (word >> (16 - bit_pos - length)) & mask
+    return (data[byte_pos] >> (8 - bit_pos - length)) & mask
+
+
+class RleReader:
+    """Port of the RLE decoder in LVGL's lv_font_fmt_txt.c."""
+
+    def __init__(self, data, bpp):
+        self.data = data
+        self.bpp = bpp
+        self.state = "single"
+        self.pos = 0
+        self.prev = 0
+        self.count = 0
+
+    def next(self):
+        if self.state == "single":
+            value = get_bits(self.data, self.pos, self.bpp)
+            if self.pos != 0 and self.prev == value:
+                self.count = 0
+                self.state = "repeat"
+            self.prev = value
+            self.pos += self.bpp
+            return value
+        if self.state == "repeat":
+            bit = get_bits(self.data, self.pos, 1)
+            self.count += 1
+            self.pos += 1
+            if bit == 1:
+                value = self.prev
+                if self.count == 11:
+                    self.count = get_bits(self.data, self.pos, 6)
+                    self.pos += 6
+                    if self.count != 0:
+                        self.state = "counter"
+                    else:
+                        value = get_bits(self.data, self.pos, self.bpp)
+                        self.prev = value
+                        self.pos += self.bpp
+                        self.state = "single"
+                return value
+            value = get_bits(self.data, self.pos, self.bpp)
+            self.prev = value
+            self.pos += self.bpp
+            self.state = "single"
+            return value
+        value = self.prev
+        self.count -= 1
+        if self.count == 0:
+            value = get_bits(self.data, self.pos, self.bpp)
+            self.prev = value
+            self.pos += self.bpp
+            self.state = "single"
+        return value
+
+
+def glyph_values(bitmap, glyph, bpp, bitmap_format):
+    width, height = glyph["box_w"], glyph["box_h"]
+    data = bitmap[glyph["bitmap_index"]:]
+    if bitmap_format == 0:
+        return [get_bits(data, i * bpp, bpp) for i in range(width * height)]
+    if bitmap_format not in (1, 2):
+        fail("unsupported bitmap_format %d" % bitmap_format)
+
+    reader = RleReader(data, bpp)
+    out = []
+    line = [reader.next() for _ in range(width)]
+    out.extend(line)
+    for _ in range(1, height):
+        row = [reader.next() for _ in range(width)]
+        if bitmap_format == 1:  # prefiltered: rows are XOR deltas
+            line = [a ^ b for a, b in zip(row, line)]
+        else:
+            line = row
+        out.extend(line)
+    return out
+
+
+def build_pack(source):
+    bitmap, glyphs, ranges, meta = parse_font(source)
+    bpp = meta["bpp"]
+    if bpp not in OPA_TABLES:
+        fail("unsupported bpp %d" % bpp)
+    opa = OPA_TABLES[bpp]
+
+    glyph_table = bytearray()
+    bitmaps = bytearray()
+    max_glyph_bytes = 0
+    for glyph in glyphs:
+        width, height = glyph.get("box_w", 0), glyph.get("box_h", 0)
+        offset = len(bitmaps)
+        if width and height:
+            values = glyph_values(bitmap, glyph, bpp, meta["bitmap_format"])
+            bitmaps.extend(opa[v] for v in values)
+        max_glyph_bytes = max(max_glyph_bytes, width * height)
+        glyph_table += GLYPH.pack(offset, glyph.get("adv_w", 0), width, height,
+                                  glyph.get("ofs_x", 0), glyph.get("ofs_y", 0), 0)
+
+    range_table = b"".join(RANGE.pack(*r) for r in ranges)
+    ranges_offset = HEADER.size
+    glyphs_offset = ranges_offset + len(range_table)
+    bitmaps_offset = glyphs_offset + len(glyph_table)
+    header = HEADER.pack(MAGIC, VERSION, HEADER.size, meta["line_height"], meta["base_line"],
+                         meta["underline_position"], meta["underline_thickness"],
+                         max_glyph_bytes, len(ranges), len(glyphs), ranges_offset,
+                         glyphs_offset, bitmaps_offset)
+    return header + range_table + bytes(glyph_table) + bytes(bitmaps), len(glyphs)
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.exit(__doc__)
+    with open(argv[1], encoding="utf-8") as f:
+        source = f.read()
+    pack, glyph_count = build_pack(source)
+    with open(argv[2], "wb") as f:
+        f.write(pack)
+    print("%s: %d glyphs, %d bytes" % (argv[2], glyph_count, len(pack)))
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,66 @@
+#pragma once
+
+// Host stand-in for the Arduino core used by the UI simulator build
+// (UI_SIMULATOR). Time is virtual: millis()/micros() only move when the UI
+// waits, so runs are reproducible regardless of host speed.
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "WString.h"
+
+#define IRAM_ATTR
+#define PROGMEM
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) {
+  return HIGH;
+}
+inline void analogWrite(uint8_t, int) {}
+
+typedef struct {
+  uint32_t owner;
+  uint32_t count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+
+// Log output goes to stderr so stdout stays free for benchmark results.
+class HardwareSerial {
+ public:
+  void begin(unsigned long) {}
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char *s);
+  size_t print(const String &s) { return print(s.c_str()); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t println() { return print("\n"); }
+  size_t println(const char *s) { return print(s) + println(); }
+  size_t println(const String &s) { return println(s.c_str()); }
+  size_t println(long v) { return print(v) + println(); }
+  void flush() { std::fflush(stderr); }
+  explicit operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,24 @@
+#pragma once
+
+// Host stand-in for HTTPClient: every request fails to connect, so network
+// paths in the UI take their offline branch.
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+class HTTPClient {
+ public:
+  bool begin(WiFiClient &, const String &) { return false; }
+  bool begin(const String &) { return false; }
+  void setConnectTimeout(int32_t) {}
+  void setTimeout(uint16_t) {}
+  void setReuse(bool) {}
+  void addHeader(const String &, const String &) {}
+  int GET() { return HTTPC_ERROR_CONNECTION_REFUSED; }
+  String getString() { return String(); }
+  static String errorToString(int) { return String("connection refused"); }
+  void end() {}
+};
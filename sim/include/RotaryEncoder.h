@@ -0,0 +1,17 @@
+#pragma once
+
+// The simulator's InputAdapter replays scripted events; the encoder member
+// only needs to construct.
+
+class RotaryEncoder {
+ public:
+  enum class LatchMode {
+    FOUR3 = 1,
+    FOUR0 = 2,
+    TWO03 = 3,
+  };
+
+  RotaryEncoder(int, int, LatchMode = LatchMode::FOUR0) {}
+  void tick() {}
+  long getPosition() const { return 0; }
+};
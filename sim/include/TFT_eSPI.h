@@ -0,0 +1,12 @@
+#pragma once
+
+// The simulator renders into a host framebuffer (sim/src/lvgl_port_sim.cpp);
+// LvglPort only needs the type to exist.
+
+#include <Arduino.h>
+
+class TFT_eSPI {
+ public:
+  int16_t width() const { return 0; }
+  int16_t height() const { return 0; }
+};
@@ -0,0 +1,242 @@
+#pragma once
+
+// Host stand-in for the Arduino String class, backed by std::string. Covers
+// the subset the UI sources use; semantics follow the ESP32 core.
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class String {
+ public:
+  String() = default;
+  String(const char *s) : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  String(const String &) = default;
+  String(String &&) = default;
+  explicit String(char c) : s_(1, c) {}
+  explicit String(int v, unsigned char base = 10) { s_ = fromLong(v, base); }
+  explicit String(unsigned int v, unsigned char base = 10) { s_ = fromULong(v, base); }
+  explicit String(long v, unsigned char base = 10) { s_ = fromLong(v, base); }
+  explicit String(unsigned long v, unsigned char base = 10) { s_ = fromULong(v, base); }
+  explicit String(long long v) : s_(std::to_string(v)) {}
+  explicit String(unsigned long long v) : s_(std::to_string(v)) {}
+  explicit String(unsigned char v, unsigned char base = 10) { s_ = fromULong(v, base); }
+  explicit String(float v, unsigned int decimals = 2) { s_ = fromDouble(v, decimals); }
+  explicit String(double v, unsigned int decimals = 2) { s_ = fromDouble(v, decimals); }
+
+  String &operator=(const String &) = default;
+  String &operator=(String &&) = default;
+  String &operator=(const char *s) {
+    s_ = s ? s : "";
+    return *this;
+  }
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned int length() const { return static_cast<unsigned int>(s_.size()); }
+  bool isEmpty() const { return s_.empty(); }
+  void clear() { s_.clear(); }
+  bool reserve(unsigned int size) {
+    s_.reserve(size);
+    return true;
+  }
+
+  char charAt(unsigned int index) const { return index < s_.size() ? s_[index] : '\0'; }
+  void setCharAt(unsigned int index, char c) {
+    if (index < s_.size()) {
+      s_[index] = c;
+    }
+  }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char &operator[](unsigned int index) { return s_[index]; }
+
+  bool concat(const String &s) {
+    s_ += s.s_;
+    return true;
+  }
+  bool concat(const char *s) {
+    if (s) {
+      s_ += s;
+    }
+    return true;
+  }
+  bool concat(const char *s, unsigned int n) {
+    if (s) {
+      s_.append(s, n);
+    }
+    return true;
+  }
+  bool concat(char c) {
+    s_ += c;
+    return true;
+  }
+  template <typename T>
+  bool concat(T v) {
+    return concat(String(v));
+  }
+
+  String &operator+=(const String &s) {
+    concat(s);
+    return *this;
+  }
+  String &operator+=(const char *s) {
+    concat(s);
+    return *this;
+  }
+  String &operator+=(char c) {
+    concat(c);
+    return *this;
+  }
+  template <typename T>
+  String &operator+=(T v) {
+    concat(String(v));
+    return *this;
+  }
+
+  bool equals(const String &s) const { return s_ == s.s_; }
+  bool equals(const char *s) const { return s_ == (s ? s : ""); }
+  bool equalsIgnoreCase(const String &s) const {
+    if (s_.size() != s.s_.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < s_.size(); ++i) {
+      if (std::tolower(static_cast<unsigned char>(s_[i])) !=
+          std::tolower(static_cast<unsigned char>(s.s_[i]))) {
+        return false;
+      }
+    }
+    return true;
+  }
+  int compareTo(const String &s) const { return s_.compare(s.s_); }
+  bool startsWith(const String &prefix) const { return s_.rfind(prefix.s_, 0) == 0; }
+  bool endsWith(const String &suffix) const {
+    return s_.size() >= suffix.s_.size() &&
+           s_.compare(s_.size() - suffix.s_.size(), suffix.s_.size(), suffix.s_) == 0;
+  }
+
+  int indexOf(char c, unsigned int from = 0) const { return npos(s_.find(c, from)); }
+  int indexOf(const String &s, unsigned int from = 0) const {
+    return npos(s_.find(s.s_, from));
+  }
+  int lastIndexOf(char c) const { return npos(s_.rfind(c)); }
+  int lastIndexOf(const String &s) const { return npos(s_.rfind(s.s_)); }
+
+  String substring(unsigned int from) const {
+    return from < s_.size() ? String(s_.substr(from)) : String();
+  }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+      const unsigned int tmp = from;
+      from = to;
+      to = tmp;
+    }
+    if (from >= s_.size()) {
+      return String();
+    }
+    if (to > s_.size()) {
+      to = static_cast<unsigned int>(s_.size());
+    }
+    return String(s_.substr(from, to - from));
+  }
+
+  void remove(unsigned int index) {
+    if (index < s_.size()) {
+      s_.erase(index);
+    }
+  }
+  void remove(unsigned int index, unsigned int count) {
+    if (index < s_.size()) {
+      s_.erase(index, count);
+    }
+  }
+  void replace(const String &find, const String &with) {
+    if (find.s_.empty()) {
+      return;
+    }
+    size_t pos = 0;
+    while ((pos = s_.find(find.s_, pos)) != std::string::npos) {
+      s_.replace(pos, find.s_.size(), with.s_);
+      pos += with.s_.size();
+    }
+  }
+  void replace(char find, char with) {
+    for (char &c : s_) {
+      if (c == find) {
+        c = with;
+      }
+    }
+  }
+  void toLowerCase() {
+    for (char &c : s_) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+  }
+  void toUpperCase() {
+    for (char &c : s_) {
+      c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+  }
+  void trim() {
+    const size_t first = s_.find_first_not_of(" \t\r\n\f\v");
+    if (first == std::string::npos) {
+      s_.clear();
+      return;
+    }
+    const size_t last = s_.find_last_not_of(" \t\r\n\f\v");
+    s_ = s_.substr(first, last - first + 1);
+  }
+
+  long toInt() const { return std::strtol(s_.c_str(), nullptr, 10); }
+  float toFloat() const { return std::strtof(s_.c_str(), nullptr); }
+  double toDouble() const { return std::strtod(s_.c_str(), nullptr); }
+
+  friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+  friend String operator+(const String &a, const char *b) { return String(a.s_ + (b ? b : "")); }
+  friend String operator+(const char *a, const String &b) { return String((a ? a : "") + b.s_); }
+  friend String operator+(const String &a, char b) { return String(a.s_ + b); }
+  template <typename T>
+  friend String operator+(const String &a, T b) {
+    return a + String(b);
+  }
+
+  friend bool operator==(const String &a, const String &b) { return a.s_ == b.s_; }
+  friend bool operator==(const String &a, const char *b) { return a.equals(b); }
+  friend bool operator==(const char *a, const String &b) { return b.equals(a); }
+  friend bool operator!=(const String &a, const String &b) { return a.s_ != b.s_; }
+  friend bool operator!=(const String &a, const char *b) { return !a.equals(b); }
+  friend bool operator!=(const char *a, const String &b) { return !b.equals(a); }
+  friend bool operator<(const String &a, const String &b) { return a.s_ < b.s_; }
+
+ private:
+  static int npos(size_t pos) { return pos == std::string::npos ? -1 : static_cast<int>(pos); }
+  static std::string fromULong(unsigned long v, unsigned char base) {
+    if (base < 2 || base > 36) {
+      base = 10;
+    }
+    char buf[72];
+    char *p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    do {
+      const unsigned digit = static_cast<unsigned>(v % base);
+      *--p = static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10);
+      v /= base;
+    } while (v != 0);
+    return std::string(p);
+  }
+  static std::string fromLong(long v, unsigned char base) {
+    if (base == 10 && v < 0) {
+      return "-" + fromULong(static_cast<unsigned long>(-(v + 1)) + 1UL, base);
+    }
+    return fromULong(static_cast<unsigned long>(v), base);
+  }
+  static std::string fromDouble(double v, unsigned int decimals) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(decimals), v);
+    return std::string(buf);
+  }
+
+  std::string s_;
+};
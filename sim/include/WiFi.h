@@ -0,0 +1,32 @@
+#pragma once
+
+// Host stand-in for the Arduino WiFi class: never connected, events are
+// accepted and dropped.
+
+#include <Arduino.h>
+
+#include <functional>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef int arduino_event_id_t;
+typedef struct {
+  int unused;
+} arduino_event_info_t;
+
+typedef std::function<void(arduino_event_id_t, arduino_event_info_t)> WiFiEventFuncCb;
+
+class WiFiClass {
+ public:
+  wl_status_t status() const { return WL_DISCONNECTED; }
+  bool isConnected() const { return false; }
+  int32_t RSSI() const { return 0; }
+  int onEvent(WiFiEventFuncCb, arduino_event_id_t = 0) { return 0; }
+};
+
+extern WiFiClass WiFi;
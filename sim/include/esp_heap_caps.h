@@ -0,0 +1,26 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF capability allocator. Reports a comfortable
+// internal heap so UI code takes its normal (non low-memory) paths.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+inline size_t heap_caps_get_free_size(uint32_t) {
+  return 200U * 1024U;
+}
+inline size_t heap_caps_get_largest_free_block(uint32_t) {
+  return 96U * 1024U;
+}
+inline void *heap_caps_malloc(size_t size, uint32_t) {
+  return std::malloc(size);
+}
+inline void heap_caps_free(void *ptr) {
+  std::free(ptr);
+}
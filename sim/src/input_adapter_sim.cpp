@@ -0,0 +1,234 @@
+#include "../../src/ui/input_adapter.h"
+
+#include <cstdlib>
+#include <sstream>
+
+#include "../../src/core/ui_events.h"
+#include "sim_host.h"
+
+// Scripted InputAdapter: instead of GPIO edges, steps from sim::loadScript()
+// become InputEvents when their virtual time comes. Once a script runs out,
+// BACK is sent every kAutoBackMs so any modal loop left open unwinds.
+namespace {
+
+constexpr unsigned long kAutoBackMs = 1000UL;
+// A script still being driven after this much virtual time is stuck in a
+// screen that ignores BACK.
+constexpr unsigned long kScriptLimitMs = 120000UL;
+
+std::vector<sim::Step> gSteps;
+size_t gNextStep = 0;
+unsigned long gNextDueMs = 0;
+unsigned long gScriptStartMs = 0;
+sim::ShotHook gShotHook;
+
+unsigned long dueAfter(const sim::Step &step, unsigned long now) {
+  return step.kind == sim::StepKind::Wait ? now + static_cast<unsigned long>(step.value) : now;
+}
+
+uint8_t saturatingAdd(uint8_t value, int add) {
+  const int sum = static_cast<int>(value) + add;
+  return static_cast<uint8_t>(sum > 0xFF ? 0xFF : sum);
+}
+
+bool parseCount(std::istringstream &in, int fallback, int *out) {
+  std::string token;
+  if (!(in >> token)) {
+    *out = fallback;
+    return true;
+  }
+  char *end = nullptr;
+  const long value = std::strtol(token.c_str(), &end, 10);
+  if (!end || *end != '\0' || value < 0 || value > 100000) {
+    return false;
+  }
+  *out = static_cast<int>(value);
+  return true;
+}
+
+}  // namespace
+
+namespace sim {
+
+bool parseScript(const std::string &text, std::vector<Step> *out, std::string *error) {
+  out->clear();
+  std::istringstream all(text);
+  std::string part;
+  while (std::getline(all, part, ';')) {
+    std::istringstream in(part);
+    std::string verb;
+    if (!(in >> verb)) {
+      continue;
+    }
+
+    Step step;
+    bool ok = true;
+    if (verb == "wait") {
+      step.kind = StepKind::Wait;
+      ok = parseCount(in, -1, &step.value) && step.value >= 0;
+    } else if (verb == "next" || verb == "prev") {
+      step.kind = StepKind::Delta;
+      ok = parseCount(in, 1, &step.value);
+      if (verb == "prev") {
+        step.value = -step.value;
+      }
+    } else if (verb == "ok") {
+      step.kind = StepKind::Ok;
+    } else if (verb == "back") {
+      step.kind = StepKind::Back;
+    } else if (verb == "long") {
+      step.kind = StepKind::OkLong;
+    } else if (verb == "shot") {
+      step.kind = StepKind::Shot;
+      ok = static_cast<bool>(in >> step.name);
+    } else {
+      ok = false;
+    }
+
+    std::string extra;
+    if (!ok || (in >> extra)) {
+      if (error) {
+        *error = "bad script step: '" + part + "'";
+      }
+      return false;
+    }
+    out->push_back(step);
+  }
+  return true;
+}
+
+void loadScript(const std::vector<Step> &steps) {
+  gSteps = steps;
+  gNextStep = 0;
+  gScriptStartMs = millis();
+  gNextDueMs = gSteps.empty() ? millis() + kAutoBackMs : dueAfter(gSteps[0], millis());
+}
+
+bool scriptFinished() {
+  return gNextStep >= gSteps.size();
+}
+
+unsigned long nextStepDueMs() {
+  return gNextDueMs;
+}
+
+void setShotHook(const ShotHook &hook) {
+  gShotHook = hook;
+}
+
+}  // namespace sim
+
+InputAdapter::InputAdapter() : encoder_(0, 1, RotaryEncoder::LatchMode::TWO03) {}
+
+void InputAdapter::begin(lv_display_t *display) {
+  (void)display;
+  lastActivityMs_ = millis();
+}
+
+void InputAdapter::tick() {
+  const unsigned long now = millis();
+  if (static_cast<long>(now - gNextDueMs) < 0) {
+    return;
+  }
+
+  if (now - gScriptStartMs > kScriptLimitMs) {
+    Serial.printf("[sim] script still running after %lu ms, giving up\n", kScriptLimitMs);
+    std::exit(1);
+  }
+
+  // One step per tick, so each input gets its own service pass and render.
+  if (sim::scriptFinished()) {
+    if (!okBackBlocked_) {
+      pendingEvent_.back = true;
+      pendingEvent_.backCount = saturatingAdd(pendingEvent_.backCount, 1);
+    }
+    gNextDueMs = now + kAutoBackMs;
+    lastActivityMs_ = now;
+    uievents::postFromIsr(uievents::kInput);
+    return;
+  }
+
+  const sim::Step step = gSteps[gNextStep++];
+  switch (step.kind) {
+    case sim::StepKind::Wait:
+      break;
+    case sim::StepKind::Delta:
+      pendingEvent_.delta += step.value;
+      break;
+    case sim::StepKind::Ok:
+      if (!okBackBlocked_) {
+        pendingEvent_.ok = true;
+        pendingEvent_.okCount = saturatingAdd(pendingEvent_.okCount, 1);
+      }
+      break;
+    case sim::StepKind::Back:
+      if (!okBackBlocked_) {
+        pendingEvent_.back = true;
+        pendingEvent_.backCount = saturatingAdd(pendingEvent_.backCount, 1);
+      }
+      break;
+    case sim::StepKind::OkLong:
+      if (!okBackBlocked_) {
+        pendingEvent_.okLong = true;
+        pendingEvent_.okLongCount = saturatingAdd(pendingEvent_.okLongCount, 1);
+      }
+      break;
+    case sim::StepKind::Shot:
+      if (gShotHook) {
+        gShotHook(step.name);
+      }
+      break;
+  }
+
+  if (step.kind != sim::StepKind::Wait && step.kind != sim::StepKind::Shot) {
+    lastActivityMs_ = now;
+    uievents::postFromIsr(uievents::kInput);
+  }
+  gNextDueMs = sim::scriptFinished() ? now + kAutoBackMs : dueAfter(gSteps[gNextStep], now);
+}
+
+void InputAdapter::resetState() {
+  pendingEvent_ = InputEvent{};
+}
+
+void InputAdapter::setOkBackBlocked(bool blocked) {
+  okBackBlocked_ = blocked;
+  if (!blocked) {
+    return;
+  }
+  pendingEvent_.ok = false;
+  pendingEvent_.back = false;
+  pendingEvent_.okLong = false;
+  pendingEvent_.okCount = 0;
+  pendingEvent_.backCount = 0;
+  pendingEvent_.okLongCount = 0;
+}
+
+InputEvent InputAdapter::pollEvent() {
+  InputEvent out = pendingEvent_;
+  pendingEvent_ = InputEvent{};
+  return out;
+}
+
+bool InputAdapter::hasPendingInput() const {
+  return pendingEvent_.delta != 0 || pendingEvent_.ok || pendingEvent_.back ||
+         pendingEvent_.okLong;
+}
+
+bool InputAdapter::idleFor(unsigned long ms) const {
+  return millis() - lastActivityMs_ >= ms;
+}
+
+bool InputAdapter::armSleepWake() {
+  return false;
+}
+
+void InputAdapter::disarmSleepWake() {}
+
+void InputAdapter::setGroup(lv_group_t *group) {
+  (void)group;
+}
+
+lv_indev_t *InputAdapter::indev() const {
+  return indev_;
+}
@@ -0,0 +1,221 @@
+#include "../../src/ui/lvgl_port.h"
+
+#include <vector>
+
+#include "../../src/hal/board_config.h"
+#include "sim_host.h"
+
+// Headless LvglPort: the same partial-buffer setup as the device (band height
+// HAL_DISPLAY_BUFFER_LINES), flushing into a host framebuffer. Frame times
+// are measured on the host clock so they reflect real render cost, while the
+// LVGL tick follows the virtual clock.
+namespace {
+
+constexpr uint16_t kBufferLines = HAL_DISPLAY_BUFFER_LINES;
+
+// The UI is laid out for the rotated (landscape) panel.
+#if HAL_DISPLAY_ROTATION % 2 == 1
+constexpr int kScreenWidth =
+    HAL_DISPLAY_WIDTH > HAL_DISPLAY_HEIGHT ? HAL_DISPLAY_WIDTH : HAL_DISPLAY_HEIGHT;
+constexpr int kScreenHeight =
+    HAL_DISPLAY_WIDTH > HAL_DISPLAY_HEIGHT ? HAL_DISPLAY_HEIGHT : HAL_DISPLAY_WIDTH;
+#else
+constexpr int kScreenWidth = HAL_DISPLAY_WIDTH;
+constexpr int kScreenHeight = HAL_DISPLAY_HEIGHT;
+#endif
+
+std::vector<uint16_t> gFramebuffer;
+
+uint32_t hostMicros32() {
+  return static_cast<uint32_t>(sim::hostMicros());
+}
+
+}  // namespace
+
+namespace sim {
+
+int screenWidth() {
+  return kScreenWidth;
+}
+
+int screenHeight() {
+  return kScreenHeight;
+}
+
+const uint16_t *framebuffer() {
+  return gFramebuffer.data();
+}
+
+}  // namespace sim
+
+LvglPort::LvglPort() = default;
+
+bool LvglPort::begin() {
+  if (initialized_) {
+    return true;
+  }
+
+  lv_init();
+
+  gFramebuffer.assign(static_cast<size_t>(kScreenWidth) * kScreenHeight, 0);
+  const size_t bufBytes = static_cast<size_t>(kScreenWidth) * kBufferLines *
+                          lv_color_format_get_size(LV_COLOR_FORMAT_RGB565);
+  bufferLines_ = kBufferLines;
+  buf1_ = static_cast<lv_color_t *>(malloc(bufBytes));
+  buf2_ = static_cast<lv_color_t *>(malloc(bufBytes));
+  if (!buf1_ || !buf2_) {
+    Serial.println("[sim] LVGL draw buffer alloc failed");
+    return false;
+  }
+
+  display_ = lv_display_create(kScreenWidth, kScreenHeight);
+  if (!display_) {
+    Serial.println("[sim] LVGL display create failed");
+    return false;
+  }
+
+  lv_display_set_user_data(display_, this);
+  lv_display_set_color_format(display_, LV_COLOR_FORMAT_RGB565);
+  lv_display_set_flush_cb(display_, flushCb);
+  lv_display_add_event_cb(display_, refreshEventCb, LV_EVENT_REFR_START, this);
+  lv_display_add_event_cb(display_, refreshEventCb, LV_EVENT_REFR_READY, this);
+  lv_display_set_buffers(display_,
+                         reinterpret_cast<void *>(buf1_),
+                         reinterpret_cast<void *>(buf2_),
+                         static_cast<uint32_t>(bufBytes),
+                         LV_DISPLAY_RENDER_MODE_PARTIAL);
+  lv_display_set_default(display_);
+
+  Serial.printf("[sim] display %dx%d, 2x%u line bands\n",
+                kScreenWidth,
+                kScreenHeight,
+                static_cast<unsigned>(bufferLines_));
+
+  lastTickMs_ = millis();
+  initialized_ = true;
+  return true;
+}
+
+uint32_t LvglPort::pump() {
+  if (!initialized_) {
+    return LV_NO_TIMER_READY;
+  }
+
+  const uint32_t now = millis();
+  uint32_t diff = now - lastTickMs_;
+  if (diff > 1000U) {
+    diff = 1000U;
+  }
+  if (diff > 0U) {
+    lv_tick_inc(diff);
+    lastTickMs_ = now;
+  }
+  return lv_timer_handler();
+}
+
+lv_display_t *LvglPort::display() const {
+  return display_;
+}
+
+TFT_eSPI &LvglPort::tft() {
+  return tft_;
+}
+
+bool LvglPort::ready() const {
+  return initialized_ && display_ != nullptr;
+}
+
+LvglPortStats LvglPort::stats() const {
+  LvglPortStats out;
+  out.frames = frames_;
+  out.lastFrameUs = lastFrameUs_;
+  out.avgFrameUs = frames_ > 0 ? static_cast<uint32_t>(totalFrameUs_ / frames_) : 0U;
+  out.maxFrameUs = maxFrameUs_;
+  out.lastFramePixels = lastFramePixels_;
+  out.avgFramePixels =
+      frames_ > 0 ? static_cast<uint32_t>(totalFramePixels_ / frames_) : 0U;
+  out.maxFramePixels = maxFramePixels_;
+  out.flushes = flushes_;
+  out.flushWaitUs = flushWaitUs_;
+  out.bufferLines = bufferLines_;
+  return out;
+}
+
+void LvglPort::resetStats() {
+  frames_ = 0;
+  totalFrameUs_ = 0;
+  lastFrameUs_ = 0;
+  maxFrameUs_ = 0;
+  totalFramePixels_ = 0;
+  lastFramePixels_ = 0;
+  maxFramePixels_ = 0;
+  flushes_ = 0;
+  flushWaitUs_ = 0;
+}
+
+uint32_t LvglPort::frameSequence() const {
+  return frameSequence_;
+}
+
+void LvglPort::finishPendingFlush() {}
+
+void LvglPort::refreshEventCb(lv_event_t *e) {
+  LvglPort *self = static_cast<LvglPort *>(lv_event_get_user_data(e));
+  if (!self) {
+    return;
+  }
+
+  if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+    self->frameStartUs_ = hostMicros32();
+    self->frameFlushes_ = self->flushes_;
+    self->framePixels_ = 0;
+    return;
+  }
+
+  if (self->flushes_ == self->frameFlushes_) {
+    return;
+  }
+  const uint32_t elapsed = hostMicros32() - self->frameStartUs_;
+  self->lastFrameUs_ = elapsed;
+  self->totalFrameUs_ += elapsed;
+  if (elapsed > self->maxFrameUs_) {
+    self->maxFrameUs_ = elapsed;
+  }
+  ++self->frames_;
+  ++self->frameSequence_;
+  self->lastFramePixels_ = self->framePixels_;
+  self->totalFramePixels_ += self->framePixels_;
+  if (self->framePixels_ > self->maxFramePixels_) {
+    self->maxFramePixels_ = self->framePixels_;
+  }
+}
+
+void LvglPort::flushCb(lv_display_t *disp, const lv_area_t *area, uint8_t *pxMap) {
+  LvglPort *self = static_cast<LvglPort *>(lv_display_get_user_data(disp));
+  if (!self) {
+    lv_display_flush_ready(disp);
+    return;
+  }
+
+  const uint32_t startUs = hostMicros32();
+  const int32_t width = area->x2 - area->x1 + 1;
+  const int32_t height = area->y2 - area->y1 + 1;
+  const uint16_t *src = reinterpret_cast<const uint16_t *>(pxMap);
+  for (int32_t y = 0; y < height; ++y) {
+    const int32_t row = area->y1 + y;
+    if (row < 0 || row >= kScreenHeight) {
+      continue;
+    }
+    for (int32_t x = 0; x < width; ++x) {
+      const int32_t col = area->x1 + x;
+      if (col >= 0 && col < kScreenWidth) {
+        gFramebuffer[static_cast<size_t>(row) * kScreenWidth + col] = src[y * width + x];
+      }
+    }
+  }
+  ++self->flushes_;
+  self->framePixels_ += static_cast<uint32_t>(width * height);
+  self->flushWaitUs_ += hostMicros32() - startUs;
+
+  lv_display_flush_ready(disp);
+}
@@ -0,0 +1,21 @@
+#include "../../src/core/power_manager.h"
+
+// The host has no DFS or light sleep; the UI loop always runs at full speed.
+namespace powermgr {
+
+void begin() {}
+
+bool dfsEnabled() {
+  return false;
+}
+
+bool lightSleepEnabled() {
+  return false;
+}
+
+void setUiIdle(bool idle, bool allowLightSleep) {
+  (void)idle;
+  (void)allowLightSleep;
+}
+
+}  // namespace powermgr
@@ -0,0 +1,34 @@
+#include "../../src/ui/sd_font.h"
+
+// The simulator has no SD card, so the font pack never opens and the UI uses
+// the built-in font, keeping screenshots independent of the host filesystem.
+namespace sdfont {
+
+bool open(const char *path, const lv_font_t *fallback, String *error) {
+  (void)path;
+  (void)fallback;
+  if (error) {
+    *error = "No SD card in the simulator";
+  }
+  return false;
+}
+
+void close() {}
+
+bool ready() {
+  return false;
+}
+
+const lv_font_t *font() {
+  return nullptr;
+}
+
+CacheStats stats() {
+  return CacheStats();
+}
+
+void setBeforeReadHook(const std::function<void()> &hook) {
+  (void)hook;
+}
+
+}  // namespace sdfont
@@ -0,0 +1,81 @@
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include <chrono>
+#include <ctime>
+
+#include "sim_host.h"
+
+namespace {
+
+// 2026-01-01 00:00:00 UTC. The header clock reads time(); pinning it to the
+// virtual clock keeps screenshots identical between runs.
+constexpr time_t kSimEpochSec = 1767225600;
+
+uint64_t gNowUs = 0;
+
+}  // namespace
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+
+size_t HardwareSerial::printf(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  const int written = std::vfprintf(stderr, fmt, args);
+  va_end(args);
+  return written > 0 ? static_cast<size_t>(written) : 0U;
+}
+
+size_t HardwareSerial::print(const char *s) {
+  if (!s) {
+    return 0;
+  }
+  std::fputs(s, stderr);
+  return std::strlen(s);
+}
+
+unsigned long millis() {
+  return static_cast<unsigned long>(gNowUs / 1000ULL);
+}
+
+unsigned long micros() {
+  return static_cast<unsigned long>(gNowUs);
+}
+
+void delay(uint32_t ms) {
+  gNowUs += static_cast<uint64_t>(ms) * 1000ULL;
+}
+
+void delayMicroseconds(uint32_t us) {
+  gNowUs += us;
+}
+
+void yield() {}
+
+// Linked with -Wl,--wrap=time (see [env_native_sim] in platformio.ini).
+extern "C" time_t __wrap_time(time_t *out) {
+  const time_t now = kSimEpochSec + static_cast<time_t>(gNowUs / 1000000ULL);
+  if (out) {
+    *out = now;
+  }
+  return now;
+}
+
+namespace sim {
+
+uint64_t nowUs() {
+  return gNowUs;
+}
+
+void advanceUs(uint64_t us) {
+  gNowUs += us;
+}
+
+uint64_t hostMicros() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+}  // namespace sim
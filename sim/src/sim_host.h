@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Glue between the simulator's stand-ins for the device modules (clock, input,
+// display, event wait) and the scenario runner in sim_main.cpp.
+namespace sim {
+
+// --- Virtual clock (drives millis()/micros() and the LVGL tick) ---
+uint64_t nowUs();
+void advanceUs(uint64_t us);
+// Host monotonic clock, for benchmark timings only.
+uint64_t hostMicros();
+
+// --- Framebuffer (RGB565, row-major, filled by the display flush) ---
+int screenWidth();
+int screenHeight();
+const uint16_t *framebuffer();
+
+// --- Scripted input ---
+enum class StepKind : uint8_t {
+  Wait,
+  Delta,
+  Ok,
+  Back,
+  OkLong,
+  Shot,
+};
+
+struct Step {
+  StepKind kind = StepKind::Wait;
+  int value = 0;
+  std::string name;
+};
+
+// Script syntax, steps separated by ';':
+//   wait <ms> | next [n] | prev [n] | ok | back | long | shot <name>
+bool parseScript(const std::string &text, std::vector<Step> *out, std::string *error);
+
+// Replaces the running script; steps start at the current virtual time.
+void loadScript(const std::vector<Step> &steps);
+bool scriptFinished();
+// Virtual ms at which the next step becomes due.
+unsigned long nextStepDueMs();
+
+using ShotHook = std::function<void(const std::string &name)>;
+void setShotHook(const ShotHook &hook);
+
+}  // namespace sim
@@ -0,0 +1,443 @@
+// Host UI simulator: drives UiRuntime through scripted scenarios on a
+// headless LVGL display, writes a screenshot per "shot" step and prints one
+// benchmark row per scenario. See docs/UI_SIMULATOR.md.
+
+#include <Arduino.h>
+
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "../../src/hal/board_config.h"
+#include "../../src/ui/ui_runtime.h"
+#include "sim_host.h"
+
+#ifndef SIM_BOARD_ID
+#define SIM_BOARD_ID "board"
+#endif
+
+namespace {
+
+constexpr unsigned long kSettleStepMs = 10UL;
+
+struct Options {
+  std::string outDir = "sim_out/" SIM_BOARD_ID;
+  std::string goldenDir;
+  bool updateGolden = false;
+  std::string only;
+  int repeat = 1;
+};
+
+struct Scenario {
+  const char *name;
+  const char *script;
+  void (*run)(UiRuntime &ui);
+};
+
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> rgb;
+};
+
+const std::function<void()> kNoTick;
+
+std::vector<String> strings(std::initializer_list<const char *> items) {
+  std::vector<String> out;
+  for (const char *item : items) {
+    out.push_back(item);
+  }
+  return out;
+}
+
+// Pumps the UI for non-modal screens (overlays) without blocking on input.
+void settle(UiRuntime &ui, unsigned long ms) {
+  const unsigned long start = millis();
+  while (millis() - start < ms) {
+    ui.tick();
+    delay(kSettleStepMs);
+  }
+  ui.tick();
+}
+
+// --- Scenarios. Menus mirror the real app menus so layout changes show up
+// --- in the same places they would on the device.
+
+void runBootSplash(UiRuntime &ui) {
+  ui.showBootSplash("v1.0.0", 1500, kNoTick);
+}
+
+void runLauncher(UiRuntime &ui) {
+  const UiLanguage lang = ui.language();
+  std::vector<String> items;
+  items.push_back(uiText(lang, UiTextKey::AppMarket));
+  items.push_back(uiText(lang, UiTextKey::Settings));
+  items.push_back(uiText(lang, UiTextKey::FileExplorer));
+  ui.setStatusLine("");
+  ui.launcherLoop(uiText(lang, UiTextKey::Launcher), items, 0, kNoTick);
+}
+
+void runLauncherKorean(UiRuntime &ui) {
+  ui.setKoreanFontInstalled(true);
+  ui.setLanguage(UiLanguage::Korean);
+  runLauncher(ui);
+  ui.setLanguage(UiLanguage::English);
+}
+
+void runSettingsMenu(UiRuntime &ui) {
+  ui.menuLoop("Setting",
+              strings({"Wi-Fi", "BLE", "System", "Diagnostics", "Firmware Update", "Back"}),
+              0,
+              kNoTick,
+              "OK Select  BACK Exit",
+              "Saved");
+}
+
+void runLongMenu(UiRuntime &ui) {
+  std::vector<String> items;
+  for (int i = 0; i < 48; ++i) {
+    items.push_back("IMG_" + String(1000 + i) + ".JPG  " + String(12 + i * 7) + " KB");
+  }
+  items.push_back("Back");
+  ui.menuLoop("File Explorer", items, 0, kNoTick, "OK Open  BACK Up", "/sd/DCIM");
+}
+
+void runOpenClawMenu(UiRuntime &ui) {
+  ui.menuLoop("OpenClaw",
+              strings({"Gateway", "Messenger", "Save & Apply", "Back"}),
+              0,
+              kNoTick,
+              "OK Select  BACK Exit",
+              "Gateway: offline");
+}
+
+void runMessengerHome(UiRuntime &ui) {
+  ui.messengerHomeLoop(strings({"[12:01] agent: build finished",
+                                "[12:03] me: ship it",
+                                "[12:04] agent: uploading 3 files",
+                                "[12:09] agent: done, 0 errors"}),
+                       0,
+                       kNoTick);
+}
+
+void runInfo(UiRuntime &ui) {
+  std::vector<String> lines;
+  lines.push_back("Board: " HAL_BOARD_NAME);
+  lines.push_back("Frames: 1234  avg 8.1 ms");
+  for (int i = 0; i < 24; ++i) {
+    lines.push_back("Line " + String(i + 1) + ": the quick brown fox jumps over the lazy dog");
+  }
+  ui.showInfo("Perf Report", lines, kNoTick);
+}
+
+void runConfirm(UiRuntime &ui) {
+  ui.confirm("Factory Reset", "Erase all settings and reboot?", kNoTick);
+}
+
+void runTextInput(UiRuntime &ui) {
+  String value = "zx-os";
+  ui.textInput("Device Name", value, false, kNoTick);
+}
+
+void runNumberWheel(UiRuntime &ui) {
+  int value = 60;
+  ui.numberWheelInput("Brightness", 10, 100, 5, value, kNoTick, "%");
+}
+
+void runProgressOverlay(UiRuntime &ui) {
+  for (int percent = 0; percent <= 100; percent += 10) {
+    ui.showProgressOverlay("Firmware Update", "Writing flash...", percent);
+    settle(ui, 100);
+  }
+  ui.hideProgressOverlay();
+  settle(ui, 100);
+}
+
+void runToast(UiRuntime &ui) {
+  ui.showToast("Saved", "Settings written to NVS", 1200, kNoTick);
+}
+
+const Scenario kScenarios[] = {
+    {"boot", "wait 700; shot boot", runBootSplash},
+    {"launcher",
+     "wait 400; shot launcher; next; wait 400; shot launcher_next; next; wait 400; "
+     "prev 2; wait 400; ok",
+     runLauncher},
+    {"launcher_ko", "wait 400; shot launcher_ko; next; wait 400; back", runLauncherKorean},
+    {"settings",
+     "wait 300; shot settings; next; wait 150; next; wait 150; next; wait 300; "
+     "shot settings_diag; back",
+     runSettingsMenu},
+    {"long_menu",
+     "wait 300; shot long_menu; next; wait 100; next; wait 100; next; wait 100; next; "
+     "wait 100; next; wait 100; next; wait 100; next; wait 100; next; wait 100; next 12; "
+     "wait 300; shot long_menu_scrolled; prev 30; wait 300; back",
+     runLongMenu},
+    {"openclaw", "wait 300; shot openclaw; next 3; wait 300; back", runOpenClawMenu},
+    {"messenger", "wait 300; shot messenger; next; wait 300; shot messenger_next; back",
+     runMessengerHome},
+    {"info", "wait 300; shot info; next 5; wait 300; shot info_scrolled; back", runInfo},
+    {"confirm", "wait 300; shot confirm; next; wait 300; shot confirm_no; back", runConfirm},
+    {"text_input",
+     "wait 300; shot text_input; next 3; wait 200; ok; wait 300; shot text_input_typed; back",
+     runTextInput},
+    {"number_wheel",
+     "wait 300; shot number_wheel; next 4; wait 300; shot number_wheel_80; back",
+     runNumberWheel},
+    {"progress", "wait 550; shot progress_50", runProgressOverlay},
+    {"toast", "wait 300; shot toast", runToast},
+};
+
+bool makeDirs(const std::string &path) {
+  std::string partial;
+  for (size_t i = 0; i <= path.size(); ++i) {
+    if (i == path.size() || path[i] == '/') {
+      if (!partial.empty() && mkdir(partial.c_str(), 0755) != 0 && errno != EEXIST) {
+        return false;
+      }
+    }
+    if (i < path.size()) {
+      partial += path[i];
+    }
+  }
+  return true;
+}
+
+Image captureScreen() {
+  Image image;
+  image.width = sim::screenWidth();
+  image.height = sim::screenHeight();
+  image.rgb.resize(static_cast<size_t>(image.width) * image.height * 3U);
+  const uint16_t *fb = sim::framebuffer();
+  for (size_t i = 0; i < static_cast<size_t>(image.width) * image.height; ++i) {
+    const uint16_t px = fb[i];
+    const uint8_t r = static_cast<uint8_t>((px >> 11) & 0x1F);
+    const uint8_t g = static_cast<uint8_t>((px >> 5) & 0x3F);
+    const uint8_t b = static_cast<uint8_t>(px & 0x1F);
+    image.rgb[i * 3U] = static_cast<uint8_t>((r << 3) | (r >> 2));
+    image.rgb[i * 3U + 1U] = static_cast<uint8_t>((g << 2) | (g >> 4));
+    image.rgb[i * 3U + 2U] = static_cast<uint8_t>((b << 3) | (b >> 2));
+  }
+  return image;
+}
+
+bool writePpm(const std::string &path, const Image &image) {
+  FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    return false;
+  }
+  std::fprintf(f, "P6\n%d %d\n255\n", image.width, image.height);
+  const bool ok = std::fwrite(image.rgb.data(), 1, image.rgb.size(), f) == image.rgb.size();
+  return std::fclose(f) == 0 && ok;
+}
+
+bool readPpm(const std::string &path, Image *image) {
+  FILE *f = std::fopen(path.c_str(), "rb");
+  if (!f) {
+    return false;
+  }
+  int maxValue = 0;
+  const bool header =
+      std::fscanf(f, "P6 %d %d %d", &image->width, &image->height, &maxValue) == 3 &&
+      maxValue == 255 && std::fgetc(f) != EOF && image->width > 0 && image->height > 0;
+  bool ok = false;
+  if (header) {
+    image->rgb.resize(static_cast<size_t>(image->width) * image->height * 3U);
+    ok = std::fread(image->rgb.data(), 1, image->rgb.size(), f) == image->rgb.size();
+  }
+  std::fclose(f);
+  return ok;
+}
+
+// Pixels whose RGB differs; -1 when the sizes do not match.
+long diffPixels(const Image &a, const Image &b) {
+  if (a.width != b.width || a.height != b.height) {
+    return -1;
+  }
+  long count = 0;
+  for (size_t i = 0; i < a.rgb.size(); i += 3U) {
+    if (a.rgb[i] != b.rgb[i] || a.rgb[i + 1U] != b.rgb[i + 1U] ||
+        a.rgb[i + 2U] != b.rgb[i + 2U]) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+class ShotRecorder {
+ public:
+  explicit ShotRecorder(const Options &options) : options_(options) {}
+
+  void setEnabled(bool enabled) { enabled_ = enabled; }
+  int failures() const { return failures_; }
+
+  void capture(const std::string &name) {
+    if (!enabled_) {
+      return;
+    }
+    const Image image = captureScreen();
+    const std::string file = name + ".ppm";
+    if (!writePpm(options_.outDir + "/" + file, image)) {
+      std::fprintf(stderr, "[sim] cannot write %s/%s\n", options_.outDir.c_str(), file.c_str());
+      ++failures_;
+    }
+    if (options_.goldenDir.empty()) {
+      return;
+    }
+
+    const std::string goldenPath = options_.goldenDir + "/" + file;
+    if (options_.updateGolden) {
+      if (!writePpm(goldenPath, image)) {
+        std::fprintf(stderr, "[sim] cannot write %s\n", goldenPath.c_str());
+        ++failures_;
+      }
+      return;
+    }
+
+    Image golden;
+    if (!readPpm(goldenPath, &golden)) {
+      std::fprintf(stderr, "[sim] %s: missing golden %s\n", name.c_str(), goldenPath.c_str());
+      ++failures_;
+      return;
+    }
+    const long diff = diffPixels(image, golden);
+    if (diff != 0) {
+      if (diff < 0) {
+        std::fprintf(stderr, "[sim] %s: size %dx%d, golden %dx%d\n", name.c_str(),
+                     image.width, image.height, golden.width, golden.height);
+      } else {
+        std::fprintf(stderr, "[sim] %s: %ld pixels differ from golden\n", name.c_str(), diff);
+      }
+      ++failures_;
+    }
+  }
+
+ private:
+  const Options &options_;
+  bool enabled_ = true;
+  int failures_ = 0;
+};
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "usage: %s [--out DIR] [--golden DIR [--update-golden]] [--only NAME]\n"
+               "          [--repeat N] [--list]\n",
+               argv0);
+}
+
+bool parseArgs(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--out" && hasValue) {
+      options->outDir = argv[++i];
+    } else if (arg == "--golden" && hasValue) {
+      options->goldenDir = argv[++i];
+    } else if (arg == "--update-golden") {
+      options->updateGolden = true;
+    } else if (arg == "--only" && hasValue) {
+      options->only = argv[++i];
+    } else if (arg == "--repeat" && hasValue) {
+      options->repeat = std::atoi(argv[++i]);
+      if (options->repeat < 1) {
+        return false;
+      }
+    } else if (arg == "--list") {
+      for (const Scenario &scenario : kScenarios) {
+        std::printf("%s\n", scenario.name);
+      }
+      std::exit(0);
+    } else {
+      return false;
+    }
+  }
+  return !options->updateGolden || !options->goldenDir.empty();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseArgs(argc, argv, &options)) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (!makeDirs(options.outDir) ||
+      (options.updateGolden && !makeDirs(options.goldenDir))) {
+    std::fprintf(stderr, "[sim] cannot create output directories\n");
+    return 2;
+  }
+
+  // The header clock formats local time; pin the zone so output is stable.
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  ShotRecorder recorder(options);
+  sim::setShotHook([&recorder](const std::string &name) { recorder.capture(name); });
+
+  UiRuntime ui;
+  ui.begin();
+
+  std::printf("board,scenario,pass,frames,avg_frame_us,max_frame_us,avg_px,max_px,"
+              "builds,objects,in_place,host_ms\n");
+  int ran = 0;
+  for (int pass = 0; pass < options.repeat; ++pass) {
+    // Screenshots are deterministic; only the first pass records them.
+    recorder.setEnabled(pass == 0);
+    for (const Scenario &scenario : kScenarios) {
+      if (!options.only.empty() && options.only != scenario.name) {
+        continue;
+      }
+
+      std::vector<sim::Step> steps;
+      std::string error;
+      if (!sim::parseScript(scenario.script, &steps, &error)) {
+        std::fprintf(stderr, "[sim] %s: %s\n", scenario.name, error.c_str());
+        return 2;
+      }
+
+      ui.resetInputState();
+      ui.resetRenderStats();
+      sim::loadScript(steps);
+      const uint64_t hostStartUs = sim::hostMicros();
+      scenario.run(ui);
+      const uint64_t hostUs = sim::hostMicros() - hostStartUs;
+      if (!sim::scriptFinished()) {
+        std::fprintf(stderr, "[sim] %s: returned before its script finished\n",
+                     scenario.name);
+      }
+
+      const UiRenderStats stats = ui.renderStats();
+      std::printf("%s,%s,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                  SIM_BOARD_ID,
+                  scenario.name,
+                  pass,
+                  static_cast<unsigned long>(stats.frames),
+                  static_cast<unsigned long>(stats.avgFrameUs),
+                  static_cast<unsigned long>(stats.maxFrameUs),
+                  static_cast<unsigned long>(stats.avgFramePixels),
+                  static_cast<unsigned long>(stats.maxFramePixels),
+                  static_cast<unsigned long>(stats.fullBuilds),
+                  static_cast<unsigned long>(stats.objectsCreated),
+                  static_cast<unsigned long>(stats.inPlaceUpdates),
+                  static_cast<unsigned long>(hostUs / 1000ULL));
+      ++ran;
+    }
+  }
+
+  if (ran == 0) {
+    std::fprintf(stderr, "[sim] no scenario named '%s'\n", options.only.c_str());
+    return 2;
+  }
+  if (recorder.failures() > 0) {
+    std::fprintf(stderr, "[sim] %d screenshot check(s) failed\n", recorder.failures());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,29 @@
+#include "../../src/core/system_status.h"
+
+// Fixed status so header indicators render the same on every run: Wi-Fi
+// down, battery at 76 %, clock valid (time() is pinned by sim_arduino.cpp).
+bool SystemStatusService::begin() {
+  published_.wifiConnected = false;
+  published_.batteryPct = 76;
+  published_.batteryCharging = false;
+  published_.batteryChargingKnown = true;
+  published_.timeValid = true;
+  published_.sequence = 1;
+  return true;
+}
+
+bool SystemStatusService::running() const {
+  return true;
+}
+
+SystemStatusSnapshot SystemStatusService::snapshot() const {
+  return published_;
+}
+
+void SystemStatusService::setTimezone(const String &posixTz) {
+  snprintf(pendingTz_, sizeof(pendingTz_), "%s", posixTz.c_str());
+}
+
+void SystemStatusService::requestTimeSync() {}
+
+void SystemStatusService::applyTimeConfig() {}
@@ -0,0 +1,57 @@
+#include "../../src/core/ui_events.h"
+
+#include "sim_host.h"
+
+// Virtual-time version of the UI wake-up group: a wait jumps the clock to the
+// timeout or to the next scripted input step, whichever comes first.
+namespace {
+
+uint32_t gPending = 0;
+uint32_t gFirstInputEdgeUs = 0;
+
+}  // namespace
+
+namespace uievents {
+
+bool begin() {
+  return true;
+}
+
+void post(uint32_t bits) {
+  gPending |= bits & kAll;
+}
+
+void postFromIsr(uint32_t bits) {
+  if ((bits & kInput) != 0 && gFirstInputEdgeUs == 0) {
+    gFirstInputEdgeUs = static_cast<uint32_t>(micros()) | 1UL;
+  }
+  post(bits);
+}
+
+uint32_t wait(uint32_t timeoutMs) {
+  if (gPending != 0) {
+    const uint32_t bits = gPending;
+    gPending = 0;
+    return bits;
+  }
+
+  const unsigned long now = millis();
+  const unsigned long dueMs = sim::nextStepDueMs();
+  if (static_cast<long>(dueMs - now) <= 0) {
+    return kInput;
+  }
+  if (dueMs - now < timeoutMs) {
+    sim::advanceUs(static_cast<uint64_t>(dueMs - now) * 1000ULL);
+    return kInput;
+  }
+  sim::advanceUs(static_cast<uint64_t>(timeoutMs) * 1000ULL);
+  return 0;
+}
+
+uint32_t takeInputEdgeUs() {
+  const uint32_t edge = gFirstInputEdgeUs;
+  gFirstInputEdgeUs = 0;
+  return edge;
+}
+
+}  // namespace uievents
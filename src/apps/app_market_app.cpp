@@ -1,13 +1,9 @@
 #include "app_market_app.h"
 
-#include <ArduinoJson.h>
-#include <HTTPClient.h>
 #include <SD.h>
 #include <SPI.h>
 #include <Update.h>
 #include <WiFi.h>
-#include <WiFiClient.h>
-#include <WiFiClientSecure.h>
 
 #include <algorithm>
 #include <vector>
@@ -16,6 +12,9 @@
 #include <esp_partition.h>
 
 #include "../core/board_pins.h"
+#include "../core/dir_listing.h"
+#include "../core/firmware_fetch.h"
+#include "../core/github_release.h"
 #include "../core/runtime_config.h"
 #include "../core/shared_spi_bus.h"
 #include "../ui/ui_runtime.h"
@@ -27,7 +26,7 @@ constexpr const char *kLatestPackagePath = "/appmarket/latest.bin";
 constexpr const char *kBackupPackagePath = "/appmarket/current_backup.bin";
 constexpr const char *kPinnedRepoSlug = "HITEYY/AI-cc1101";
 constexpr size_t kTransferChunkBytes = 2048;
-constexpr unsigned long kDownloadIdleTimeoutMs = 12000UL;
+constexpr const char *kUserAgent = "AI-cc1101-APPMarket";
 
 struct ReleaseInfo {
   String tag;
@@ -36,17 +35,8 @@ struct ReleaseInfo {
   uint32_t size = 0;
 };
 
-struct ReleaseAssetEntry {
-  String name;
-  String downloadUrl;
-  uint32_t size = 0;
-};
-
-struct ReleaseBrowseEntry {
-  String tag;
-  bool prerelease = false;
-  std::vector<ReleaseAssetEntry> assets;
-};
+using ReleaseAssetEntry = ghrelease::Asset;
+using ReleaseBrowseEntry = ghrelease::Release;
 
 struct FsEntry {
   String fullPath;
@@ -220,6 +210,7 @@ bool ensureMarketDirectory(String *error) {
     }
     return false;
   }
+  dirlisting::noteChanged(kAppMarketDir);
   return true;
 }
 
@@ -293,135 +284,6 @@ bool resolveRepoSlug(const RuntimeConfig &config,
   return true;
 }
 
-bool httpGetSecure(const String &url,
-                   String &responseOut,
-                   int &httpCodeOut,
-                   String *error) {
-  responseOut = "";
-  httpCodeOut = -1;
-
-  if (WiFi.status() != WL_CONNECTED) {
-    if (error) {
-      *error = "Wi-Fi is not connected";
-    }
-    return false;
-  }
-
-  WiFiClientSecure client;
-  client.setInsecure();
-
-  HTTPClient http;
-  if (!http.begin(client, url)) {
-    if (error) {
-      *error = "HTTP begin failed";
-    }
-    return false;
-  }
-
-  http.setTimeout(12000);
-  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-  http.addHeader("User-Agent", "AI-cc1101-APPMarket");
-  http.addHeader("Accept", "application/vnd.github+json");
-
-  const int code = http.GET();
-  httpCodeOut = code;
-  if (code > 0) {
-    responseOut = http.getString();
-  }
-  http.end();
-
-  if (code <= 0) {
-    if (error) {
-      *error = "HTTP request failed";
-    }
-    return false;
-  }
-  if (code < 200 || code >= 300) {
-    if (error) {
-      *error = "HTTP " + String(code);
-    }
-    return false;
-  }
-  return true;
-}
-
-bool parseLatestReleaseBody(const String &body,
-                            const String &preferredAssetNameRaw,
-                            ReleaseInfo &infoOut,
-                            String *error) {
-  DynamicJsonDocument doc(32768);
-  const auto parseErr = deserializeJson(doc, body);
-  if (parseErr || !doc.is<JsonObject>()) {
-    if (error) {
-      *error = "Release JSON parse failed";
-    }
-    return false;
-  }
-
-  const JsonObjectConst root = doc.as<JsonObjectConst>();
-  infoOut.tag = String(static_cast<const char *>(root["tag_name"] | ""));
-  if (infoOut.tag.isEmpty()) {
-    infoOut.tag = String(static_cast<const char *>(root["name"] | ""));
-  }
-  if (infoOut.tag.isEmpty()) {
-    infoOut.tag = "(unknown)";
-  }
-
-  if (!root["assets"].is<JsonArrayConst>()) {
-    if (error) {
-      *error = "Release has no assets";
-    }
-    return false;
-  }
-
-  const JsonArrayConst assets = root["assets"].as<JsonArrayConst>();
-  if (assets.size() == 0) {
-    if (error) {
-      *error = "Release has empty assets";
-    }
-    return false;
-  }
-
-  const String preferredAssetName = preferredAssetNameRaw;
-  JsonObjectConst selected;
-
-  if (!preferredAssetName.isEmpty()) {
-    for (JsonObjectConst asset : assets) {
-      const String name = String(static_cast<const char *>(asset["name"] | ""));
-      if (name == preferredAssetName) {
-        selected = asset;
-        break;
-      }
-    }
-  }
-
-  if (selected.isNull()) {
-    for (JsonObjectConst asset : assets) {
-      const String name = String(static_cast<const char *>(asset["name"] | ""));
-      if (hasBinExtension(name)) {
-        selected = asset;
-        break;
-      }
-    }
-  }
-
-  if (selected.isNull()) {
-    selected = assets[0];
-  }
-
-  infoOut.assetName = String(static_cast<const char *>(selected["name"] | ""));
-  infoOut.downloadUrl = String(static_cast<const char *>(selected["browser_download_url"] | ""));
-  infoOut.size = selected["size"] | 0;
-
-  if (infoOut.assetName.isEmpty() || infoOut.downloadUrl.isEmpty()) {
-    if (error) {
-      *error = "Release asset URL missing";
-    }
-    return false;
-  }
-  return true;
-}
-
 bool fetchLatestReleaseInfo(const RuntimeConfig &config,
                             ReleaseInfo &infoOut,
                             String *error) {
@@ -430,84 +292,17 @@ bool fetchLatestReleaseInfo(const RuntimeConfig &config,
     return false;
   }
 
-  const String url = "https://api.github.com/repos/" + repo + "/releases/latest";
-  String body;
-  int code = -1;
-  String httpErr;
-  if (!httpGetSecure(url, body, code, &httpErr)) {
-    if (error) {
-      *error = httpErr;
-    }
-    return false;
-  }
-
-  if (!parseLatestReleaseBody(body, config.appMarketReleaseAsset, infoOut, error)) {
-    return false;
-  }
-  return true;
-}
-
-bool parseReleaseCatalogBody(const String &body,
-                             std::vector<ReleaseBrowseEntry> &releasesOut,
-                             String *error) {
-  releasesOut.clear();
-
-  DynamicJsonDocument doc(65536);
-  const auto parseErr = deserializeJson(doc, body);
-  if (parseErr || !doc.is<JsonArray>()) {
-    if (error) {
-      *error = "Release list parse failed";
-    }
+  ghrelease::Release release;
+  if (!ghrelease::fetchLatest(repo, kUserAgent, release, error)) {
     return false;
   }
 
-  const JsonArrayConst roots = doc.as<JsonArrayConst>();
-  for (JsonObjectConst root : roots) {
-    if (root["draft"] | false) {
-      continue;
-    }
-
-    ReleaseBrowseEntry release;
-    release.tag = String(static_cast<const char *>(root["tag_name"] | ""));
-    if (release.tag.isEmpty()) {
-      release.tag = String(static_cast<const char *>(root["name"] | ""));
-    }
-    if (release.tag.isEmpty()) {
-      release.tag = "(unknown)";
-    }
-    release.prerelease = root["prerelease"] | false;
-
-    if (!root["assets"].is<JsonArrayConst>()) {
-      continue;
-    }
-    const JsonArrayConst assets = root["assets"].as<JsonArrayConst>();
-    for (JsonObjectConst assetRoot : assets) {
-      ReleaseAssetEntry asset;
-      asset.name = String(static_cast<const char *>(assetRoot["name"] | ""));
-      asset.downloadUrl =
-          String(static_cast<const char *>(assetRoot["browser_download_url"] | ""));
-      asset.size = assetRoot["size"] | 0;
-      if (asset.name.isEmpty() || asset.downloadUrl.isEmpty()) {
-        continue;
-      }
-      release.assets.push_back(asset);
-    }
-
-    if (release.assets.empty()) {
-      continue;
-    }
-    releasesOut.push_back(release);
-    if (releasesOut.size() >= 8) {
-      break;
-    }
-  }
-
-  if (releasesOut.empty()) {
-    if (error) {
-      *error = "No releases with assets";
-    }
-    return false;
-  }
+  const ghrelease::Asset &asset =
+      release.assets[ghrelease::preferredAssetIndex(release, config.appMarketReleaseAsset)];
+  infoOut.tag = release.tag;
+  infoOut.assetName = asset.name;
+  infoOut.downloadUrl = asset.downloadUrl;
+  infoOut.size = asset.size;
   return true;
 }
 
@@ -519,18 +314,16 @@ bool fetchReleaseCatalog(const RuntimeConfig &config,
     return false;
   }
 
-  const String url = "https://api.github.com/repos/" + repo + "/releases?per_page=8";
-  String body;
-  int code = -1;
-  String httpErr;
-  if (!httpGetSecure(url, body, code, &httpErr)) {
+  if (!ghrelease::fetchCatalog(repo, kUserAgent, 8, releasesOut, error)) {
+    return false;
+  }
+  if (releasesOut.empty()) {
     if (error) {
-      *error = httpErr;
+      *error = "No releases with assets";
     }
     return false;
   }
-
-  return parseReleaseCatalogBody(body, releasesOut, error);
+  return true;
 }
 
 String releaseMenuLabel(const ReleaseBrowseEntry &release) {
@@ -553,25 +346,6 @@ String releaseAssetMenuLabel(const ReleaseAssetEntry &asset) {
   return label;
 }
 
-int preferredAssetIndex(const ReleaseBrowseEntry &release,
-                        const String &preferredAssetNameRaw) {
-  String preferredAssetName = preferredAssetNameRaw;
-  preferredAssetName.trim();
-  if (!preferredAssetName.isEmpty()) {
-    for (size_t i = 0; i < release.assets.size(); ++i) {
-      if (release.assets[i].name == preferredAssetName) {
-        return static_cast<int>(i);
-      }
-    }
-  }
-  for (size_t i = 0; i < release.assets.size(); ++i) {
-    if (hasBinExtension(release.assets[i].name)) {
-      return static_cast<int>(i);
-    }
-  }
-  return 0;
-}
-
 bool browseReleaseAsset(AppContext &ctx,
                         ReleaseInfo &infoOut,
                         const std::function<void()> &backgroundTick,
@@ -608,7 +382,8 @@ bool browseReleaseAsset(AppContext &ctx,
     releaseSelected = releaseChoice;
 
     const ReleaseBrowseEntry &release = releases[static_cast<size_t>(releaseChoice)];
-    int assetSelected = preferredAssetIndex(release, ctx.config.appMarketReleaseAsset);
+    int assetSelected =
+        static_cast<int>(ghrelease::preferredAssetIndex(release, ctx.config.appMarketReleaseAsset));
 
     while (true) {
       std::vector<String> assetMenu;
@@ -640,173 +415,70 @@ bool browseReleaseAsset(AppContext &ctx,
   }
 }
 
-bool downloadUrlToSdFile(const String &url,
-                         const char *destPath,
-                         const std::function<void()> &backgroundTick,
-                         const std::function<void(uint32_t, int)> &progressTick,
-                         uint32_t *bytesOut,
-                         String *error) {
-  if (bytesOut) {
-    *bytesOut = 0;
-  }
-
-  if (WiFi.status() != WL_CONNECTED) {
-    if (error) {
-      *error = "Wi-Fi is not connected";
-    }
-    return false;
-  }
-
-  String sdErr;
-  if (!ensureSdMounted(false, &sdErr)) {
-    if (error) {
-      *error = sdErr;
-    }
-    return false;
-  }
-  if (!ensureMarketDirectory(&sdErr)) {
-    if (error) {
-      *error = sdErr;
-    }
-    return false;
-  }
-
-  const String tempPath = String(destPath) + ".tmp";
-  if (SD.exists(tempPath.c_str())) {
-    SD.remove(tempPath.c_str());
-  }
-
-  WiFiClientSecure client;
-  client.setInsecure();
-
-  HTTPClient http;
-  if (!http.begin(client, url)) {
-    if (error) {
-      *error = "HTTP begin failed";
+// Fetches the .sha256 asset published next to url. Nothing vouches for a
+// release without one, so it is only used once the user accepts an
+// unverified image; action names what happens next ("Install", "Download").
+bool fetchChecksumOrConfirm(AppContext &ctx,
+                            const String &url,
+                            const String &assetName,
+                            const char *action,
+                            const std::function<void()> &backgroundTick,
+                            String &sha256,
+                            String *error) {
+  bool hasSha256 = false;
+  {
+    OverlayScope overlay(ctx.uiRuntime, "APPMarket", "Fetching checksum...", -1);
+    if (!fwfetch::fetchSha256(url, kUserAgent, sha256, &hasSha256, error)) {
+      return false;
     }
-    return false;
   }
-
-  http.setTimeout(15000);
-  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-  http.addHeader("User-Agent", "AI-cc1101-APPMarket");
-
-  const int code = http.GET();
-  const int totalSize = http.getSize();
-  if (code <= 0 || code < 200 || code >= 300) {
-    const String response = code > 0 ? http.getString() : String("");
-    http.end();
-    if (error) {
-      String msg = code <= 0 ? String("Download HTTP failed")
-                             : String("HTTP ") + String(code);
-      if (!response.isEmpty()) {
-        msg += ": " + trimMiddle(response, 40);
-      }
-      *error = msg;
-    }
-    return false;
+  if (hasSha256) {
+    return true;
   }
-
-  File file = SD.open(tempPath.c_str(), FILE_WRITE);
-  if (!file || file.isDirectory()) {
-    if (file) {
-      file.close();
-    }
-    http.end();
-    if (error) {
-      *error = "SD file open failed";
-    }
-    return false;
+  if (ctx.uiRuntime->confirm("No Checksum",
+                             trimMiddle(assetName, 20) + " has no SHA-256. " + action +
+                                 " unverified?",
+                             backgroundTick,
+                             action,
+                             "Cancel")) {
+    return true;
   }
-
-  WiFiClient *stream = http.getStreamPtr();
-  int remain = http.getSize();
-  uint8_t buffer[kTransferChunkBytes];
-  uint32_t writtenTotal = 0;
-  unsigned long lastProgressMs = millis();
-  if (progressTick) {
-    progressTick(0, totalSize);
-  }
-
-  while (http.connected() && (remain > 0 || remain == -1)) {
-    const size_t available = stream->available();
-    if (available == 0) {
-      if (millis() - lastProgressMs > kDownloadIdleTimeoutMs) {
-        file.close();
-        http.end();
-        SD.remove(tempPath.c_str());
-        if (error) {
-          *error = "Download timeout";
-        }
-        return false;
-      }
-      delay(5);
-      if (backgroundTick) {
-        backgroundTick();
-      }
-      continue;
-    }
-
-    const size_t toRead = std::min(available, sizeof(buffer));
-    const int readLen = stream->readBytes(buffer, toRead);
-    if (readLen <= 0) {
-      continue;
-    }
-
-    const size_t written = file.write(buffer, static_cast<size_t>(readLen));
-    if (written != static_cast<size_t>(readLen)) {
-      file.close();
-      http.end();
-      SD.remove(tempPath.c_str());
-      if (error) {
-        *error = "SD write failed";
-      }
-      return false;
-    }
-
-    writtenTotal += static_cast<uint32_t>(written);
-    if (remain > 0) {
-      remain -= static_cast<int>(written);
-    }
-
-    lastProgressMs = millis();
-    if (progressTick) {
-      progressTick(writtenTotal, totalSize);
-    }
-    if (backgroundTick) {
-      backgroundTick();
-    }
+  if (error) {
+    *error = "No SHA-256 published, canceled";
   }
+  return false;
+}
 
-  file.close();
-  http.end();
-
-  if (writtenTotal == 0) {
-    SD.remove(tempPath.c_str());
+// Downloads url to destPath, picking up an interrupted earlier download of
+// the same URL, and checks it against sha256 unless that is empty.
+bool downloadUrlToSdFile(const String &url,
+                         const String &sha256,
+                         const char *destPath,
+                         const std::function<void()> &backgroundTick,
+                         const fwfetch::ProgressFn &progressTick,
+                         fwfetch::Result *result,
+                         String *error) {
+  String sdErr;
+  if (!ensureSdMounted(false, &sdErr) || !ensureMarketDirectory(&sdErr)) {
     if (error) {
-      *error = "Downloaded file is empty";
+      *error = sdErr;
     }
     return false;
   }
 
-  if (SD.exists(destPath)) {
-    SD.remove(destPath);
-  }
-  if (!SD.rename(tempPath.c_str(), destPath)) {
-    SD.remove(tempPath.c_str());
-    if (error) {
-      *error = "SD rename failed";
-    }
-    return false;
-  }
+  return fwfetch::downloadToSd(url,
+                               kUserAgent,
+                               destPath,
+                               sha256,
+                               backgroundTick,
+                               progressTick,
+                               result,
+                               error);
+}
 
-  if (bytesOut) {
-    *bytesOut = writtenTotal;
-  }
-  if (progressTick) {
-    progressTick(writtenTotal, totalSize);
-  }
-  return true;
+String downloadSummary(const ReleaseInfo &info, const fwfetch::Result &result) {
+  return "Downloaded " + info.assetName + " (" + formatBytes(result.bytes) + ", " +
+         String(result.kilobytesPerSecond) + " KB/s" + (result.verified ? ", SHA-256 ok" : "") + ")";
 }
 
 bool installFirmwareFromSd(const String &path,
@@ -932,6 +604,7 @@ bool backupRunningFirmwareToSd(const char *destPath,
     SD.remove(tempPath.c_str());
   }
 
+  dirlisting::noteChanged(tempPath);
   File out = SD.open(tempPath.c_str(), FILE_WRITE);
   if (!out || out.isDirectory()) {
     if (out) {
@@ -1005,6 +678,7 @@ bool removeSdFileIfExists(const char *path, String *error) {
   if (!SD.exists(path)) {
     return true;
   }
+  dirlisting::noteChanged(path);
   if (!SD.remove(path)) {
     if (error) {
       *error = "Delete failed";
@@ -1256,6 +930,7 @@ void runAppMarketApp(AppContext &ctx,
     menu.push_back("Check Latest");
     menu.push_back("Browse Releases");
     menu.push_back("Download Latest to SD");
+    menu.push_back("Stream Latest to Flash");
     menu.push_back(String("Install Latest ") +
                    (latestExists ? "(" + formatBytes(latestSize) + ")" : "(missing)"));
     menu.push_back("Backup Running App to SD");
@@ -1283,7 +958,7 @@ void runAppMarketApp(AppContext &ctx,
                                         backgroundTick,
                                         "OK Select  BACK Exit",
                                         subtitle);
-    if (choice < 0 || choice == 13) {
+    if (choice < 0 || choice == 14) {
       return;
     }
     selected = choice;
@@ -1383,19 +1058,28 @@ void runAppMarketApp(AppContext &ctx,
         continue;
       }
 
-      uint32_t downloaded = 0;
+      String sha256;
+      if (!fetchChecksumOrConfirm(
+              ctx, info.downloadUrl, info.assetName, "Download", backgroundTick, sha256, &err)) {
+        lastAction = "Browse download failed: " + err;
+        ctx.uiRuntime->showToast("APPMarket", err, 1800, backgroundTick);
+        continue;
+      }
+
+      fwfetch::Result downloaded;
       {
         OverlayScope overlay(ctx.uiRuntime, "APPMarket", "Preparing download...", -1);
         if (!downloadUrlToSdFile(info.downloadUrl,
+                                 sha256,
                                  kLatestPackagePath,
                                  backgroundTick,
-                                 [&](uint32_t written, int total) {
+                                 [&](uint32_t written, uint32_t total) {
                                    int percent = -1;
                                    String progressText = "Downloading " + formatBytes(written);
                                    if (total > 0) {
                                      percent = static_cast<int>((static_cast<uint64_t>(written) * 100ULL) /
                                                                 static_cast<uint64_t>(total));
-                                     progressText += " / " + formatBytes(static_cast<uint32_t>(total));
+                                     progressText += " / " + formatBytes(total);
                                    }
                                    overlay.update("APPMarket", progressText, percent);
                                  },
@@ -1409,7 +1093,7 @@ void runAppMarketApp(AppContext &ctx,
 
       lastTag = info.tag;
       lastAsset = info.assetName;
-      lastAction = "Downloaded " + info.assetName + " (" + formatBytes(downloaded) + ")";
+      lastAction = downloadSummary(info, downloaded);
       ctx.uiRuntime->showToast("APPMarket", "Downloaded selected release", 1500, backgroundTick);
       continue;
     }
@@ -1423,19 +1107,28 @@ void runAppMarketApp(AppContext &ctx,
         continue;
       }
 
-      uint32_t downloaded = 0;
+      String sha256;
+      if (!fetchChecksumOrConfirm(
+              ctx, info.downloadUrl, info.assetName, "Download", backgroundTick, sha256, &err)) {
+        lastAction = "Download failed: " + err;
+        ctx.uiRuntime->showToast("APPMarket", err, 1800, backgroundTick);
+        continue;
+      }
+
+      fwfetch::Result downloaded;
       {
         OverlayScope overlay(ctx.uiRuntime, "APPMarket", "Preparing download...", -1);
         if (!downloadUrlToSdFile(info.downloadUrl,
+                                 sha256,
                                  kLatestPackagePath,
                                  backgroundTick,
-                                 [&](uint32_t written, int total) {
+                                 [&](uint32_t written, uint32_t total) {
                                    int percent = -1;
                                    String progressText = "Downloading " + formatBytes(written);
                                    if (total > 0) {
                                      percent = static_cast<int>((static_cast<uint64_t>(written) * 100ULL) /
                                                                 static_cast<uint64_t>(total));
-                                     progressText += " / " + formatBytes(static_cast<uint32_t>(total));
+                                     progressText += " / " + formatBytes(total);
                                    }
                                    overlay.update("APPMarket", progressText, percent);
                                  },
@@ -1449,12 +1142,72 @@ void runAppMarketApp(AppContext &ctx,
 
       lastTag = info.tag;
       lastAsset = info.assetName;
-      lastAction = "Downloaded " + info.assetName + " (" + formatBytes(downloaded) + ")";
+      lastAction = downloadSummary(info, downloaded);
       ctx.uiRuntime->showToast("APPMarket", "Downloaded to SD", 1500, backgroundTick);
       continue;
     }
 
     if (choice == 6) {
+      ReleaseInfo info;
+      String err;
+      if (!fetchLatestReleaseInfo(ctx.config, info, &err)) {
+        lastAction = "Stream check failed: " + err;
+        ctx.uiRuntime->showToast("APPMarket", err, 1800, backgroundTick);
+        continue;
+      }
+      lastTag = info.tag;
+      lastAsset = info.assetName;
+      if (!confirmInstall(ctx,
+                          "Stream Install",
+                          "Flash " + trimMiddle(info.assetName, 24) + " without SD?",
+                          backgroundTick)) {
+        continue;
+      }
+
+      String sha256;
+      if (!fetchChecksumOrConfirm(
+              ctx, info.downloadUrl, info.assetName, "Install", backgroundTick, sha256, &err)) {
+        lastAction = "Stream install failed: " + err;
+        ctx.uiRuntime->showToast("APPMarket", err, 1900, backgroundTick);
+        continue;
+      }
+
+      fwfetch::Result result;
+      {
+        OverlayScope overlay(ctx.uiRuntime, "APPMarket", "Flashing firmware...", 0);
+        if (!fwfetch::installFromUrl(info.downloadUrl,
+                                     kUserAgent,
+                                     sha256,
+                                     backgroundTick,
+                                     [&](uint32_t done, uint32_t total) {
+                                       int percent = -1;
+                                       String progressText = "Flashing " + formatBytes(done);
+                                       if (total > 0) {
+                                         percent = static_cast<int>((static_cast<uint64_t>(done) * 100ULL) /
+                                                                    static_cast<uint64_t>(total));
+                                         progressText += " / " + formatBytes(total);
+                                       }
+                                       overlay.update("APPMarket", progressText, percent);
+                                     },
+                                     &result,
+                                     &err)) {
+          lastAction = "Stream install failed: " + err;
+          ctx.uiRuntime->showToast("APPMarket", err, 1900, backgroundTick);
+          continue;
+        }
+      }
+
+      ctx.uiRuntime->showToast("APPMarket",
+                               result.verified ? "SHA-256 verified, rebooting"
+                                               : "Install complete, rebooting",
+                               1200,
+                               backgroundTick);
+      delay(300);
+      ESP.restart();
+      return;
+    }
+
+    if (choice == 7) {
       if (!latestExists) {
         ctx.uiRuntime->showToast("APPMarket", "Latest package not found", 1700, backgroundTick);
         continue;
@@ -1494,7 +1247,7 @@ void runAppMarketApp(AppContext &ctx,
       return;
     }
 
-    if (choice == 7) {
+    if (choice == 8) {
       String err;
       {
         OverlayScope overlay(ctx.uiRuntime, "APPMarket", "Backing up running firmware...", 0);
@@ -1524,7 +1277,7 @@ void runAppMarketApp(AppContext &ctx,
       continue;
     }
 
-    if (choice == 8) {
+    if (choice == 9) {
       uint32_t backupSize = 0;
       if (!statSdFile(kBackupPackagePath, backupSize)) {
         ctx.uiRuntime->showToast("APPMarket", "Backup package not found", 1700, backgroundTick);
@@ -1565,7 +1318,7 @@ void runAppMarketApp(AppContext &ctx,
       return;
     }
 
-    if (choice == 9) {
+    if (choice == 10) {
       String path;
       if (!selectBinFileFromSd(ctx, path, backgroundTick)) {
         continue;
@@ -1606,7 +1359,7 @@ void runAppMarketApp(AppContext &ctx,
       return;
     }
 
-    if (choice == 10) {
+    if (choice == 11) {
       String err;
       if (!ensureSdMounted(false, &err)) {
         ctx.uiRuntime->showToast("APPMarket", err, 1700, backgroundTick);
@@ -1622,7 +1375,7 @@ void runAppMarketApp(AppContext &ctx,
       continue;
     }
 
-    if (choice == 11) {
+    if (choice == 12) {
       String err;
       if (!ensureSdMounted(false, &err)) {
         ctx.uiRuntime->showToast("APPMarket", err, 1700, backgroundTick);
@@ -1638,7 +1391,7 @@ void runAppMarketApp(AppContext &ctx,
       continue;
     }
 
-    if (choice == 12) {
+    if (choice == 13) {
       saveAppMarketConfig(ctx, backgroundTick);
       if (!ctx.configDirty) {
         lastAction = "Config saved";
@@ -11,19 +11,24 @@
 #include <vector>
 
 #include "../core/board_pins.h"
+#include "../core/dir_listing.h"
+#include "../core/sd_bench.h"
 #include "../core/shared_spi_bus.h"
+#include "../core/text_pager.h"
+#include "../core/voice_codec.h"
+#include "../ui/image_cache.h"
 #include "../ui/ui_runtime.h"
 
 namespace {
 
 struct FsEntry {
   String fullPath;
-  String label;
   bool isDirectory = false;
   uint64_t size = 0;
 };
 
 bool gSdMounted = false;
+constexpr const char *kAdpcmPlaybackPath = "/.zxos-play.wav";
 
 String formatBytes(uint64_t bytes) {
   static const char *kUnits[] = {"B", "KB", "MB", "GB"};
@@ -121,6 +126,8 @@ bool ensureSdMounted(bool forceMount, String *error) {
   pinMode(boardpins::kSdCs, OUTPUT);
   digitalWrite(boardpins::kSdCs, HIGH);
 
+  // Listings of a previous mount may describe another card.
+  dirlisting::clear();
   SPIClass *spiBus = sharedspi::bus();
   const bool mounted = SD.begin(boardpins::kSdCs,
                                 *spiBus,
@@ -143,72 +150,8 @@ bool ensureSdMounted(bool forceMount, String *error) {
 #endif
 }
 
-bool listDirectory(const String &path,
-                   std::vector<FsEntry> &outEntries,
-                   String *error) {
-  outEntries.clear();
-
-  File dir = SD.open(path.c_str(), FILE_READ);
-  if (!dir || !dir.isDirectory()) {
-    if (error) {
-      *error = "Directory open failed";
-    }
-    if (dir) {
-      dir.close();
-    }
-    return false;
-  }
-
-  File entry = dir.openNextFile();
-  while (entry) {
-    const String rawName = String(entry.name());
-    if (!rawName.isEmpty()) {
-      FsEntry item;
-      item.fullPath = buildChildPath(path, rawName);
-      item.isDirectory = entry.isDirectory();
-      item.size = entry.size();
-
-      item.label = item.isDirectory ? "[D] " : "[F] ";
-      item.label += baseName(item.fullPath);
-      if (!item.isDirectory) {
-        item.label += " (" + formatBytes(item.size) + ")";
-      }
-
-      outEntries.push_back(item);
-    }
-
-    entry.close();
-    entry = dir.openNextFile();
-  }
-  dir.close();
-
-  std::sort(outEntries.begin(),
-            outEntries.end(),
-            [](const FsEntry &a, const FsEntry &b) {
-              if (a.isDirectory != b.isDirectory) {
-                return a.isDirectory;
-              }
-              String lhs = a.fullPath;
-              String rhs = b.fullPath;
-              lhs.toLowerCase();
-              rhs.toLowerCase();
-              return lhs < rhs;
-            });
-
-  return true;
-}
-
-void showSdInfo(AppContext &ctx,
-                const std::function<void()> &backgroundTick) {
-  String err;
-  if (!ensureSdMounted(false, &err)) {
-    ctx.uiRuntime->showToast("SD Card",
-                      err.isEmpty() ? String("Mount failed") : err,
-                      1800,
-                      backgroundTick);
-    return;
-  }
-
+void showSdDetails(AppContext &ctx,
+                   const std::function<void()> &backgroundTick) {
   const uint8_t type = SD.cardType();
   const uint64_t cardSize = SD.cardSize();
   const uint64_t totalBytes = SD.totalBytes();
@@ -226,19 +169,156 @@ void showSdInfo(AppContext &ctx,
   ctx.uiRuntime->showInfo("SD Card Info", lines, backgroundTick, "OK/BACK Exit");
 }
 
-String sanitizeTextLine(const String &input) {
-  String out;
-  out.reserve(input.length());
+String formatLatencyUs(uint32_t us) {
+  if (us >= 10000U) {
+    return String(us / 1000U) + " ms";
+  }
+  return String(static_cast<float>(us) / 1000.0f, 1) + " ms";
+}
 
-  for (size_t i = 0; i < input.length(); ++i) {
-    const char c = input[static_cast<unsigned int>(i)];
-    if ((c >= 32 && c <= 126) || c == '\t') {
-      out += c;
-    } else {
-      out += '.';
+std::vector<String> benchmarkLines(const sdbench::Report &report) {
+  std::vector<String> lines;
+  String verdict = report.verdict;
+  verdict.toUpperCase();
+  lines.push_back("Result: " + verdict);
+  if (!report.reason.isEmpty()) {
+    lines.push_back(report.reason);
+  }
+
+  const sdbench::CardId &cid = report.cid;
+  if (cid.valid) {
+    char line[48];
+    snprintf(line,
+             sizeof(line),
+             "%s %s rev %u.%u  MID %02X",
+             cid.oemId,
+             cid.productName,
+             cid.revisionMajor,
+             cid.revisionMinor,
+             cid.manufacturerId);
+    lines.push_back(line);
+    snprintf(line, sizeof(line), "SN %08lX  made %04u-%02u",
+             static_cast<unsigned long>(cid.serial), cid.year, cid.month);
+    lines.push_back(line);
+  } else {
+    lines.push_back("CID: not available");
+  }
+  lines.push_back(cardTypeName(report.cardType) + " " + formatBytes(report.cardBytes) +
+                  ", test file " + formatBytes(report.fileBytes));
+
+  for (size_t i = 0; i < report.clockCount; ++i) {
+    const sdbench::ClockResult &result = report.clocks[i];
+    lines.push_back("-- " + String(result.clockHz / 1000000U) + " MHz --");
+    if (!result.mounted) {
+      lines.push_back(result.error);
+      continue;
+    }
+    for (const sdbench::BlockResult &block : result.blocks) {
+      if (block.blockBytes == 0U || block.writeKBps == 0U) {
+        continue;
+      }
+      const String size = block.blockBytes >= 1024U ? String(block.blockBytes / 1024U) + "K"
+                                                    : String(block.blockBytes);
+      lines.push_back("Seq " + size + ": W " + String(block.writeKBps) + " R " +
+                      String(block.readKBps) + " KB/s");
+    }
+    if (result.complete) {
+      lines.push_back("Rand 4K read: " + String(result.randomReadIops) + " IOPS, p99 " +
+                      formatLatencyUs(result.randomRead.p99Us));
+      lines.push_back("4K write p50/p99: " + formatLatencyUs(result.write4k.p50Us) + " / " +
+                      formatLatencyUs(result.write4k.p99Us));
+    }
+    lines.push_back("Worst write stall: " + formatLatencyUs(result.worstWriteStallUs));
+    if (result.verifyErrors > 0U) {
+      lines.push_back("Bad blocks read back: " + String(result.verifyErrors));
+    }
+    if (!result.error.isEmpty()) {
+      lines.push_back(result.error);
+    }
+  }
+  if (report.saved) {
+    lines.push_back(String("Saved to ") + sdbench::kResultsPath);
+  }
+  return lines;
+}
+
+void runSdBenchmark(AppContext &ctx,
+                    const std::function<void()> &backgroundTick) {
+  if (!ctx.uiRuntime->confirm("SD Benchmark",
+                              "Tests every SPI clock, ~1 min",
+                              backgroundTick,
+                              "Run",
+                              "Cancel")) {
+    return;
+  }
+
+  ctx.uiRuntime->showProgressOverlay("SD Benchmark", "Starting", 0);
+  ctx.uiRuntime->tick();
+  sdbench::Report report;
+  String err;
+  const bool ran = sdbench::run(
+      sdbench::Options(),
+      &report,
+      [&](const String &stage, uint8_t percent) {
+        ctx.uiRuntime->showProgressOverlay("SD Benchmark", stage, percent);
+        if (backgroundTick) {
+          backgroundTick();
+        }
+        ctx.uiRuntime->tick();
+        return !ctx.uiRuntime->pollInput().back;
+      },
+      &err);
+  ctx.uiRuntime->hideProgressOverlay();
+  ctx.uiRuntime->resetInputState();
+  // The card was remounted (or failed to come back); mount it again on the
+  // next access instead of trusting the old state.
+  gSdMounted = false;
+
+  if (!ran) {
+    ctx.uiRuntime->showToast("SD Benchmark",
+                             err.isEmpty() ? String("Benchmark failed") : err,
+                             1800,
+                             backgroundTick);
+    return;
+  }
+  ctx.uiRuntime->showInfo("SD Benchmark", benchmarkLines(report), backgroundTick, "OK/BACK Exit");
+}
+
+void showSdInfo(AppContext &ctx,
+                const std::function<void()> &backgroundTick) {
+  int selected = 0;
+  while (true) {
+    String err;
+    if (!ensureSdMounted(false, &err)) {
+      ctx.uiRuntime->showToast("SD Card",
+                        err.isEmpty() ? String("Mount failed") : err,
+                        1800,
+                        backgroundTick);
+      return;
+    }
+
+    std::vector<String> menu;
+    menu.push_back("Card Details");
+    menu.push_back("Run Benchmark");
+    menu.push_back("Back");
+    const String subtitle = cardTypeName(SD.cardType()) + " " + formatBytes(SD.cardSize());
+    const int choice = ctx.uiRuntime->menuLoop("SD Card Info",
+                                        menu,
+                                        selected,
+                                        backgroundTick,
+                                        "OK Select  BACK Exit",
+                                        subtitle);
+    if (choice < 0 || choice == 2) {
+      return;
+    }
+    selected = choice;
+
+    if (choice == 0) {
+      showSdDetails(ctx, backgroundTick);
+    } else if (choice == 1) {
+      runSdBenchmark(ctx, backgroundTick);
     }
   }
-  return out;
 }
 
 bool isImageFilePath(const String &path) {
@@ -302,63 +382,282 @@ void showFileInfo(AppContext &ctx,
   ctx.uiRuntime->showInfo("File Info", lines, backgroundTick, "OK/BACK Exit");
 }
 
-void previewTextFile(AppContext &ctx,
-                     const FsEntry &entry,
-                     const std::function<void()> &backgroundTick) {
-  File file = SD.open(entry.fullPath.c_str(), FILE_READ);
-  if (!file || file.isDirectory()) {
-    if (file) {
-      file.close();
-    }
-    ctx.uiRuntime->showToast("Preview", "File open failed", 1500, backgroundTick);
+void viewTextFile(AppContext &ctx,
+                  const FsEntry &entry,
+                  const std::function<void()> &backgroundTick) {
+  TextPager pager;
+  String openErr;
+  if (!pager.open(entry.fullPath, &openErr)) {
+    ctx.uiRuntime->showToast("Text", openErr, 1500, backgroundTick);
     return;
   }
 
-  std::vector<String> lines;
-  lines.push_back(trimMiddle(entry.fullPath, 30));
-  lines.push_back("Size: " + formatBytes(entry.size));
-  lines.push_back("----------------");
+  lv_display_t *display = lv_display_get_default();
+  const int screenW = display ? lv_display_get_horizontal_resolution(display) : 320;
+  const int screenH = display ? lv_display_get_vertical_resolution(display) : 170;
+  const int lineHeight = std::max<int>(1, lv_font_get_line_height(LV_FONT_DEFAULT));
+  const size_t visibleLines =
+      static_cast<size_t>(std::max(1, (screenH - 56) / lineHeight));
+  // Average glyph width of the proportional UI font is about 7 px.
+  const size_t maxChars = static_cast<size_t>(std::max(8, (screenW - 8) / 7));
+  const String fileName = trimMiddle(baseName(entry.fullPath), 34);
+
+  lv_obj_t *statusLabel = nullptr;
+  lv_obj_t *bodyLabel = nullptr;
+  // Menus and dialogs replace the screen, so it is rebuilt after each one.
+  const auto buildScreen = [&]() {
+    lv_obj_t *screen = lv_screen_active();
+    lv_obj_clean(screen);
+    lv_obj_set_style_bg_color(screen, lv_color_hex(0x000000), 0);
+    lv_obj_set_style_bg_opa(screen, LV_OPA_COVER, 0);
+
+    lv_obj_t *nameLabel = lv_label_create(screen);
+    lv_label_set_text(nameLabel, fileName.c_str());
+    lv_obj_set_style_text_color(nameLabel, lv_color_white(), 0);
+    lv_obj_align(nameLabel, LV_ALIGN_TOP_MID, 0, 2);
+
+    statusLabel = lv_label_create(screen);
+    lv_obj_set_style_text_color(statusLabel, lv_color_hex(0xB0B0B0), 0);
+    lv_obj_align(statusLabel, LV_ALIGN_TOP_MID, 0, 18);
+
+    bodyLabel = lv_label_create(screen);
+    lv_obj_set_width(bodyLabel, screenW - 8);
+    lv_label_set_long_mode(bodyLabel, LV_LABEL_LONG_CLIP);
+    lv_obj_set_style_text_color(bodyLabel, lv_color_hex(0xE0E0E0), 0);
+    lv_obj_set_pos(bodyLabel, 4, 36);
+
+    lv_obj_t *hintLabel = lv_label_create(screen);
+    lv_label_set_text(hintLabel, "Rotate Scroll  OK Menu  BACK Exit");
+    lv_obj_set_style_text_color(hintLabel, lv_color_hex(0x9A9A9A), 0);
+    lv_obj_align(hintLabel, LV_ALIGN_BOTTOM_MID, 0, -2);
+  };
+
+  // Long scans (jumping far ahead, searching) show progress after a moment
+  // and can be cancelled with BACK.
+  bool overlayShown = false;
+  bool scanCancelled = false;
+  const auto longScan = [&](const char *title, const char *message) {
+    const unsigned long startedMs = millis();
+    overlayShown = false;
+    scanCancelled = false;
+    return TextPager::ProgressFn([&, title, message, startedMs](uint8_t percent) {
+      if (!overlayShown && millis() - startedMs < 300UL) {
+        return true;
+      }
+      overlayShown = true;
+      ctx.uiRuntime->showProgressOverlay(title, message, percent);
+      if (backgroundTick) {
+        backgroundTick();
+      }
+      ctx.uiRuntime->tick();
+      scanCancelled = ctx.uiRuntime->pollInput().back;
+      return !scanCancelled;
+    });
+  };
+  const auto endScan = [&]() {
+    if (overlayShown) {
+      ctx.uiRuntime->hideProgressOverlay();
+      overlayShown = false;
+    }
+  };
+
+  uint32_t top = 0;
+  uint32_t shownTop = 0;
+  std::vector<String> window;
+  const auto updateStatus = [&]() {
+    String status = "Line " + String(static_cast<unsigned long>(top + 1U)) + " / " +
+                    String(static_cast<unsigned long>(pager.lineCount()));
+    if (!pager.indexComplete()) {
+      status += "+  indexing " + String(pager.indexedPercent()) + "%";
+    }
+    status += "  " + formatBytes(pager.fileSize());
+    lv_label_set_text(statusLabel, status.c_str());
+  };
+  const auto render = [&]() {
+    bool ok = pager.readLines(top, visibleLines, maxChars, window,
+                              longScan("Text", "Indexing..."));
+    endScan();
+    if (!ok && scanCancelled) {
+      top = shownTop;
+      ok = pager.readLines(top, visibleLines, maxChars, window);
+    }
+    // Past the end: settle on the last full page.
+    if (ok && window.size() < visibleLines && top > 0U && pager.indexComplete()) {
+      const uint32_t lines = pager.lineCount();
+      top = lines > visibleLines ? lines - static_cast<uint32_t>(visibleLines) : 0U;
+      ok = pager.readLines(top, visibleLines, maxChars, window);
+    }
+    String body;
+    if (!ok) {
+      body = "(read error)";
+    } else if (window.empty()) {
+      body = "(empty file)";
+    }
+    for (size_t i = 0; i < window.size(); ++i) {
+      if (i > 0) {
+        body += '\n';
+      }
+      body += window[i];
+    }
+    lv_label_set_text(bodyLabel, body.c_str());
+    shownTop = top;
+    updateStatus();
+  };
+
+  String needle;
+  const auto search = [&](uint32_t fromLine) {
+    uint32_t found = 0;
+    const bool hit = pager.find(needle, fromLine, &found, longScan("Search", "Searching..."));
+    endScan();
+    if (hit) {
+      top = found;
+    } else if (!scanCancelled) {
+      ctx.uiRuntime->showToast("Search", "No more matches", 1200, backgroundTick);
+    }
+  };
 
-  constexpr int kMaxPreviewLines = 20;
-  int shown = 0;
+  // Indexing continues a block at a time while the viewer is idle, so the
+  // line count and jump targets are known without one long pause.
+  constexpr unsigned long kStatusRefreshMs = 500UL;
+  unsigned long lastStatusMs = 0;
 
-  while (file.available() && shown < kMaxPreviewLines) {
-    String line = file.readStringUntil('\n');
-    line.replace("\r", "");
-    line = sanitizeTextLine(line);
-    if (line.length() > 44) {
-      line = line.substring(0, 41) + "...";
+  buildScreen();
+  render();
+  ctx.uiRuntime->resetInputState();
+  while (true) {
+    ctx.uiRuntime->tick();
+    const UiEvent ev = ctx.uiRuntime->pollInput();
+    // A long OK also reports back, so find-next is checked first.
+    if (ev.okLong && !needle.isEmpty()) {
+      search(top + 1U);
+      buildScreen();
+      render();
+    } else if (ev.back) {
+      break;
+    } else if (ev.delta != 0) {
+      const int64_t next = static_cast<int64_t>(top) + ev.delta;
+      top = next < 0 ? 0U : static_cast<uint32_t>(next);
+      render();
+    } else if (ev.ok) {
+      std::vector<String> items = {"Jump to %", "Search", "Find Next", "Top", "End", "Back"};
+      const int choice = ctx.uiRuntime->menuLoop("Text",
+                                                 items,
+                                                 0,
+                                                 backgroundTick,
+                                                 "OK Select  BACK Exit",
+                                                 fileName);
+      if (choice == 0) {
+        int percent = pager.fileSize() > 0U
+                          ? static_cast<int>((static_cast<uint64_t>(top) * 100ULL) /
+                                             std::max<uint32_t>(1U, pager.lineCount()))
+                          : 0;
+        percent = std::min(100, percent);
+        if (ctx.uiRuntime->numberWheelInput("Jump to", 0, 100, 5, percent, backgroundTick, "%")) {
+          uint32_t line = top;
+          if (pager.lineAtPercent(static_cast<uint8_t>(percent), &line,
+                                  longScan("Text", "Indexing..."))) {
+            top = line;
+          }
+          endScan();
+        }
+      } else if (choice == 1) {
+        if (ctx.uiRuntime->textInput("Search", needle, false, backgroundTick)) {
+          needle.trim();
+          if (!needle.isEmpty()) {
+            search(top);
+          }
+        }
+      } else if (choice == 2) {
+        if (needle.isEmpty()) {
+          ctx.uiRuntime->showToast("Search", "Nothing to find", 1000, backgroundTick);
+        } else {
+          search(top + 1U);
+        }
+      } else if (choice == 3) {
+        top = 0;
+      } else if (choice == 4) {
+        uint32_t line = top;
+        if (pager.lineAtPercent(100, &line, longScan("Text", "Indexing..."))) {
+          top = line;
+        }
+        endScan();
+      }
+      buildScreen();
+      render();
+      ctx.uiRuntime->resetInputState();
+    } else if (!pager.indexComplete()) {
+      pager.indexStep(TextPager::kBlockBytes);
+      if (millis() - lastStatusMs >= kStatusRefreshMs) {
+        lastStatusMs = millis();
+        updateStatus();
+      }
     }
-    if (line.isEmpty()) {
-      line = " ";
+    if (backgroundTick) {
+      backgroundTick();
     }
-    lines.push_back(line);
-    ++shown;
+    delay(4);
   }
+  ctx.uiRuntime->resetInputState();
+}
 
-  if (shown == 0) {
-    lines.push_back("(empty file)");
-  } else if (file.available()) {
-    lines.push_back("... (truncated)");
+// Scale (256 = 1:1) that fits w x h into the viewport, never enlarging.
+uint32_t fitScale(uint32_t w, uint32_t h, int viewportW, int viewportH) {
+  if (w == 0U || h == 0U) {
+    return 256U;
   }
-
-  file.close();
-
-  ctx.uiRuntime->showInfo("File Preview", lines, backgroundTick, "OK/BACK Exit");
+  const uint32_t zx = static_cast<uint32_t>(
+      (static_cast<uint64_t>(viewportW) * 256ULL) / static_cast<uint64_t>(w));
+  const uint32_t zy = static_cast<uint32_t>(
+      (static_cast<uint64_t>(viewportH) * 256ULL) / static_cast<uint64_t>(h));
+  return std::max(8U, std::min(256U, std::min(zx, zy)));
 }
 
 void viewImageFile(AppContext &ctx,
                    const FsEntry &entry,
                    const std::function<void()> &backgroundTick) {
-  const String lvPath = toLvglSdPath(entry.fullPath);
+  lv_display_t *display = lv_display_get_default();
+  const int screenW = display ? lv_display_get_horizontal_resolution(display) : 320;
+  const int screenH = display ? lv_display_get_vertical_resolution(display) : 170;
+  const int viewportW = std::max(1, screenW - 8);
+  const int viewportH = std::max(1, screenH - 52);
 
-  lv_image_header_t header;
-  if (lv_image_decoder_get_info(lvPath.c_str(), &header) != LV_RESULT_OK) {
-    ctx.uiRuntime->showToast("Image",
-                             "Unsupported image format",
-                             1700,
-                             backgroundTick);
-    return;
+  // Decoded once at close to screen size and cached; formats the cache cannot
+  // decode (BMP) are still drawn straight from SD by LVGL.
+  imagecache::DecodeInfo info;
+  String decodeErr;
+  const lv_image_dsc_t *decoded = imagecache::load(entry.fullPath,
+                                                   static_cast<uint16_t>(viewportW),
+                                                   static_cast<uint16_t>(viewportH),
+                                                   &info,
+                                                   &decodeErr);
+  const String lvPath = toLvglSdPath(entry.fullPath);
+  uint32_t imageW = 0;
+  uint32_t imageH = 0;
+  String meta;
+  if (decoded) {
+    imageW = decoded->header.w;
+    imageH = decoded->header.h;
+    meta = String(static_cast<unsigned long>(info.sourceW)) + "x" +
+           String(static_cast<unsigned long>(info.sourceH));
+    if (info.reduction > 1U) {
+      meta += " 1/" + String(info.reduction);
+    }
+    meta += info.cacheHit ? String("  cached")
+                          : "  " + String(static_cast<unsigned long>(info.openMs)) + " ms";
+  } else {
+    lv_image_header_t header;
+    if (lv_image_decoder_get_info(lvPath.c_str(), &header) != LV_RESULT_OK) {
+      ctx.uiRuntime->showToast("Image",
+                               decodeErr.isEmpty() ? String("Unsupported image format")
+                                                   : decodeErr,
+                               1700,
+                               backgroundTick);
+      return;
+    }
+    imageW = header.w;
+    imageH = header.h;
+    meta = String(static_cast<unsigned long>(imageW)) + "x" +
+           String(static_cast<unsigned long>(imageH));
   }
 
   lv_obj_t *screen = lv_screen_active();
@@ -378,50 +677,71 @@ void viewImageFile(AppContext &ctx,
   lv_obj_align(nameLabel, LV_ALIGN_TOP_MID, 0, 2);
 
   lv_obj_t *metaLabel = lv_label_create(screen);
-  const String meta = String(static_cast<unsigned long>(header.w)) + "x" +
-                      String(static_cast<unsigned long>(header.h));
   lv_label_set_text(metaLabel, meta.c_str());
   lv_obj_set_style_text_color(metaLabel, lv_color_hex(0xB0B0B0), 0);
   lv_obj_align(metaLabel, LV_ALIGN_TOP_MID, 0, 18);
 
   lv_obj_t *hintLabel = lv_label_create(screen);
-  lv_label_set_text(hintLabel, "OK/BACK Exit");
+  lv_label_set_text(hintLabel, decoded ? "OK Fit/1:1  Rotate Pan  BACK Exit" : "OK/BACK Exit");
   lv_obj_set_style_text_color(hintLabel, lv_color_hex(0x9A9A9A), 0);
   lv_obj_align(hintLabel, LV_ALIGN_BOTTOM_MID, 0, -2);
 
-  lv_obj_t *image = lv_image_create(screen);
-  lv_image_set_src(image, lvPath.c_str());
+  // The viewport clips the 1:1 image; panning only moves it, so the cached
+  // pixels are redrawn without decoding again.
+  lv_obj_t *viewport = lv_obj_create(screen);
+  lv_obj_remove_style_all(viewport);
+  lv_obj_set_size(viewport, viewportW, viewportH);
+  lv_obj_remove_flag(viewport, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_align(viewport, LV_ALIGN_CENTER, 0, 8);
+
+  lv_obj_t *image = lv_image_create(viewport);
+  if (decoded) {
+    lv_image_set_src(image, decoded);
+  } else {
+    lv_image_set_src(image, lvPath.c_str());
+  }
   lv_image_set_inner_align(image, LV_IMAGE_ALIGN_CENTER);
 
-  lv_display_t *display = lv_display_get_default();
-  const int screenW = display ? lv_display_get_horizontal_resolution(display) : 320;
-  const int screenH = display ? lv_display_get_vertical_resolution(display) : 170;
-  const int viewportW = std::max(1, screenW - 8);
-  const int viewportH = std::max(1, screenH - 52);
-
-  uint32_t zoom = 256U;
-  if (header.w > 0U && header.h > 0U) {
-    const uint32_t zx = static_cast<uint32_t>(
-        (static_cast<uint64_t>(viewportW) * 256ULL) / static_cast<uint64_t>(header.w));
-    const uint32_t zy = static_cast<uint32_t>(
-        (static_cast<uint64_t>(viewportH) * 256ULL) / static_cast<uint64_t>(header.h));
-    zoom = std::min(zx, zy);
-    if (zoom > 256U) {
-      zoom = 256U;
-    }
-    if (zoom < 8U) {
-      zoom = 8U;
+  constexpr int kPanStepPx = 24;
+  const int maxPanX = std::max(0, static_cast<int>(imageW) - viewportW);
+  const int maxPanY = std::max(0, static_cast<int>(imageH) - viewportH);
+  bool fit = true;
+  bool panVertical = maxPanY > maxPanX;
+  int panX = maxPanX / 2;
+  int panY = maxPanY / 2;
+  const auto layout = [&]() {
+    if (fit) {
+      lv_image_set_scale(image, fitScale(imageW, imageH, viewportW, viewportH));
+      lv_obj_align(image, LV_ALIGN_CENTER, 0, 0);
+      return;
     }
-  }
-  lv_image_set_scale(image, zoom);
-  lv_obj_align(image, LV_ALIGN_CENTER, 0, 8);
+    lv_image_set_scale(image, 256U);
+    lv_obj_set_pos(image,
+                   maxPanX > 0 ? -panX : (viewportW - static_cast<int>(imageW)) / 2,
+                   maxPanY > 0 ? -panY : (viewportH - static_cast<int>(imageH)) / 2);
+  };
+  layout();
 
   ctx.uiRuntime->resetInputState();
   while (true) {
     ctx.uiRuntime->tick();
     const UiEvent ev = ctx.uiRuntime->pollInput();
-    if (ev.back || ev.ok || ev.okLong) {
+    // A long OK also reports back, so the pan-axis toggle is checked first.
+    if (decoded && ev.okLong && maxPanX > 0 && maxPanY > 0) {
+      panVertical = !panVertical;
+    } else if (ev.back || (!decoded && (ev.ok || ev.okLong))) {
       break;
+    } else if (ev.ok) {
+      fit = !fit;
+      layout();
+    } else if (ev.delta != 0 && !fit) {
+      // Long OK switches the axis when the image overflows both ways.
+      if (maxPanX == 0 || (panVertical && maxPanY > 0)) {
+        panY = std::max(0, std::min(maxPanY, panY + ev.delta * kPanStepPx));
+      } else {
+        panX = std::max(0, std::min(maxPanX, panX + ev.delta * kPanStepPx));
+      }
+      layout();
     }
     if (backgroundTick) {
       backgroundTick();
@@ -429,6 +749,12 @@ void viewImageFile(AppContext &ctx,
     delay(4);
   }
   ctx.uiRuntime->resetInputState();
+
+  // Without PSRAM the decoded image is internal RAM the rest of the UI needs.
+  lv_obj_delete(viewport);
+  if (!imagecache::persistent()) {
+    imagecache::clear();
+  }
 }
 
 void playAudioFile(AppContext &ctx,
@@ -442,13 +768,36 @@ void playAudioFile(AppContext &ctx,
                            backgroundTick);
   return;
 #else
+  // The I2S player only understands PCM WAV, so expand IMA-ADPCM voice notes
+  // into a scratch file first.
+  String playPath = entry.fullPath;
+  const bool decodedAdpcm = isImaAdpcmWavFile(entry.fullPath);
+  if (decodedAdpcm) {
+    String decodeErr;
+    if (!decodeImaAdpcmWavToPcm(entry.fullPath, kAdpcmPlaybackPath, backgroundTick, &decodeErr)) {
+      ctx.uiRuntime->showToast("Audio",
+                               decodeErr.isEmpty() ? String("ADPCM decode failed") : decodeErr,
+                               1700,
+                               backgroundTick);
+      return;
+    }
+    playPath = kAdpcmPlaybackPath;
+  }
+  const auto removeScratch = [decodedAdpcm]() {
+    if (decodedAdpcm) {
+      SD.remove(kAdpcmPlaybackPath);
+      dirlisting::noteChanged(kAdpcmPlaybackPath);
+    }
+  };
+
   Audio audio;
   audio.setPinout(USER_AUDIO_I2S_BCLK_PIN,
                   USER_AUDIO_I2S_LRCLK_PIN,
                   USER_AUDIO_I2S_DOUT_PIN);
   audio.setVolume(std::max(0, std::min(21, USER_AUDIO_PLAYBACK_VOLUME)));
 
-  if (!audio.connecttoFS(SD, entry.fullPath.c_str())) {
+  if (!audio.connecttoFS(SD, playPath.c_str())) {
+    removeScratch();
     ctx.uiRuntime->showToast("Audio", "Playback start failed", 1700, backgroundTick);
     return;
   }
@@ -456,6 +805,7 @@ void playAudioFile(AppContext &ctx,
   lv_obj_t *screen = lv_screen_active();
   if (!screen) {
     audio.stopSong();
+    removeScratch();
     ctx.uiRuntime->showToast("Audio", "Display not ready", 1400, backgroundTick);
     return;
   }
@@ -530,6 +880,7 @@ void playAudioFile(AppContext &ctx,
 
   const bool endedNaturally = !exitRequested && !audio.isRunning();
   audio.stopSong();
+  removeScratch();
   ctx.uiRuntime->resetInputState();
 
   if (endedNaturally) {
@@ -550,7 +901,7 @@ void runFileMenu(AppContext &ctx,
     int actionInfo = -1;
     int actionViewImage = -1;
     int actionPlayAudio = -1;
-    int actionPreviewText = -1;
+    int actionViewText = -1;
     int actionBack = -1;
 
     std::vector<String> menu;
@@ -566,8 +917,8 @@ void runFileMenu(AppContext &ctx,
       menu.push_back("Play Audio");
     }
 
-    actionPreviewText = static_cast<int>(menu.size());
-    menu.push_back("Preview Text");
+    actionViewText = static_cast<int>(menu.size());
+    menu.push_back("View Text");
 
     actionBack = static_cast<int>(menu.size());
     menu.push_back("Back");
@@ -590,8 +941,8 @@ void runFileMenu(AppContext &ctx,
       viewImageFile(ctx, entry, backgroundTick);
     } else if (choice == actionPlayAudio) {
       playAudioFile(ctx, entry, backgroundTick);
-    } else if (choice == actionPreviewText) {
-      previewTextFile(ctx, entry, backgroundTick);
+    } else if (choice == actionViewText) {
+      viewTextFile(ctx, entry, backgroundTick);
     }
   }
 }
@@ -608,6 +959,7 @@ bool deletePathRecursive(const String &path,
   }
 
   const bool isDir = node.isDirectory();
+  dirlisting::noteChanged(path);
   if (!isDir) {
     node.close();
     if (!SD.remove(path.c_str())) {
@@ -667,19 +1019,13 @@ bool quickFormatSd(const std::function<void()> &backgroundTick,
     return false;
   }
 
-  std::vector<FsEntry> rootEntries;
-  if (!listDirectory("/", rootEntries, error)) {
+  // Deleting "/" removes everything below it and keeps the root itself.
+  const bool deleted = deletePathRecursive("/", backgroundTick, error);
+  dirlisting::clear();
+  if (!deleted) {
     return false;
   }
 
-  for (std::vector<FsEntry>::const_iterator it = rootEntries.begin();
-       it != rootEntries.end();
-       ++it) {
-    if (!deletePathRecursive(it->fullPath, backgroundTick, error)) {
-      return false;
-    }
-  }
-
   if (backgroundTick) {
     backgroundTick();
   }
@@ -724,6 +1070,116 @@ void formatSdCard(AppContext &ctx,
   ctx.uiRuntime->showToast("SD Format", "Quick format completed", 1600, backgroundTick);
 }
 
+enum class BrowseRow : uint8_t {
+  Up,
+  Entry,
+  Status,
+  Refresh,
+  Back,
+};
+
+// Browse list rows: ".. (Up)" below the root, the entries, a status row while
+// the directory is loading (or was cut short), then Refresh and Back.
+size_t browseRowCount(const dirlisting::Listing &listing, bool hasUp) {
+  const bool status = !listing.complete() || listing.truncated();
+  return (hasUp ? 1U : 0U) + listing.size() + (status ? 1U : 0U) + 2U;
+}
+
+BrowseRow browseRowAt(const dirlisting::Listing &listing,
+                      bool hasUp,
+                      size_t row,
+                      size_t *entryIndex) {
+  if (hasUp) {
+    if (row == 0) {
+      return BrowseRow::Up;
+    }
+    --row;
+  }
+  if (row < listing.size()) {
+    *entryIndex = row;
+    return BrowseRow::Entry;
+  }
+  row -= listing.size();
+  if (!listing.complete() || listing.truncated()) {
+    if (row == 0) {
+      return BrowseRow::Status;
+    }
+    --row;
+  }
+  return row == 0 ? BrowseRow::Refresh : BrowseRow::Back;
+}
+
+// Selection keys for the browse list: entries use their record handle, the
+// fixed rows take values no handle reaches.
+constexpr uint32_t kBrowseKeyUp = 0xFFFFFFF0UL;
+constexpr uint32_t kBrowseKeyStatus = 0xFFFFFFF1UL;
+constexpr uint32_t kBrowseKeyRefresh = 0xFFFFFFF2UL;
+constexpr uint32_t kBrowseKeyBack = 0xFFFFFFF3UL;
+
+uint32_t browseRowKey(const dirlisting::Listing &listing, bool hasUp, size_t row) {
+  size_t index = 0;
+  switch (browseRowAt(listing, hasUp, row, &index)) {
+    case BrowseRow::Up:
+      return kBrowseKeyUp;
+    case BrowseRow::Entry:
+      return listing.handle(index);
+    case BrowseRow::Status:
+      return kBrowseKeyStatus;
+    case BrowseRow::Refresh:
+      return kBrowseKeyRefresh;
+    case BrowseRow::Back:
+    default:
+      return kBrowseKeyBack;
+  }
+}
+
+int findBrowseRow(const dirlisting::Listing &listing, bool hasUp, uint32_t key) {
+  const size_t count = browseRowCount(listing, hasUp);
+  switch (key) {
+    case kBrowseKeyUp:
+      return hasUp ? 0 : -1;
+    case kBrowseKeyStatus:
+      if (listing.complete() && !listing.truncated()) {
+        return -1;
+      }
+      return static_cast<int>(count) - 3;
+    case kBrowseKeyRefresh:
+      return static_cast<int>(count) - 2;
+    case kBrowseKeyBack:
+      return static_cast<int>(count) - 1;
+    default:
+      break;
+  }
+  size_t index = 0;
+  if (!listing.find(key, &index)) {
+    return -1;
+  }
+  return static_cast<int>(index + (hasUp ? 1U : 0U));
+}
+
+String browseRowLabel(const dirlisting::Listing &listing, bool hasUp, size_t row) {
+  size_t index = 0;
+  switch (browseRowAt(listing, hasUp, row, &index)) {
+    case BrowseRow::Up:
+      return ".. (Up)";
+    case BrowseRow::Entry:
+      if (listing.isDirectory(index)) {
+        return "[D] " + listing.name(index);
+      }
+      return "[F] " + listing.name(index) + " (" + formatBytes(listing.fileSize(index)) + ")";
+    case BrowseRow::Status:
+      if (listing.complete()) {
+        return "(list truncated at " + String(static_cast<unsigned long>(listing.size())) + ")";
+      }
+      return "Loading... " + String(static_cast<unsigned long>(listing.size()));
+    case BrowseRow::Refresh:
+      return "Refresh";
+    case BrowseRow::Back:
+    default:
+      return "Back";
+  }
+}
+
 void browseSd(AppContext &ctx,
               const std::function<void()> &backgroundTick) {
   String err;
@@ -735,12 +1191,16 @@ void browseSd(AppContext &ctx,
     return;
   }
 
+  // Directory reading per menu pass while a listing loads; the rest of the
+  // pass keeps input and drawing responsive.
+  constexpr uint32_t kListStepMs = 15;
+
   String currentPath = "/";
   int selected = 0;
 
   while (true) {
-    std::vector<FsEntry> entries;
-    if (!listDirectory(currentPath, entries, &err)) {
+    dirlisting::Listing *listing = dirlisting::open(currentPath, &err);
+    if (!listing) {
       ctx.uiRuntime->showToast("Explorer",
                         err.isEmpty() ? String("Read failed") : err,
                         1700,
@@ -748,23 +1208,17 @@ void browseSd(AppContext &ctx,
       return;
     }
 
-    std::vector<String> menu;
-    if (currentPath != "/") {
-      menu.push_back(".. (Up)");
-    }
-
-    for (std::vector<FsEntry>::const_iterator it = entries.begin();
-         it != entries.end();
-         ++it) {
-      menu.push_back(it->label);
-    }
-
-    menu.push_back("Refresh");
-    menu.push_back("Back");
+    const bool hasUp = currentPath != "/";
+    UiListSource source;
+    source.count = [&]() { return browseRowCount(*listing, hasUp); };
+    source.label = [&](size_t row) { return browseRowLabel(*listing, hasUp, row); };
+    source.loadStep = [&]() { return listing->step(kListStepMs); };
+    source.key = [&](size_t row) { return browseRowKey(*listing, hasUp, row); };
+    source.find = [&](uint32_t key) { return findBrowseRow(*listing, hasUp, key); };
 
     const String subtitle = "Path: " + trimMiddle(currentPath, 23);
     const int choice = ctx.uiRuntime->menuLoop("File Explorer",
-                                        menu,
+                                        source,
                                         selected,
                                         backgroundTick,
                                         "OK Open  BACK Exit",
@@ -776,28 +1230,27 @@ void browseSd(AppContext &ctx,
 
     selected = choice;
 
-    int idx = choice;
-    if (currentPath != "/") {
-      if (idx == 0) {
+    size_t index = 0;
+    switch (browseRowAt(*listing, hasUp, static_cast<size_t>(choice), &index)) {
+      case BrowseRow::Up:
         currentPath = parentPath(currentPath);
         selected = 0;
         continue;
-      }
-      idx -= 1;
-    }
-
-    const int entryCount = static_cast<int>(entries.size());
-    if (idx == entryCount) {
-      continue;
-    }
-    if (idx == entryCount + 1) {
-      return;
-    }
-    if (idx < 0 || idx >= entryCount) {
-      continue;
+      case BrowseRow::Status:
+        continue;
+      case BrowseRow::Refresh:
+        dirlisting::noteChanged(currentPath);
+        continue;
+      case BrowseRow::Back:
+        return;
+      case BrowseRow::Entry:
+        break;
     }
 
-    const FsEntry selectedEntry = entries[static_cast<size_t>(idx)];
+    FsEntry selectedEntry;
+    selectedEntry.fullPath = listing->fullPath(index);
+    selectedEntry.isDirectory = listing->isDirectory(index);
+    selectedEntry.size = listing->fileSize(index);
     if (selectedEntry.isDirectory) {
       currentPath = selectedEntry.fullPath;
       selected = 0;
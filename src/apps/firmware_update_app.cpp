@@ -1,18 +1,17 @@
 #include "firmware_update_app.h"
 
-#include <ArduinoJson.h>
-#include <HTTPClient.h>
 #include <SD.h>
 #include <SPI.h>
 #include <Update.h>
 #include <WiFi.h>
-#include <WiFiClient.h>
-#include <WiFiClientSecure.h>
 
 #include <algorithm>
 #include <vector>
 
 #include "../core/board_pins.h"
+#include "../core/dir_listing.h"
+#include "../core/firmware_fetch.h"
+#include "../core/github_release.h"
 #include "../core/shared_spi_bus.h"
 #include "../ui/ui_runtime.h"
 
@@ -22,7 +21,8 @@ constexpr const char *kFirmwareRepoSlug = "HITEYY/AI-cc1101";
 constexpr const char *kFirmwareDir = "/firmware";
 constexpr const char *kLatestFirmwarePath = "/firmware/latest.bin";
 constexpr size_t kTransferChunkBytes = 2048;
-constexpr unsigned long kDownloadIdleTimeoutMs = 12000UL;
+constexpr const char *kUserAgent = "AI-cc1101-FirmwareUpdate";
+constexpr bool kStageToSd = USER_OTA_STAGE_TO_SD != 0;
 
 struct ReleaseInfo {
   String tag;
@@ -103,12 +103,6 @@ String trimMiddle(const String &value, size_t maxLength) {
          value.substring(value.length() - right);
 }
 
-bool hasBinExtension(const String &pathOrNameRaw) {
-  String pathOrName = pathOrNameRaw;
-  pathOrName.toLowerCase();
-  return pathOrName.endsWith(".bin");
-}
-
 bool ensureSdMounted(bool forceMount, String *error) {
   if (gSdMountedForFirmware && !forceMount) {
     return true;
@@ -167,6 +161,7 @@ bool ensureFirmwareDirectory(String *error) {
     }
     return false;
   }
+  dirlisting::noteChanged(kFirmwareDir);
   return true;
 }
 
@@ -186,406 +181,100 @@ bool statSdFile(const String &path, uint32_t &sizeOut) {
   return true;
 }
 
-bool httpGetSecure(const String &url,
-                   String &responseOut,
-                   int &httpCodeOut,
-                   String *error) {
-  responseOut = "";
-  httpCodeOut = -1;
-
-  if (WiFi.status() != WL_CONNECTED) {
-    if (error) {
-      *error = "Wi-Fi is not connected";
-    }
-    return false;
-  }
-
-  WiFiClientSecure client;
-  client.setInsecure();
-
-  HTTPClient http;
-  if (!http.begin(client, url)) {
-    if (error) {
-      *error = "HTTP begin failed";
-    }
-    return false;
-  }
-
-  http.setTimeout(12000);
-  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-  http.addHeader("User-Agent", "AI-cc1101-FirmwareUpdate");
-  http.addHeader("Accept", "application/vnd.github+json");
-
-  const int code = http.GET();
-  httpCodeOut = code;
-  if (code > 0) {
-    responseOut = http.getString();
-  }
-  http.end();
-
-  if (code <= 0) {
-    if (error) {
-      *error = "HTTP request failed";
-    }
-    return false;
-  }
-  if (code < 200 || code >= 300) {
-    if (error) {
-      String msg = "HTTP " + String(code);
-      DynamicJsonDocument doc(768);
-      const auto parseErr = deserializeJson(doc, responseOut);
-      if (!parseErr && doc.is<JsonObjectConst>()) {
-        const String detail = String(static_cast<const char *>(doc["message"] | ""));
-        if (!detail.isEmpty()) {
-          msg += ": " + detail;
-        }
-      }
-      *error = msg;
-    }
-    return false;
-  }
-  return true;
+void fillReleaseInfo(const ghrelease::Release &release, ReleaseInfo &infoOut) {
+  const ghrelease::Asset &asset = release.assets[ghrelease::preferredAssetIndex(release, "")];
+  infoOut.tag = release.tag;
+  infoOut.assetName = asset.name;
+  infoOut.downloadUrl = asset.downloadUrl;
+  infoOut.size = asset.size;
 }
 
-bool parseLatestReleaseBody(const String &body,
-                            const String &preferredAssetNameRaw,
-                            ReleaseInfo &infoOut,
+bool fetchLatestReleaseInfo(ReleaseInfo &infoOut,
                             String *error) {
-  DynamicJsonDocument doc(32768);
-  const auto parseErr = deserializeJson(doc, body);
-  if (parseErr || !doc.is<JsonObject>()) {
-    if (error) {
-      *error = "Release JSON parse failed";
-    }
-    return false;
-  }
-
-  const JsonObjectConst root = doc.as<JsonObjectConst>();
-  infoOut.tag = String(static_cast<const char *>(root["tag_name"] | ""));
-  if (infoOut.tag.isEmpty()) {
-    infoOut.tag = String(static_cast<const char *>(root["name"] | ""));
-  }
-  if (infoOut.tag.isEmpty()) {
-    infoOut.tag = "(unknown)";
-  }
-
-  if (!root["assets"].is<JsonArrayConst>()) {
-    if (error) {
-      *error = "Release has no assets";
-    }
-    return false;
-  }
-
-  const JsonArrayConst assets = root["assets"].as<JsonArrayConst>();
-  if (assets.size() == 0) {
-    if (error) {
-      *error = "Release has empty assets";
-    }
-    return false;
-  }
-
-  String preferredAssetName = preferredAssetNameRaw;
-  preferredAssetName.trim();
-
-  JsonObjectConst selected;
-  if (!preferredAssetName.isEmpty()) {
-    for (JsonObjectConst asset : assets) {
-      const String name = String(static_cast<const char *>(asset["name"] | ""));
-      if (name == preferredAssetName) {
-        selected = asset;
-        break;
-      }
-    }
-  }
-
-  if (selected.isNull()) {
-    for (JsonObjectConst asset : assets) {
-      const String name = String(static_cast<const char *>(asset["name"] | ""));
-      if (hasBinExtension(name)) {
-        selected = asset;
-        break;
-      }
-    }
-  }
-
-  if (selected.isNull()) {
-    selected = assets[0];
+  ghrelease::Release latest;
+  String latestErr;
+  if (ghrelease::fetchLatest(kFirmwareRepoSlug, kUserAgent, latest, &latestErr)) {
+    fillReleaseInfo(latest, infoOut);
+    return true;
   }
 
-  infoOut.assetName = String(static_cast<const char *>(selected["name"] | ""));
-  infoOut.downloadUrl =
-      String(static_cast<const char *>(selected["browser_download_url"] | ""));
-  infoOut.size = selected["size"] | 0;
-
-  if (infoOut.assetName.isEmpty() || infoOut.downloadUrl.isEmpty()) {
-    if (error) {
-      *error = "Release asset URL missing";
+  std::vector<ghrelease::Release> releases;
+  String listErr;
+  if (ghrelease::fetchCatalog(kFirmwareRepoSlug, kUserAgent, 8, releases, &listErr)) {
+    if (!releases.empty()) {
+      fillReleaseInfo(releases.front(), infoOut);
+      return true;
     }
-    return false;
-  }
-  return true;
-}
-
-bool parseReleaseCatalogBody(const String &body,
-                             ReleaseInfo &infoOut,
-                             String *error) {
-  DynamicJsonDocument doc(65536);
-  const auto parseErr = deserializeJson(doc, body);
-  if (parseErr || !doc.is<JsonArrayConst>()) {
     if (error) {
-      *error = "Release list parse failed";
+      *error = "No published firmware release found. Publish a GitHub Release with a .bin asset.";
     }
     return false;
   }
-
-  const JsonArrayConst roots = doc.as<JsonArrayConst>();
-  for (JsonObjectConst root : roots) {
-    if (root["draft"] | false) {
-      continue;
-    }
-    if (!root["assets"].is<JsonArrayConst>()) {
-      continue;
-    }
-
-    const JsonArrayConst assets = root["assets"].as<JsonArrayConst>();
-    if (assets.size() == 0) {
-      continue;
-    }
-
-    JsonObjectConst selected;
-    for (JsonObjectConst asset : assets) {
-      const String name = String(static_cast<const char *>(asset["name"] | ""));
-      if (hasBinExtension(name)) {
-        selected = asset;
-        break;
-      }
-    }
-    if (selected.isNull()) {
-      selected = assets[0];
-    }
-
-    infoOut.tag = String(static_cast<const char *>(root["tag_name"] | ""));
-    if (infoOut.tag.isEmpty()) {
-      infoOut.tag = String(static_cast<const char *>(root["name"] | ""));
-    }
-    if (infoOut.tag.isEmpty()) {
-      infoOut.tag = "(unknown)";
-    }
-
-    infoOut.assetName = String(static_cast<const char *>(selected["name"] | ""));
-    infoOut.downloadUrl =
-        String(static_cast<const char *>(selected["browser_download_url"] | ""));
-    infoOut.size = selected["size"] | 0;
-
-    if (!infoOut.assetName.isEmpty() && !infoOut.downloadUrl.isEmpty()) {
-      return true;
-    }
-  }
-
   if (error) {
-    *error = "No releases with downloadable assets";
+    *error = latestErr + " / " + listErr;
   }
   return false;
 }
 
-bool fetchLatestReleaseInfo(ReleaseInfo &infoOut,
+// Fetches the .sha256 asset published next to url. Nothing vouches for a
+// release without one, so it is only used once the user accepts an
+// unverified image; action names what happens next ("Install", "Download").
+bool fetchChecksumOrConfirm(AppContext &ctx,
+                            const String &url,
+                            const String &assetName,
+                            const char *action,
+                            const std::function<void()> &backgroundTick,
+                            String &sha256,
                             String *error) {
-  const String latestUrl = "https://api.github.com/repos/" + String(kFirmwareRepoSlug) +
-                           "/releases/latest";
-  String latestBody;
-  int latestCode = -1;
-  String latestErr;
-  if (httpGetSecure(latestUrl, latestBody, latestCode, &latestErr)) {
-    return parseLatestReleaseBody(latestBody, "", infoOut, error);
-  }
-
-  const String listUrl = "https://api.github.com/repos/" + String(kFirmwareRepoSlug) +
-                         "/releases?per_page=8";
-  String listBody;
-  int listCode = -1;
-  String listErr;
-  if (httpGetSecure(listUrl, listBody, listCode, &listErr)) {
-    if (parseReleaseCatalogBody(listBody, infoOut, error)) {
-      return true;
-    }
-    if (error) {
-      *error = "No published firmware release found. Publish a GitHub Release with a .bin asset.";
+  bool hasSha256 = false;
+  {
+    OverlayScope overlay(ctx.uiRuntime, "Firmware Update", "Fetching checksum...", -1);
+    if (!fwfetch::fetchSha256(url, kUserAgent, sha256, &hasSha256, error)) {
+      return false;
     }
-    return false;
+  }
+  if (hasSha256) {
+    return true;
+  }
+  if (ctx.uiRuntime->confirm("No Checksum",
+                             trimMiddle(assetName, 20) + " has no SHA-256. " + action +
+                                 " unverified?",
+                             backgroundTick,
+                             action,
+                             "Cancel")) {
+    return true;
   }
   if (error) {
-    *error = latestErr + " / " + listErr;
+    *error = "No SHA-256 published, canceled";
   }
   return false;
 }
 
+// Downloads url to destPath, picking up an interrupted earlier download of
+// the same URL, and checks it against sha256 unless that is empty.
 bool downloadUrlToSdFile(const String &url,
+                         const String &sha256,
                          const char *destPath,
                          const std::function<void()> &backgroundTick,
-                         const std::function<void(uint32_t, int)> &progressTick,
-                         uint32_t *bytesOut,
+                         const fwfetch::ProgressFn &progressTick,
+                         fwfetch::Result *result,
                          String *error) {
-  if (bytesOut) {
-    *bytesOut = 0;
-  }
-
-  if (WiFi.status() != WL_CONNECTED) {
-    if (error) {
-      *error = "Wi-Fi is not connected";
-    }
-    return false;
-  }
-
   String sdErr;
-  if (!ensureSdMounted(false, &sdErr)) {
-    if (error) {
-      *error = sdErr;
-    }
-    return false;
-  }
-  if (!ensureFirmwareDirectory(&sdErr)) {
+  if (!ensureSdMounted(false, &sdErr) || !ensureFirmwareDirectory(&sdErr)) {
     if (error) {
       *error = sdErr;
     }
     return false;
   }
 
-  const String tempPath = String(destPath) + ".tmp";
-  if (SD.exists(tempPath.c_str())) {
-    SD.remove(tempPath.c_str());
-  }
-
-  WiFiClientSecure client;
-  client.setInsecure();
-
-  HTTPClient http;
-  if (!http.begin(client, url)) {
-    if (error) {
-      *error = "HTTP begin failed";
-    }
-    return false;
-  }
-
-  http.setTimeout(15000);
-  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-  http.addHeader("User-Agent", "AI-cc1101-FirmwareUpdate");
-
-  const int code = http.GET();
-  const int totalSize = http.getSize();
-  if (code <= 0 || code < 200 || code >= 300) {
-    const String response = code > 0 ? http.getString() : String("");
-    http.end();
-    if (error) {
-      String msg = code <= 0 ? String("Download HTTP failed")
-                             : String("HTTP ") + String(code);
-      if (!response.isEmpty()) {
-        msg += ": " + trimMiddle(response, 40);
-      }
-      *error = msg;
-    }
-    return false;
-  }
-
-  File file = SD.open(tempPath.c_str(), FILE_WRITE);
-  if (!file || file.isDirectory()) {
-    if (file) {
-      file.close();
-    }
-    http.end();
-    if (error) {
-      *error = "SD file open failed";
-    }
-    return false;
-  }
-
-  WiFiClient *stream = http.getStreamPtr();
-  int remain = http.getSize();
-  uint8_t buffer[kTransferChunkBytes];
-  uint32_t writtenTotal = 0;
-  unsigned long lastProgressMs = millis();
-  if (progressTick) {
-    progressTick(0, totalSize);
-  }
-
-  while (http.connected() && (remain > 0 || remain == -1)) {
-    const size_t available = stream->available();
-    if (available == 0) {
-      if (millis() - lastProgressMs > kDownloadIdleTimeoutMs) {
-        file.close();
-        http.end();
-        SD.remove(tempPath.c_str());
-        if (error) {
-          *error = "Download timeout";
-        }
-        return false;
-      }
-      delay(5);
-      if (backgroundTick) {
-        backgroundTick();
-      }
-      continue;
-    }
-
-    const size_t toRead = std::min(available, sizeof(buffer));
-    const int readLen = stream->readBytes(buffer, toRead);
-    if (readLen <= 0) {
-      continue;
-    }
-
-    const size_t written = file.write(buffer, static_cast<size_t>(readLen));
-    if (written != static_cast<size_t>(readLen)) {
-      file.close();
-      http.end();
-      SD.remove(tempPath.c_str());
-      if (error) {
-        *error = "SD write failed";
-      }
-      return false;
-    }
-
-    writtenTotal += static_cast<uint32_t>(written);
-    if (remain > 0) {
-      remain -= static_cast<int>(written);
-    }
-
-    lastProgressMs = millis();
-    if (progressTick) {
-      progressTick(writtenTotal, totalSize);
-    }
-    if (backgroundTick) {
-      backgroundTick();
-    }
-  }
-
-  file.close();
-  http.end();
-
-  if (writtenTotal == 0) {
-    SD.remove(tempPath.c_str());
-    if (error) {
-      *error = "Downloaded file is empty";
-    }
-    return false;
-  }
-
-  if (SD.exists(destPath)) {
-    SD.remove(destPath);
-  }
-  if (!SD.rename(tempPath.c_str(), destPath)) {
-    SD.remove(tempPath.c_str());
-    if (error) {
-      *error = "SD rename failed";
-    }
-    return false;
-  }
-
-  if (bytesOut) {
-    *bytesOut = writtenTotal;
-  }
-  if (progressTick) {
-    progressTick(writtenTotal, totalSize);
-  }
-  return true;
+  return fwfetch::downloadToSd(url,
+                               kUserAgent,
+                               destPath,
+                               sha256,
+                               backgroundTick,
+                               progressTick,
+                               result,
+                               error);
 }
 
 bool installFirmwareFromSd(const String &path,
@@ -727,32 +416,42 @@ void showStatus(AppContext &ctx,
 
 bool downloadLatest(AppContext &ctx,
                     ReleaseInfo &infoOut,
-                    uint32_t &downloadedBytesOut,
+                    fwfetch::Result &resultOut,
                     const std::function<void()> &backgroundTick,
                     String *error) {
   if (!fetchLatestReleaseInfo(infoOut, error)) {
     return false;
   }
+  String sha256;
+  if (!fetchChecksumOrConfirm(
+          ctx, infoOut.downloadUrl, infoOut.assetName, "Download", backgroundTick, sha256, error)) {
+    return false;
+  }
 
-  downloadedBytesOut = 0;
   OverlayScope overlay(ctx.uiRuntime, "Firmware Update", "Preparing download...", -1);
   return downloadUrlToSdFile(infoOut.downloadUrl,
+                             sha256,
                              kLatestFirmwarePath,
                              backgroundTick,
-                             [&](uint32_t written, int total) {
+                             [&](uint32_t written, uint32_t total) {
                                int percent = -1;
                                String progressText = "Downloading " + formatBytes(written);
                                if (total > 0) {
                                  percent = static_cast<int>((static_cast<uint64_t>(written) * 100ULL) /
                                                             static_cast<uint64_t>(total));
-                                 progressText += " / " + formatBytes(static_cast<uint32_t>(total));
+                                 progressText += " / " + formatBytes(total);
                                }
                                overlay.update("Firmware Update", progressText, percent);
                              },
-                             &downloadedBytesOut,
+                             &resultOut,
                              error);
 }
 
+String downloadSummary(const ReleaseInfo &info, const fwfetch::Result &result) {
+  return "Downloaded " + info.assetName + " (" + formatBytes(result.bytes) + ", " +
+         String(result.kilobytesPerSecond) + " KB/s" + (result.verified ? ", SHA-256 ok" : "") + ")";
+}
+
 bool installDownloaded(AppContext &ctx,
                        const std::function<void()> &backgroundTick,
                        String *error) {
@@ -772,6 +471,37 @@ bool installDownloaded(AppContext &ctx,
                                error);
 }
 
+// Streams the release asset into the OTA partition, checked against its
+// .sha256 asset.
+bool installLatestDirect(AppContext &ctx,
+                         const ReleaseInfo &info,
+                         const std::function<void()> &backgroundTick,
+                         fwfetch::Result *result,
+                         String *error) {
+  String sha256;
+  if (!fetchChecksumOrConfirm(
+          ctx, info.downloadUrl, info.assetName, "Install", backgroundTick, sha256, error)) {
+    return false;
+  }
+  OverlayScope overlay(ctx.uiRuntime, "Firmware Update", "Flashing firmware...", 0);
+  return fwfetch::installFromUrl(info.downloadUrl,
+                                 kUserAgent,
+                                 sha256,
+                                 backgroundTick,
+                                 [&](uint32_t done, uint32_t total) {
+                                   int percent = -1;
+                                   String progressText = "Flashing " + formatBytes(done);
+                                   if (total > 0) {
+                                     percent = static_cast<int>((static_cast<uint64_t>(done) * 100ULL) /
+                                                                static_cast<uint64_t>(total));
+                                     progressText += " / " + formatBytes(total);
+                                   }
+                                   overlay.update("Firmware Update", progressText, percent);
+                                 },
+                                 result,
+                                 error);
+}
+
 }  // namespace
 
 void runFirmwareUpdateApp(AppContext &ctx,
@@ -837,7 +567,7 @@ void runFirmwareUpdateApp(AppContext &ctx,
     if (choice == 2) {
       ReleaseInfo info;
       String err;
-      uint32_t downloaded = 0;
+      fwfetch::Result downloaded;
       if (!downloadLatest(ctx, info, downloaded, backgroundTick, &err)) {
         lastAction = "Download failed: " + err;
         ctx.uiRuntime->showToast("Firmware", err, 1800, backgroundTick);
@@ -846,7 +576,7 @@ void runFirmwareUpdateApp(AppContext &ctx,
 
       lastTag = info.tag;
       lastAsset = info.assetName;
-      lastAction = "Downloaded " + info.assetName + " (" + formatBytes(downloaded) + ")";
+      lastAction = downloadSummary(info, downloaded);
       ctx.uiRuntime->showToast("Firmware", "Downloaded to /firmware/latest.bin", 1600, backgroundTick);
       continue;
     }
@@ -887,7 +617,40 @@ void runFirmwareUpdateApp(AppContext &ctx,
 
       ReleaseInfo info;
       String err;
-      uint32_t downloaded = 0;
+      if (!kStageToSd) {
+        if (!fetchLatestReleaseInfo(info, &err)) {
+          lastAction = "Update failed: " + err;
+          ctx.uiRuntime->showToast("Firmware", err, 1900, backgroundTick);
+          continue;
+        }
+        lastTag = info.tag;
+        lastAsset = info.assetName;
+        if (!confirmInstall(ctx,
+                            "Install Latest",
+                            "Flash " + trimMiddle(info.tag, 20) + " directly?",
+                            backgroundTick)) {
+          lastAction = "Latest " + info.tag + " (install canceled)";
+          continue;
+        }
+
+        fwfetch::Result result;
+        if (!installLatestDirect(ctx, info, backgroundTick, &result, &err)) {
+          lastAction = "Update failed: " + err;
+          ctx.uiRuntime->showToast("Firmware", err, 1900, backgroundTick);
+          continue;
+        }
+
+        ctx.uiRuntime->showToast("Firmware",
+                                 result.verified ? "SHA-256 verified, rebooting"
+                                                 : "Update complete, rebooting",
+                                 1200,
+                                 backgroundTick);
+        delay(300);
+        ESP.restart();
+        return;
+      }
+
+      fwfetch::Result downloaded;
       if (!downloadLatest(ctx, info, downloaded, backgroundTick, &err)) {
         lastAction = "Update failed: " + err;
         ctx.uiRuntime->showToast("Firmware", err, 1900, backgroundTick);
@@ -896,7 +659,7 @@ void runFirmwareUpdateApp(AppContext &ctx,
 
       lastTag = info.tag;
       lastAsset = info.assetName;
-      lastAction = "Downloaded " + info.assetName + " (" + formatBytes(downloaded) + ")";
+      lastAction = downloadSummary(info, downloaded);
 
       if (!confirmInstall(ctx,
                           "Install Latest",
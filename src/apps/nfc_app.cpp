@@ -4,6 +4,7 @@
 
 #include <vector>
 
+#include "../core/shared_i2c_bus.h"
 #include "../ui/ui_runtime.h"
 #include "user_config.h"
 
@@ -52,6 +53,7 @@ bool ensureNfcReady(String *errorOut) {
     return false;
   }
 
+  sharedi2c::Guard i2c;
   Wire.begin(USER_NFC_I2C_SDA, USER_NFC_I2C_SCL);
   gPn532.begin();
   gFirmwareVersion = gPn532.getFirmwareVersion();
@@ -108,10 +110,11 @@ void scanNfcTag(AppContext &ctx,
 
   uint8_t uid[10] = {0};
   uint8_t uidLength = 0;
-  const bool ok = gPn532.readPassiveTargetID(PN532_MIFARE_ISO14443A,
-                                             uid,
-                                             &uidLength,
-                                             200);
+  bool ok = false;
+  {
+    sharedi2c::Guard i2c;
+    ok = gPn532.readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 200);
+  }
   if (!ok || uidLength == 0) {
     ctx.uiRuntime->showToast("NFC", "No tag detected", 1200, backgroundTick);
     return;
@@ -1,9 +1,12 @@
 #include "openclaw_app.h"
 
 #include <SD.h>
-#include <SHA256.h>
 #include <SPI.h>
 #include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 #include <limits.h>
 #include <time.h>
 
@@ -17,10 +20,16 @@ extern "C" {
 #include "../core/cc1101_radio.h"
 #include "../core/audio_recorder.h"
 #include "../core/ble_manager.h"
+#include "../core/chat_history.h"
+#include "../core/chunk_window.h"
+#include "../core/dir_listing.h"
 #include "../core/board_pins.h"
 #include "../core/gateway_client.h"
+#include "../core/message_outbox.h"
 #include "../core/runtime_config.h"
+#include "../core/sha256_stream.h"
 #include "../core/shared_spi_bus.h"
+#include "../core/voice_codec.h"
 #include "../core/wifi_manager.h"
 #include "../ui/ui_runtime.h"
 #include "user_config.h"
@@ -35,8 +44,14 @@ constexpr size_t kMessageChunkBytes = 256;
 constexpr size_t kBase64ChunkBufferBytes =
     ((kMessageChunkBytes + 2U) / 3U) * 4U + 1U;
 constexpr size_t kAgentAttachmentChunkBytes = 3840;
+// Voice stream chunks waiting for the sender task (about 0.5 s of 16 kHz PCM).
+constexpr UBaseType_t kVoiceUploadQueueDepth = 4;
+constexpr uint32_t kVoiceUploadTaskStackBytes = 6144;
+constexpr UBaseType_t kVoiceUploadTaskPriority = 2;
 constexpr size_t kAgentAttachmentBase64ChunkBytes =
     ((kAgentAttachmentChunkBytes + 2U) / 3U) * 4U + 1U;
+// Attachments are read from SD this many chunks at a time (15 KB).
+constexpr size_t kAgentAttachmentReadChunks = 4;
 constexpr uint32_t kMessengerBinaryAttachMaxBytes =
     static_cast<uint32_t>(USER_MESSENGER_BINARY_ATTACH_MAX_BYTES);
 constexpr size_t kMessengerTextFallbackPreviewMaxChars =
@@ -50,27 +65,37 @@ constexpr bool kLegacyMediaFallbackEnabled =
     USER_MESSENGER_ENABLE_LEGACY_MEDIA_FALLBACK != 0;
 constexpr size_t kAgentRequestMessageMaxChars = 19000U;
 constexpr uint32_t kMaxVoiceBytes = 2097152;
+constexpr VoiceEncoding kVoiceEncoding =
+    USER_MESSENGER_VOICE_ADPCM != 0 ? VoiceEncoding::ImaAdpcm : VoiceEncoding::Pcm16;
+constexpr bool kVoiceStreamUploadEnabled = USER_MESSENGER_VOICE_STREAM_UPLOAD != 0;
+constexpr bool kVoiceSdSpoolEnabled = USER_MESSENGER_VOICE_SD_SPOOL != 0;
 constexpr uint32_t kMaxFileBytes = 4194304;
 constexpr uint32_t kChatSendAttachmentMaxBytes = 98304;
 constexpr uint8_t kChunkSendMaxRetries = 3;
 constexpr unsigned long kChunkRetryWaitMs = 2500UL;
-constexpr size_t kOutboxCapacity = 40;
-constexpr size_t kOutboxMaxIdLen = 96;
-constexpr size_t kOutboxMaxMetaLen = 64;
-constexpr size_t kOutboxMaxTextLen = 768;
-constexpr size_t kOutboxMaxFileNameLen = 128;
-
-GatewayInboxMessage gOutbox[kOutboxCapacity];
-size_t gOutboxStart = 0;
-size_t gOutboxCount = 0;
+constexpr uint8_t kAttachWindow = static_cast<uint8_t>(USER_MESSENGER_ATTACH_WINDOW);
+constexpr uint32_t kAttachAckTimeoutMs =
+    static_cast<uint32_t>(USER_MESSENGER_ATTACH_ACK_TIMEOUT_MS);
+constexpr uint8_t kAttachMaxAttempts = static_cast<uint8_t>(USER_MESSENGER_ATTACH_MAX_ATTEMPTS);
+constexpr unsigned long kAttachReconnectWaitMs =
+    static_cast<unsigned long>(USER_MESSENGER_ATTACH_RECONNECT_WAIT_MS);
+constexpr unsigned long kAttachProgressIntervalMs = 250UL;
+// How long a text send waits for the drainer before reporting "queued".
+constexpr unsigned long kTextSendWaitMs = 1500UL;
+// Outbox attachments that failed in transport are retried this many times,
+// first after kAttachRetryBaseMs and then twice as long each time.
+constexpr uint8_t kAttachOutboxMaxAttempts = 5;
+constexpr unsigned long kAttachRetryBaseMs = 5000UL;
+
 String gMessengerSessionKey;
 String gSubscribedSessionKey;
 unsigned long gSubscribedConnectOkMs = 0;
-
-struct ChatEntry {
-  GatewayInboxMessage message;
-  bool outgoing = false;
-};
+// Connection (lastConnectOkMs) on which node.event went unanswered for a full
+// ack timeout, so later attachments on it skip the probe.
+unsigned long gSilentGatewayConnectOkMs = 0;
+// Outbox attachment waiting out its retry backoff, and when it may go again.
+String gAttachRetryId;
+unsigned long gAttachRetryAtMs = 0;
 
 struct SdSelectEntry {
   String fullPath;
@@ -90,10 +115,14 @@ enum class AttachmentRoute : uint8_t {
   TextFallback = 2,
   LegacyMetaChunk = 3,
   Failed = 4,
+  Streamed = 5,
 };
 
 struct AttachmentSendResult {
   bool ok = false;
+  // The file itself cannot be sent (missing, empty, too large, unreadable);
+  // retrying will not help.
+  bool permanent = false;
   AttachmentRoute route = AttachmentRoute::Failed;
   String error;
   String messageId;
@@ -147,6 +176,26 @@ class ScopedProgressOverlay {
   String title_;
 };
 
+class ScopedResponseHandler {
+ public:
+  ScopedResponseHandler(GatewayClient *gateway, GatewayClient::ResponseHandler handler)
+      : gateway_(gateway) {
+    if (gateway_) {
+      token_ = gateway_->addResponseHandler(handler);
+    }
+  }
+
+  ~ScopedResponseHandler() {
+    if (gateway_) {
+      gateway_->removeResponseHandler(token_);
+    }
+  }
+
+ private:
+  GatewayClient *gateway_ = nullptr;
+  uint32_t token_ = 0;
+};
+
 bool sendTextPayload(AppContext &ctx,
                      const String &rawText,
                      const std::function<void()> &backgroundTick);
@@ -189,6 +238,9 @@ String attachmentRouteToast(AttachmentRoute route) {
   if (route == AttachmentRoute::LegacyMetaChunk) {
     return "Sent (legacy fallback)";
   }
+  if (route == AttachmentRoute::Streamed) {
+    return "Sent (streamed)";
+  }
   return "Send failed";
 }
 
@@ -219,17 +271,75 @@ String withGatewayErrorSuffix(const String &base, GatewayClient *gateway) {
   return merged;
 }
 
+bool waitForGatewayReady(AppContext &ctx,
+                         const std::function<void()> &backgroundTick,
+                         unsigned long timeoutMs) {
+  ctx.gateway->connectNow();
+
+  const unsigned long startMs = millis();
+  while (millis() - startMs < timeoutMs) {
+    if (backgroundTick) {
+      backgroundTick();
+    }
+    const GatewayStatus now = ctx.gateway->status();
+    if (now.gatewayReady && now.wsConnected) {
+      return true;
+    }
+    delay(25);
+  }
+  return false;
+}
+
+// Whether this connection's gateway answers node.event, so attachment chunks
+// can be paced by acks. Called right after a node.event was sent (the
+// attachment BEGIN, probeRequestId), with no gateway tick in between; its
+// answer serves as the probe. The verdict is kept per connection. A
+// connection lost mid-probe is not remembered as silent.
+bool gatewayAcksNodeEvents(AppContext &ctx,
+                           const String &probeRequestId,
+                           const std::function<void()> &backgroundTick) {
+  const unsigned long connection = ctx.gateway->status().lastConnectOkMs;
+  if (connection != 0 && connection == gSilentGatewayConnectOkMs) {
+    return false;
+  }
+
+  bool answered = false;
+  ScopedResponseHandler probe(ctx.gateway,
+                              [&](const String &requestId, bool, const String &) {
+                                if (requestId == probeRequestId) {
+                                  answered = true;
+                                }
+                              });
+  const unsigned long startMs = millis();
+  while (!answered) {
+    if (millis() - startMs >= kAttachAckTimeoutMs) {
+      gSilentGatewayConnectOkMs = connection;
+      return false;
+    }
+    if (backgroundTick) {
+      backgroundTick();
+    }
+    const GatewayStatus now = ctx.gateway->status();
+    if (!now.gatewayReady || now.lastConnectOkMs != connection) {
+      return false;
+    }
+    delay(5);
+  }
+  return true;
+}
+
 bool sendGatewayEventWithRetry(AppContext &ctx,
                                const char *eventName,
                                JsonDocument &payload,
                                const std::function<void()> &backgroundTick,
-                               uint8_t maxRetries = kChunkSendMaxRetries) {
+                               uint8_t maxRetries = kChunkSendMaxRetries,
+                               String *requestIdOut = nullptr) {
   if (maxRetries == 0) {
     maxRetries = 1;
   }
 
   for (uint8_t attempt = 0; attempt < maxRetries; ++attempt) {
-    if (ctx.gateway->sendNodeEvent(eventName, payload)) {
+    if (ctx.gateway->sendNodeEvent(eventName, payload, requestIdOut)) {
       return true;
     }
 
@@ -237,19 +347,7 @@ bool sendGatewayEventWithRetry(AppContext &ctx,
       break;
     }
 
-    ctx.gateway->connectNow();
-
-    const unsigned long startMs = millis();
-    while (millis() - startMs < kChunkRetryWaitMs) {
-      if (backgroundTick) {
-        backgroundTick();
-      }
-      const GatewayStatus now = ctx.gateway->status();
-      if (now.gatewayReady && now.wsConnected) {
-        break;
-      }
-      delay(25);
-    }
+    waitForGatewayReady(ctx, backgroundTick, kChunkRetryWaitMs);
   }
 
   return false;
@@ -266,68 +364,10 @@ String activeMessengerSessionKey() {
   return gMessengerSessionKey;
 }
 
-void clampString(String &value, size_t maxLen) {
-  if (maxLen == 0) {
-    value = "";
-    return;
-  }
-  if (value.length() <= maxLen) {
-    return;
-  }
-  if (maxLen <= 3) {
-    value = value.substring(0, maxLen);
-    return;
-  }
-  value = value.substring(0, maxLen - 3) + "...";
-}
-
-void clampOutboxMessage(GatewayInboxMessage &message) {
-  clampString(message.id, kOutboxMaxIdLen);
-  clampString(message.event, kOutboxMaxMetaLen);
-  clampString(message.type, kOutboxMaxMetaLen);
-  clampString(message.from, kOutboxMaxMetaLen);
-  clampString(message.to, kOutboxMaxMetaLen);
-  clampString(message.text, kOutboxMaxTextLen);
-  clampString(message.fileName, kOutboxMaxFileNameLen);
-  clampString(message.contentType, kOutboxMaxMetaLen);
-}
-
-void pushOutbox(const GatewayInboxMessage &message) {
-  if (kOutboxCapacity == 0) {
-    return;
-  }
-
-  GatewayInboxMessage bounded = message;
-  clampOutboxMessage(bounded);
-
-  size_t pos = 0;
-  if (gOutboxCount < kOutboxCapacity) {
-    pos = (gOutboxStart + gOutboxCount) % kOutboxCapacity;
-    ++gOutboxCount;
-  } else {
-    pos = gOutboxStart;
-    gOutboxStart = (gOutboxStart + 1) % kOutboxCapacity;
-  }
-  gOutbox[pos] = bounded;
-}
-
-bool outboxMessage(size_t index, GatewayInboxMessage &out) {
-  if (index >= gOutboxCount) {
-    return false;
-  }
-  const size_t pos = (gOutboxStart + index) % kOutboxCapacity;
-  out = gOutbox[pos];
-  return true;
-}
-
-void clearOutbox() {
-  gOutboxStart = 0;
-  gOutboxCount = 0;
-}
-
 void clearMessengerMessages(AppContext &ctx) {
   ctx.gateway->clearInbox();
-  clearOutbox();
+  outbox::clearHistory();
+  chathistory::clear();
 }
 
 bool sendChatSessionEvent(AppContext &ctx,
@@ -436,11 +476,17 @@ String formatBytes(uint64_t bytes) {
   return String(buf);
 }
 
+String voiceWavMime(VoiceEncoding encoding) {
+  // RFC 2361 names non-PCM WAV payloads by their format tag.
+  return encoding == VoiceEncoding::ImaAdpcm ? "audio/vnd.wave;codec=11" : "audio/wav";
+}
+
 String detectAudioMime(const String &path) {
   String lower = path;
   lower.toLowerCase();
   if (lower.endsWith(".wav")) {
-    return "audio/wav";
+    return voiceWavMime(isImaAdpcmWavFile(path) ? VoiceEncoding::ImaAdpcm
+                                                : VoiceEncoding::Pcm16);
   }
   if (lower.endsWith(".mp3")) {
     return "audio/mpeg";
@@ -540,9 +586,28 @@ String makeMessageId(const char *prefix) {
   id += String(static_cast<unsigned long>(millis()));
   id += "-";
   id += String(seq);
+  // Outbox ids outlive a reboot, where millis() and seq start over.
+  id += "-";
+  id += String(static_cast<unsigned long>(esp_random() & 0xFFFFU), HEX);
   return id;
 }
 
+// Outgoing messages enter the chat history when queued. Their delivery state
+// comes from the outbox while it still has them, and from the outcome the
+// outbox writes back into the history (see main.cpp) after that.
+void recordOutgoingHistory(const outbox::Entry &entry) {
+  chathistory::Message message;
+  message.id = entry.id;
+  message.outgoing = true;
+  message.type = outbox::kindToken(entry.kind);
+  message.from = kMessageSenderId;
+  message.text = entry.text;
+  message.fileName = entry.fileName;
+  message.bytes = entry.bytes;
+  message.tsMs = entry.tsMs;
+  chathistory::record(message);
+}
+
 bool encodeBase64(const uint8_t *data,
                   size_t len,
                   char *out,
@@ -836,10 +901,6 @@ void startMainSessionWithGreeting(AppContext &ctx,
 bool sendTextPayload(AppContext &ctx,
                      const String &rawText,
                      const std::function<void()> &backgroundTick) {
-  if (!ensureGatewayReady(ctx, backgroundTick)) {
-    return false;
-  }
-
   String text = rawText;
   text.trim();
   if (text.isEmpty()) {
@@ -847,34 +908,50 @@ bool sendTextPayload(AppContext &ctx,
     return false;
   }
 
-  if (!ensureMessengerSessionSubscription(ctx, backgroundTick)) {
+  const bool online = ctx.gateway->status().gatewayReady;
+  if (online) {
+    ensureMessengerSessionSubscription(ctx, backgroundTick);
+  }
+
+  // Queued in the outbox; the background drainer sends it now or once the
+  // gateway is back.
+  outbox::Entry entry;
+  entry.id = makeMessageId("txt");
+  entry.kind = outbox::Kind::Text;
+  entry.sessionKey = activeMessengerSessionKey();
+  entry.to = kDefaultSessionAgentId;
+  entry.text = text;
+  entry.tsMs = currentUnixMs();
+  String queueError;
+  if (!outbox::add(entry, &queueError)) {
+    ctx.uiRuntime->showToast("Messenger",
+                             queueError.isEmpty() ? String("Text send failed") : queueError,
+                             1500,
+                             backgroundTick);
     return false;
   }
+  recordOutgoingHistory(entry);
 
-  DynamicJsonDocument payload(2048);
-  const String messageId = makeMessageId("txt");
-  const String target = kDefaultSessionAgentId;
-  payload["message"] = text;
-  payload["sessionKey"] = activeMessengerSessionKey();
-  payload["deliver"] = false;
-  const uint64_t ts = currentUnixMs();
-
-  if (!ctx.gateway->sendNodeEvent("agent.request", payload)) {
-    ctx.uiRuntime->showToast("Messenger", "Text send failed", 1500, backgroundTick);
-    return false;
+  if (online) {
+    const unsigned long startMs = millis();
+    while (millis() - startMs < kTextSendWaitMs) {
+      if (backgroundTick) {
+        backgroundTick();
+      }
+      outbox::State state = outbox::State::Queued;
+      outbox::stateOf(entry.id, &state);
+      if (state == outbox::State::Sent) {
+        ctx.uiRuntime->showToast("Messenger", "Text sent", 1100, backgroundTick);
+        return true;
+      }
+      if (state == outbox::State::Failed) {
+        break;
+      }
+      delay(10);
+    }
   }
 
-  GatewayInboxMessage sent;
-  sent.id = messageId;
-  sent.event = "agent.request";
-  sent.type = "text";
-  sent.from = kMessageSenderId;
-  sent.to = target;
-  sent.text = text;
-  sent.tsMs = ts;
-  pushOutbox(sent);
-
-  ctx.uiRuntime->showToast("Messenger", "Text sent", 1100, backgroundTick);
+  ctx.uiRuntime->showToast("Messenger", "Queued, sends when online", 1300, backgroundTick);
   return true;
 }
 
@@ -888,12 +965,7 @@ void sendTextMessage(AppContext &ctx,
   sendTextPayload(ctx, text, backgroundTick);
 }
 
-bool sendAgentRequestMessage(AppContext &ctx,
-                             const String &sessionKey,
-                             const String &target,
-                             const String &message,
-                             const std::function<void()> &backgroundTick,
-                             String *errorOut = nullptr) {
+bool checkAgentRequestMessage(const String &message, String *errorOut) {
   if (message.isEmpty()) {
     if (errorOut) {
       *errorOut = "Message is empty";
@@ -906,7 +978,12 @@ bool sendAgentRequestMessage(AppContext &ctx,
     }
     return false;
   }
+  return true;
+}
 
+DynamicJsonDocument buildAgentRequestPayload(const String &sessionKey,
+                                             const String &target,
+                                             const String &message) {
   size_t payloadCap = message.length() + 640U;
   if (payloadCap < 1024U) {
     payloadCap = 1024U;
@@ -920,71 +997,30 @@ bool sendAgentRequestMessage(AppContext &ctx,
   }
   payload["deliver"] = false;
   payload["thinking"] = "low";
-  if (!sendGatewayEventWithRetry(ctx, "agent.request", payload, backgroundTick)) {
-    if (errorOut) {
-      *errorOut = withGatewayErrorSuffix("Agent request send failed", ctx.gateway);
-    }
-    return false;
-  }
-  return true;
-}
-
-String hexDigest(const uint8_t *digest, size_t len) {
-  static const char kHex[] = "0123456789abcdef";
-  if (!digest || len == 0) {
-    return "";
-  }
-  String out;
-  out.reserve(len * 2U);
-  for (size_t i = 0; i < len; ++i) {
-    const uint8_t value = digest[i];
-    out += kHex[(value >> 4) & 0x0F];
-    out += kHex[value & 0x0F];
-  }
-  return out;
+  return payload;
 }
 
-String computeFileSha256Hex(const String &filePath, String *errorOut = nullptr) {
-  File file = SD.open(filePath.c_str(), FILE_READ);
-  if (!file || file.isDirectory()) {
-    if (file) {
-      file.close();
-    }
-    if (errorOut) {
-      *errorOut = "Checksum read failed";
-    }
-    return "";
-  }
-
-  SHA256 hash;
-  uint8_t digest[SHA256::HASH_SIZE] = {0};
-  uint8_t buffer[1024] = {0};
-  bool failed = false;
-
-  hash.reset();
-  while (file.available()) {
-    const size_t readLen = file.read(buffer, sizeof(buffer));
-    if (readLen == 0) {
-      failed = true;
-      break;
-    }
-    hash.update(buffer, readLen);
+bool sendAgentRequestMessage(AppContext &ctx,
+                             const String &sessionKey,
+                             const String &target,
+                             const String &message,
+                             const std::function<void()> &backgroundTick,
+                             String *errorOut = nullptr,
+                             uint8_t maxRetries = kChunkSendMaxRetries,
+                             String *requestIdOut = nullptr) {
+  if (!checkAgentRequestMessage(message, errorOut)) {
+    return false;
   }
-  file.close();
 
-  if (failed) {
+  DynamicJsonDocument payload = buildAgentRequestPayload(sessionKey, target, message);
+  if (!sendGatewayEventWithRetry(
+          ctx, "agent.request", payload, backgroundTick, maxRetries, requestIdOut)) {
     if (errorOut) {
-      *errorOut = "Checksum read failed";
+      *errorOut = withGatewayErrorSuffix("Agent request send failed", ctx.gateway);
     }
-    return "";
-  }
-
-  hash.finalize(digest, sizeof(digest));
-  const String hex = hexDigest(digest, sizeof(digest));
-  if (hex.isEmpty() && errorOut) {
-    *errorOut = "Checksum encode failed";
+    return false;
   }
-  return hex;
+  return true;
 }
 
 String readTextFilePreview(const String &filePath,
@@ -1142,6 +1178,113 @@ AttachmentSendResult sendAttachmentTextFallback(
   return result;
 }
 
+// Serves attachment chunks by index. Chunks are read from SD
+// kAgentAttachmentReadChunks at a time and hashed on that first read, which
+// is in file order because first sends are; a resend of a chunk that has left
+// the block is read again on its own.
+class AttachmentChunkReader {
+ public:
+  AttachmentChunkReader(File &file, uint32_t totalBytes)
+      : file_(file),
+        totalBytes_(totalBytes),
+        block_(kAgentAttachmentChunkBytes * kAgentAttachmentReadChunks, 0),
+        single_(kAgentAttachmentChunkBytes, 0) {}
+
+  bool ok() const {
+    return !block_.empty() && !single_.empty();
+  }
+
+  bool load(uint16_t seq, const uint8_t **data, size_t *len) {
+    const uint32_t offset = static_cast<uint32_t>(seq) *
+                            static_cast<uint32_t>(kAgentAttachmentChunkBytes);
+    if (offset >= totalBytes_) {
+      return false;
+    }
+    *len = std::min(kAgentAttachmentChunkBytes, static_cast<size_t>(totalBytes_ - offset));
+
+    if (blockChunks_ > 0 && seq >= blockFirst_ && seq < blockFirst_ + blockChunks_) {
+      *data = block_.data() + (static_cast<size_t>(seq - blockFirst_) * kAgentAttachmentChunkBytes);
+      return true;
+    }
+
+    if (offset == readBytes_) {
+      const size_t want = std::min(block_.size(), static_cast<size_t>(totalBytes_ - offset));
+      if (!readAt(offset, block_.data(), want)) {
+        return false;
+      }
+      hash_.update(block_.data(), want);
+      readBytes_ += static_cast<uint32_t>(want);
+      blockFirst_ = seq;
+      blockChunks_ = static_cast<uint16_t>((want + kAgentAttachmentChunkBytes - 1U) /
+                                           kAgentAttachmentChunkBytes);
+      *data = block_.data();
+      return true;
+    }
+
+    if (offset > readBytes_ || !readAt(offset, single_.data(), *len)) {
+      return false;
+    }
+    *data = single_.data();
+    return true;
+  }
+
+  Sha256Stream &hash() {
+    return hash_;
+  }
+
+ private:
+  bool readAt(uint32_t offset, uint8_t *out, size_t len) {
+    if (file_.position() != offset && !file_.seek(offset)) {
+      return false;
+    }
+    return file_.read(out, len) == len;
+  }
+
+  File &file_;
+  uint32_t totalBytes_ = 0;
+  std::vector<uint8_t> block_;
+  std::vector<uint8_t> single_;
+  uint16_t blockFirst_ = 0;
+  uint16_t blockChunks_ = 0;
+  uint32_t readBytes_ = 0;
+  Sha256Stream hash_;
+};
+
+String attachmentProgressText(const ChunkWindow &window,
+                              uint32_t totalBytes,
+                              unsigned long elapsedMs) {
+  uint32_t ackedBytes = static_cast<uint32_t>(window.acked()) *
+                        static_cast<uint32_t>(kAgentAttachmentChunkBytes);
+  if (ackedBytes > totalBytes) {
+    ackedBytes = totalBytes;
+  }
+  const uint32_t kbps =
+      elapsedMs > 0 ? static_cast<uint32_t>((static_cast<uint64_t>(ackedBytes) * 1000ULL) /
+                                            (static_cast<uint64_t>(elapsedMs) * 1024ULL))
+                    : 0U;
+  String text = "Sending ";
+  text += String(static_cast<unsigned long>(window.acked()));
+  text += "/";
+  text += String(static_cast<unsigned long>(window.total()));
+  text += ", ";
+  text += String(static_cast<unsigned long>(kbps));
+  text += " KB/s";
+  if (window.retransmits() > 0) {
+    text += "\n";
+    text += String(static_cast<unsigned long>(window.retransmits()));
+    text += window.retransmits() == 1 ? " retry" : " retries";
+  }
+  return text;
+}
+
+int attachmentPercent(const ChunkWindow &window) {
+  if (window.total() == 0) {
+    return 0;
+  }
+  return static_cast<int>((static_cast<uint32_t>(window.acked()) * 100U) /
+                          static_cast<uint32_t>(window.total()));
+}
+
 AttachmentSendResult sendAttachmentViaAgentRequest(
     AppContext &ctx,
     const String &filePath,
@@ -1162,6 +1305,7 @@ AttachmentSendResult sendAttachmentViaAgentRequest(
 
   if (totalBytes == 0 || totalBytes > kAgentAttachmentMaxBytes) {
     result.error = "Binary attachment exceeds limit";
+    result.permanent = true;
     return result;
   }
   if (!ensureMessengerSessionSubscription(ctx, backgroundTick)) {
@@ -1169,13 +1313,6 @@ AttachmentSendResult sendAttachmentViaAgentRequest(
     return result;
   }
 
-  String checksumError;
-  const String checksum = computeFileSha256Hex(filePath, &checksumError);
-  if (checksum.isEmpty()) {
-    result.error = checksumError.isEmpty() ? String("Checksum failed") : checksumError;
-    return result;
-  }
-
   const String sessionKey = activeMessengerSessionKey();
   const uint16_t totalChunks = static_cast<uint16_t>(
       (totalBytes + static_cast<uint32_t>(kAgentAttachmentChunkBytes) - 1U) /
@@ -1200,12 +1337,13 @@ AttachmentSendResult sendAttachmentViaAgentRequest(
     }
     ensureMessengerSessionSubscription(ctx, backgroundTick, false);
     result.error = "Attachment open failed";
+    result.permanent = true;
     return result;
   }
 
-  std::vector<uint8_t> raw(kAgentAttachmentChunkBytes, 0);
+  AttachmentChunkReader reader(file, totalBytes);
   std::vector<char> encoded(kAgentAttachmentBase64ChunkBytes, 0);
-  if (raw.empty() || encoded.empty()) {
+  if (!reader.ok() || encoded.empty()) {
     file.close();
     ensureMessengerSessionSubscription(ctx, backgroundTick, false);
     result.error = "Out of memory";
@@ -1227,45 +1365,127 @@ AttachmentSendResult sendAttachmentViaAgentRequest(
   beginMessage += String(static_cast<unsigned long>(totalBytes));
   beginMessage += "\nchunks:";
   beginMessage += String(static_cast<unsigned long>(totalChunks));
-  beginMessage += "\nchecksum:";
-  beginMessage += checksum;
   beginMessage += "\nencoding:base64";
   if (!caption.isEmpty()) {
     beginMessage += "\ncaption:";
     beginMessage += caption;
   }
-  beginMessage += "\nreply:ignore chunk transport and wait for END";
+  beginMessage += "\nreply:ignore chunk transport and wait for END (checksum follows in END)";
 
   String sendError;
+  String beginRequestId;
   if (!sendAgentRequestMessage(ctx,
                                sessionKey,
                                target,
                                beginMessage,
                                backgroundTick,
-                               &sendError)) {
+                               &sendError,
+                               kChunkSendMaxRetries,
+                               &beginRequestId)) {
     file.close();
     ensureMessengerSessionSubscription(ctx, backgroundTick, false);
     result.error = sendError.isEmpty() ? String("Attachment begin send failed") : sendError;
     return result;
   }
 
-  uint16_t chunkIndex = 0;
-  int lastShownDecile = -1;
+  // Chunks are paced by the gateway's response to each agent.request: up to
+  // kAttachWindow are in flight, a rejected or unanswered chunk is resent on
+  // its own, and a dropped connection resumes from the first unacked chunk.
+  ChunkWindow window;
+  window.begin(totalChunks, kAttachWindow, kAttachAckTimeoutMs, kAttachMaxAttempts);
+  String lastRejection;
+  ScopedResponseHandler acks(ctx.gateway,
+                             [&](const String &requestId, bool ok, const String &error) {
+                               if (!window.onResponse(requestId, ok)) {
+                                 return;
+                               }
+                               if (!ok) {
+                                 lastRejection = error;
+                               }
+                             });
+
   bool failed = false;
+  // Gateways that never answer node.event get the chunks unpaced. Decided
+  // from the BEGIN's answer, never from a lost chunk window.
+  progress.update("Starting upload...", 0);
+  const bool unpaced = !gatewayAcksNodeEvents(ctx, beginRequestId, backgroundTick);
+  bool needReconnect = false;
+  uint8_t reconnects = 0;
+  uint16_t ackedAtReconnect = 0;
+  unsigned long connectGeneration = ctx.gateway->status().lastConnectOkMs;
+  const unsigned long startMs = millis();
+  unsigned long lastProgressMs = 0;
+
+  while (!window.done()) {
+    if (backgroundTick) {
+      backgroundTick();
+    }
 
-  while (file.available() && chunkIndex < totalChunks) {
-    const size_t readLen = file.read(raw.data(), raw.size());
-    if (readLen == 0) {
-      break;
+    const GatewayStatus gateway = ctx.gateway->status();
+    const bool ready = gateway.gatewayReady && gateway.wsConnected;
+    if (needReconnect || !ready || gateway.lastConnectOkMs != connectGeneration) {
+      // Whatever was in flight may have gone down with the old socket.
+      window.requeueInFlight();
+      needReconnect = false;
+      if (window.acked() != ackedAtReconnect) {
+        ackedAtReconnect = window.acked();
+        reconnects = 0;
+      }
+      if (++reconnects > kChunkSendMaxRetries) {
+        failed = true;
+        sendError = withGatewayErrorSuffix("Attachment chunk send failed", ctx.gateway);
+        break;
+      }
+      if (!ready) {
+        progress.update("Reconnecting...", attachmentPercent(window));
+        if (!waitForGatewayReady(ctx, backgroundTick, kAttachReconnectWaitMs)) {
+          failed = true;
+          sendError = withGatewayErrorSuffix("Gateway lost during attachment", ctx.gateway);
+          break;
+        }
+      }
+      connectGeneration = ctx.gateway->status().lastConnectOkMs;
+      continue;
+    }
+
+    const unsigned long now = millis();
+    if (unpaced) {
+      window.ackInFlight();
+    }
+
+    if (now - lastProgressMs >= kAttachProgressIntervalMs) {
+      lastProgressMs = now;
+      progress.update(attachmentProgressText(window, totalBytes, now - startMs),
+                      attachmentPercent(window));
+    }
+
+    const int seq = window.next(now);
+    if (seq < 0) {
+      if (window.failed()) {
+        failed = true;
+        sendError = "Chunk " + String(window.failedChunk() + 1) + " not acknowledged";
+        if (!lastRejection.isEmpty()) {
+          sendError += ": ";
+          sendError += lastRejection;
+        }
+        break;
+      }
+      delay(5);
+      continue;
     }
 
+    const uint8_t *chunkData = nullptr;
+    size_t chunkLen = 0;
+    if (!reader.load(static_cast<uint16_t>(seq), &chunkData, &chunkLen)) {
+      failed = true;
+      result.permanent = true;
+      sendError = "Attachment read failed";
+      break;
+    }
     size_t encodedLen = 0;
-    if (!encodeBase64(raw.data(),
-                      readLen,
-                      encoded.data(),
-                      encoded.size(),
-                      &encodedLen)) {
+    if (!encodeBase64(chunkData, chunkLen, encoded.data(), encoded.size(), &encodedLen)) {
       failed = true;
+      result.permanent = true;
       sendError = "Base64 encode failed";
       break;
     }
@@ -1276,43 +1496,26 @@ AttachmentSendResult sendAttachmentViaAgentRequest(
     chunkMessage += "id:";
     chunkMessage += result.messageId;
     chunkMessage += "\nseq:";
-    chunkMessage += String(static_cast<unsigned long>(chunkIndex + 1));
+    chunkMessage += String(static_cast<unsigned long>(seq + 1));
     chunkMessage += "\nchunks:";
     chunkMessage += String(static_cast<unsigned long>(totalChunks));
     chunkMessage += "\nbytes:";
-    chunkMessage += String(static_cast<unsigned long>(readLen));
+    chunkMessage += String(static_cast<unsigned long>(chunkLen));
     chunkMessage += "\ndata:";
     chunkMessage += encoded.data();
     chunkMessage += "\nreply:ignore";
 
-    if (!sendAgentRequestMessage(ctx,
-                                 sessionKey,
-                                 target,
-                                 chunkMessage,
-                                 backgroundTick,
-                                 &sendError)) {
-      failed = true;
-      break;
-    }
-
-    ++chunkIndex;
-    const int percent = static_cast<int>((static_cast<uint32_t>(chunkIndex) * 100U) /
-                                         static_cast<uint32_t>(totalChunks));
-    const int decile = percent / 10;
-    if (decile != lastShownDecile) {
-      lastShownDecile = decile;
-      progress.update("Sending attachment...", percent);
-    }
-    if (backgroundTick && ((chunkIndex % 4U) == 0U)) {
-      backgroundTick();
+    DynamicJsonDocument payload = buildAgentRequestPayload(sessionKey, target, chunkMessage);
+    String requestId;
+    if (!ctx.gateway->sendNodeEvent("agent.request", payload, &requestId)) {
+      window.markSendFailed(static_cast<uint16_t>(seq));
+      needReconnect = true;
+      continue;
     }
+    window.markSent(static_cast<uint16_t>(seq), requestId, now);
   }
   file.close();
-
-  if (!failed && chunkIndex != totalChunks) {
-    failed = true;
-    sendError = "Attachment chunks incomplete";
-  }
+  const String checksum = reader.hash().finishHex();
 
   if (!ensureMessengerSessionSubscription(ctx, backgroundTick, false)) {
     failed = true;
@@ -1348,7 +1551,8 @@ AttachmentSendResult sendAttachmentViaAgentRequest(
     endMessage += caption;
   }
   endMessage +=
-      "\nReconstruct ATTACHMENT_CHUNK parts with same id in order and process as one file.";
+      "\nReconstruct ATTACHMENT_CHUNK parts with same id in seq order (chunks may arrive out "
+      "of order or more than once; keep one per seq) and process as one file.";
 
   if (!sendAgentRequestMessage(ctx,
                                sessionKey,
@@ -1366,33 +1570,377 @@ AttachmentSendResult sendAttachmentViaAgentRequest(
   return result;
 }
 
-const char *chatSendAttachmentType(AttachmentKind kind, const String &mimeType) {
-  if (kind == AttachmentKind::Voice) {
-    return "audio";
+// Uploads a voice note as agent.request ATTACHMENT frames while it is being
+// recorded. The capture side only encodes chunks and queues them; a sender
+// task does the socket writes (single attempt each), so a slow or stalled
+// gateway never holds up the mic. A full queue or a failed send breaks the
+// stream. The SHA-256 covers the streamed bytes and is sent in END with the
+// final header, since the streamed header has placeholder sizes. A broken
+// stream is reported so the SD spool can be sent through the regular path.
+class VoiceStreamUpload {
+ public:
+  VoiceStreamUpload(AppContext &ctx, const String &fileName, const String &mimeType)
+      : ctx_(ctx), fileName_(fileName), mimeType_(mimeType) {}
+
+  ~VoiceStreamUpload() {
+    stopSender();
+    if (queue_) {
+      vQueueDelete(queue_);
+    }
+    if (senderDone_) {
+      vSemaphoreDelete(senderDone_);
+    }
+    if (gatewayLock_) {
+      vSemaphoreDelete(gatewayLock_);
+    }
   }
-  return isImageMimeType(mimeType) ? "image" : "file";
-}
 
-AttachmentSendResult sendAttachmentViaChatSend(
-    AppContext &ctx,
-    const String &filePath,
-    const String &mimeType,
-    AttachmentKind kind,
-    const String &target,
-    const String &caption,
-    uint32_t totalBytes,
-    const std::function<void()> &backgroundTick) {
-  AttachmentSendResult result;
-  result.ok = false;
-  result.route = AttachmentRoute::Failed;
-  result.eventName = "chat.send";
-  result.mimeType = mimeType;
-  result.fileName = baseName(filePath);
+  bool begin(const std::function<void()> &backgroundTick) {
+    messageId_ = makeMessageId(attachmentKindToken(AttachmentKind::Voice));
+    target_ = defaultAgentId();
+    if (!ensureMessengerSessionSubscription(ctx_, backgroundTick, false)) {
+      error_ = "Chat subscribe failed";
+      return false;
+    }
+    sessionKey_ = activeMessengerSessionKey();
+
+    raw_.reserve(kAgentAttachmentChunkBytes);
+    encoded_.assign(kAgentAttachmentBase64ChunkBytes, 0);
+    hash_.reset();
+
+    sendChatSessionEvent(ctx_, "chat.unsubscribe", sessionKey_);
+    gSubscribedSessionKey = "";
+    gSubscribedConnectOkMs = 0;
+    unsubscribed_ = true;
+
+    String beginMessage;
+    beginMessage.reserve(512U);
+    beginMessage += "[ATTACHMENT_BEGIN]\n";
+    beginMessage += "id:";
+    beginMessage += messageId_;
+    beginMessage += "\nkind:";
+    beginMessage += attachmentKindToken(AttachmentKind::Voice);
+    beginMessage += "\nname:";
+    beginMessage += fileName_;
+    beginMessage += "\nmime:";
+    beginMessage += mimeType_;
+    beginMessage += "\ntransfer:stream";
+    beginMessage += "\nencoding:base64";
+    beginMessage += "\nreply:ignore chunk transport and wait for END (size and checksum follow in END)";
+
+    if (!sendAgentRequestMessage(ctx_,
+                                 sessionKey_,
+                                 target_,
+                                 beginMessage,
+                                 backgroundTick,
+                                 &error_)) {
+      fail(error_.isEmpty() ? String("Attachment begin send failed") : error_);
+      resubscribe(backgroundTick);
+      return false;
+    }
+    if (!startSender()) {
+      fail("Upload task start failed");
+      abort();
+      resubscribe(backgroundTick);
+      return false;
+    }
+    active_ = true;
+    return true;
+  }
+
+  // Runs tick unless the sender task is using the gateway right now; capture
+  // loops call this instead of their background tick while streaming.
+  void tickIfGatewayIdle(const std::function<void()> &tick) {
+    if (!tick) {
+      return;
+    }
+    if (!gatewayLock_) {
+      tick();
+      return;
+    }
+    if (xSemaphoreTake(gatewayLock_, 0) == pdTRUE) {
+      tick();
+      xSemaphoreGive(gatewayLock_);
+    }
+  }
+
+  // Sink callback; returns false only once the stream is broken.
+  bool accept(const uint8_t *data, size_t length) {
+    if (!active_) {
+      return false;
+    }
+    if (sendFailed_) {
+      stopSender();
+      fail(sendError_);
+      return false;
+    }
+    hash_.update(data, length);
+    totalBytes_ += static_cast<uint32_t>(length);
+    if (totalBytes_ > kAgentAttachmentMaxBytes) {
+      fail("Binary attachment exceeds limit");
+      return false;
+    }
+
+    while (length > 0) {
+      const size_t take = std::min(length, kAgentAttachmentChunkBytes - raw_.size());
+      raw_.insert(raw_.end(), data, data + take);
+      data += take;
+      length -= take;
+      if (raw_.size() == kAgentAttachmentChunkBytes && !flushChunk()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool finish(const uint8_t *header, size_t headerLength) {
+    if (!active_) {
+      return false;
+    }
+    if (!raw_.empty() && !flushChunk()) {
+      return false;
+    }
+    stopSender();
+    if (sendFailed_) {
+      fail(sendError_);
+      return false;
+    }
+
+    char headerBase64[((VoiceWavWriter::kMaxHeaderBytes + 2U) / 3U) * 4U + 1U] = {0};
+    if (!encodeBase64(header, headerLength, headerBase64, sizeof(headerBase64))) {
+      fail("Base64 encode failed");
+      return false;
+    }
+
+    const String checksum = hash_.finishHex();
+
+    String endMessage;
+    endMessage.reserve(768U);
+    endMessage += "[ATTACHMENT_END]\n";
+    endMessage += "id:";
+    endMessage += messageId_;
+    endMessage += "\nkind:";
+    endMessage += attachmentKindToken(AttachmentKind::Voice);
+    endMessage += "\nname:";
+    endMessage += fileName_;
+    endMessage += "\nmime:";
+    endMessage += mimeType_;
+    endMessage += "\nsize:";
+    endMessage += String(static_cast<unsigned long>(totalBytes_));
+    endMessage += "\nchunks:";
+    endMessage += String(static_cast<unsigned long>(chunks_));
+    endMessage += "\nchecksum:";
+    endMessage += checksum;
+    endMessage += "\ntransfer:stream";
+    endMessage += "\nheaderBytes:";
+    endMessage += String(static_cast<unsigned long>(headerLength));
+    endMessage += "\nheader:";
+    endMessage += headerBase64;
+    endMessage +=
+        "\nReconstruct ATTACHMENT_CHUNK parts with same id in order, verify checksum, "
+        "then overwrite the first headerBytes bytes with header and process as one file.";
+
+    if (!sendAgentRequestMessage(ctx_,
+                                 sessionKey_,
+                                 target_,
+                                 endMessage,
+                                 std::function<void()>(),
+                                 &error_,
+                                 1)) {
+      fail(error_.isEmpty() ? String("Attachment end send failed") : error_);
+      return false;
+    }
+    active_ = false;
+    done_ = true;
+    return true;
+  }
+
+  // Tells the gateway to drop a partial stream; best effort.
+  void abort() {
+    stopSender();
+    if (messageId_.isEmpty() || done_ || sessionKey_.isEmpty()) {
+      return;
+    }
+    String abortMessage = "[ATTACHMENT_ABORT]\nid:";
+    abortMessage += messageId_;
+    abortMessage += "\nreply:ignore";
+    sendAgentRequestMessage(ctx_,
+                            sessionKey_,
+                            target_,
+                            abortMessage,
+                            std::function<void()>(),
+                            nullptr,
+                            1);
+    active_ = false;
+  }
+
+  void resubscribe(const std::function<void()> &backgroundTick) {
+    if (unsubscribed_) {
+      ensureMessengerSessionSubscription(ctx_, backgroundTick, false);
+      unsubscribed_ = false;
+    }
+  }
+
+  bool done() const { return done_; }
+  const String &error() const { return error_; }
+  const String &messageId() const { return messageId_; }
+  const String &target() const { return target_; }
+  uint32_t totalBytes() const { return totalBytes_; }
+
+ private:
+  bool flushChunk() {
+    if (chunks_ >= kAgentAttachmentMaxChunks) {
+      fail("Chunk count out of range");
+      return false;
+    }
+
+    size_t encodedLen = 0;
+    if (!encodeBase64(raw_.data(), raw_.size(), encoded_.data(), encoded_.size(), &encodedLen)) {
+      fail("Base64 encode failed");
+      return false;
+    }
+
+    String *chunkMessage = new String();
+    chunkMessage->reserve(encodedLen + 320U);
+    *chunkMessage += "[ATTACHMENT_CHUNK]\n";
+    *chunkMessage += "id:";
+    *chunkMessage += messageId_;
+    *chunkMessage += "\nseq:";
+    *chunkMessage += String(static_cast<unsigned long>(chunks_ + 1U));
+    *chunkMessage += "\nbytes:";
+    *chunkMessage += String(static_cast<unsigned long>(raw_.size()));
+    *chunkMessage += "\ndata:";
+    *chunkMessage += encoded_.data();
+    *chunkMessage += "\nreply:ignore";
+
+    // Never wait here: a full queue means the link cannot keep up.
+    if (xQueueSend(queue_, &chunkMessage, 0) != pdTRUE) {
+      delete chunkMessage;
+      fail("Upload backlog full");
+      return false;
+    }
+    ++chunks_;
+    raw_.clear();
+    return true;
+  }
+
+  bool startSender() {
+    queue_ = xQueueCreate(kVoiceUploadQueueDepth, sizeof(String *));
+    senderDone_ = xSemaphoreCreateBinary();
+    gatewayLock_ = xSemaphoreCreateMutex();
+    if (!queue_ || !senderDone_ || !gatewayLock_) {
+      return false;
+    }
+    if (xTaskCreate(&VoiceStreamUpload::senderEntry,
+                    "voice_tx",
+                    kVoiceUploadTaskStackBytes,
+                    this,
+                    kVoiceUploadTaskPriority,
+                    &sender_) != pdPASS) {
+      sender_ = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  // Lets the sender finish what is queued (or drop it after a failure) and
+  // waits for the task to exit.
+  void stopSender() {
+    if (!sender_) {
+      return;
+    }
+    String *stop = nullptr;
+    xQueueSend(queue_, &stop, portMAX_DELAY);
+    xSemaphoreTake(senderDone_, portMAX_DELAY);
+    sender_ = nullptr;
+  }
+
+  static void senderEntry(void *arg) {
+    static_cast<VoiceStreamUpload *>(arg)->runSender();
+    vTaskDelete(nullptr);
+  }
+
+  void runSender() {
+    String *message = nullptr;
+    while (xQueueReceive(queue_, &message, portMAX_DELAY) == pdTRUE && message) {
+      if (!sendFailed_) {
+        String sendError;
+        xSemaphoreTake(gatewayLock_, portMAX_DELAY);
+        const bool sent = sendAgentRequestMessage(ctx_,
+                                                  sessionKey_,
+                                                  target_,
+                                                  *message,
+                                                  std::function<void()>(),
+                                                  &sendError,
+                                                  1);
+        xSemaphoreGive(gatewayLock_);
+        if (!sent) {
+          sendError_ = sendError.isEmpty() ? String("Attachment chunk send failed") : sendError;
+          sendFailed_ = true;
+        }
+      }
+      delete message;
+    }
+    xSemaphoreGive(senderDone_);
+  }
+
+  void fail(const String &reason) {
+    error_ = reason;
+    active_ = false;
+  }
+
+  AppContext &ctx_;
+  String fileName_;
+  String mimeType_;
+  String messageId_;
+  String sessionKey_;
+  String target_;
+  String error_;
+  Sha256Stream hash_;
+  std::vector<uint8_t> raw_;
+  std::vector<char> encoded_;
+  uint32_t totalBytes_ = 0;
+  uint16_t chunks_ = 0;
+  bool active_ = false;
+  bool done_ = false;
+  bool unsubscribed_ = false;
+  QueueHandle_t queue_ = nullptr;
+  SemaphoreHandle_t senderDone_ = nullptr;
+  SemaphoreHandle_t gatewayLock_ = nullptr;
+  TaskHandle_t sender_ = nullptr;
+  // Written by the sender task; sendError_ is read only after the flag.
+  volatile bool sendFailed_ = false;
+  String sendError_;
+};
+
+const char *chatSendAttachmentType(AttachmentKind kind, const String &mimeType) {
+  if (kind == AttachmentKind::Voice) {
+    return "audio";
+  }
+  return isImageMimeType(mimeType) ? "image" : "file";
+}
+
+AttachmentSendResult sendAttachmentViaChatSend(
+    AppContext &ctx,
+    const String &filePath,
+    const String &mimeType,
+    AttachmentKind kind,
+    const String &target,
+    const String &caption,
+    uint32_t totalBytes,
+    const std::function<void()> &backgroundTick) {
+  AttachmentSendResult result;
+  result.ok = false;
+  result.route = AttachmentRoute::Failed;
+  result.eventName = "chat.send";
+  result.mimeType = mimeType;
+  result.fileName = baseName(filePath);
   result.totalBytes = totalBytes;
   result.messageId = makeMessageId(attachmentKindToken(kind));
 
   if (totalBytes == 0 || totalBytes > kChatSendAttachmentMaxBytes) {
     result.error = "Attachment too large for chat.send";
+    result.permanent = true;
     return result;
   }
   if (!ensureMessengerSessionSubscription(ctx, backgroundTick)) {
@@ -1406,6 +1954,7 @@ AttachmentSendResult sendAttachmentViaChatSend(
       file.close();
     }
     result.error = "Attachment open failed";
+    result.permanent = true;
     return result;
   }
 
@@ -1426,11 +1975,13 @@ AttachmentSendResult sendAttachmentViaChatSend(
     if (readLen == 0) {
       file.close();
       result.error = "Attachment read failed";
+      result.permanent = true;
       return result;
     }
     if (!encodeBase64(raw.data(), readLen, encoded.data(), encoded.size())) {
       file.close();
       result.error = "Base64 encode failed";
+      result.permanent = true;
       return result;
     }
     base64 += encoded.data();
@@ -1496,12 +2047,14 @@ AttachmentSendResult sendLegacyAttachmentChunks(
   }
   if (totalBytes == 0) {
     result.error = "Attachment is empty";
+    result.permanent = true;
     return result;
   }
   const uint32_t legacyMaxBytes =
       kind == AttachmentKind::Voice ? kMaxVoiceBytes : kMaxFileBytes;
   if (totalBytes > legacyMaxBytes) {
     result.error = "Legacy chunk payload too large";
+    result.permanent = true;
     return result;
   }
   if (!ensureMessengerSessionSubscription(ctx, backgroundTick)) {
@@ -1547,6 +2100,7 @@ AttachmentSendResult sendLegacyAttachmentChunks(
       file.close();
     }
     result.error = "Attachment open failed";
+    result.permanent = true;
     return result;
   }
 
@@ -1661,55 +2215,90 @@ AttachmentSendResult sendLegacyVoiceChunks(
                                     "msg.voice.chunk");
 }
 
-bool sendAttachmentMessage(AppContext &ctx,
-                           AttachmentKind kind,
-                           const String &filePath,
-                           const String &caption,
-                           const std::function<void()> &backgroundTick) {
-  const String uiTitle = attachmentUiTitle(kind);
+outbox::Kind outboxKind(AttachmentKind kind) {
+  return kind == AttachmentKind::Voice ? outbox::Kind::Voice : outbox::Kind::File;
+}
+
+AttachmentKind attachmentKind(outbox::Kind kind) {
+  return kind == outbox::Kind::Voice ? AttachmentKind::Voice : AttachmentKind::File;
+}
+
+void recordSentAttachment(AttachmentKind kind,
+                          const AttachmentSendResult &sendResult,
+                          const String &target,
+                          const String &caption,
+                          const String &filePath,
+                          const String &mimeType,
+                          uint32_t totalBytes) {
+  outbox::Entry sent;
+  sent.id = sendResult.messageId.isEmpty() ? makeMessageId(attachmentKindToken(kind))
+                                           : sendResult.messageId;
+  sent.kind = outboxKind(kind);
+  sent.state = outbox::State::Sent;
+  sent.sessionKey = activeMessengerSessionKey();
+  sent.to = target;
+  sent.text = caption;
+  sent.path = filePath;
+  sent.fileName = sendResult.fileName.isEmpty() ? baseName(filePath) : sendResult.fileName;
+  sent.mimeType = sendResult.mimeType.isEmpty() ? mimeType : sendResult.mimeType;
+  sent.bytes = sendResult.totalBytes > 0 ? sendResult.totalBytes : totalBytes;
+  sent.tsMs = currentUnixMs();
+  if (outbox::add(sent)) {
+    recordOutgoingHistory(sent);
+  }
+}
+
+// Checks an attachment before it is queued; sets *totalBytes on success.
+bool checkAttachmentFile(AttachmentKind kind,
+                         const String &filePath,
+                         uint32_t *totalBytes,
+                         String *error) {
   if (filePath.isEmpty()) {
-    ctx.uiRuntime->showToast(uiTitle, "Path is empty", 1300, backgroundTick);
+    *error = "Path is empty";
     return false;
   }
 
-  const String target = defaultAgentId();
-  const String mimeType =
-      kind == AttachmentKind::Voice ? detectAudioMime(filePath) : detectFileMime(filePath);
-
   File file = SD.open(filePath.c_str(), FILE_READ);
   if (!file || file.isDirectory()) {
     if (file) {
       file.close();
     }
-    ctx.uiRuntime->showToast(uiTitle,
-                             kind == AttachmentKind::Voice ? "Open voice file failed"
-                                                           : "Open file failed",
-                             1600,
-                             backgroundTick);
+    *error = kind == AttachmentKind::Voice ? "Open voice file failed" : "Open file failed";
     return false;
   }
 
-  const uint32_t totalBytes = static_cast<uint32_t>(file.size());
+  *totalBytes = static_cast<uint32_t>(file.size());
   file.close();
-  if (totalBytes == 0) {
-    ctx.uiRuntime->showToast(uiTitle,
-                             kind == AttachmentKind::Voice ? "Voice file is empty"
-                                                           : "File is empty",
-                             1500,
-                             backgroundTick);
+  if (*totalBytes == 0) {
+    *error = kind == AttachmentKind::Voice ? "Voice file is empty" : "File is empty";
     return false;
   }
 
   const uint32_t routeMaxBytes =
       kind == AttachmentKind::Voice ? kMaxVoiceBytes : kMaxFileBytes;
-  if (totalBytes > routeMaxBytes) {
-    ctx.uiRuntime->showToast(uiTitle,
-                             kind == AttachmentKind::Voice ? "File too large (max 2MB)"
-                                                           : "File too large (max 4MB)",
-                             1800,
-                             backgroundTick);
+  if (*totalBytes > routeMaxBytes) {
+    *error = kind == AttachmentKind::Voice ? "File too large (max 2MB)"
+                                           : "File too large (max 4MB)";
     return false;
   }
+  return true;
+}
+
+AttachmentSendResult deliverAttachment(AppContext &ctx,
+                                       AttachmentKind kind,
+                                       const String &filePath,
+                                       const String &caption,
+                                       const std::function<void()> &backgroundTick) {
+  AttachmentSendResult sendResult;
+  uint32_t totalBytes = 0;
+  if (!checkAttachmentFile(kind, filePath, &totalBytes, &sendResult.error)) {
+    sendResult.permanent = true;
+    return sendResult;
+  }
+
+  const String target = defaultAgentId();
+  const String mimeType =
+      kind == AttachmentKind::Voice ? detectAudioMime(filePath) : detectFileMime(filePath);
 
   bool framedPreferred = false;
   String fallbackReason;
@@ -1726,7 +2315,6 @@ bool sendAttachmentMessage(AppContext &ctx,
     fallbackReason = "Binary size exceeds framed route limit";
   }
 
-  AttachmentSendResult sendResult;
   if (totalBytes <= kChatSendAttachmentMaxBytes) {
     sendResult = sendAttachmentViaChatSend(ctx,
                                            filePath,
@@ -1780,50 +2368,150 @@ bool sendAttachmentMessage(AppContext &ctx,
                                             backgroundTick);
   }
 
-  if (!sendResult.ok) {
+  if (!sendResult.ok && sendResult.error.isEmpty()) {
+    sendResult.error = "Send failed";
+  }
+  return sendResult;
+}
+
+// Sends queued attachments at the head of the outbox. Queued texts ahead of
+// them belong to the background drainer; with waitForTexts they are given a
+// moment to clear, otherwise this returns. Stops when the gateway drops or an
+// attachment is queued again after a transport failure; it is retried once
+// its backoff has passed.
+void drainOutboxAttachments(AppContext &ctx,
+                            const std::function<void()> &backgroundTick,
+                            bool waitForTexts) {
+  unsigned long waitStartMs = 0;
+  while (ctx.gateway->status().gatewayReady) {
+    outbox::Entry head;
+    if (!outbox::head(head)) {
+      return;
+    }
+    if (head.kind != outbox::Kind::Text && head.state == outbox::State::Queued &&
+        head.id == gAttachRetryId && static_cast<long>(millis() - gAttachRetryAtMs) < 0) {
+      if (waitForTexts) {
+        ctx.uiRuntime->showToast(attachmentUiTitle(attachmentKind(head.kind)),
+                                 "Queued behind a retry",
+                                 1300,
+                                 backgroundTick);
+      }
+      return;
+    }
+    if (head.kind == outbox::Kind::Text || head.state == outbox::State::Sending) {
+      if (!waitForTexts) {
+        return;
+      }
+      if (waitStartMs == 0) {
+        waitStartMs = millis();
+      } else if (millis() - waitStartMs >= kTextSendWaitMs * 8UL) {
+        return;
+      }
+      if (backgroundTick) {
+        backgroundTick();
+      }
+      delay(10);
+      continue;
+    }
+    waitStartMs = 0;
+
+    const AttachmentKind kind = attachmentKind(head.kind);
+    ensureSdMountedForVoice();
+    outbox::setState(head.id, outbox::State::Sending);
+    ensureMessengerSessionSubscription(ctx, backgroundTick, false);
+    const AttachmentSendResult sendResult =
+        deliverAttachment(ctx, kind, head.path, head.text, backgroundTick);
+    if (sendResult.ok) {
+      gAttachRetryId = "";
+      outbox::setState(head.id, outbox::State::Sent);
+      ctx.uiRuntime->showToast(attachmentUiTitle(kind),
+                               attachmentRouteToast(sendResult.route),
+                               1300,
+                               backgroundTick);
+      continue;
+    }
+
     String errorMessage = sendResult.error;
     errorMessage.trim();
-    if (errorMessage.isEmpty()) {
-      errorMessage = "Send failed";
+    // Only a problem with the file fails at once. Transport errors, even
+    // with the link up, are queued again with a growing delay until the
+    // attempts run out (head.attempts predates this try).
+    const uint8_t attempts = static_cast<uint8_t>(head.attempts + 1U);
+    const bool giveUp = sendResult.permanent || attempts >= kAttachOutboxMaxAttempts;
+    outbox::setState(head.id,
+                     giveUp ? outbox::State::Failed : outbox::State::Queued,
+                     errorMessage);
+    if (giveUp) {
+      gAttachRetryId = "";
+      ctx.uiRuntime->showToast(attachmentUiTitle(kind), errorMessage, 1900, backgroundTick);
+      continue;
     }
-    ctx.uiRuntime->showToast(uiTitle, errorMessage, 1900, backgroundTick);
+    const unsigned long backoffMs = kAttachRetryBaseMs << std::min<uint8_t>(attempts - 1U, 4U);
+    gAttachRetryId = head.id;
+    gAttachRetryAtMs = millis() + backoffMs;
+    ctx.uiRuntime->showToast(attachmentUiTitle(kind),
+                             "Queued, retry in " + String(backoffMs / 1000UL) + " s",
+                             1900,
+                             backgroundTick);
+    return;
+  }
+}
+
+bool sendAttachmentMessage(AppContext &ctx,
+                           AttachmentKind kind,
+                           const String &filePath,
+                           const String &caption,
+                           const std::function<void()> &backgroundTick) {
+  const String uiTitle = attachmentUiTitle(kind);
+  uint32_t totalBytes = 0;
+  String checkError;
+  if (!checkAttachmentFile(kind, filePath, &totalBytes, &checkError)) {
+    ctx.uiRuntime->showToast(uiTitle, checkError, 1600, backgroundTick);
     return false;
   }
 
-  GatewayInboxMessage sent;
-  sent.id = sendResult.messageId.isEmpty() ? makeMessageId(attachmentKindToken(kind))
-                                           : sendResult.messageId;
-  sent.event = sendResult.eventName.isEmpty() ? "agent.request" : sendResult.eventName;
-  sent.type = attachmentKindToken(kind);
-  sent.from = kMessageSenderId;
-  sent.to = target;
-  sent.text = caption;
-  sent.fileName = sendResult.fileName.isEmpty() ? baseName(filePath) : sendResult.fileName;
-  sent.contentType = sendResult.mimeType.isEmpty() ? mimeType : sendResult.mimeType;
-  sent.voiceBytes = sendResult.totalBytes > 0 ? sendResult.totalBytes : totalBytes;
-  sent.tsMs = currentUnixMs();
-  pushOutbox(sent);
+  // The outbox keeps a reference to the file; it is read when sent.
+  outbox::Entry entry;
+  entry.id = makeMessageId(attachmentKindToken(kind));
+  entry.kind = outboxKind(kind);
+  entry.sessionKey = activeMessengerSessionKey();
+  entry.to = defaultAgentId();
+  entry.text = caption;
+  entry.path = filePath;
+  entry.fileName = baseName(filePath);
+  entry.mimeType =
+      kind == AttachmentKind::Voice ? detectAudioMime(filePath) : detectFileMime(filePath);
+  entry.bytes = totalBytes;
+  entry.tsMs = currentUnixMs();
+  String queueError;
+  if (!outbox::add(entry, &queueError)) {
+    ctx.uiRuntime->showToast(uiTitle,
+                             queueError.isEmpty() ? String("Send failed") : queueError,
+                             1600,
+                             backgroundTick);
+    return false;
+  }
+  recordOutgoingHistory(entry);
 
-  ctx.uiRuntime->showToast(uiTitle, attachmentRouteToast(sendResult.route), 1300, backgroundTick);
-  return true;
+  if (!ctx.gateway->status().gatewayReady) {
+    ctx.uiRuntime->showToast(uiTitle, "Queued, sends when online", 1300, backgroundTick);
+    return true;
+  }
+  drainOutboxAttachments(ctx, backgroundTick, true);
+  outbox::State state = outbox::State::Queued;
+  outbox::stateOf(entry.id, &state);
+  return state == outbox::State::Sent;
 }
 
 bool sendVoiceFileMessage(AppContext &ctx,
                           const String &filePath,
                           const String &caption,
                           const std::function<void()> &backgroundTick) {
-  if (!ensureGatewayReady(ctx, backgroundTick)) {
-    return false;
-  }
   return sendAttachmentMessage(ctx, AttachmentKind::Voice, filePath, caption, backgroundTick);
 }
 
 void sendVoiceMessage(AppContext &ctx,
                       const std::function<void()> &backgroundTick) {
-  if (!ensureGatewayReady(ctx, backgroundTick)) {
-    return;
-  }
-
   String filePath = "/voice.wav";
   if (!ctx.uiRuntime->textInput("Voice File Path", filePath, false, backgroundTick)) {
     return;
@@ -1849,28 +2537,157 @@ void sendVoiceMessage(AppContext &ctx,
   sendVoiceFileMessage(ctx, filePath, String(), backgroundTick);
 }
 
-void recordVoiceFromMic(AppContext &ctx,
+// tick is the background tick to use during capture. droppedSamples reports
+// capture overruns (0 when the source has none).
+using VoiceRecordFn = std::function<bool(const String &path,
+                                         const VoiceWavStreamSink *sink,
+                                         const std::function<void()> &tick,
+                                         String *error,
+                                         uint32_t *bytesWritten,
+                                         uint32_t *droppedSamples)>;
+
+// Records a voice note and delivers it. With stream upload enabled the audio
+// goes out while capture runs; the SD copy (when spooling) is only re-read if
+// the live stream broke.
+void recordAndSendVoice(AppContext &ctx,
+                        const String &uiTitle,
+                        const String &failFallback,
+                        const String &voicePath,
+                        const VoiceRecordFn &record,
                         const std::function<void()> &backgroundTick) {
-  if (!ensureGatewayReady(ctx, backgroundTick)) {
+  const bool spoolToSd = !kVoiceStreamUploadEnabled || kVoiceSdSpoolEnabled;
+  VoiceStreamUpload upload(ctx, baseName(voicePath), voiceWavMime(kVoiceEncoding));
+  VoiceWavStreamSink sink;
+  if (kVoiceStreamUploadEnabled) {
+    if (upload.begin(backgroundTick)) {
+      sink.onData = [&upload, spoolToSd](const uint8_t *data, size_t length) {
+        return upload.accept(data, length) || spoolToSd;
+      };
+      sink.onFinish = [&upload, spoolToSd](const uint8_t *header, size_t length) {
+        return upload.finish(header, length) || spoolToSd;
+      };
+    } else if (!spoolToSd) {
+      ctx.uiRuntime->showToast("Voice", upload.error(), 1800, backgroundTick);
+      return;
+    }
+  }
+
+  String recordErr;
+  uint32_t bytesWritten = 0;
+  uint32_t droppedSamples = 0;
+  bool recorded = false;
+  {
+    ScopedOkBackBlock guard(ctx.uiRuntime);
+    recorded = record(spoolToSd ? voicePath : String(),
+                      sink.onData ? &sink : nullptr,
+                      [&upload, &backgroundTick]() { upload.tickIfGatewayIdle(backgroundTick); },
+                      &recordErr,
+                      &bytesWritten,
+                      &droppedSamples);
+  }
+
+  if (!upload.done()) {
+    upload.abort();
+  }
+  upload.resubscribe(backgroundTick);
+
+  if (!recorded) {
+    ctx.uiRuntime->showToast(uiTitle,
+                             recordErr.isEmpty() ? failFallback : recordErr,
+                             1800,
+                             backgroundTick);
     return;
   }
+  if (droppedSamples > 0) {
+    ctx.uiRuntime->showToast(uiTitle,
+                             "Mic overrun: " + String(static_cast<unsigned long>(droppedSamples)) +
+                                 " samples lost",
+                             1500,
+                             backgroundTick);
+  }
 
-  if (!isMicRecordingAvailable()) {
-    ctx.uiRuntime->showToast("Voice", "MIC is not configured", 1700, backgroundTick);
+  if (upload.done()) {
+    AttachmentSendResult sent;
+    sent.ok = true;
+    sent.route = AttachmentRoute::Streamed;
+    sent.messageId = upload.messageId();
+    sent.eventName = "agent.request";
+    sent.mimeType = voiceWavMime(kVoiceEncoding);
+    sent.fileName = baseName(voicePath);
+    sent.totalBytes = upload.totalBytes();
+    recordSentAttachment(AttachmentKind::Voice,
+                       sent,
+                       upload.target(),
+                       String(),
+                       voicePath,
+                       sent.mimeType,
+                       sent.totalBytes);
+    ctx.uiRuntime->showToast("Voice", attachmentRouteToast(sent.route), 1300, backgroundTick);
     return;
   }
 
-  uint16_t recordSeconds = 0;
-  if (!askVoiceRecordSeconds(ctx, backgroundTick, &recordSeconds)) {
+  if (!spoolToSd) {
+    ctx.uiRuntime->showToast("Voice",
+                             upload.error().isEmpty() ? String("Voice stream failed")
+                                                      : upload.error(),
+                             1800,
+                             backgroundTick);
+    return;
+  }
+
+  if (bytesWritten > kMaxVoiceBytes) {
+    SD.remove(voicePath.c_str());
+    dirlisting::noteChanged(voicePath);
+    ctx.uiRuntime->showToast("Voice", "Recording too large for send", 1700, backgroundTick);
     return;
   }
 
+  if (kVoiceStreamUploadEnabled && !upload.error().isEmpty()) {
+    ctx.uiRuntime->showToast("Voice",
+                             "Live upload stopped (" + upload.error() + "), sending saved copy",
+                             1700,
+                             backgroundTick);
+  }
+  sendVoiceFileMessage(ctx, voicePath, String(), backgroundTick);
+}
+
+bool ensureVoiceSpoolReady(AppContext &ctx, const std::function<void()> &backgroundTick) {
+  if (kVoiceStreamUploadEnabled && !kVoiceSdSpoolEnabled) {
+    return true;
+  }
   String mountErr;
   if (!ensureSdMountedForVoice(&mountErr)) {
     ctx.uiRuntime->showToast("Voice",
                       mountErr.isEmpty() ? String("SD mount failed") : mountErr,
                       1600,
                       backgroundTick);
+    return false;
+  }
+  return true;
+}
+
+// Recordings spooled to SD can wait in the outbox; stream-only ones cannot.
+bool voiceNeedsGateway() {
+  return kVoiceStreamUploadEnabled && !kVoiceSdSpoolEnabled;
+}
+
+void recordVoiceFromMic(AppContext &ctx,
+                        const std::function<void()> &backgroundTick) {
+  if (voiceNeedsGateway() && !ensureGatewayReady(ctx, backgroundTick)) {
+    return;
+  }
+
+  if (!isMicRecordingAvailable()) {
+    ctx.uiRuntime->showToast("Voice", "MIC is not configured", 1700, backgroundTick);
+    return;
+  }
+
+  uint16_t recordSeconds = 0;
+  if (!askVoiceRecordSeconds(ctx, backgroundTick, &recordSeconds)) {
+    return;
+  }
+
+  if (!ensureVoiceSpoolReady(ctx, backgroundTick)) {
     return;
   }
 
@@ -1883,33 +2700,29 @@ void recordVoiceFromMic(AppContext &ctx,
   recordingMsg += "s...";
   ctx.uiRuntime->showToast("Voice", recordingMsg, 900, backgroundTick);
 
-  String recordErr;
-  uint32_t bytesWritten = 0;
-  {
-    ScopedOkBackBlock guard(ctx.uiRuntime);
-    const std::function<void()> noBackgroundTick;
-    if (!recordMicWavToSd(voicePath,
-                          recordSeconds,
-                          noBackgroundTick,
-                          std::function<bool()>(),
-                          &recordErr,
-                          &bytesWritten)) {
-      ctx.uiRuntime->showToast("Voice",
-                        recordErr.isEmpty() ? String("MIC recording failed")
-                                            : recordErr,
-                        1800,
-                        backgroundTick);
-      return;
-    }
-  }
-
-  if (bytesWritten > kMaxVoiceBytes) {
-    SD.remove(voicePath.c_str());
-    ctx.uiRuntime->showToast("Voice", "Recording too large for send", 1700, backgroundTick);
-    return;
-  }
-
-  sendVoiceFileMessage(ctx, voicePath, String(), backgroundTick);
+  recordAndSendVoice(
+      ctx,
+      "Voice",
+      "MIC recording failed",
+      voicePath,
+      [recordSeconds](const String &path,
+                      const VoiceWavStreamSink *sink,
+                      const std::function<void()> &,
+                      String *error,
+                      uint32_t *bytesWritten,
+                      uint32_t *droppedSamples) {
+        const std::function<void()> noBackgroundTick;
+        return recordMicWavToSd(path,
+                                recordSeconds,
+                                noBackgroundTick,
+                                std::function<bool()>(),
+                                error,
+                                bytesWritten,
+                                kVoiceEncoding,
+                                sink,
+                                droppedSamples);
+      },
+      backgroundTick);
 }
 
 bool recordVoiceFromBle(AppContext &ctx,
@@ -1931,7 +2744,7 @@ bool recordVoiceFromBle(AppContext &ctx,
     return false;
   }
 
-  if (!ensureGatewayReady(ctx, backgroundTick)) {
+  if (voiceNeedsGateway() && !ensureGatewayReady(ctx, backgroundTick)) {
     return true;
   }
 
@@ -1940,12 +2753,7 @@ bool recordVoiceFromBle(AppContext &ctx,
     return true;
   }
 
-  String mountErr;
-  if (!ensureSdMountedForVoice(&mountErr)) {
-    ctx.uiRuntime->showToast("Voice",
-                      mountErr.isEmpty() ? String("SD mount failed") : mountErr,
-                      1600,
-                      backgroundTick);
+  if (!ensureVoiceSpoolReady(ctx, backgroundTick)) {
     return true;
   }
 
@@ -1958,32 +2766,28 @@ bool recordVoiceFromBle(AppContext &ctx,
   recordingMsg += "s...";
   ctx.uiRuntime->showToast("BLE", recordingMsg, 900, backgroundTick);
 
-  String recordErr;
-  uint32_t bytesWritten = 0;
-  {
-    ScopedOkBackBlock guard(ctx.uiRuntime);
-    if (!ctx.ble->recordAudioStreamWavToSd(voicePath,
-                                           recordSeconds,
-                                           backgroundTick,
-                                           std::function<bool()>(),
-                                           &recordErr,
-                                           &bytesWritten)) {
-      ctx.uiRuntime->showToast("BLE",
-                        recordErr.isEmpty() ? String("BLE recording failed")
-                                            : recordErr,
-                        1800,
-                        backgroundTick);
-      return true;
-    }
-  }
-
-  if (bytesWritten > kMaxVoiceBytes) {
-    SD.remove(voicePath.c_str());
-    ctx.uiRuntime->showToast("Voice", "Recording too large for send", 1700, backgroundTick);
-    return true;
-  }
-
-  sendVoiceFileMessage(ctx, voicePath, String(), backgroundTick);
+  recordAndSendVoice(
+      ctx,
+      "BLE",
+      "BLE recording failed",
+      voicePath,
+      [&ctx, recordSeconds](const String &path,
+                            const VoiceWavStreamSink *sink,
+                            const std::function<void()> &tick,
+                            String *error,
+                            uint32_t *bytesWritten,
+                            uint32_t *droppedSamples) {
+        *droppedSamples = 0;
+        return ctx.ble->recordAudioStreamWavToSd(path,
+                                                 recordSeconds,
+                                                 tick,
+                                                 std::function<bool()>(),
+                                                 error,
+                                                 bytesWritten,
+                                                 kVoiceEncoding,
+                                                 sink);
+      },
+      backgroundTick);
   return true;
 }
 
@@ -1998,10 +2802,6 @@ void recordVoiceMessage(AppContext &ctx,
 
 void sendFileMessage(AppContext &ctx,
                      const std::function<void()> &backgroundTick) {
-  if (!ensureGatewayReady(ctx, backgroundTick)) {
-    return;
-  }
-
   String mountErr;
   if (!ensureSdMountedForVoice(&mountErr)) {
     ctx.uiRuntime->showToast("File",
@@ -2024,8 +2824,7 @@ void sendFileMessage(AppContext &ctx,
   sendAttachmentMessage(ctx, AttachmentKind::File, filePath, caption, backgroundTick);
 }
 
-String makeChatPreview(const ChatEntry &entry) {
-  const GatewayInboxMessage &message = entry.message;
+String makeChatPreview(const chathistory::Message &message) {
   String body;
   const bool isVoice = message.type.startsWith("voice");
   const bool isFile = message.type.startsWith("file");
@@ -2034,8 +2833,8 @@ String makeChatPreview(const ChatEntry &entry) {
     body = "[Voice] ";
     if (!message.fileName.isEmpty()) {
       body += message.fileName;
-    } else if (message.voiceBytes > 0) {
-      body += String(message.voiceBytes) + " bytes";
+    } else if (message.bytes > 0) {
+      body += String(message.bytes) + " bytes";
     } else {
       body += "attachment";
     }
@@ -2043,8 +2842,8 @@ String makeChatPreview(const ChatEntry &entry) {
     body = "[File] ";
     if (!message.fileName.isEmpty()) {
       body += message.fileName;
-    } else if (message.voiceBytes > 0) {
-      body += String(message.voiceBytes) + " bytes";
+    } else if (message.bytes > 0) {
+      body += String(message.bytes) + " bytes";
     } else {
       body += "attachment";
     }
@@ -2056,85 +2855,55 @@ String makeChatPreview(const ChatEntry &entry) {
     body = "(no text)";
   }
 
-  String label = entry.outgoing ? "Me: " : "Agent: ";
+  String label = "Agent: ";
+  if (message.outgoing) {
+    outbox::State state = outbox::State::Queued;
+    if (outbox::stateOf(message.id, &state)) {
+      label = state == outbox::State::Sent     ? "Me: "
+              : state == outbox::State::Failed ? "Me (failed): "
+                                               : "Me (queued): ";
+    } else if (message.delivery == chathistory::Delivery::Sent) {
+      label = "Me: ";
+    } else if (message.delivery == chathistory::Delivery::Failed) {
+      label = "Me (failed): ";
+    } else {
+      // Left the outbox before its outcome reached the history.
+      label = "Me (unconfirmed): ";
+    }
+  }
   label += body;
   return label;
 }
 
-std::vector<ChatEntry> collectChatEntries(AppContext &ctx) {
-  std::vector<ChatEntry> entries;
-  const size_t inboxCount = ctx.gateway->inboxCount();
-  entries.reserve(inboxCount + gOutboxCount);
-
-  for (size_t i = 0; i < inboxCount; ++i) {
-    GatewayInboxMessage message;
-    if (!ctx.gateway->inboxMessage(i, message)) {
-      continue;
-    }
-    ChatEntry entry;
-    entry.message = message;
-    entry.outgoing = false;
-    entries.push_back(entry);
-  }
-
-  for (size_t i = 0; i < gOutboxCount; ++i) {
-    GatewayInboxMessage message;
-    if (!outboxMessage(i, message)) {
-      continue;
+// Chat history as the messenger's line source; only the lines on screen are
+// read back.
+UiChatSource makeChatSource() {
+  UiChatSource source;
+  source.count = []() { return chathistory::count(); };
+  source.lines = [](size_t first, size_t max, std::vector<String> &out) {
+    std::vector<chathistory::Message> messages;
+    chathistory::read(first, max, messages);
+    out.reserve(out.size() + messages.size());
+    for (const chathistory::Message &message : messages) {
+      out.push_back(makeChatPreview(message));
     }
-    ChatEntry entry;
-    entry.message = message;
-    entry.outgoing = true;
-    entries.push_back(entry);
-  }
-
-  std::sort(entries.begin(),
-            entries.end(),
-            [](const ChatEntry &a, const ChatEntry &b) {
-              const uint64_t ta = a.message.tsMs;
-              const uint64_t tb = b.message.tsMs;
-              if (ta == tb) {
-                if (a.outgoing != b.outgoing) {
-                  return a.outgoing && !b.outgoing;
-                }
-                return a.message.id < b.message.id;
-              }
-              if (ta == 0) {
-                return false;
-              }
-              if (tb == 0) {
-                return true;
-              }
-              return ta < tb;
-            });
-
-  return entries;
-}
-
-std::vector<String> buildMessengerPreviewLines(const std::vector<ChatEntry> &entries) {
-  std::vector<String> lines;
-  if (entries.empty()) {
-    lines.push_back("(no messages)");
-    return lines;
-  }
-
-  lines.reserve(entries.size());
-  for (size_t i = 0; i < entries.size(); ++i) {
-    lines.push_back(makeChatPreview(entries[static_cast<size_t>(i)]));
-  }
-  return lines;
+  };
+  // Queued/failed labels follow the outbox.
+  source.revision = []() { return chathistory::revision() * 31U + outbox::revision(); };
+  return source;
 }
 
 void runMessagingMenu(AppContext &ctx,
                       const std::function<void()> &backgroundTick) {
   int selected = 0;
+  chathistory::setSession(activeMessengerSessionKey());
+  const UiChatSource chatSource = makeChatSource();
 
   while (true) {
     ensureMessengerSessionSubscription(ctx, backgroundTick, false);
+    drainOutboxAttachments(ctx, backgroundTick, false);
 
-    std::vector<ChatEntry> entries = collectChatEntries(ctx);
-    std::vector<String> previewLines = buildMessengerPreviewLines(entries);
-    const MessengerAction action = ctx.uiRuntime->messengerHomeLoop(previewLines,
+    const MessengerAction action = ctx.uiRuntime->messengerHomeLoop(chatSource,
                                                                     selected,
                                                                     backgroundTick);
 
@@ -2325,12 +3094,10 @@ std::vector<String> buildStatusLines(AppContext &ctx) {
   lines.push_back("WS Connected: " + boolLabel(gs.wsConnected));
   lines.push_back("Gateway Ready: " + boolLabel(gs.gatewayReady));
   lines.push_back("Should Connect: " + boolLabel(gs.shouldConnect));
-  const size_t receivedCount = ctx.gateway->inboxCount();
-  const size_t sentCount = gOutboxCount;
-  lines.push_back("Chat Messages: " +
-                  String(static_cast<unsigned long>(receivedCount + sentCount)) +
-                  " (Rx " + String(static_cast<unsigned long>(receivedCount)) +
-                  " / Tx " + String(static_cast<unsigned long>(sentCount)) + ")");
+  lines.push_back("Chat History: " + String(static_cast<unsigned long>(chathistory::count())) +
+                  " (" + chathistory::storageName() + ")");
+  lines.push_back("Outbox Queued: " + String(static_cast<unsigned long>(outbox::pendingCount())) +
+                  " (" + outbox::storageName() + ")");
   lines.push_back("Auth Mode: " + String(gatewayAuthModeName(ctx.config.gatewayAuthMode)));
   lines.push_back("Device Name: " + effectiveDeviceName(ctx.config));
   lines.push_back("Device Token: " + boolLabel(!ctx.config.gatewayDeviceToken.isEmpty()));
@@ -2356,10 +3123,23 @@ std::vector<String> buildStatusLines(AppContext &ctx) {
                     (bs.audioServiceUuid.isEmpty() ? String("(auto)") : bs.audioServiceUuid));
     lines.push_back("BLE Audio Char: " +
                     (bs.audioCharUuid.isEmpty() ? String("(auto)") : bs.audioCharUuid));
+    lines.push_back("BLE Audio Ring: " + String(static_cast<unsigned long>(bs.audioRingBytes)) +
+                    " B" + (bs.audioRingInPsram ? " (PSRAM)" : ""));
+    lines.push_back("BLE Audio Peak: " +
+                    String(static_cast<unsigned long>(bs.audioRingHighWater)) + " B");
+    lines.push_back("BLE Audio Overruns: " +
+                    String(static_cast<unsigned long>(bs.audioOverruns)) + " (" +
+                    String(static_cast<unsigned long>(bs.audioOverrunBytes)) + " B)");
   }
   if (bs.rssi != 0) {
     lines.push_back("BLE RSSI: " + String(bs.rssi));
   }
+  if (bs.connected) {
+    lines.push_back(String("BLE Link: ") +
+                    (bs.linkProfile == BleLinkProfile::LowPower ? "Low Power" : "Throughput") +
+                    ", MTU " + String(static_cast<unsigned int>(bs.linkMtu)) + ", " +
+                    String(bs.linkIntervalMs, 2) + " ms, " + (bs.linkPhy2M ? "2M" : "1M"));
+  }
   lines.push_back("MIC Recording: " +
                   String(isMicRecordingAvailable() ? "Enabled" : "Disabled"));
   if (isMicRecordingAvailable()) {
@@ -2371,9 +3151,16 @@ std::vector<String> buildStatusLines(AppContext &ctx) {
       lines.push_back("MIC Data Pin: " + String(static_cast<int>(USER_MIC_PDM_DATA_PIN)));
       lines.push_back("MIC Clock Pin: " + String(static_cast<int>(USER_MIC_PDM_CLK_PIN)));
     }
-    lines.push_back("MIC Sample Rate: " +
-                    String(static_cast<unsigned long>(USER_MIC_SAMPLE_RATE)));
+    const unsigned long micRate = USER_MIC_ADC_PIN >= 0
+                                      ? static_cast<unsigned long>(USER_MIC_ADC_SAMPLE_RATE)
+                                      : static_cast<unsigned long>(USER_MIC_SAMPLE_RATE);
+    lines.push_back("MIC Sample Rate: " + String(micRate));
   }
+  lines.push_back("Voice Encoding: " + String(voiceEncodingName(kVoiceEncoding)));
+  lines.push_back(String("Voice Upload: ") +
+                  (kVoiceStreamUploadEnabled
+                       ? (kVoiceSdSpoolEnabled ? "stream + SD spool" : "stream only")
+                       : "after recording"));
   if (!bs.lastError.isEmpty()) {
     lines.push_back("BLE Last Error: " + bs.lastError);
   }
@@ -5,9 +5,11 @@
 
 #include "../core/ble_manager.h"
 #include "../core/gateway_client.h"
+#include "../core/perf_profiler.h"
 #include "../core/runtime_config.h"
 #include "../core/wifi_manager.h"
 #include "../ui/i18n.h"
+#include "../ui/sd_font.h"
 #include "../ui/ui_runtime.h"
 
 namespace {
@@ -384,6 +386,42 @@ void showBleKeyboardInput(AppContext &ctx,
   ctx.uiRuntime->showInfo("BLE Keyboard", lines, backgroundTick, "OK/BACK Exit");
 }
 
+void runBleThroughputTest(AppContext &ctx,
+                          const std::function<void()> &backgroundTick) {
+  constexpr uint16_t kTestSeconds = 5;
+  if (!ctx.ble->status().connected) {
+    ctx.uiRuntime->showToast("BLE", "Connect an audio device first", 1500, backgroundTick);
+    return;
+  }
+
+  ctx.uiRuntime->showToast("BLE", "Measuring 5s...", 800, backgroundTick);
+  BleThroughputResult result;
+  String err;
+  if (!ctx.ble->runThroughputTest(kTestSeconds, backgroundTick, &result, &err)) {
+    ctx.uiRuntime->showToast("BLE Test",
+                      err.isEmpty() ? String("Throughput test failed") : err,
+                      1800,
+                      backgroundTick);
+    return;
+  }
+
+  std::vector<String> lines;
+  lines.push_back("Throughput: " + String(static_cast<unsigned long>(result.bytesPerSecond)) +
+                  " B/s");
+  lines.push_back("Received: " + String(static_cast<unsigned long>(result.receivedBytes)) +
+                  " B in " + String(static_cast<unsigned long>(result.packets)) + " pkts");
+  lines.push_back("Dropped: " + String(static_cast<unsigned long>(result.droppedBytes)) +
+                  " B (" + String(result.dropPercent, 1) + "%)");
+  lines.push_back("Max Gap: " + String(static_cast<unsigned long>(result.maxGapMs)) + " ms");
+  lines.push_back("MTU: " + String(static_cast<unsigned int>(result.mtu)));
+  lines.push_back("Interval: " + String(result.intervalMs, 2) + " ms");
+  lines.push_back(String("PHY: ") + (result.phy2M ? "2M" : "1M"));
+  lines.push_back(String("Profile: ") +
+                  (ctx.ble->linkProfile() == BleLinkProfile::LowPower ? "Low Power"
+                                                                      : "Throughput"));
+  ctx.uiRuntime->showInfo("BLE Throughput", lines, backgroundTick, "OK/BACK Exit");
+}
+
 void scanAndConnectBle(AppContext &ctx,
                        const std::function<void()> &backgroundTick) {
   std::vector<BleDeviceInfo> devices;
@@ -481,6 +519,9 @@ void runBleMenu(AppContext &ctx,
     menu.push_back("Edit Device Addr");
     menu.push_back(String("Auto Connect: ") +
                    (ctx.config.bleAutoConnect ? "On" : "Off"));
+    menu.push_back(String("Link: ") +
+                   (ctx.config.bleLowPowerLink ? "Low Power" : "Throughput"));
+    menu.push_back("Throughput Test");
     menu.push_back("Forget Saved");
     menu.push_back("Back");
 
@@ -490,7 +531,7 @@ void runBleMenu(AppContext &ctx,
                                         backgroundTick,
                                         "OK Select  BACK Exit",
                                         buildBleSubtitle(ctx));
-    if (choice < 0 || choice == 8) {
+    if (choice < 0 || choice == 10) {
       return;
     }
     selected = choice;
@@ -560,6 +601,24 @@ void runBleMenu(AppContext &ctx,
     }
 
     if (choice == 7) {
+      ctx.config.bleLowPowerLink = !ctx.config.bleLowPowerLink;
+      ctx.ble->setLinkProfile(ctx.config.bleLowPowerLink ? BleLinkProfile::LowPower
+                                                         : BleLinkProfile::Throughput);
+      markDirty(ctx);
+      ctx.uiRuntime->showToast("BLE",
+                        ctx.config.bleLowPowerLink ? "Low power link profile"
+                                                   : "Throughput link profile",
+                        1300,
+                        backgroundTick);
+      continue;
+    }
+
+    if (choice == 8) {
+      runBleThroughputTest(ctx, backgroundTick);
+      continue;
+    }
+
+    if (choice == 9) {
       ctx.config.bleDeviceAddress = "";
       ctx.config.bleAutoConnect = false;
       ctx.ble->disconnectNow();
@@ -770,6 +829,140 @@ void runSystemMenu(AppContext &ctx,
   }
 }
 
+String msLabel(uint32_t us) {
+  return String(static_cast<float>(us) / 1000.0f, 1);
+}
+
+void showPerfReport(AppContext &ctx,
+                    const std::function<void()> &backgroundTick) {
+  std::vector<String> lines;
+  const unsigned long windowSec = (millis() - perf::windowStartMs()) / 1000UL;
+  lines.push_back("Window: " + String(windowSec) + " s" +
+                  (perf::enabled() ? "" : " (paused)"));
+
+  const perf::FrameStats &frames = perf::frameStats();
+  if (frames.frames > 0) {
+    lines.push_back("Frames: " + String(static_cast<unsigned long>(frames.frames)) +
+                    " avg " + msLabel(static_cast<uint32_t>(frames.totalUs / frames.frames)) +
+                    " max " + msLabel(frames.maxUs) + " ms");
+    lines.push_back("Pixels avg/max: " +
+                    String(static_cast<unsigned long>(frames.totalPixels / frames.frames)) +
+                    "/" + String(static_cast<unsigned long>(frames.maxPixels)));
+  } else {
+    lines.push_back("Frames: 0");
+  }
+
+  lines.push_back("avg / p95 / max (ms):");
+  for (size_t i = 0; i < perf::kComponentCount; ++i) {
+    const perf::Component component = static_cast<perf::Component>(i);
+    const perf::ComponentStats &stats = perf::componentStats(component);
+    if (stats.count == 0) {
+      continue;
+    }
+    lines.push_back(String(perf::componentName(component)) + ": " +
+                    msLabel(static_cast<uint32_t>(stats.totalUs / stats.count)) + " / " +
+                    msLabel(perf::percentileUs(stats, 95)) + " / " +
+                    msLabel(stats.maxUs));
+  }
+
+  perf::StallEvent stalls[perf::kTopStalls];
+  const size_t stallCount = perf::topStalls(stalls, perf::kTopStalls);
+  lines.push_back("Stalls >= " + String(perf::kStallThresholdUs / 1000U) + " ms: " +
+                  String(static_cast<unsigned>(stallCount)));
+  for (size_t i = 0; i < stallCount; ++i) {
+    lines.push_back(" " + msLabel(stalls[i].durationUs) + " " +
+                    perf::componentName(stalls[i].component) + " @" +
+                    String(static_cast<float>(stalls[i].atMs) / 1000.0f, 1) + "s");
+  }
+
+  ctx.uiRuntime->showInfo("Diagnostics", lines, backgroundTick, "OK/BACK Exit");
+}
+
+String kbLabel(uint32_t bytes) {
+  return String(static_cast<float>(bytes) / 1024.0f, 1) + " KB";
+}
+
+void showFontCacheReport(AppContext &ctx,
+                         const std::function<void()> &backgroundTick) {
+  std::vector<String> lines;
+  if (!sdfont::ready()) {
+    lines.push_back("Font pack not loaded");
+    lines.push_back(String("Pack: ") + USER_KOREAN_FONT_PACK_PATH);
+    ctx.uiRuntime->showInfo("Font Cache", lines, backgroundTick, "OK/BACK Exit");
+    return;
+  }
+
+  const sdfont::CacheStats stats = sdfont::stats();
+  const uint32_t lookups = stats.hits + stats.misses;
+  lines.push_back("Hits: " + String(static_cast<unsigned long>(stats.hits)) + " (" +
+                  String(lookups > 0 ? static_cast<unsigned long>(
+                                           (stats.hits * 100ULL) / lookups)
+                                     : 0UL) +
+                  "%)");
+  lines.push_back("Misses: " + String(static_cast<unsigned long>(stats.misses)) +
+                  " evicted " + String(static_cast<unsigned long>(stats.evictions)));
+  lines.push_back("Glyphs: " + String(stats.cachedGlyphs) + "/" +
+                  String(stats.capacityGlyphs) + " of " +
+                  String(static_cast<unsigned long>(stats.glyphCount)));
+  lines.push_back("SD reads: " + String(static_cast<unsigned long>(stats.sdReads)) +
+                  " avg " +
+                  msLabel(stats.sdReads > 0
+                              ? static_cast<uint32_t>(stats.sdReadUs / stats.sdReads)
+                              : 0U) +
+                  " max " + msLabel(stats.maxSdReadUs) + " ms");
+  if (stats.sdReadErrors > 0) {
+    lines.push_back("Read errors: " + String(static_cast<unsigned long>(stats.sdReadErrors)));
+  }
+  lines.push_back("RAM: " + kbLabel(stats.residentBytes) +
+                  (stats.cacheInPsram ? " PSRAM" : " internal"));
+  lines.push_back("Full font: " + kbLabel(stats.fullBitmapBytes));
+
+  ctx.uiRuntime->showInfo("Font Cache", lines, backgroundTick, "OK/BACK Exit");
+}
+
+void runDiagnosticsMenu(AppContext &ctx,
+                        const std::function<void()> &backgroundTick) {
+  int selected = 0;
+
+  while (true) {
+    std::vector<String> menu;
+    menu.push_back("Perf Report");
+    menu.push_back(String("Profiler: ") + (perf::enabled() ? "On" : "Off"));
+    menu.push_back("Reset Counters");
+    menu.push_back("Font Cache");
+    menu.push_back("Back");
+
+    const int choice = ctx.uiRuntime->menuLoop("Setting / Diagnostics",
+                                        menu,
+                                        selected,
+                                        backgroundTick,
+                                        "OK Select  BACK Exit",
+                                        "Frame time and stalls");
+    if (choice < 0 || choice == 4) {
+      return;
+    }
+    selected = choice;
+
+    if (choice == 0) {
+      showPerfReport(ctx, backgroundTick);
+    } else if (choice == 1) {
+#if USER_PERF_PROFILER_ENABLED
+      perf::setEnabled(!perf::enabled());
+#else
+      ctx.uiRuntime->showToast("Diagnostics",
+                               "Profiler disabled in this build",
+                               1400,
+                               backgroundTick);
+#endif
+    } else if (choice == 2) {
+      perf::reset();
+      ctx.uiRuntime->showToast("Diagnostics", "Counters reset", 900, backgroundTick);
+    } else if (choice == 3) {
+      showFontCacheReport(ctx, backgroundTick);
+    }
+  }
+}
+
 }  // namespace
 
 void runSettingsApp(AppContext &ctx,
@@ -781,6 +974,7 @@ void runSettingsApp(AppContext &ctx,
     menu.push_back("Wi-Fi");
     menu.push_back("BLE");
     menu.push_back("System");
+    menu.push_back("Diagnostics");
     menu.push_back("Firmware Update");
     menu.push_back("Back");
 
@@ -792,7 +986,7 @@ void runSettingsApp(AppContext &ctx,
                                         "OK Select  BACK Exit",
                                         subtitle);
 
-    if (choice < 0 || choice == 4) {
+    if (choice < 0 || choice == 5) {
       return;
     }
 
@@ -805,6 +999,8 @@ void runSettingsApp(AppContext &ctx,
     } else if (choice == 2) {
       runSystemMenu(ctx, backgroundTick);
     } else if (choice == 3) {
+      runDiagnosticsMenu(ctx, backgroundTick);
+    } else if (choice == 4) {
       runFirmwareUpdateApp(ctx, backgroundTick);
     }
   }
@@ -3,6 +3,7 @@
 #include <SD.h>
 
 #include <algorithm>
+#include <vector>
 
 #if defined(ARDUINO_ARCH_ESP32)
 #include <driver/i2s.h>
@@ -13,84 +14,83 @@
 #else
 #define AUDIO_RECORDER_HAS_I2S_PDM_CHANNEL 0
 #endif
+#if __has_include(<esp_adc/adc_continuous.h>)
+#include <esp_adc/adc_continuous.h>
+#define AUDIO_RECORDER_HAS_ADC_CONTINUOUS 1
+#else
+#define AUDIO_RECORDER_HAS_ADC_CONTINUOUS 0
+#endif
+#else
+#define AUDIO_RECORDER_HAS_ADC_CONTINUOUS 0
 #endif
 
 #include "user_config.h"
 #include "board_pins.h"
+#include "dir_listing.h"
+#include "perf_profiler.h"
 
 namespace {
 
-constexpr uint16_t kWavHeaderBytes = 44;
 bool gPdmI2sInstalled = false;
 
-uint32_t sampleRateHz() {
-  const uint32_t configured = static_cast<uint32_t>(USER_MIC_SAMPLE_RATE);
-  return std::max<uint32_t>(4000U, std::min<uint32_t>(configured, 22050U));
+// IMA ADPCM encode cost, reported under system.perf "voiceEncode".
+struct EncodeCost {
+  uint32_t recordings = 0;
+  uint32_t lastSampleRate = 0;
+  uint32_t lastSamples = 0;
+  uint32_t lastEncodeUs = 0;
+  uint64_t totalAudioUs = 0;
+  uint64_t totalEncodeUs = 0;
+};
+
+EncodeCost gEncodeCost;
+
+uint32_t encodeUsPerAudioSecond(uint64_t encodeUs, uint64_t audioUs) {
+  return audioUs > 0 ? static_cast<uint32_t>((encodeUs * 1000000ULL) / audioUs) : 0U;
 }
 
-uint32_t pdmSampleRateHz(uint32_t configured) {
-  // T-Embed onboard PDM MIC is stable at 16kHz or higher.
-  return std::max<uint32_t>(16000U, std::min<uint32_t>(configured, 22050U));
+void appendEncodeCostJson(JsonObject obj) {
+  obj["recordings"] = gEncodeCost.recordings;
+  obj["sampleRate"] = gEncodeCost.lastSampleRate;
+  obj["lastSamples"] = gEncodeCost.lastSamples;
+  obj["lastEncodeUs"] = gEncodeCost.lastEncodeUs;
+  const uint64_t lastAudioUs =
+      gEncodeCost.lastSampleRate > 0
+          ? (static_cast<uint64_t>(gEncodeCost.lastSamples) * 1000000ULL) / gEncodeCost.lastSampleRate
+          : 0U;
+  obj["lastUsPerAudioSec"] = encodeUsPerAudioSecond(gEncodeCost.lastEncodeUs, lastAudioUs);
+  // 10000 us per audio second is 1% of one core.
+  obj["avgUsPerAudioSec"] =
+      encodeUsPerAudioSecond(gEncodeCost.totalEncodeUs, gEncodeCost.totalAudioUs);
 }
 
-void writeLe16(uint8_t *out, uint16_t value) {
-  out[0] = static_cast<uint8_t>(value & 0xFFU);
-  out[1] = static_cast<uint8_t>((value >> 8) & 0xFFU);
+void noteEncodeCost(const VoiceWavWriter &writer, uint32_t sampleRate) {
+  static bool reportRegistered = false;
+  if (!reportRegistered) {
+    reportRegistered = perf::addJsonSection("voiceEncode", appendEncodeCostJson);
+  }
+  gEncodeCost.recordings++;
+  gEncodeCost.lastSampleRate = sampleRate;
+  gEncodeCost.lastSamples = writer.sampleCount();
+  gEncodeCost.lastEncodeUs = writer.encodeMicros();
+  gEncodeCost.totalAudioUs +=
+      (static_cast<uint64_t>(writer.sampleCount()) * 1000000ULL) / sampleRate;
+  gEncodeCost.totalEncodeUs += writer.encodeMicros();
 }
 
-void writeLe32(uint8_t *out, uint32_t value) {
-  out[0] = static_cast<uint8_t>(value & 0xFFU);
-  out[1] = static_cast<uint8_t>((value >> 8) & 0xFFU);
-  out[2] = static_cast<uint8_t>((value >> 16) & 0xFFU);
-  out[3] = static_cast<uint8_t>((value >> 24) & 0xFFU);
+uint32_t sampleRateHz() {
+  const uint32_t configured = static_cast<uint32_t>(USER_MIC_SAMPLE_RATE);
+  return std::max<uint32_t>(4000U, std::min<uint32_t>(configured, 22050U));
 }
 
-bool writeWavHeader(File &file, uint32_t sampleRate, uint32_t dataBytes) {
-  uint8_t header[kWavHeaderBytes] = {0};
-
-  const uint16_t channels = 1;
-  const uint16_t bitsPerSample = 16;
-  const uint32_t byteRate = sampleRate * static_cast<uint32_t>(channels) *
-                            (static_cast<uint32_t>(bitsPerSample) / 8U);
-  const uint16_t blockAlign =
-      static_cast<uint16_t>(channels * (bitsPerSample / 8U));
-  const uint32_t riffSize = 36U + dataBytes;
-
-  // RIFF chunk
-  header[0] = 'R';
-  header[1] = 'I';
-  header[2] = 'F';
-  header[3] = 'F';
-  writeLe32(header + 4, riffSize);
-  header[8] = 'W';
-  header[9] = 'A';
-  header[10] = 'V';
-  header[11] = 'E';
-
-  // fmt subchunk
-  header[12] = 'f';
-  header[13] = 'm';
-  header[14] = 't';
-  header[15] = ' ';
-  writeLe32(header + 16, 16);  // PCM fmt size
-  writeLe16(header + 20, 1);   // PCM format
-  writeLe16(header + 22, channels);
-  writeLe32(header + 24, sampleRate);
-  writeLe32(header + 28, byteRate);
-  writeLe16(header + 32, blockAlign);
-  writeLe16(header + 34, bitsPerSample);
-
-  // data subchunk
-  header[36] = 'd';
-  header[37] = 'a';
-  header[38] = 't';
-  header[39] = 'a';
-  writeLe32(header + 40, dataBytes);
-
-  if (!file.seek(0)) {
-    return false;
-  }
-  return file.write(header, sizeof(header)) == sizeof(header);
+uint32_t adcSampleRateHz() {
+  const uint32_t configured = static_cast<uint32_t>(USER_MIC_ADC_SAMPLE_RATE);
+  return std::max<uint32_t>(4000U, std::min<uint32_t>(configured, 48000U));
+}
+
+uint32_t pdmSampleRateHz(uint32_t configured) {
+  // T-Embed onboard PDM MIC is stable at 16kHz or higher.
+  return std::max<uint32_t>(16000U, std::min<uint32_t>(configured, 22050U));
 }
 
 void setError(String *error, const String &value) {
@@ -146,16 +146,233 @@ bool hasPdmPinConflict(String *detail) {
   return false;
 }
 
-bool captureAdcSamples(File &file,
+// Single-pole DC blocker state, carried across capture blocks.
+struct DcBlocker {
+  int32_t trackQ8 = 0;
+};
+
+// Converts raw 12-bit ADC codes to centered 16-bit PCM and removes the DC
+// offset. Runs over a whole block with the filter state held in registers and
+// no I/O or division in the loop body. It stays a scalar loop: the tracker is
+// a one-pole IIR, so every sample depends on the previous one and cannot be
+// spread across SIMD lanes (the ESP32's LX6 has none, and the S3's PIE only
+// helps the centering step, which is a shift and subtract per sample anyway).
+void dcBlockAdcBlock(const uint16_t *raw, int16_t *out, size_t count, DcBlocker &state) {
+  int32_t track = state.trackQ8;
+  for (size_t i = 0; i < count; ++i) {
+    const int32_t centered = (static_cast<int32_t>(raw[i]) - 2048) << 4;
+    track += ((centered << 8) - track) >> 6;
+    int32_t hp = centered - (track >> 8);
+    hp = hp < -32768 ? -32768 : (hp > 32767 ? 32767 : hp);
+    out[i] = static_cast<int16_t>(hp);
+  }
+  state.trackQ8 = track;
+}
+
+#if AUDIO_RECORDER_HAS_ADC_CONTINUOUS
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define AUDIO_RECORDER_ADC_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define AUDIO_RECORDER_ADC_CHANNEL(p) ((p)->type1.channel)
+#define AUDIO_RECORDER_ADC_DATA(p) ((p)->type1.data)
+#else
+#define AUDIO_RECORDER_ADC_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define AUDIO_RECORDER_ADC_CHANNEL(p) ((p)->type2.channel)
+#define AUDIO_RECORDER_ADC_DATA(p) ((p)->type2.data)
+#endif
+
+bool IRAM_ATTR onAdcPoolOverflow(adc_continuous_handle_t handle,
+                                 const adc_continuous_evt_data_t *edata,
+                                 void *userData) {
+  (void)handle;
+  (void)edata;
+  ++*static_cast<volatile uint32_t *>(userData);
+  return false;
+}
+
+bool captureAdcSamples(VoiceWavWriter &writer,
                        uint32_t totalSamples,
                        uint32_t sampleRate,
                        const std::function<void()> &backgroundTick,
                        const std::function<bool()> &stopRequested,
                        uint32_t *samplesWritten,
+                       uint32_t *droppedSamples,
                        String *error) {
   if (samplesWritten) {
     *samplesWritten = 0;
   }
+  if (droppedSamples) {
+    *droppedSamples = 0;
+  }
+
+  adc_unit_t unit = ADC_UNIT_1;
+  adc_channel_t channel = ADC_CHANNEL_0;
+  esp_err_t err = adc_continuous_io_to_channel(USER_MIC_ADC_PIN, &unit, &channel);
+  if (err != ESP_OK) {
+    setError(error, formatEspErr("MIC ADC pin invalid", err));
+    return false;
+  }
+  if (unit != ADC_UNIT_1) {
+    // ADC2 is shared with Wi-Fi and cannot be sampled continuously.
+    setError(error, "MIC ADC pin must be on ADC1");
+    return false;
+  }
+
+  // The DMA engine has a minimum conversion rate (20 kHz on ESP32). Sample at
+  // an integer multiple of the target rate and average down to it.
+  const uint32_t minHwRate = static_cast<uint32_t>(SOC_ADC_SAMPLE_FREQ_THRES_LOW);
+  const uint32_t decimation =
+      std::max<uint32_t>(1U, (minHwRate + sampleRate - 1U) / sampleRate);
+  const uint32_t hwRate = sampleRate * decimation;
+
+  constexpr uint32_t kFrameResults = 256;
+  constexpr uint32_t kPoolFrames = 8;
+  constexpr uint8_t kMaxEmptyReads = 20;
+  const uint32_t frameBytes = kFrameResults * SOC_ADC_DIGI_RESULT_BYTES;
+
+  adc_continuous_handle_t handle = nullptr;
+  adc_continuous_handle_cfg_t handleCfg = {};
+  handleCfg.max_store_buf_size = frameBytes * kPoolFrames;
+  handleCfg.conv_frame_size = frameBytes;
+  err = adc_continuous_new_handle(&handleCfg, &handle);
+  if (err != ESP_OK || handle == nullptr) {
+    setError(error, formatEspErr("MIC ADC alloc failed", err));
+    return false;
+  }
+
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_12;
+  pattern.channel = static_cast<uint8_t>(channel);
+  pattern.unit = static_cast<uint8_t>(unit);
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_continuous_config_t digCfg = {};
+  digCfg.sample_freq_hz = hwRate;
+  digCfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digCfg.format = AUDIO_RECORDER_ADC_OUTPUT_FORMAT;
+  digCfg.pattern_num = 1;
+  digCfg.adc_pattern = &pattern;
+  err = adc_continuous_config(handle, &digCfg);
+  if (err != ESP_OK) {
+    adc_continuous_deinit(handle);
+    setError(error, formatEspErr("MIC ADC config failed", err));
+    return false;
+  }
+
+  volatile uint32_t overflowCount = 0;
+  adc_continuous_evt_cbs_t callbacks = {};
+  callbacks.on_pool_ovf = onAdcPoolOverflow;
+  adc_continuous_register_event_callbacks(handle,
+                                          &callbacks,
+                                          const_cast<uint32_t *>(&overflowCount));
+
+  err = adc_continuous_start(handle);
+  if (err != ESP_OK) {
+    adc_continuous_deinit(handle);
+    setError(error, formatEspErr("MIC ADC start failed", err));
+    return false;
+  }
+
+  const auto shutdownAdc = [handle]() {
+    adc_continuous_stop(handle);
+    adc_continuous_deinit(handle);
+  };
+
+  std::vector<uint8_t> frame(frameBytes, 0);
+  std::vector<uint16_t> raw(kFrameResults, 0);
+  std::vector<int16_t> pcm(kFrameResults, 0);
+  DcBlocker dc;
+  uint32_t accum = 0;
+  uint32_t accumCount = 0;
+  uint8_t emptyReads = 0;
+
+  while (writer.sampleCount() < totalSamples) {
+    if (stopRequested && stopRequested()) {
+      break;
+    }
+
+    uint32_t readBytes = 0;
+    err = adc_continuous_read(handle, frame.data(), frameBytes, &readBytes, 100);
+    if (err == ESP_ERR_TIMEOUT) {
+      if (++emptyReads > kMaxEmptyReads) {
+        shutdownAdc();
+        setError(error, "MIC ADC timeout");
+        return false;
+      }
+      if (backgroundTick) {
+        backgroundTick();
+      }
+      continue;
+    }
+    if (err != ESP_OK) {
+      shutdownAdc();
+      setError(error, formatEspErr("MIC ADC read failed", err));
+      return false;
+    }
+    emptyReads = 0;
+
+    size_t produced = 0;
+    for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= readBytes;
+         offset += SOC_ADC_DIGI_RESULT_BYTES) {
+      const adc_digi_output_data_t *result =
+          reinterpret_cast<const adc_digi_output_data_t *>(frame.data() + offset);
+      if (AUDIO_RECORDER_ADC_CHANNEL(result) != static_cast<uint32_t>(channel)) {
+        continue;
+      }
+      accum += AUDIO_RECORDER_ADC_DATA(result);
+      if (++accumCount < decimation) {
+        continue;
+      }
+      raw[produced++] = static_cast<uint16_t>(accum / decimation);
+      accum = 0;
+      accumCount = 0;
+    }
+
+    const uint32_t remaining = totalSamples - writer.sampleCount();
+    produced = std::min<size_t>(produced, remaining);
+    dcBlockAdcBlock(raw.data(), pcm.data(), produced, dc);
+    if (!writer.writeSamples(pcm.data(), produced)) {
+      shutdownAdc();
+      setError(error, "Failed to write voice sample");
+      return false;
+    }
+
+    if (backgroundTick) {
+      backgroundTick();
+    }
+  }
+
+  shutdownAdc();
+  // Each overflow discards one conversion frame.
+  const uint32_t dropped = overflowCount * (kFrameResults / decimation);
+  if (dropped > 0) {
+    Serial.printf("[mic] adc pool overflowed %u times, %u samples lost\n",
+                  static_cast<unsigned int>(overflowCount),
+                  static_cast<unsigned int>(dropped));
+  }
+  if (droppedSamples) {
+    *droppedSamples = dropped;
+  }
+
+  if (samplesWritten) {
+    *samplesWritten = writer.sampleCount();
+  }
+  return true;
+}
+#else
+bool captureAdcSamples(VoiceWavWriter &writer,
+                       uint32_t totalSamples,
+                       uint32_t sampleRate,
+                       const std::function<void()> &backgroundTick,
+                       const std::function<bool()> &stopRequested,
+                       uint32_t *samplesWritten,
+                       uint32_t *droppedSamples,
+                       String *error) {
+  if (samplesWritten) {
+    *samplesWritten = 0;
+  }
+  if (droppedSamples) {
+    *droppedSamples = 0;
+  }
 
 #if defined(ARDUINO_ARCH_ESP32)
   analogReadResolution(12);
@@ -167,31 +384,21 @@ bool captureAdcSamples(File &file,
 
   const uint32_t sampleIntervalUs = 1000000UL / sampleRate;
   uint32_t nextSampleUs = micros();
-  int32_t dcTrackQ8 = 0;
   const uint16_t tickStride = 192;
-  uint32_t writtenSamples = 0;
+  DcBlocker dc;
 
   for (uint32_t i = 0; i < totalSamples; ++i) {
     if (stopRequested && stopRequested()) {
       break;
     }
 
-    const int raw = analogRead(USER_MIC_ADC_PIN);
-    int32_t centered = static_cast<int32_t>(raw) - 2048;
-    centered <<= 4;
-
-    const int32_t sampleQ8 = centered << 8;
-    dcTrackQ8 += (sampleQ8 - dcTrackQ8) / 64;
-    int32_t hp = centered - (dcTrackQ8 >> 8);
-    hp = std::max<int32_t>(-32768, std::min<int32_t>(32767, hp));
-
-    const int16_t sample = static_cast<int16_t>(hp);
-    if (file.write(reinterpret_cast<const uint8_t *>(&sample), sizeof(sample)) !=
-        sizeof(sample)) {
+    const uint16_t raw = static_cast<uint16_t>(analogRead(USER_MIC_ADC_PIN));
+    int16_t sample = 0;
+    dcBlockAdcBlock(&raw, &sample, 1, dc);
+    if (!writer.writeSamples(&sample, 1)) {
       setError(error, "Failed to write voice sample");
       return false;
     }
-    ++writtenSamples;
 
     if (backgroundTick && ((i % tickStride) == 0U)) {
       backgroundTick();
@@ -207,14 +414,15 @@ bool captureAdcSamples(File &file,
   }
 
   if (samplesWritten) {
-    *samplesWritten = writtenSamples;
+    *samplesWritten = writer.sampleCount();
   }
   return true;
 }
+#endif
 
 #if defined(ARDUINO_ARCH_ESP32)
 #if AUDIO_RECORDER_HAS_I2S_PDM_CHANNEL && SOC_I2S_SUPPORTS_PDM_RX
-bool capturePdmSamplesWithChannelApi(File &file,
+bool capturePdmSamplesWithChannelApi(VoiceWavWriter &writer,
                                      uint32_t targetDataBytes,
                                      uint32_t sampleRate,
                                      const std::function<void()> &backgroundTick,
@@ -331,7 +539,7 @@ bool capturePdmSamplesWithChannelApi(File &file,
       }
 
       emptyReads = 0;
-      if (file.write(chunk, readBytes) != readBytes) {
+      if (!writer.writeSampleBytes(chunk, readBytes)) {
         i2s_channel_disable(rxChan);
         i2s_del_channel(rxChan);
         setError(error, "Failed to write voice sample");
@@ -372,7 +580,7 @@ bool capturePdmSamplesWithChannelApi(File &file,
 }
 #endif
 
-bool capturePdmSamples(File &file,
+bool capturePdmSamples(VoiceWavWriter &writer,
                        uint32_t targetDataBytes,
                        uint32_t sampleRate,
                        const std::function<void()> &backgroundTick,
@@ -380,7 +588,7 @@ bool capturePdmSamples(File &file,
                        uint32_t *dataBytesWritten,
                        String *error) {
 #if AUDIO_RECORDER_HAS_I2S_PDM_CHANNEL && SOC_I2S_SUPPORTS_PDM_RX
-  return capturePdmSamplesWithChannelApi(file,
+  return capturePdmSamplesWithChannelApi(writer,
                                          targetDataBytes,
                                          sampleRate,
                                          backgroundTick,
@@ -542,7 +750,7 @@ bool capturePdmSamples(File &file,
       }
 
       emptyReads = 0;
-      if (file.write(chunk, readBytes) != readBytes) {
+      if (!writer.writeSampleBytes(chunk, readBytes)) {
         shutdownI2s();
         setError(error, "Failed to write voice sample");
         return false;
@@ -604,13 +812,20 @@ bool recordMicWavToSd(const String &path,
                       const std::function<void()> &backgroundTick,
                       const std::function<bool()> &stopRequested,
                       String *error,
-                      uint32_t *bytesWritten) {
+                      uint32_t *bytesWritten,
+                      VoiceEncoding encoding,
+                      const VoiceWavStreamSink *sink,
+                      uint32_t *droppedSamples) {
+  if (droppedSamples) {
+    *droppedSamples = 0;
+  }
   if (!isMicRecordingAvailable()) {
     setError(error, "MIC is not configured");
     return false;
   }
 
-  if (path.isEmpty() || !path.startsWith("/")) {
+  const bool toFile = !path.isEmpty();
+  if ((toFile && !path.startsWith("/")) || (!toFile && !sink)) {
     setError(error, "Invalid file path");
     return false;
   }
@@ -636,86 +851,98 @@ bool recordMicWavToSd(const String &path,
   }
 
   uint32_t sampleRate = sampleRateHz();
-  if (!hasAdcMicConfigured() && hasPdmMicConfigured()) {
+  if (hasAdcMicConfigured()) {
+    sampleRate = adcSampleRateHz();
+  } else if (hasPdmMicConfigured()) {
     sampleRate = pdmSampleRateHz(sampleRate);
   }
   const uint32_t maxSamples = sampleRate * static_cast<uint32_t>(seconds);
 
-  if (SD.exists(path.c_str())) {
-    SD.remove(path.c_str());
+  File file;
+  if (toFile) {
+    if (SD.exists(path.c_str())) {
+      SD.remove(path.c_str());
+    }
+    dirlisting::noteChanged(path);
+    file = SD.open(path.c_str(), FILE_WRITE);
+    if (!file || file.isDirectory()) {
+      if (file) {
+        file.close();
+      }
+      setError(error, "Failed to create voice file");
+      return false;
+    }
   }
 
-  File file = SD.open(path.c_str(), FILE_WRITE);
-  if (!file || file.isDirectory()) {
-    if (file) {
+  auto discardFile = [&]() {
+    if (toFile) {
       file.close();
+      SD.remove(path.c_str());
     }
-    setError(error, "Failed to create voice file");
-    return false;
-  }
+  };
 
-  uint8_t blankHeader[kWavHeaderBytes] = {0};
-  if (file.write(blankHeader, sizeof(blankHeader)) != sizeof(blankHeader)) {
-    file.close();
-    SD.remove(path.c_str());
+  VoiceWavWriter writer;
+  if (!writer.begin(toFile ? &file : nullptr, sampleRate, encoding, sink)) {
+    discardFile();
     setError(error, "Failed to write WAV header");
     return false;
   }
 
   bool captured = false;
-  uint32_t capturedDataBytes = 0;
   if (hasAdcMicConfigured()) {
     uint32_t capturedSamples = 0;
-    captured = captureAdcSamples(file,
+    captured = captureAdcSamples(writer,
                                  maxSamples,
                                  sampleRate,
                                  backgroundTick,
                                  stopRequested,
                                  &capturedSamples,
+                                 droppedSamples,
                                  error);
-    capturedDataBytes = capturedSamples * 2U;
   }
 #if defined(ARDUINO_ARCH_ESP32)
   else if (hasPdmMicConfigured()) {
     const uint32_t targetDataBytes = maxSamples * 2U;
-    captured = capturePdmSamples(file,
+    uint32_t capturedPcmBytes = 0;
+    captured = capturePdmSamples(writer,
                                  targetDataBytes,
                                  sampleRate,
                                  backgroundTick,
                                  stopRequested,
-                                 &capturedDataBytes,
+                                 &capturedPcmBytes,
                                  error);
   }
 #endif
 
   if (!captured) {
-    file.close();
-    SD.remove(path.c_str());
+    discardFile();
     if (error && error->isEmpty()) {
       setError(error, "MIC capture failed");
     }
     return false;
   }
 
-  if (capturedDataBytes == 0) {
-    file.close();
-    SD.remove(path.c_str());
+  if (writer.sampleCount() == 0) {
+    discardFile();
     setError(error, "No audio captured");
     return false;
   }
 
-  if (!writeWavHeader(file, sampleRate, capturedDataBytes)) {
-    file.close();
-    SD.remove(path.c_str());
+  if (!writer.finish()) {
+    discardFile();
     setError(error, "Failed to finalize WAV header");
     return false;
   }
 
-  file.flush();
-  file.close();
+  if (toFile) {
+    file.close();
+  }
 
+  if (encoding == VoiceEncoding::ImaAdpcm) {
+    noteEncodeCost(writer, sampleRate);
+  }
   if (bytesWritten) {
-    *bytesWritten = capturedDataBytes + kWavHeaderBytes;
+    *bytesWritten = writer.totalBytes();
   }
   setError(error, "");
   return true;
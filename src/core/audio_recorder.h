@@ -4,11 +4,19 @@
 
 #include <functional>
 
+#include "voice_codec.h"
+
 bool isMicRecordingAvailable();
 
+// path may be empty when sink is set; the recording is then streamed only.
+// droppedSamples counts audio lost because the ADC DMA pool overflowed (the
+// recording is shorter than the time it covered by that much).
 bool recordMicWavToSd(const String &path,
                       uint16_t seconds,
                       const std::function<void()> &backgroundTick,
                       const std::function<bool()> &stopRequested = std::function<bool()>(),
                       String *error = nullptr,
-                      uint32_t *bytesWritten = nullptr);
+                      uint32_t *bytesWritten = nullptr,
+                      VoiceEncoding encoding = VoiceEncoding::Pcm16,
+                      const VoiceWavStreamSink *sink = nullptr,
+                      uint32_t *droppedSamples = nullptr);
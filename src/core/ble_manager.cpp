@@ -3,15 +3,25 @@
 #include <NimBLEDevice.h>
 #include <SD.h>
 #include <freertos/FreeRTOS.h>
+#if __has_include(<soc/soc_caps.h>)
+#include <soc/soc_caps.h>
+#endif
 
 #include <algorithm>
 #include <string>
 #include <cstring>
 
+#include "dir_listing.h"
+
 #if __has_include(<NimBLEExtAdvertising.h>)
 #define NIMBLE_V2_PLUS 1
 #endif
 
+// 2M PHY needs a BLE 5 controller (S3/C3); the original ESP32 is 4.2 only.
+#if defined(NIMBLE_V2_PLUS) && defined(SOC_BLE_50_SUPPORTED) && SOC_BLE_50_SUPPORTED
+#define BLE_LINK_HAS_2M_PHY 1
+#endif
+
 namespace {
 
 constexpr uint32_t kScanTimeMs = 5000;
@@ -25,17 +35,38 @@ constexpr uint16_t kAppearanceKeyboard = 0x03C1;
 constexpr uint16_t kUuidHidService = 0x1812;
 constexpr uint16_t kUuidHidBootKeyboardInput = 0x2A22;
 constexpr uint16_t kUuidHidReport = 0x2A4D;
-constexpr uint16_t kWavHeaderBytes = 44;
 constexpr size_t kAudioCaptureDrainBytes = 768;
 constexpr unsigned long kAudioPacketTimeoutMs = 3000UL;
 constexpr unsigned long kAudioFlushTailMs = 120UL;
 constexpr uint32_t kBleAudioMinBytes = 256U;
+constexpr size_t kAudioRingBytes = static_cast<size_t>(USER_BLE_AUDIO_RING_BYTES);
+// 247-byte ATT MTU + 4-byte L2CAP header fills one 251-byte DLE packet.
+// Builds that cap the preferred MTU in sdkconfig (128 on the classic-ESP32
+// CYD, which has no PSRAM) keep their cap.
+#if defined(CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU) && CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU < 247
+constexpr uint16_t kBleLinkMtu = CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU;
+#else
+constexpr uint16_t kBleLinkMtu = 247;
+#endif
+constexpr uint16_t kBleDataLenOctets = 251;
+
+struct BleLinkParams {
+  uint16_t minInterval;  // 1.25 ms units
+  uint16_t maxInterval;
+  uint16_t latency;      // connection events the peripheral may skip
+  uint16_t timeout;      // 10 ms units
+};
+
+constexpr BleLinkParams kThroughputLink = {6, 12, 0, 400};
+constexpr BleLinkParams kLowPowerLink = {24, 40, 4, 600};
+
+const BleLinkParams &linkParamsFor(BleLinkProfile profile) {
+  return profile == BleLinkProfile::LowPower ? kLowPowerLink : kThroughputLink;
+}
 
 constexpr const char *kNusServiceUuid = "6e400001-b5a3-f393-e0a9-e50e24dcca9e";
 constexpr const char *kNusTxCharUuid = "6e400003-b5a3-f393-e0a9-e50e24dcca9e";
 
-portMUX_TYPE gBleAudioMux = portMUX_INITIALIZER_UNLOCKED;
-
 bool containsAddress(const std::vector<BleDeviceInfo> &list,
                      const String &address) {
   for (std::vector<BleDeviceInfo>::const_iterator it = list.begin();
@@ -112,63 +143,6 @@ bool extractBootKeyboardReport(const uint8_t *data,
   return true;
 }
 
-void writeLe16(uint8_t *out, uint16_t value) {
-  out[0] = static_cast<uint8_t>(value & 0xFFU);
-  out[1] = static_cast<uint8_t>((value >> 8) & 0xFFU);
-}
-
-void writeLe32(uint8_t *out, uint32_t value) {
-  out[0] = static_cast<uint8_t>(value & 0xFFU);
-  out[1] = static_cast<uint8_t>((value >> 8) & 0xFFU);
-  out[2] = static_cast<uint8_t>((value >> 16) & 0xFFU);
-  out[3] = static_cast<uint8_t>((value >> 24) & 0xFFU);
-}
-
-bool writeBleWavHeader(File &file, uint32_t sampleRate, uint32_t dataBytes) {
-  uint8_t header[kWavHeaderBytes] = {0};
-
-  const uint16_t channels = 1;
-  const uint16_t bitsPerSample = 16;
-  const uint32_t byteRate = sampleRate * static_cast<uint32_t>(channels) *
-                            (static_cast<uint32_t>(bitsPerSample) / 8U);
-  const uint16_t blockAlign =
-      static_cast<uint16_t>(channels * (bitsPerSample / 8U));
-  const uint32_t riffSize = 36U + dataBytes;
-
-  header[0] = 'R';
-  header[1] = 'I';
-  header[2] = 'F';
-  header[3] = 'F';
-  writeLe32(header + 4, riffSize);
-  header[8] = 'W';
-  header[9] = 'A';
-  header[10] = 'V';
-  header[11] = 'E';
-
-  header[12] = 'f';
-  header[13] = 'm';
-  header[14] = 't';
-  header[15] = ' ';
-  writeLe32(header + 16, 16);
-  writeLe16(header + 20, 1);
-  writeLe16(header + 22, channels);
-  writeLe32(header + 24, sampleRate);
-  writeLe32(header + 28, byteRate);
-  writeLe16(header + 32, blockAlign);
-  writeLe16(header + 34, bitsPerSample);
-
-  header[36] = 'd';
-  header[37] = 'a';
-  header[38] = 't';
-  header[39] = 'a';
-  writeLe32(header + 40, dataBytes);
-
-  if (!file.seek(0)) {
-    return false;
-  }
-  return file.write(header, sizeof(header)) == sizeof(header);
-}
-
 }  // namespace
 
 void BleManager::begin() {
@@ -181,6 +155,9 @@ void BleManager::configure(const RuntimeConfig &config) {
   const String prevSavedAddress = config_.bleDeviceAddress;
   config_ = config;
 
+  setLinkProfile(config_.bleLowPowerLink ? BleLinkProfile::LowPower
+                                         : BleLinkProfile::Throughput);
+
   const String nextDeviceName = effectiveDeviceName(config_);
   if (initialized_ && prevDeviceName != nextDeviceName) {
     NimBLEDevice::setDeviceName(std::string(nextDeviceName.c_str()));
@@ -329,6 +306,7 @@ bool BleManager::connectToDevice(const String &address,
   }
 
   nextClient->setConnectTimeout(5);
+  applyConnectParams(nextClient);
 
   const std::string addressStr(address.c_str());
   const NimBLEAddress publicAddress(addressStr, BLE_ADDR_PUBLIC);
@@ -354,6 +332,7 @@ bool BleManager::connectToDevice(const String &address,
   connectedName_ = effectiveDeviceName(config_);
   connectedRssi_ = client_->getRssi();
 
+  tuneConnectedLink();
   analyzeConnectedProfile();
 
   if (connectedIsKeyboard_) {
@@ -377,7 +356,9 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
                                           const std::function<void()> &backgroundTick,
                                           const std::function<bool()> &stopRequested,
                                           String *error,
-                                          uint32_t *bytesWritten) {
+                                          uint32_t *bytesWritten,
+                                          VoiceEncoding encoding,
+                                          const VoiceWavStreamSink *sink) {
   if (!client_ || !client_->isConnected()) {
     if (error) {
       *error = "BLE device is not connected";
@@ -385,7 +366,8 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
     return false;
   }
 
-  if (path.isEmpty() || !path.startsWith("/")) {
+  const bool toFile = !path.isEmpty();
+  if ((toFile && !path.startsWith("/")) || (!toFile && !sink)) {
     if (error) {
       *error = "Invalid file path";
     }
@@ -408,76 +390,63 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
     return false;
   }
 
-  if (!audioStreamChr_ || !connectedHasAudioStream_) {
-    audioStreamChr_ = findAudioStreamCharacteristic(&audioStreamServiceUuid_,
-                                                    &audioStreamCharUuid_);
-    connectedHasAudioStream_ = audioStreamChr_ != nullptr;
-  }
-  if (!audioStreamChr_ || !connectedHasAudioStream_) {
+  if (!resolveAudioStream()) {
     if (error) {
       *error = "BLE audio stream characteristic not found";
     }
     return false;
   }
 
-  if (SD.exists(path.c_str())) {
-    SD.remove(path.c_str());
+  File file;
+  if (toFile) {
+    if (SD.exists(path.c_str())) {
+      SD.remove(path.c_str());
+    }
+    dirlisting::noteChanged(path);
+    file = SD.open(path.c_str(), FILE_WRITE);
+    if (!file || file.isDirectory()) {
+      if (file) {
+        file.close();
+      }
+      if (error) {
+        *error = "Failed to create BLE voice file";
+      }
+      return false;
+    }
   }
 
-  File file = SD.open(path.c_str(), FILE_WRITE);
-  if (!file || file.isDirectory()) {
-    if (file) {
+  auto discardFile = [&]() {
+    if (toFile) {
       file.close();
+      SD.remove(path.c_str());
     }
-    if (error) {
-      *error = "Failed to create BLE voice file";
-    }
-    return false;
-  }
+  };
 
-  uint8_t blankHeader[kWavHeaderBytes] = {0};
-  if (file.write(blankHeader, sizeof(blankHeader)) != sizeof(blankHeader)) {
-    file.close();
-    SD.remove(path.c_str());
+  const uint32_t sampleRate = std::max<uint32_t>(
+      4000U,
+      std::min<uint32_t>(static_cast<uint32_t>(USER_MIC_SAMPLE_RATE), 22050U));
+  VoiceWavWriter writer;
+  if (!writer.begin(toFile ? &file : nullptr, sampleRate, encoding, sink)) {
+    discardFile();
     if (error) {
       *error = "Failed to write WAV header";
     }
     return false;
   }
 
-  resetAudioCaptureBuffer();
-  portENTER_CRITICAL(&gBleAudioMux);
-  audioCaptureActive_ = true;
-  portEXIT_CRITICAL(&gBleAudioMux);
-
-  const bool useNotify = audioStreamChr_->canNotify();
-  const bool subscribed = audioStreamChr_->subscribe(
-      useNotify,
-      [this](NimBLERemoteCharacteristic *, uint8_t *pData, size_t length, bool) {
-        handleAudioPacket(pData, length);
-      });
-  if (!subscribed) {
-    portENTER_CRITICAL(&gBleAudioMux);
-    audioCaptureActive_ = false;
-    portEXIT_CRITICAL(&gBleAudioMux);
-    file.close();
-    SD.remove(path.c_str());
+  String streamError;
+  if (!beginAudioStream(&streamError)) {
+    discardFile();
     if (error) {
-      *error = "Failed to subscribe BLE audio stream";
+      *error = streamError;
     }
     return false;
   }
 
-  const uint32_t sampleRate = std::max<uint32_t>(
-      4000U,
-      std::min<uint32_t>(static_cast<uint32_t>(USER_MIC_SAMPLE_RATE), 22050U));
   const unsigned long startMs = millis();
   const unsigned long endMs = startMs + static_cast<unsigned long>(seconds) * 1000UL;
 
   uint8_t drain[kAudioCaptureDrainBytes] = {0};
-  uint8_t pendingByte = 0;
-  bool hasPendingByte = false;
-  uint32_t dataBytes = 0;
   bool failed = false;
   String failReason;
 
@@ -492,38 +461,12 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
       break;
     }
 
-    const size_t readBytes = popAudioData(drain, sizeof(drain));
+    const size_t readBytes = audioRing_.pop(drain, sizeof(drain));
     if (readBytes > 0) {
-      size_t offset = 0;
-      if (hasPendingByte) {
-        uint8_t pair[2] = {pendingByte, drain[0]};
-        if (file.write(pair, sizeof(pair)) != sizeof(pair)) {
-          failed = true;
-          failReason = "Failed to write BLE audio";
-          break;
-        }
-        dataBytes += 2;
-        hasPendingByte = false;
-        offset = 1;
-      }
-
-      if (!failed && offset < readBytes) {
-        const size_t remain = readBytes - offset;
-        const size_t evenBytes = remain & ~static_cast<size_t>(1);
-        if (evenBytes > 0) {
-          if (file.write(drain + offset, evenBytes) != evenBytes) {
-            failed = true;
-            failReason = "Failed to write BLE audio";
-            break;
-          }
-          dataBytes += static_cast<uint32_t>(evenBytes);
-          offset += evenBytes;
-        }
-
-        if (offset < readBytes) {
-          pendingByte = drain[readBytes - 1];
-          hasPendingByte = true;
-        }
+      if (!writer.writeSampleBytes(drain, readBytes)) {
+        failed = true;
+        failReason = "Failed to write BLE audio";
+        break;
       }
     } else {
       delay(4);
@@ -534,12 +477,8 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
     }
 
     const unsigned long now = millis();
-    uint32_t receivedBytes = 0;
-    unsigned long lastPacketMs = 0;
-    portENTER_CRITICAL(&gBleAudioMux);
-    receivedBytes = audioReceivedBytes_;
-    lastPacketMs = audioLastPacketMs_;
-    portEXIT_CRITICAL(&gBleAudioMux);
+    const uint32_t receivedBytes = audioReceivedBytes_.load();
+    const unsigned long lastPacketMs = audioLastPacketMs_.load();
 
     if (receivedBytes == 0 && now - startMs >= kAudioPacketTimeoutMs) {
       failed = true;
@@ -556,7 +495,7 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
 
   const unsigned long flushUntil = millis() + kAudioFlushTailMs;
   while (!failed && millis() < flushUntil) {
-    const size_t readBytes = popAudioData(drain, sizeof(drain));
+    const size_t readBytes = audioRing_.pop(drain, sizeof(drain));
     if (readBytes == 0) {
       delay(2);
       if (backgroundTick) {
@@ -565,35 +504,10 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
       continue;
     }
 
-    size_t offset = 0;
-    if (hasPendingByte) {
-      uint8_t pair[2] = {pendingByte, drain[0]};
-      if (file.write(pair, sizeof(pair)) != sizeof(pair)) {
-        failed = true;
-        failReason = "Failed to write BLE audio";
-        break;
-      }
-      dataBytes += 2;
-      hasPendingByte = false;
-      offset = 1;
-    }
-
-    if (offset < readBytes) {
-      const size_t remain = readBytes - offset;
-      const size_t evenBytes = remain & ~static_cast<size_t>(1);
-      if (evenBytes > 0) {
-        if (file.write(drain + offset, evenBytes) != evenBytes) {
-          failed = true;
-          failReason = "Failed to write BLE audio";
-          break;
-        }
-        dataBytes += static_cast<uint32_t>(evenBytes);
-        offset += evenBytes;
-      }
-      if (offset < readBytes) {
-        pendingByte = drain[readBytes - 1];
-        hasPendingByte = true;
-      }
+    if (!writer.writeSampleBytes(drain, readBytes)) {
+      failed = true;
+      failReason = "Failed to write BLE audio";
+      break;
     }
 
     if (backgroundTick) {
@@ -601,44 +515,37 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
     }
   }
 
-  portENTER_CRITICAL(&gBleAudioMux);
-  audioCaptureActive_ = false;
-  portEXIT_CRITICAL(&gBleAudioMux);
-  audioStreamChr_->unsubscribe();
+  endAudioStream();
 
-  if (!failed && dataBytes < kBleAudioMinBytes) {
+  if (!failed && writer.sampleCount() * 2U < kBleAudioMinBytes) {
     failed = true;
     failReason = "BLE audio data is too small";
   }
 
-  if (!failed && !writeBleWavHeader(file, sampleRate, dataBytes)) {
+  if (!failed && !writer.finish()) {
     failed = true;
     failReason = "Failed to finalize WAV header";
   }
 
-  file.flush();
-  file.close();
-
   if (failed) {
-    SD.remove(path.c_str());
+    discardFile();
     if (error) {
       *error = failReason;
     }
     setError(failReason);
     return false;
   }
+  if (toFile) {
+    file.close();
+  }
 
   if (bytesWritten) {
-    *bytesWritten = dataBytes + kWavHeaderBytes;
+    *bytesWritten = writer.totalBytes();
   }
   if (error) {
     *error = "";
   }
-  uint32_t droppedBytes = 0;
-  portENTER_CRITICAL(&gBleAudioMux);
-  droppedBytes = audioDroppedBytes_;
-  portEXIT_CRITICAL(&gBleAudioMux);
-  if (droppedBytes > 0) {
+  if (audioRing_.overrunBytes() > 0) {
     setError("BLE audio captured with packet drops");
   } else {
     setError("BLE audio captured");
@@ -693,6 +600,23 @@ BleStatus BleManager::status() const {
   state.audioStreamAvailable = connectedHasAudioStream_;
   state.audioServiceUuid = audioStreamServiceUuid_;
   state.audioCharUuid = audioStreamCharUuid_;
+  state.audioRingBytes = static_cast<uint32_t>(
+      audioRing_.allocated() ? audioRing_.capacity() : kAudioRingBytes);
+  state.audioRingInPsram = audioRing_.inPsram();
+  state.audioRingHighWater = static_cast<uint32_t>(audioRing_.highWater());
+  state.audioOverrunBytes = audioRing_.overrunBytes();
+  state.audioOverruns = audioRing_.overrunEvents();
+  state.linkProfile = linkProfile_;
+  if (connected_ && client_ && client_->isConnected()) {
+    state.linkMtu = client_->getMTU();
+    state.linkIntervalMs = static_cast<float>(client_->getConnInfo().getConnInterval()) * 1.25f;
+#if BLE_LINK_HAS_2M_PHY
+    uint8_t txPhy = 0;
+    uint8_t rxPhy = 0;
+    state.linkPhy2M = client_->getPhy(&txPhy, &rxPhy) && txPhy == BLE_GAP_LE_PHY_2M &&
+                      rxPhy == BLE_GAP_LE_PHY_2M;
+#endif
+  }
   state.keyboardText = keyboardInputBuffer_;
   state.pairingHint = pairingHint_;
   state.lastError = lastError_;
@@ -709,6 +633,7 @@ bool BleManager::ensureInitialized(String *error) {
   NimBLEDevice::setSecurityAuth(true, true, true);
   NimBLEDevice::setSecurityIOCap(BLE_HS_IO_KEYBOARD_ONLY);
   NimBLEDevice::setSecurityPasskey(123456);
+  NimBLEDevice::setMTU(kBleLinkMtu);
 
   scan_ = NimBLEDevice::getScan();
   if (!scan_) {
@@ -1132,74 +1057,235 @@ void BleManager::resetAudioStreamState() {
   audioStreamServiceUuid_ = "";
   audioStreamCharUuid_ = "";
   connectedHasAudioStream_ = false;
-  resetAudioCaptureBuffer();
+  stopAudioCapture();
 }
 
-void BleManager::resetAudioCaptureBuffer() {
-  portENTER_CRITICAL(&gBleAudioMux);
-  audioRingHead_ = 0;
-  audioRingTail_ = 0;
-  audioReceivedBytes_ = 0;
-  audioDroppedBytes_ = 0;
-  audioLastPacketMs_ = 0;
-  audioCaptureActive_ = false;
-  portEXIT_CRITICAL(&gBleAudioMux);
+void BleManager::setLinkProfile(BleLinkProfile profile) {
+  if (profile == linkProfile_) {
+    return;
+  }
+  linkProfile_ = profile;
+  if (connected_ && client_ && client_->isConnected()) {
+    tuneConnectedLink();
+  }
 }
 
-void BleManager::handleAudioPacket(const uint8_t *data, size_t length) {
-  if (!data || length == 0) {
+BleLinkProfile BleManager::linkProfile() const {
+  return linkProfile_;
+}
+
+void BleManager::applyConnectParams(NimBLEClient *client) const {
+  if (!client) {
     return;
   }
+  const BleLinkParams &params = linkParamsFor(linkProfile_);
+  client->setConnectionParams(params.minInterval,
+                              params.maxInterval,
+                              params.latency,
+                              params.timeout);
+}
 
-  portENTER_CRITICAL(&gBleAudioMux);
-  if (!audioCaptureActive_) {
-    portEXIT_CRITICAL(&gBleAudioMux);
+void BleManager::tuneConnectedLink() {
+  if (!client_ || !client_->isConnected()) {
     return;
   }
 
-  size_t head = audioRingHead_;
-  const size_t tail = audioRingTail_;
-  uint32_t written = 0;
-  uint32_t dropped = 0;
+  // Peripherals may reject or clamp any of these; the link keeps working
+  // with whatever was agreed, so failures are only logged.
+  const BleLinkParams &params = linkParamsFor(linkProfile_);
+  if (!client_->updateConnParams(params.minInterval,
+                                 params.maxInterval,
+                                 params.latency,
+                                 params.timeout)) {
+    Serial.println("[ble] conn param update rejected");
+  }
+  client_->setDataLen(kBleDataLenOctets);
+#if BLE_LINK_HAS_2M_PHY
+  const uint8_t phyMask = linkProfile_ == BleLinkProfile::Throughput
+                              ? BLE_GAP_LE_PHY_2M_MASK
+                              : BLE_GAP_LE_PHY_1M_MASK;
+  if (!client_->updatePhy(phyMask, phyMask)) {
+    Serial.println("[ble] PHY update rejected");
+  }
+#endif
+}
+
+bool BleManager::runThroughputTest(uint16_t seconds,
+                                   const std::function<void()> &backgroundTick,
+                                   BleThroughputResult *result,
+                                   String *error) {
+  if (!client_ || !client_->isConnected()) {
+    if (error) {
+      *error = "BLE device is not connected";
+    }
+    return false;
+  }
+  if (!resolveAudioStream()) {
+    if (error) {
+      *error = "BLE audio stream characteristic not found";
+    }
+    return false;
+  }
+  if (seconds == 0) {
+    seconds = 1;
+  }
+
+  String streamError;
+  if (!beginAudioStream(&streamError)) {
+    if (error) {
+      *error = streamError;
+    }
+    return false;
+  }
 
-  for (size_t i = 0; i < length; ++i) {
-    const size_t next = (head + 1U) % kAudioRingCapacity;
-    if (next == tail) {
-      dropped += static_cast<uint32_t>(length - i);
+  uint8_t drain[kAudioCaptureDrainBytes] = {0};
+  const unsigned long startMs = millis();
+  const unsigned long testMs = static_cast<unsigned long>(seconds) * 1000UL;
+  unsigned long firstPacketMs = 0;
+  bool timedOut = false;
+  while (millis() - startMs < testMs) {
+    if (!client_ || !client_->isConnected()) {
       break;
     }
-    audioRing_[head] = data[i];
-    head = next;
-    ++written;
+    if (audioRing_.pop(drain, sizeof(drain)) == 0) {
+      delay(2);
+    }
+    if (firstPacketMs == 0 && audioPackets_.load() > 0) {
+      firstPacketMs = millis();
+    }
+    if (firstPacketMs == 0 && millis() - startMs >= kAudioPacketTimeoutMs) {
+      timedOut = true;
+      break;
+    }
+    if (backgroundTick) {
+      backgroundTick();
+    }
   }
+  const unsigned long endMs = millis();
 
-  audioRingHead_ = head;
-  audioReceivedBytes_ += written;
-  audioDroppedBytes_ += dropped;
-  if (written > 0) {
-    audioLastPacketMs_ = millis();
+  BleThroughputResult out;
+  out.receivedBytes = audioReceivedBytes_.load();
+  out.packets = audioPackets_.load();
+  out.droppedBytes = audioRing_.overrunBytes();
+  out.maxGapMs = audioMaxGapMs_.load();
+  endAudioStream();
+
+  if (timedOut) {
+    if (error) {
+      *error = "No BLE audio packets received";
+    }
+    return false;
+  }
+
+  // Measure from the first notification so subscribe latency is not
+  // counted against the link.
+  out.durationMs = static_cast<uint32_t>(endMs - (firstPacketMs ? firstPacketMs : startMs));
+  if (out.durationMs > 0) {
+    out.bytesPerSecond = static_cast<uint32_t>(
+        (static_cast<uint64_t>(out.receivedBytes + out.droppedBytes) * 1000ULL) /
+        out.durationMs);
   }
-  portEXIT_CRITICAL(&gBleAudioMux);
+  const uint32_t offered = out.receivedBytes + out.droppedBytes;
+  if (offered > 0) {
+    out.dropPercent = static_cast<float>(out.droppedBytes) * 100.0f / static_cast<float>(offered);
+  }
+
+  const BleStatus link = status();
+  out.mtu = link.linkMtu;
+  out.intervalMs = link.linkIntervalMs;
+  out.phy2M = link.linkPhy2M;
+  if (result) {
+    *result = out;
+  }
+  if (error) {
+    *error = "";
+  }
+  return true;
 }
 
-size_t BleManager::popAudioData(uint8_t *out, size_t maxLen) {
-  if (!out || maxLen == 0) {
-    return 0;
+bool BleManager::resolveAudioStream() {
+  if (!audioStreamChr_ || !connectedHasAudioStream_) {
+    audioStreamChr_ = findAudioStreamCharacteristic(&audioStreamServiceUuid_,
+                                                    &audioStreamCharUuid_);
+    connectedHasAudioStream_ = audioStreamChr_ != nullptr;
   }
+  return audioStreamChr_ && connectedHasAudioStream_;
+}
 
-  portENTER_CRITICAL(&gBleAudioMux);
-  size_t tail = audioRingTail_;
-  const size_t head = audioRingHead_;
-  size_t copied = 0;
+bool BleManager::beginAudioStream(String *error) {
+  if (!startAudioCapture(error)) {
+    return false;
+  }
 
-  while (tail != head && copied < maxLen) {
-    out[copied++] = audioRing_[tail];
-    tail = (tail + 1U) % kAudioRingCapacity;
+  const bool useNotify = audioStreamChr_->canNotify();
+  const bool subscribed = audioStreamChr_->subscribe(
+      useNotify,
+      [this](NimBLERemoteCharacteristic *, uint8_t *pData, size_t length, bool) {
+        handleAudioPacket(pData, length);
+      });
+  if (!subscribed) {
+    stopAudioCapture();
+    if (error) {
+      *error = "Failed to subscribe BLE audio stream";
+    }
+    return false;
   }
+  return true;
+}
 
-  audioRingTail_ = tail;
-  portEXIT_CRITICAL(&gBleAudioMux);
-  return copied;
+void BleManager::endAudioStream() {
+  if (audioStreamChr_) {
+    audioStreamChr_->unsubscribe();
+  }
+  stopAudioCapture();
+}
+
+bool BleManager::startAudioCapture(String *error) {
+  stopAudioCapture();
+  if (!audioRing_.allocate(kAudioRingBytes)) {
+    if (error) {
+      *error = "BLE audio buffer alloc failed";
+    }
+    return false;
+  }
+  audioReceivedBytes_.store(0);
+  audioLastPacketMs_.store(0);
+  audioPackets_.store(0);
+  audioMaxGapMs_.store(0);
+  audioCaptureActive_.store(true);
+  return true;
+}
+
+void BleManager::stopAudioCapture() {
+  audioCaptureActive_.store(false);
+  // A notification already past the active check may still be copying.
+  while (audioProducerBusy_.load()) {
+    delay(1);
+  }
+  // Stats stay readable for BleStatus; the storage goes back to the heap.
+  audioRing_.release();
+}
+
+void BleManager::handleAudioPacket(const uint8_t *data, size_t length) {
+  if (!data || length == 0) {
+    return;
+  }
+
+  audioProducerBusy_.store(true);
+  if (audioCaptureActive_.load()) {
+    const uint32_t now = static_cast<uint32_t>(millis());
+    const uint32_t last = audioLastPacketMs_.load();
+    if (last != 0 && now - last > audioMaxGapMs_.load()) {
+      audioMaxGapMs_.store(now - last);
+    }
+    audioPackets_.fetch_add(1);
+    const size_t written = audioRing_.push(data, length);
+    if (written > 0) {
+      audioReceivedBytes_.fetch_add(static_cast<uint32_t>(written));
+    }
+    audioLastPacketMs_.store(now);
+  }
+  audioProducerBusy_.store(false);
 }
 
 void BleManager::resetSessionState() {
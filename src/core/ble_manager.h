@@ -2,10 +2,13 @@
 
 #include <Arduino.h>
 
+#include <atomic>
 #include <functional>
 #include <vector>
 
 #include "runtime_config.h"
+#include "spsc_byte_ring.h"
+#include "voice_codec.h"
 
 class NimBLEScan;
 class NimBLEClient;
@@ -23,6 +26,24 @@ struct BleDeviceInfo {
   bool isLikelyAudio = false;
 };
 
+enum class BleLinkProfile : uint8_t {
+  Throughput = 0,  // 2M PHY, max MTU/DLE, 7.5-15 ms interval
+  LowPower = 1,    // 1M PHY, 30-50 ms interval with peripheral latency
+};
+
+struct BleThroughputResult {
+  uint32_t durationMs = 0;
+  uint32_t receivedBytes = 0;
+  uint32_t packets = 0;
+  uint32_t bytesPerSecond = 0;  // everything that arrived over the air
+  uint32_t droppedBytes = 0;    // arrived but did not fit the ring
+  float dropPercent = 0.0f;
+  uint32_t maxGapMs = 0;        // longest gap between notifications
+  uint16_t mtu = 0;
+  float intervalMs = 0.0f;
+  bool phy2M = false;
+};
+
 struct BleStatus {
   bool initialized = false;
   bool scanning = false;
@@ -37,6 +58,15 @@ struct BleStatus {
   bool audioStreamAvailable = false;
   String audioServiceUuid;
   String audioCharUuid;
+  uint32_t audioRingBytes = 0;
+  bool audioRingInPsram = false;
+  uint32_t audioRingHighWater = 0;
+  uint32_t audioOverrunBytes = 0;
+  uint32_t audioOverruns = 0;
+  BleLinkProfile linkProfile = BleLinkProfile::Throughput;
+  uint16_t linkMtu = 0;
+  float linkIntervalMs = 0.0f;
+  bool linkPhy2M = false;
   String keyboardText;
   String pairingHint;
   String lastError;
@@ -53,12 +83,24 @@ class BleManager {
   bool connectToDevice(const String &address,
                        const String &name = "",
                        String *error = nullptr);
+  // path may be empty when sink is set; the recording is then streamed only.
   bool recordAudioStreamWavToSd(const String &path,
                                 uint16_t seconds,
                                 const std::function<void()> &backgroundTick,
                                 const std::function<bool()> &stopRequested = std::function<bool()>(),
                                 String *error = nullptr,
-                                uint32_t *bytesWritten = nullptr);
+                                uint32_t *bytesWritten = nullptr,
+                                VoiceEncoding encoding = VoiceEncoding::Pcm16,
+                                const VoiceWavStreamSink *sink = nullptr);
+  // Drains the audio stream characteristic for `seconds` without recording
+  // and reports achieved throughput, ring drops and the longest packet gap.
+  bool runThroughputTest(uint16_t seconds,
+                         const std::function<void()> &backgroundTick,
+                         BleThroughputResult *result,
+                         String *error = nullptr);
+  // Applied on the next connect, and renegotiated at once if connected.
+  void setLinkProfile(BleLinkProfile profile);
+  BleLinkProfile linkProfile() const;
   void disconnectNow();
   void clearKeyboardInput();
   String keyboardInputText() const;
@@ -82,9 +124,14 @@ class BleManager {
   bool isLikelySystemServiceUuid(const String &uuidLower) const;
   bool isLikelyAudioServiceUuid(const String &uuidLower) const;
   void resetAudioStreamState();
-  void resetAudioCaptureBuffer();
+  void applyConnectParams(NimBLEClient *client) const;
+  void tuneConnectedLink();
+  bool resolveAudioStream();
+  bool beginAudioStream(String *error);
+  void endAudioStream();
+  bool startAudioCapture(String *error);
+  void stopAudioCapture();
   void handleAudioPacket(const uint8_t *data, size_t length);
-  size_t popAudioData(uint8_t *out, size_t maxLen);
   void resetSessionState();
   bool updateDeviceInfoFromAdvertised(const NimBLEAdvertisedDevice *device,
                                       BleDeviceInfo &info) const;
@@ -92,6 +139,7 @@ class BleManager {
   RuntimeConfig config_;
   NimBLEScan *scan_ = nullptr;
   NimBLEClient *client_ = nullptr;
+  BleLinkProfile linkProfile_ = BleLinkProfile::Throughput;
 
   bool initialized_ = false;
   bool scanning_ = false;
@@ -108,14 +156,14 @@ class BleManager {
   NimBLERemoteCharacteristic *audioStreamChr_ = nullptr;
   String audioStreamServiceUuid_;
   String audioStreamCharUuid_;
-  static constexpr size_t kAudioRingCapacity = 16384;
-  uint8_t audioRing_[kAudioRingCapacity] = {0};
-  size_t audioRingHead_ = 0;
-  size_t audioRingTail_ = 0;
-  uint32_t audioReceivedBytes_ = 0;
-  uint32_t audioDroppedBytes_ = 0;
-  unsigned long audioLastPacketMs_ = 0;
-  bool audioCaptureActive_ = false;
+  // Written by the NimBLE host task, drained by the recording loop.
+  SpscByteRing audioRing_;
+  std::atomic<uint32_t> audioReceivedBytes_{0};
+  std::atomic<uint32_t> audioLastPacketMs_{0};
+  std::atomic<uint32_t> audioPackets_{0};
+  std::atomic<uint32_t> audioMaxGapMs_{0};
+  std::atomic<bool> audioCaptureActive_{false};
+  std::atomic<bool> audioProducerBusy_{false};
   String keyboardInputBuffer_;
   String pairingHint_;
   uint8_t lastKeyboardKeys_[6] = {0, 0, 0, 0, 0, 0};
@@ -0,0 +1,619 @@
+#include "chat_history.h"
+
+#include <ArduinoJson.h>
+#include <SD.h>
+
+#include "dir_listing.h"
+#include "gateway_client.h"
+#include "user_config.h"
+
+namespace chathistory {
+namespace {
+
+constexpr const char *kMessengerDir = "/messenger";
+constexpr const char *kHistoryDir = "/messenger/history";
+// Same as the messenger's default session.
+constexpr const char *kDefaultSessionKey = "agent:main:main";
+constexpr const char *kIndexRewriteMode = "r+";
+constexpr size_t kSessionNameChars = 24;
+// Newest index records searched for a same-id message and for the insert
+// position of a message that arrives out of time order.
+constexpr size_t kTailRecords = 32;
+// Messages kept per session without an SD card.
+constexpr size_t kRamMessages = 64;
+constexpr uint32_t kStorageCheckMs = 5000;
+constexpr uint32_t kInboxScanMs = 250;
+// A streamed reply is written once it has not changed for kSettleMs, and at
+// most every kStreamWriteMs while it keeps changing.
+constexpr uint32_t kSettleMs = 800;
+constexpr uint32_t kStreamWriteMs = 5000;
+constexpr uint32_t kFlagOutgoing = 1U;
+
+struct IndexRecord {
+  uint64_t tsMs;
+  uint32_t offset;
+  uint32_t length;
+  uint32_t idHash;
+  uint32_t flags;
+};
+static_assert(sizeof(IndexRecord) == 24, "index records are 24 bytes on SD");
+
+// Inbox message being copied into the history.
+struct Tracked {
+  String id;
+  uint32_t hash = 0;
+  uint32_t changedMs = 0;
+  uint32_t dirtySinceMs = 0;
+  uint32_t writtenHash = 0;
+  bool written = false;
+};
+
+String gSession;
+String gBasePath;
+bool gStarted = false;
+bool gOnSd = false;
+size_t gCount = 0;
+uint32_t gRevision = 0;
+std::vector<Message> gRam;
+uint32_t gLastStorageCheckMs = 0;
+uint32_t gSeenInboxRevision = 0;
+uint32_t gLastInboxScanMs = 0;
+std::vector<Tracked> gTracked;
+
+uint32_t fnv1a(const String &text, uint32_t hash = 2166136261U) {
+  for (size_t i = 0; i < text.length(); ++i) {
+    hash ^= static_cast<uint8_t>(text[i]);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+bool sdAvailable() {
+#if HAL_HAS_SD_CARD
+  return SD.cardType() != CARD_NONE;
+#else
+  return false;
+#endif
+}
+
+// "/messenger/history/agent_main_main-1a2b3c4d"; the hash keeps keys that
+// sanitize to the same name apart.
+String sessionBasePath(const String &sessionKey) {
+  String name;
+  for (size_t i = 0; i < sessionKey.length() && name.length() < kSessionNameChars; ++i) {
+    const char c = sessionKey[i];
+    name += (isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_') ? c : '_';
+  }
+  char hash[12];
+  snprintf(hash, sizeof(hash), "-%08lx", static_cast<unsigned long>(fnv1a(sessionKey)));
+  return String(kHistoryDir) + "/" + name + hash;
+}
+
+String logPathOf(const String &base) {
+  return base + ".log";
+}
+
+String indexPathOf(const String &base) {
+  return base + ".idx";
+}
+
+String messageLine(const Message &message) {
+  DynamicJsonDocument doc(message.id.length() + message.type.length() + message.from.length() +
+                          message.text.length() + message.fileName.length() + 384U);
+  doc["id"] = message.id;
+  doc["dir"] = message.outgoing ? "out" : "in";
+  doc["type"] = message.type;
+  doc["from"] = message.from;
+  doc["text"] = message.text;
+  if (!message.fileName.isEmpty()) {
+    doc["name"] = message.fileName;
+  }
+  if (message.bytes > 0) {
+    doc["bytes"] = message.bytes;
+  }
+  doc["ts"] = message.tsMs;
+  if (message.delivery == Delivery::Sent) {
+    doc["st"] = "sent";
+  } else if (message.delivery == Delivery::Failed) {
+    doc["st"] = "failed";
+  }
+  String line;
+  serializeJson(doc, line);
+  line += '\n';
+  return line;
+}
+
+bool parseLine(const String &line, Message &out) {
+  DynamicJsonDocument doc(line.length() + 512U);
+  if (deserializeJson(doc, line)) {
+    return false;
+  }
+  out.id = String(static_cast<const char *>(doc["id"] | ""));
+  out.outgoing = strcmp(doc["dir"] | "in", "out") == 0;
+  out.type = String(static_cast<const char *>(doc["type"] | "text"));
+  out.from = String(static_cast<const char *>(doc["from"] | ""));
+  out.text = String(static_cast<const char *>(doc["text"] | ""));
+  out.fileName = String(static_cast<const char *>(doc["name"] | ""));
+  out.bytes = doc["bytes"] | 0U;
+  out.tsMs = doc["ts"] | 0ULL;
+  const char *delivery = doc["st"] | "";
+  out.delivery = strcmp(delivery, "sent") == 0     ? Delivery::Sent
+                 : strcmp(delivery, "failed") == 0 ? Delivery::Failed
+                                                   : Delivery::Unknown;
+  return true;
+}
+
+size_t sdCount(const String &base) {
+  File index = SD.open(indexPathOf(base).c_str(), FILE_READ);
+  if (!index) {
+    return 0;
+  }
+  const size_t records = static_cast<size_t>(index.size()) / sizeof(IndexRecord);
+  index.close();
+  return records;
+}
+
+bool readLogLine(File &log, const IndexRecord &record, String &line) {
+  if (!log.seek(record.offset)) {
+    return false;
+  }
+  line = log.readStringUntil('\n');
+  return line.length() == record.length;
+}
+
+bool sameMessage(const String &base, const IndexRecord &record, const String &id) {
+  File log = SD.open(logPathOf(base).c_str(), FILE_READ);
+  if (!log) {
+    return false;
+  }
+  String line;
+  Message stored;
+  const bool same = readLogLine(log, record, line) && parseLine(line, stored) && stored.id == id;
+  log.close();
+  return same;
+}
+
+// Appends message to the session's log and files its index record in time
+// order among the newest kTailRecords. *added is false when an earlier copy
+// of the message was replaced; *shifted is true when records that were
+// already there moved or changed.
+bool storeOnSd(const String &base, const Message &message, bool *added, bool *shifted) {
+  *added = false;
+  *shifted = false;
+  if (!SD.exists(kMessengerDir)) {
+    SD.mkdir(kMessengerDir);
+  }
+  if (!SD.exists(kHistoryDir)) {
+    SD.mkdir(kHistoryDir);
+  }
+
+  const String logPath = logPathOf(base);
+  const String indexPath = indexPathOf(base);
+  const String line = messageLine(message);
+  File log = SD.open(logPath.c_str(), FILE_APPEND);
+  if (!log) {
+    return false;
+  }
+  IndexRecord record;
+  record.tsMs = message.tsMs;
+  record.offset = static_cast<uint32_t>(log.size());
+  record.length = static_cast<uint32_t>(line.length()) - 1U;
+  record.idHash = fnv1a(message.id);
+  record.flags = message.outgoing ? kFlagOutgoing : 0U;
+  const bool written =
+      log.write(reinterpret_cast<const uint8_t *>(line.c_str()), line.length()) == line.length();
+  log.close();
+  dirlisting::noteChanged(logPath);
+  if (!written) {
+    return false;
+  }
+
+  if (!SD.exists(indexPath.c_str())) {
+    File created = SD.open(indexPath.c_str(), FILE_WRITE);
+    if (!created) {
+      return false;
+    }
+    created.close();
+  }
+  File index = SD.open(indexPath.c_str(), kIndexRewriteMode);
+  if (!index) {
+    return false;
+  }
+  // A record cut short by power loss is overwritten by the next one.
+  const size_t total = static_cast<size_t>(index.size()) / sizeof(IndexRecord);
+  const size_t tailFirst = total > kTailRecords ? total - kTailRecords : 0;
+  const size_t tailCount = total - tailFirst;
+  IndexRecord tail[kTailRecords + 1];
+  const size_t tailBytes = tailCount * sizeof(IndexRecord);
+  if (tailCount > 0 &&
+      (!index.seek(static_cast<uint32_t>(tailFirst * sizeof(IndexRecord))) ||
+       index.read(reinterpret_cast<uint8_t *>(tail), tailBytes) != tailBytes)) {
+    index.close();
+    return false;
+  }
+
+  if (!message.id.isEmpty()) {
+    for (size_t i = tailCount; i-- > 0;) {
+      if (tail[i].idHash != record.idHash || tail[i].flags != record.flags ||
+          !sameMessage(base, tail[i], message.id)) {
+        continue;
+      }
+      // Same message again (a streamed reply that grew): the record keeps its
+      // place and points at the new line.
+      record.tsMs = tail[i].tsMs;
+      const bool ok = index.seek(static_cast<uint32_t>((tailFirst + i) * sizeof(IndexRecord))) &&
+                      index.write(reinterpret_cast<const uint8_t *>(&record), sizeof(record)) ==
+                          sizeof(record);
+      index.close();
+      dirlisting::noteChanged(indexPath);
+      *shifted = ok;
+      return ok;
+    }
+  }
+
+  size_t pos = tailCount;
+  while (pos > 0 && record.tsMs != 0 && tail[pos - 1].tsMs > record.tsMs) {
+    --pos;
+  }
+  for (size_t i = tailCount; i > pos; --i) {
+    tail[i] = tail[i - 1];
+  }
+  tail[pos] = record;
+  const size_t writeBytes = (tailCount + 1 - pos) * sizeof(IndexRecord);
+  const bool ok = index.seek(static_cast<uint32_t>((tailFirst + pos) * sizeof(IndexRecord))) &&
+                  index.write(reinterpret_cast<const uint8_t *>(&tail[pos]), writeBytes) ==
+                      writeBytes;
+  index.close();
+  dirlisting::noteChanged(indexPath);
+  *added = ok;
+  *shifted = ok && pos < tailCount;
+  return ok;
+}
+
+void storeInRam(const Message &message) {
+  const size_t tailFirst = gRam.size() > kTailRecords ? gRam.size() - kTailRecords : 0;
+  if (!message.id.isEmpty()) {
+    for (size_t i = gRam.size(); i-- > tailFirst;) {
+      if (gRam[i].id == message.id && gRam[i].outgoing == message.outgoing) {
+        const uint64_t tsMs = gRam[i].tsMs;
+        gRam[i] = message;
+        gRam[i].tsMs = tsMs;
+        ++gRevision;
+        return;
+      }
+    }
+  }
+  size_t pos = gRam.size();
+  while (pos > tailFirst && message.tsMs != 0 && gRam[pos - 1].tsMs > message.tsMs) {
+    --pos;
+  }
+  if (pos < gRam.size()) {
+    ++gRevision;
+  }
+  gRam.insert(gRam.begin() + static_cast<long>(pos), message);
+  if (gRam.size() > kRamMessages) {
+    gRam.erase(gRam.begin());
+    ++gRevision;
+  }
+}
+
+void openSession(const String &sessionKey) {
+  gSession = sessionKey;
+  gBasePath = sessionBasePath(sessionKey);
+  gRam.clear();
+  gOnSd = sdAvailable();
+  gCount = gOnSd ? sdCount(gBasePath) : 0;
+  gLastStorageCheckMs = millis();
+  gStarted = true;
+  ++gRevision;
+}
+
+void ensureStarted() {
+  if (!gStarted) {
+    openSession(kDefaultSessionKey);
+  }
+}
+
+void checkStorage() {
+  const bool sd = sdAvailable();
+  if (sd == gOnSd) {
+    return;
+  }
+  // Card inserted: what was kept in RAM moves onto it. Card gone: start over
+  // in RAM; the card keeps its history for when it is back.
+  std::vector<Message> ram;
+  ram.swap(gRam);
+  gOnSd = sd;
+  gCount = sd ? sdCount(gBasePath) : 0;
+  ++gRevision;
+  if (sd) {
+    for (const Message &message : ram) {
+      record(message);
+    }
+  }
+}
+
+// Outgoing message id among the newest kTailRecords of sessionKey.
+bool findOutgoing(const String &sessionKey, const String &id, Message &out) {
+  if (sessionKey == gSession && !gOnSd) {
+    const size_t tailFirst = gRam.size() > kTailRecords ? gRam.size() - kTailRecords : 0;
+    for (size_t i = gRam.size(); i-- > tailFirst;) {
+      if (gRam[i].outgoing && gRam[i].id == id) {
+        out = gRam[i];
+        return true;
+      }
+    }
+    return false;
+  }
+  if (!gOnSd) {
+    return false;
+  }
+
+  const String base = sessionBasePath(sessionKey);
+  File index = SD.open(indexPathOf(base).c_str(), FILE_READ);
+  if (!index) {
+    return false;
+  }
+  const size_t total = static_cast<size_t>(index.size()) / sizeof(IndexRecord);
+  const size_t tailFirst = total > kTailRecords ? total - kTailRecords : 0;
+  const size_t tailCount = total - tailFirst;
+  IndexRecord tail[kTailRecords];
+  const size_t tailBytes = tailCount * sizeof(IndexRecord);
+  const bool indexOk = index.seek(static_cast<uint32_t>(tailFirst * sizeof(IndexRecord))) &&
+                       index.read(reinterpret_cast<uint8_t *>(tail), tailBytes) == tailBytes;
+  index.close();
+  if (!indexOk) {
+    return false;
+  }
+
+  const uint32_t idHash = fnv1a(id);
+  File log;
+  bool found = false;
+  for (size_t i = tailCount; i-- > 0 && !found;) {
+    if (tail[i].idHash != idHash || (tail[i].flags & kFlagOutgoing) == 0) {
+      continue;
+    }
+    if (!log) {
+      log = SD.open(logPathOf(base).c_str(), FILE_READ);
+      if (!log) {
+        return false;
+      }
+    }
+    String line;
+    found = readLogLine(log, tail[i], line) && parseLine(line, out) && out.id == id;
+  }
+  if (log) {
+    log.close();
+  }
+  return found;
+}
+
+bool storeForSession(const String &sessionKey, const Message &message) {
+  if (sessionKey == gSession) {
+    return record(message);
+  }
+  if (!gOnSd) {
+    return false;
+  }
+  bool added = false;
+  bool shifted = false;
+  return storeOnSd(sessionBasePath(sessionKey), message, &added, &shifted);
+}
+
+String inboxId(const GatewayInboxMessage &message) {
+  if (!message.id.isEmpty()) {
+    return message.id;
+  }
+  char id[24];
+  snprintf(id,
+           sizeof(id),
+           "in-%08lx",
+           static_cast<unsigned long>(fnv1a(message.text, fnv1a(message.from)) ^
+                                      static_cast<uint32_t>(message.tsMs)));
+  return String(id);
+}
+
+int findTracked(const String &id) {
+  for (size_t i = 0; i < gTracked.size(); ++i) {
+    if (gTracked[i].id == id) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void scanInbox(GatewayClient &gateway, uint32_t now) {
+  bool pending = false;
+  for (const Tracked &tracked : gTracked) {
+    if (!tracked.written || tracked.writtenHash != tracked.hash) {
+      pending = true;
+      break;
+    }
+  }
+  const uint32_t inboxRevision = gateway.inboxRevision();
+  if (inboxRevision == gSeenInboxRevision && !pending) {
+    return;
+  }
+  gSeenInboxRevision = inboxRevision;
+
+  // Rebuilt from the inbox each pass, so ids that fell out of it are dropped.
+  std::vector<Tracked> next;
+  next.reserve(gateway.inboxCount());
+  for (size_t i = 0; i < gateway.inboxCount(); ++i) {
+    GatewayInboxMessage message;
+    if (!gateway.inboxMessage(i, message)) {
+      continue;
+    }
+    const String id = inboxId(message);
+    const uint32_t hash = fnv1a(message.text, fnv1a(message.fileName, fnv1a(message.type)));
+    const int known = findTracked(id);
+    Tracked tracked;
+    if (known >= 0) {
+      tracked = gTracked[static_cast<size_t>(known)];
+    } else {
+      tracked.id = id;
+      tracked.hash = hash;
+      tracked.changedMs = now;
+      tracked.dirtySinceMs = now;
+    }
+    if (tracked.hash != hash) {
+      if (tracked.written && tracked.writtenHash == tracked.hash) {
+        tracked.dirtySinceMs = now;
+      }
+      tracked.hash = hash;
+      tracked.changedMs = now;
+    }
+
+    const bool dirty = !tracked.written || tracked.writtenHash != tracked.hash;
+    if (dirty && (now - tracked.changedMs >= kSettleMs ||
+                  now - tracked.dirtySinceMs >= kStreamWriteMs)) {
+      Message stored;
+      stored.id = id;
+      stored.outgoing = false;
+      stored.type = message.type;
+      stored.from = message.from;
+      stored.text = message.text;
+      stored.fileName = message.fileName;
+      stored.bytes = message.voiceBytes;
+      stored.tsMs = message.tsMs;
+      const String sessionKey = message.to.startsWith("agent:") ? message.to : gSession;
+      // Not retried: a card that fails one write fails the next.
+      storeForSession(sessionKey, stored);
+      tracked.written = true;
+      tracked.writtenHash = tracked.hash;
+      tracked.dirtySinceMs = now;
+    }
+    next.push_back(tracked);
+  }
+  gTracked.swap(next);
+}
+
+}  // namespace
+
+void setSession(const String &sessionKey) {
+  if (gStarted && sessionKey == gSession) {
+    return;
+  }
+  openSession(sessionKey.isEmpty() ? String(kDefaultSessionKey) : sessionKey);
+}
+
+const String &session() {
+  ensureStarted();
+  return gSession;
+}
+
+void tick(GatewayClient &gateway) {
+  ensureStarted();
+  const uint32_t now = millis();
+  if (now - gLastStorageCheckMs >= kStorageCheckMs) {
+    gLastStorageCheckMs = now;
+    checkStorage();
+  }
+  if (now - gLastInboxScanMs >= kInboxScanMs) {
+    gLastInboxScanMs = now;
+    scanInbox(gateway, now);
+  }
+}
+
+bool record(const Message &message) {
+  ensureStarted();
+  if (!gOnSd) {
+    storeInRam(message);
+    return true;
+  }
+  bool added = false;
+  bool shifted = false;
+  if (!storeOnSd(gBasePath, message, &added, &shifted)) {
+    return false;
+  }
+  if (added) {
+    ++gCount;
+  }
+  if (shifted) {
+    ++gRevision;
+  }
+  return true;
+}
+
+bool setDelivery(const String &sessionKey, const String &id, Delivery delivery) {
+  ensureStarted();
+  Message message;
+  if (id.isEmpty() || !findOutgoing(sessionKey, id, message)) {
+    return false;
+  }
+  if (message.delivery == delivery) {
+    return true;
+  }
+  message.delivery = delivery;
+  return storeForSession(sessionKey, message);
+}
+
+size_t count() {
+  ensureStarted();
+  return gOnSd ? gCount : gRam.size();
+}
+
+size_t read(size_t first, size_t max, std::vector<Message> &out) {
+  ensureStarted();
+  const size_t total = count();
+  if (first >= total || max == 0) {
+    return 0;
+  }
+  const size_t n = total - first < max ? total - first : max;
+  if (!gOnSd) {
+    out.insert(out.end(),
+               gRam.begin() + static_cast<long>(first),
+               gRam.begin() + static_cast<long>(first + n));
+    return n;
+  }
+
+  std::vector<IndexRecord> records(n);
+  File index = SD.open(indexPathOf(gBasePath).c_str(), FILE_READ);
+  const size_t bytes = n * sizeof(IndexRecord);
+  const bool indexOk = index && index.seek(static_cast<uint32_t>(first * sizeof(IndexRecord))) &&
+                       index.read(reinterpret_cast<uint8_t *>(records.data()), bytes) == bytes;
+  if (index) {
+    index.close();
+  }
+  File log = SD.open(logPathOf(gBasePath).c_str(), FILE_READ);
+  for (size_t i = 0; i < n; ++i) {
+    Message message;
+    String line;
+    if (!indexOk || !log || !readLogLine(log, records[i], line) || !parseLine(line, message)) {
+      message = Message();
+      message.outgoing = indexOk && (records[i].flags & kFlagOutgoing) != 0;
+      message.tsMs = indexOk ? records[i].tsMs : 0;
+      message.text = "(unreadable)";
+    }
+    out.push_back(message);
+  }
+  if (log) {
+    log.close();
+  }
+  return n;
+}
+
+uint32_t revision() {
+  return gRevision;
+}
+
+void clear() {
+  ensureStarted();
+  if (gOnSd) {
+    const String logPath = logPathOf(gBasePath);
+    const String indexPath = indexPathOf(gBasePath);
+    SD.remove(indexPath.c_str());
+    SD.remove(logPath.c_str());
+    dirlisting::noteChanged(indexPath);
+    dirlisting::noteChanged(logPath);
+  }
+  gRam.clear();
+  gCount = 0;
+  ++gRevision;
+}
+
+const char *storageName() {
+  return gOnSd ? "sd" : "ram";
+}
+
+}  // namespace chathistory
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+class GatewayClient;
+
+// Messenger chat history, one store per session key. On SD each session has
+// an append-only JSON-lines log plus a small index of fixed-size records
+// (timestamp, log offset, length) kept in time order, so the messenger reads
+// only the messages it shows instead of loading the whole conversation.
+// Without a card the current session is kept in RAM (newest messages only).
+//
+// tick() copies incoming gateway messages into the history. Messages that are
+// still streaming (the gateway updates them in place) are written once they
+// settle; a later update to the same id replaces the stored one.
+namespace chathistory {
+
+// Final outcome of an outgoing message, written once the outbox settles it.
+// Unknown until then, and for messages stored before it was recorded.
+enum class Delivery : uint8_t {
+  Unknown = 0,
+  Sent = 1,
+  Failed = 2,
+};
+
+struct Message {
+  String id;
+  bool outgoing = false;
+  Delivery delivery = Delivery::Unknown;
+  String type;
+  String from;
+  String text;
+  String fileName;
+  uint32_t bytes = 0;
+  uint64_t tsMs = 0;
+};
+
+// Session that count()/read() refer to. Incoming messages addressed to an
+// "agent:..." session key are stored with that session; others with this one.
+void setSession(const String &sessionKey);
+const String &session();
+void tick(GatewayClient &gateway);
+
+// Stores message with the current session, in time order. A message whose id
+// is already among the newest ones replaces it.
+bool record(const Message &message);
+
+// Records the delivery outcome of an outgoing message stored under
+// sessionKey. Only the newest messages of the session are searched (as for
+// replacements in record()); returns false when it is not among them.
+bool setDelivery(const String &sessionKey, const String &id, Delivery delivery);
+
+// Messages oldest first.
+size_t count();
+// Reads messages [first, first + max). Every index record in range yields a
+// message, so out grows by exactly the returned count.
+size_t read(size_t first, size_t max, std::vector<Message> &out);
+// Changes whenever messages already counted change (replaced, inserted
+// before newer ones, cleared); plain appends only raise count().
+uint32_t revision();
+// Deletes the current session's history.
+void clear();
+
+// "sd" or "ram".
+const char *storageName();
+
+}  // namespace chathistory
@@ -0,0 +1,142 @@
+#include "chunk_window.h"
+
+void ChunkWindow::begin(uint16_t totalChunks,
+                        uint8_t window,
+                        uint32_t ackTimeoutMs,
+                        uint8_t maxAttempts) {
+  state_.assign(totalChunks, kPending);
+  attempts_.assign(totalChunks, 0);
+  flights_.clear();
+  flights_.reserve(window > 0 ? window : 1);
+  acked_ = 0;
+  firstUnacked_ = 0;
+  scanFrom_ = 0;
+  window_ = window > 0 ? window : 1;
+  maxAttempts_ = maxAttempts > 0 ? maxAttempts : 1;
+  ackTimeoutMs_ = ackTimeoutMs;
+  retransmits_ = 0;
+  failedChunk_ = -1;
+}
+
+void ChunkWindow::requeue(size_t flightIndex) {
+  const uint16_t seq = flights_[flightIndex].seq;
+  state_[seq] = kPending;
+  if (seq < scanFrom_) {
+    scanFrom_ = seq;
+  }
+  flights_.erase(flights_.begin() + static_cast<long>(flightIndex));
+}
+
+int ChunkWindow::next(uint32_t nowMs) {
+  if (failed()) {
+    return -1;
+  }
+  for (size_t i = flights_.size(); i-- > 0;) {
+    if (nowMs - flights_[i].sentMs >= ackTimeoutMs_) {
+      requeue(i);
+    }
+  }
+  if (flights_.size() >= window_) {
+    return -1;
+  }
+
+  while (scanFrom_ < state_.size() && state_[scanFrom_] != kPending) {
+    ++scanFrom_;
+  }
+  if (scanFrom_ >= state_.size()) {
+    return -1;
+  }
+  const uint16_t seq = scanFrom_;
+  if (attempts_[seq] >= maxAttempts_) {
+    failedChunk_ = seq;
+    return -1;
+  }
+  return seq;
+}
+
+void ChunkWindow::markSent(uint16_t seq, const String &requestId, uint32_t nowMs) {
+  if (seq >= state_.size()) {
+    return;
+  }
+  if (attempts_[seq] > 0) {
+    ++retransmits_;
+  }
+  ++attempts_[seq];
+  state_[seq] = kInFlight;
+  Flight flight;
+  flight.seq = seq;
+  flight.requestId = requestId;
+  flight.sentMs = nowMs;
+  flights_.push_back(flight);
+}
+
+void ChunkWindow::markSendFailed(uint16_t seq) {
+  if (seq < state_.size() && seq < scanFrom_) {
+    scanFrom_ = seq;
+  }
+}
+
+bool ChunkWindow::onResponse(const String &requestId, bool ok) {
+  for (size_t i = 0; i < flights_.size(); ++i) {
+    if (flights_[i].requestId != requestId) {
+      continue;
+    }
+    if (!ok) {
+      requeue(i);
+      return true;
+    }
+    const uint16_t seq = flights_[i].seq;
+    flights_.erase(flights_.begin() + static_cast<long>(i));
+    state_[seq] = kAcked;
+    ++acked_;
+    while (firstUnacked_ < state_.size() && state_[firstUnacked_] == kAcked) {
+      ++firstUnacked_;
+    }
+    return true;
+  }
+  return false;
+}
+
+void ChunkWindow::requeueInFlight() {
+  while (!flights_.empty()) {
+    requeue(flights_.size() - 1U);
+  }
+}
+
+void ChunkWindow::ackInFlight() {
+  while (!flights_.empty()) {
+    onResponse(flights_.front().requestId, true);
+  }
+}
+
+bool ChunkWindow::done() const {
+  return acked_ == state_.size();
+}
+
+bool ChunkWindow::failed() const {
+  return failedChunk_ >= 0;
+}
+
+int ChunkWindow::failedChunk() const {
+  return failedChunk_;
+}
+
+uint16_t ChunkWindow::total() const {
+  return static_cast<uint16_t>(state_.size());
+}
+
+uint16_t ChunkWindow::acked() const {
+  return acked_;
+}
+
+uint16_t ChunkWindow::firstUnacked() const {
+  return firstUnacked_;
+}
+
+size_t ChunkWindow::inFlight() const {
+  return flights_.size();
+}
+
+uint32_t ChunkWindow::retransmits() const {
+  return retransmits_;
+}
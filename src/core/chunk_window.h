@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+// Sliding-window bookkeeping for chunked uploads sent as gateway requests.
+// Up to `window` chunks are in flight at once; each is acknowledged by the
+// gateway's response to its request id. A rejected or timed-out chunk is
+// queued again on its own (selective retransmit), and after a reconnect every
+// chunk still in flight is queued again, so the transfer continues from the
+// first unacknowledged chunk instead of restarting. Pending chunks are always
+// handed out lowest first, so first transmissions stay in file order.
+class ChunkWindow {
+ public:
+  void begin(uint16_t totalChunks, uint8_t window, uint32_t ackTimeoutMs, uint8_t maxAttempts);
+
+  // Chunk to send now, or -1 when the window is full or nothing is pending.
+  // Chunks whose ack timed out are queued again first.
+  int next(uint32_t nowMs);
+  void markSent(uint16_t seq, const String &requestId, uint32_t nowMs);
+  // The request could not be written (socket down); the chunk stays pending.
+  void markSendFailed(uint16_t seq);
+  // Returns true when requestId belonged to a chunk in flight.
+  bool onResponse(const String &requestId, bool ok);
+  // Connection lost: everything in flight is queued again.
+  void requeueInFlight();
+  // For gateways that never answer node.event: treat what is in flight as
+  // delivered.
+  void ackInFlight();
+
+  bool done() const;
+  // A chunk used up its attempts.
+  bool failed() const;
+  int failedChunk() const;
+  uint16_t total() const;
+  uint16_t acked() const;
+  // Chunks before this one are all acknowledged.
+  uint16_t firstUnacked() const;
+  size_t inFlight() const;
+  uint32_t retransmits() const;
+
+ private:
+  enum State : uint8_t {
+    kPending = 0,
+    kInFlight = 1,
+    kAcked = 2,
+  };
+
+  struct Flight {
+    uint16_t seq = 0;
+    String requestId;
+    uint32_t sentMs = 0;
+  };
+
+  void requeue(size_t flightIndex);
+
+  std::vector<uint8_t> state_;
+  std::vector<uint8_t> attempts_;
+  std::vector<Flight> flights_;
+  uint16_t acked_ = 0;
+  uint16_t firstUnacked_ = 0;
+  // Lowest chunk that may still be pending.
+  uint16_t scanFrom_ = 0;
+  uint8_t window_ = 1;
+  uint8_t maxAttempts_ = 1;
+  uint32_t ackTimeoutMs_ = 0;
+  uint32_t retransmits_ = 0;
+  int failedChunk_ = -1;
+};
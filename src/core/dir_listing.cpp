@@ -0,0 +1,362 @@
+#include "dir_listing.h"
+
+#include <SD.h>
+#include <esp_heap_caps.h>
+
+#include <algorithm>
+#include <string.h>
+
+#include "user_config.h"
+
+namespace dirlisting {
+
+namespace {
+
+// Records never straddle chunks; a handle is chunk index << kChunkShift plus
+// the record offset inside the chunk.
+constexpr uint32_t kChunkShift = 12;
+constexpr size_t kChunkBytes = 1U << kChunkShift;
+constexpr size_t kRecordHeaderBytes = 8;
+// Longest FAT name is 255 UTF-16 units, at most 765 bytes of UTF-8.
+constexpr size_t kMaxNameBytes = 768;
+constexpr uint8_t kFlagDirectory = 0x01;
+
+std::vector<Listing *> gListings;
+uint32_t gUseCounter = 0;
+
+bool psramAvailable() {
+#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
+  return psramFound();
+#else
+  return false;
+#endif
+}
+
+uint8_t *allocateChunk(bool psram) {
+#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
+  if (psram) {
+    return static_cast<uint8_t *>(ps_malloc(kChunkBytes));
+  }
+#else
+  (void)psram;
+#endif
+  return static_cast<uint8_t *>(
+      heap_caps_malloc(kChunkBytes, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL));
+}
+
+uint8_t foldAscii(uint8_t c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<uint8_t>(c + ('a' - 'A')) : c;
+}
+
+uint16_t recordNameLength(const uint8_t *rec) {
+  return static_cast<uint16_t>(rec[4] | (rec[5] << 8));
+}
+
+String parentOf(const String &path) {
+  const int slash = path.lastIndexOf('/');
+  if (slash <= 0) {
+    return "/";
+  }
+  return path.substring(0, static_cast<unsigned int>(slash));
+}
+
+size_t maxCachedListings() {
+  return psramAvailable() ? static_cast<size_t>(USER_FILE_EXPLORER_CACHED_DIRS) : 1U;
+}
+
+void erase(size_t index) {
+  delete gListings[index];
+  gListings.erase(gListings.begin() + static_cast<long>(index));
+}
+
+}  // namespace
+
+Listing::Listing(const String &path) : path_(path) {
+  usePsram_ = psramAvailable();
+  arenaLimit_ = usePsram_ ? 0U : static_cast<size_t>(USER_FILE_EXPLORER_LIST_INTERNAL_BYTES);
+}
+
+Listing::~Listing() {
+  if (dir_) {
+    dir_.close();
+  }
+  for (uint8_t *chunk : chunks_) {
+    heap_caps_free(chunk);
+  }
+}
+
+bool Listing::begin(String *error) {
+  startedMs_ = millis();
+  dir_ = SD.open(path_.c_str(), FILE_READ);
+  if (!dir_ || !dir_.isDirectory()) {
+    if (dir_) {
+      dir_.close();
+    }
+    failed_ = true;
+    if (error) {
+      *error = "Directory open failed";
+    }
+    return false;
+  }
+  return true;
+}
+
+const String &Listing::path() const {
+  return path_;
+}
+
+bool Listing::complete() const {
+  return complete_;
+}
+
+bool Listing::truncated() const {
+  return truncated_;
+}
+
+bool Listing::failed() const {
+  return failed_;
+}
+
+size_t Listing::size() const {
+  return order_.size();
+}
+
+uint8_t *Listing::record(uint32_t handle) const {
+  return chunks_[handle >> kChunkShift] + (handle & (kChunkBytes - 1U));
+}
+
+String Listing::name(size_t index) const {
+  if (index >= order_.size()) {
+    return String();
+  }
+  const uint8_t *rec = record(order_[index]);
+  const uint16_t len = recordNameLength(rec);
+  String out;
+  out.reserve(len);
+  out.concat(reinterpret_cast<const char *>(rec + kRecordHeaderBytes), len);
+  return out;
+}
+
+String Listing::fullPath(size_t index) const {
+  if (path_ == "/") {
+    return "/" + name(index);
+  }
+  return path_ + "/" + name(index);
+}
+
+bool Listing::isDirectory(size_t index) const {
+  return index < order_.size() && (record(order_[index])[6] & kFlagDirectory) != 0U;
+}
+
+uint32_t Listing::fileSize(size_t index) const {
+  if (index >= order_.size()) {
+    return 0;
+  }
+  uint32_t size = 0;
+  memcpy(&size, record(order_[index]), sizeof(size));
+  return size;
+}
+
+uint32_t Listing::handle(size_t index) const {
+  return index < order_.size() ? order_[index] : UINT32_MAX;
+}
+
+bool Listing::find(uint32_t handle, size_t *index) const {
+  if (handle == UINT32_MAX || order_.empty() || (handle >> kChunkShift) >= chunks_.size()) {
+    return false;
+  }
+  // order_ is sorted by less(), so the handle sits in its key's equal range.
+  auto it = std::lower_bound(order_.begin(),
+                             order_.end(),
+                             handle,
+                             [this](uint32_t a, uint32_t b) { return less(a, b); });
+  for (; it != order_.end() && !less(handle, *it); ++it) {
+    if (*it == handle) {
+      *index = static_cast<size_t>(it - order_.begin());
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t Listing::memoryBytes() const {
+  return chunks_.size() * kChunkBytes + order_.capacity() * sizeof(uint32_t);
+}
+
+uint32_t Listing::loadMs() const {
+  return loadMs_;
+}
+
+// Directories first, then the folded key; ties (names differing only in
+// case) fall back to the raw bytes so the order is stable.
+bool Listing::less(uint32_t a, uint32_t b) const {
+  const uint8_t *ra = record(a);
+  const uint8_t *rb = record(b);
+  const bool dirA = (ra[6] & kFlagDirectory) != 0U;
+  const bool dirB = (rb[6] & kFlagDirectory) != 0U;
+  if (dirA != dirB) {
+    return dirA;
+  }
+  const uint16_t lenA = recordNameLength(ra);
+  const uint16_t lenB = recordNameLength(rb);
+  const int keyCmp = memcmp(ra + kRecordHeaderBytes + lenA,
+                            rb + kRecordHeaderBytes + lenB,
+                            std::min(lenA, lenB));
+  if (keyCmp != 0) {
+    return keyCmp < 0;
+  }
+  if (lenA != lenB) {
+    return lenA < lenB;
+  }
+  return memcmp(ra + kRecordHeaderBytes, rb + kRecordHeaderBytes, lenA) < 0;
+}
+
+bool Listing::append(const char *name, bool isDirectory, uint32_t size) {
+  const size_t len = std::min(strlen(name), kMaxNameBytes);
+  const size_t need = (kRecordHeaderBytes + len * 2U + 3U) & ~static_cast<size_t>(3U);
+  if (chunks_.empty() || chunkUsed_ + need > kChunkBytes) {
+    if (arenaLimit_ > 0U && (chunks_.size() + 1U) * kChunkBytes > arenaLimit_) {
+      truncated_ = true;
+      return false;
+    }
+    uint8_t *chunk = allocateChunk(usePsram_);
+    if (!chunk) {
+      truncated_ = true;
+      return false;
+    }
+    chunks_.push_back(chunk);
+    chunkUsed_ = 0;
+  }
+
+  const uint32_t handle =
+      (static_cast<uint32_t>(chunks_.size() - 1U) << kChunkShift) | chunkUsed_;
+  uint8_t *rec = record(handle);
+  memcpy(rec, &size, sizeof(size));
+  rec[4] = static_cast<uint8_t>(len & 0xFFU);
+  rec[5] = static_cast<uint8_t>(len >> 8);
+  rec[6] = isDirectory ? kFlagDirectory : 0U;
+  rec[7] = 0;
+  memcpy(rec + kRecordHeaderBytes, name, len);
+  uint8_t *key = rec + kRecordHeaderBytes + len;
+  for (size_t i = 0; i < len; ++i) {
+    key[i] = foldAscii(static_cast<uint8_t>(name[i]));
+  }
+  chunkUsed_ += static_cast<uint32_t>(need);
+
+  const auto pos = std::upper_bound(order_.begin(),
+                                    order_.end(),
+                                    handle,
+                                    [this](uint32_t a, uint32_t b) { return less(a, b); });
+  order_.insert(pos, handle);
+  return true;
+}
+
+bool Listing::step(uint32_t budgetMs) {
+  if (complete_ || failed_) {
+    return false;
+  }
+
+  const unsigned long startMs = millis();
+  do {
+    File entry = dir_.openNextFile();
+    if (!entry) {
+      finish();
+      return false;
+    }
+    // Older cores return the full path from name().
+    const char *name = entry.name();
+    const char *slash = name ? strrchr(name, '/') : nullptr;
+    if (slash) {
+      name = slash + 1;
+    }
+    const bool added = !name || *name == '\0' ||
+                       append(name, entry.isDirectory(), static_cast<uint32_t>(entry.size()));
+    entry.close();
+    if (!added) {
+      finish();
+      return false;
+    }
+  } while (millis() - startMs < budgetMs);
+  return true;
+}
+
+void Listing::finish() {
+  if (dir_) {
+    dir_.close();
+  }
+  complete_ = true;
+  loadMs_ = millis() - startedMs_;
+}
+
+Listing *open(const String &path, String *error) {
+  ++gUseCounter;
+
+  // Unfinished listings of other directories hold a directory handle and
+  // are not worth keeping half read.
+  Listing *found = nullptr;
+  for (size_t i = gListings.size(); i-- > 0;) {
+    Listing *listing = gListings[i];
+    const bool samePath = listing->path_ == path;
+    if (listing->stale_ || listing->failed_ || (!listing->complete_ && !samePath)) {
+      erase(i);
+    } else if (samePath) {
+      found = listing;
+    }
+  }
+  if (found) {
+    found->lastUsed_ = gUseCounter;
+    return found;
+  }
+
+  while (!gListings.empty() && gListings.size() >= maxCachedListings()) {
+    size_t oldest = 0;
+    for (size_t i = 1; i < gListings.size(); ++i) {
+      if (gListings[i]->lastUsed_ < gListings[oldest]->lastUsed_) {
+        oldest = i;
+      }
+    }
+    erase(oldest);
+  }
+
+  Listing *listing = new Listing(path);
+  if (!listing->begin(error)) {
+    delete listing;
+    return nullptr;
+  }
+  listing->lastUsed_ = gUseCounter;
+  gListings.push_back(listing);
+  return listing;
+}
+
+void noteChanged(const String &path) {
+  if (path.isEmpty()) {
+    return;
+  }
+  const String parent = parentOf(path);
+  const String below = path.endsWith("/") ? path : path + "/";
+  for (Listing *listing : gListings) {
+    if (listing->path_ == parent || listing->path_ == path ||
+        listing->path_.startsWith(below)) {
+      listing->stale_ = true;
+    }
+  }
+}
+
+void invalidateAll() {
+  for (Listing *listing : gListings) {
+    if (!listing->complete_) {
+      listing->truncated_ = true;
+      listing->finish();
+    }
+    listing->stale_ = true;
+  }
+}
+
+void clear() {
+  for (Listing *listing : gListings) {
+    delete listing;
+  }
+  gListings.clear();
+}
+
+}  // namespace dirlisting
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include <vector>
+
+// Directory listings for the file explorer, read incrementally and cached per
+// directory. Entries are packed into a chunked arena (PSRAM when available)
+// as size, flags, name and a case-folded sort key computed once on insert;
+// the order is a sorted array of record handles that stays sorted while
+// loading, so the first page can be shown before the directory is read.
+namespace dirlisting {
+
+class Listing {
+ public:
+  explicit Listing(const String &path);
+  ~Listing();
+  Listing(const Listing &) = delete;
+  Listing &operator=(const Listing &) = delete;
+
+  const String &path() const;
+  // Reads entries for up to budgetMs. Returns true while more remain.
+  bool step(uint32_t budgetMs);
+  bool complete() const;
+  // Loading stopped at the arena limit (or on allocation failure).
+  bool truncated() const;
+  bool failed() const;
+
+  // Entries loaded so far, directories first, then by case-folded name.
+  size_t size() const;
+  String name(size_t index) const;
+  String fullPath(size_t index) const;
+  bool isDirectory(size_t index) const;
+  uint32_t fileSize(size_t index) const;
+  // Record handles stay with their entry while loading inserts rows around
+  // it; find() gives the entry's current index, false when not loaded.
+  uint32_t handle(size_t index) const;
+  bool find(uint32_t handle, size_t *index) const;
+
+  size_t memoryBytes() const;
+  uint32_t loadMs() const;
+
+ private:
+  friend Listing *open(const String &path, String *error);
+  friend void noteChanged(const String &path);
+  friend void invalidateAll();
+
+  bool begin(String *error);
+  bool append(const char *name, bool isDirectory, uint32_t size);
+  uint8_t *record(uint32_t handle) const;
+  bool less(uint32_t a, uint32_t b) const;
+  void finish();
+
+  String path_;
+  File dir_;
+  std::vector<uint8_t *> chunks_;
+  uint32_t chunkUsed_ = 0;
+  std::vector<uint32_t> order_;
+  bool usePsram_ = false;
+  size_t arenaLimit_ = 0;
+  bool complete_ = false;
+  bool truncated_ = false;
+  bool failed_ = false;
+  bool stale_ = false;
+  uint32_t startedMs_ = 0;
+  uint32_t loadMs_ = 0;
+  uint32_t lastUsed_ = 0;
+};
+
+// Listing for path: the cached one when it is still valid, otherwise a new
+// listing that fills in as step() is called. The pointer stays valid until
+// the next open() or clear(). Returns nullptr with *error set when path is
+// not a readable directory.
+Listing *open(const String &path, String *error = nullptr);
+// Call after creating, writing, renaming or deleting path on SD. Drops the
+// cached listing of its parent directory and, for directories, everything
+// below it (they are reloaded by the next open()).
+void noteChanged(const String &path);
+// Forgets every listing (SD remounted or formatted).
+void clear();
+// Like clear() for code that may run while a listing is on screen (from a
+// background tick): listings are only marked stale and their directory
+// handles closed, so pointers stay readable until the owner's next open(),
+// which reloads them. A listing that was still loading shows as truncated.
+void invalidateAll();
+
+}  // namespace dirlisting
@@ -0,0 +1,862 @@
+#include "firmware_fetch.h"
+
+#include <HTTPClient.h>
+#include <SD.h>
+#include <Update.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include <esp_heap_caps.h>
+#include <freertos/queue.h>
+
+#include <algorithm>
+
+#include "dir_listing.h"
+#include "sha256_stream.h"
+
+namespace fwfetch {
+namespace {
+
+// One flash sector per buffer: Update erases and writes whole sectors.
+constexpr size_t kBufferBytes = 4096;
+constexpr uint32_t kWriterStackBytes = 4096;
+constexpr UBaseType_t kWriterPriority = 2;
+constexpr uint8_t kStopIndex = 0xFF;
+constexpr uint32_t kHttpTimeoutMs = 15000;
+constexpr unsigned long kIdleTimeoutMs = 12000UL;
+// How long the reader waits for a free buffer before servicing the UI.
+constexpr uint32_t kBufferWaitMs = 20;
+constexpr unsigned long kProgressIntervalMs = 200UL;
+constexpr size_t kSdChunkBytes = 2048;
+constexpr uint8_t kDownloadAttempts = 4;
+constexpr unsigned long kRetryDelayMs = 1000UL;
+// How often the sidecar is brought up to date during a download.
+constexpr uint32_t kPartialSaveBytes = 64U * 1024U;
+
+struct Block {
+  uint8_t index = 0;
+  uint16_t length = 0;
+};
+
+// Two buffers cycling between the reader (caller) and a task that writes them
+// to the OTA partition, so flash erase/write overlaps the next socket read.
+class FlashWriter {
+ public:
+  ~FlashWriter() {
+    finish();
+    if (full_) {
+      vQueueDelete(full_);
+    }
+    if (empty_) {
+      vQueueDelete(empty_);
+    }
+    if (memory_) {
+      heap_caps_free(memory_);
+    }
+  }
+
+  bool begin(String *error) {
+    memory_ = static_cast<uint8_t *>(
+        heap_caps_malloc(kBufferBytes * 2U, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    full_ = xQueueCreate(2, sizeof(Block));
+    empty_ = xQueueCreate(2, sizeof(Block));
+    if (!memory_ || !full_ || !empty_) {
+      if (error) {
+        *error = "Out of memory for OTA buffers";
+      }
+      return false;
+    }
+    for (uint8_t i = 0; i < 2; ++i) {
+      Block block;
+      block.index = i;
+      xQueueSend(empty_, &block, 0);
+    }
+    if (xTaskCreate(&FlashWriter::taskEntry,
+                    "ota_write",
+                    kWriterStackBytes,
+                    this,
+                    kWriterPriority,
+                    &task_) != pdPASS) {
+      task_ = nullptr;
+      if (error) {
+        *error = "OTA writer task create failed";
+      }
+      return false;
+    }
+    return true;
+  }
+
+  // A buffer to fill, or nullptr when both are still being flashed.
+  uint8_t *acquire(uint32_t waitMs) {
+    Block block;
+    if (xQueueReceive(empty_, &block, pdMS_TO_TICKS(waitMs)) != pdTRUE) {
+      return nullptr;
+    }
+    current_ = block.index;
+    return memory_ + static_cast<size_t>(block.index) * kBufferBytes;
+  }
+
+  void submit(size_t length) {
+    Block block;
+    block.index = current_;
+    block.length = static_cast<uint16_t>(length);
+    xQueueSend(full_, &block, portMAX_DELAY);
+  }
+
+  // Waits for the writes still queued and stops the task.
+  void finish() {
+    if (!task_) {
+      return;
+    }
+    Block stop;
+    stop.index = kStopIndex;
+    xQueueSend(full_, &stop, portMAX_DELAY);
+    Block block;
+    while (xQueueReceive(empty_, &block, portMAX_DELAY) == pdTRUE && block.index != kStopIndex) {
+    }
+    task_ = nullptr;
+  }
+
+  bool failed() const {
+    return failed_;
+  }
+
+ private:
+  static void taskEntry(void *arg) {
+    static_cast<FlashWriter *>(arg)->run();
+    vTaskDelete(nullptr);
+  }
+
+  void run() {
+    Block block;
+    while (xQueueReceive(full_, &block, portMAX_DELAY) == pdTRUE) {
+      if (block.index == kStopIndex) {
+        break;
+      }
+      // After a failed write the rest is only handed back.
+      if (!failed_) {
+        uint8_t *data = memory_ + static_cast<size_t>(block.index) * kBufferBytes;
+        if (Update.write(data, block.length) != block.length) {
+          failed_ = true;
+        }
+      }
+      xQueueSend(empty_, &block, portMAX_DELAY);
+    }
+    Block stopped;
+    stopped.index = kStopIndex;
+    xQueueSend(empty_, &stopped, portMAX_DELAY);
+  }
+
+  uint8_t *memory_ = nullptr;
+  QueueHandle_t full_ = nullptr;
+  QueueHandle_t empty_ = nullptr;
+  TaskHandle_t task_ = nullptr;
+  uint8_t current_ = 0;
+  volatile bool failed_ = false;
+};
+
+bool openRequest(HTTPClient &http,
+                 WiFiClientSecure &client,
+                 const String &url,
+                 const char *userAgent,
+                 String *error) {
+  if (WiFi.status() != WL_CONNECTED) {
+    if (error) {
+      *error = "Wi-Fi is not connected";
+    }
+    return false;
+  }
+  client.setInsecure();
+  if (!http.begin(client, url)) {
+    if (error) {
+      *error = "HTTP begin failed";
+    }
+    return false;
+  }
+  http.setTimeout(kHttpTimeoutMs);
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  http.addHeader("User-Agent", userAgent ? userAgent : "AI-cc1101");
+  return true;
+}
+
+bool beginGet(HTTPClient &http,
+              WiFiClientSecure &client,
+              const String &url,
+              const char *userAgent,
+              int &codeOut,
+              String *error) {
+  codeOut = -1;
+  if (!openRequest(http, client, url, userAgent, error)) {
+    return false;
+  }
+  codeOut = http.GET();
+  if (codeOut <= 0) {
+    http.end();
+    if (error) {
+      *error = "Download HTTP failed";
+    }
+    return false;
+  }
+  return true;
+}
+
+bool isHexDigest(const String &value) {
+  if (value.length() != Sha256Stream::kDigestBytes * 2U) {
+    return false;
+  }
+  for (size_t i = 0; i < value.length(); ++i) {
+    if (!isxdigit(static_cast<unsigned char>(value[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t kilobytesPerSecond(uint32_t bytes, uint32_t elapsedMs) {
+  return elapsedMs > 0 ? static_cast<uint32_t>((static_cast<uint64_t>(bytes) * 1000ULL) /
+                                               (static_cast<uint64_t>(elapsedMs) * 1024ULL))
+                       : 0U;
+}
+
+// Download state kept next to the .tmp file, one "key value" per line.
+struct Partial {
+  String url;
+  String etag;
+  uint32_t total = 0;
+  uint32_t offset = 0;
+};
+
+bool loadPartial(const String &path, Partial &out) {
+  out = Partial();
+  File file = SD.open(path.c_str(), FILE_READ);
+  if (!file || file.isDirectory()) {
+    if (file) {
+      file.close();
+    }
+    return false;
+  }
+  while (file.available() > 0) {
+    String line = file.readStringUntil('\n');
+    line.trim();
+    const int space = line.indexOf(' ');
+    if (space <= 0) {
+      continue;
+    }
+    const String key = line.substring(0, static_cast<unsigned int>(space));
+    const String value = line.substring(static_cast<unsigned int>(space + 1));
+    if (key == "url") {
+      out.url = value;
+    } else if (key == "etag") {
+      out.etag = value;
+    } else if (key == "total") {
+      out.total = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+    } else if (key == "offset") {
+      out.offset = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+    }
+  }
+  file.close();
+  return !out.url.isEmpty();
+}
+
+void savePartial(const String &path, const Partial &partial) {
+  File file = SD.open(path.c_str(), FILE_WRITE);
+  if (!file) {
+    return;
+  }
+  const String text = "url " + partial.url + "\netag " + partial.etag + "\ntotal " +
+                      String(partial.total) + "\noffset " + String(partial.offset) + "\n";
+  file.write(reinterpret_cast<const uint8_t *>(text.c_str()), text.length());
+  file.close();
+}
+
+void removeIfExists(const String &path) {
+  if (SD.exists(path.c_str())) {
+    SD.remove(path.c_str());
+    dirlisting::noteChanged(path);
+  }
+}
+
+uint32_t sdFileSize(const String &path) {
+  File file = SD.open(path.c_str(), FILE_READ);
+  if (!file || file.isDirectory()) {
+    if (file) {
+      file.close();
+    }
+    return 0;
+  }
+  const uint32_t size = static_cast<uint32_t>(file.size());
+  file.close();
+  return size;
+}
+
+// Hashes the part that is already on SD so the final check covers it too.
+bool hashFilePrefix(const String &path,
+                    uint32_t length,
+                    Sha256Stream &sha,
+                    const std::function<void()> &backgroundTick) {
+  File file = SD.open(path.c_str(), FILE_READ);
+  if (!file || file.isDirectory()) {
+    if (file) {
+      file.close();
+    }
+    return false;
+  }
+  uint8_t buffer[kSdChunkBytes];
+  uint32_t left = length;
+  while (left > 0) {
+    const size_t want = std::min(static_cast<size_t>(left), sizeof(buffer));
+    const int readLen = file.read(buffer, want);
+    if (readLen <= 0) {
+      file.close();
+      return false;
+    }
+    sha.update(buffer, static_cast<size_t>(readLen));
+    left -= static_cast<uint32_t>(readLen);
+    if (backgroundTick) {
+      backgroundTick();
+    }
+  }
+  file.close();
+  return true;
+}
+
+// "bytes <first>-<last>/<total>"; total is 0 when given as "*".
+bool parseContentRange(const String &value, uint32_t &firstOut, uint32_t &totalOut) {
+  if (!value.startsWith("bytes ")) {
+    return false;
+  }
+  const char *text = value.c_str() + 6;
+  char *end = nullptr;
+  firstOut = static_cast<uint32_t>(strtoul(text, &end, 10));
+  if (end == text || *end != '-') {
+    return false;
+  }
+  const char *slash = strchr(end, '/');
+  totalOut = slash ? static_cast<uint32_t>(strtoul(slash + 1, nullptr, 10)) : 0U;
+  return true;
+}
+
+enum class Attempt {
+  kComplete,
+  kInterrupted,  // worth another Range request
+  kFailed,
+};
+
+// One GET from offset onwards, appended to tempPath. offset and sha always
+// describe exactly what is in the file, so any outcome can be resumed.
+Attempt fetchRemainder(const String &url,
+                       const char *userAgent,
+                       const String &tempPath,
+                       const String &metaPath,
+                       Partial &partial,
+                       uint32_t &offset,
+                       Sha256Stream &sha,
+                       uint32_t &fetched,
+                       const std::function<void()> &backgroundTick,
+                       const ProgressFn &progress,
+                       String &failure) {
+  WiFiClientSecure client;
+  HTTPClient http;
+  if (!openRequest(http, client, url, userAgent, &failure)) {
+    return Attempt::kInterrupted;
+  }
+  const char *collected[] = {"ETag", "Content-Range"};
+  http.collectHeaders(collected, 2);
+  if (offset > 0) {
+    http.addHeader("Range", "bytes=" + String(offset) + "-");
+    if (!partial.etag.isEmpty()) {
+      http.addHeader("If-Range", partial.etag);
+    }
+  }
+
+  const int code = http.GET();
+  if (code <= 0) {
+    http.end();
+    failure = "Download HTTP failed";
+    return Attempt::kInterrupted;
+  }
+
+  // The partial file cannot be continued: start over on the next attempt.
+  const auto dropPartial = [&](const char *reason) {
+    http.end();
+    failure = reason;
+    offset = 0;
+    sha.reset();
+    partial.etag = "";
+    partial.total = 0;
+    removeIfExists(tempPath);
+    return Attempt::kInterrupted;
+  };
+
+  bool restart = false;
+  if (code == 206 && offset > 0) {
+    uint32_t first = 0;
+    uint32_t total = 0;
+    if (!parseContentRange(http.header("Content-Range"), first, total) || first != offset) {
+      return dropPartial("Bad Content-Range");
+    }
+    if (total > 0) {
+      partial.total = total;
+    }
+  } else if (code == 200) {
+    // Range ignored, or the file changed since the partial download (If-Range
+    // did not match): the body is the whole file.
+    restart = offset > 0;
+    const int size = http.getSize();
+    partial.total = size > 0 ? static_cast<uint32_t>(size) : 0U;
+  } else if (code == 416 && offset > 0) {
+    return dropPartial("Resume rejected");
+  } else {
+    http.end();
+    failure = "HTTP " + String(code);
+    return code >= 500 ? Attempt::kInterrupted : Attempt::kFailed;
+  }
+
+  const String etag = http.header("ETag");
+  if (!etag.isEmpty()) {
+    partial.etag = etag;
+  }
+  if (restart) {
+    offset = 0;
+    sha.reset();
+  }
+
+  dirlisting::noteChanged(tempPath);
+  File file = SD.open(tempPath.c_str(), offset > 0 ? FILE_APPEND : FILE_WRITE);
+  if (!file || file.isDirectory()) {
+    if (file) {
+      file.close();
+    }
+    http.end();
+    failure = "SD file open failed";
+    return Attempt::kFailed;
+  }
+  partial.offset = offset;
+  savePartial(metaPath, partial);
+
+  WiFiClient *stream = http.getStreamPtr();
+  int remain = http.getSize();
+  uint8_t buffer[kSdChunkBytes];
+  unsigned long lastDataMs = millis();
+  unsigned long lastProgressMs = 0;
+  uint32_t unsaved = 0;
+  Attempt outcome = Attempt::kComplete;
+  if (progress) {
+    progress(offset, partial.total);
+  }
+
+  while (remain != 0) {
+    const size_t available = stream->available();
+    if (available == 0) {
+      if (!http.connected()) {
+        if (remain > 0) {
+          failure = "Connection lost";
+          outcome = Attempt::kInterrupted;
+        }
+        break;
+      }
+      if (millis() - lastDataMs > kIdleTimeoutMs) {
+        failure = "Download timeout";
+        outcome = Attempt::kInterrupted;
+        break;
+      }
+      delay(5);
+      if (backgroundTick) {
+        backgroundTick();
+      }
+      continue;
+    }
+
+    size_t toRead = std::min(available, sizeof(buffer));
+    if (remain > 0) {
+      toRead = std::min(toRead, static_cast<size_t>(remain));
+    }
+    const int readLen = stream->readBytes(buffer, toRead);
+    if (readLen <= 0) {
+      continue;
+    }
+    if (file.write(buffer, static_cast<size_t>(readLen)) != static_cast<size_t>(readLen)) {
+      failure = "SD write failed";
+      outcome = Attempt::kFailed;
+      break;
+    }
+
+    sha.update(buffer, static_cast<size_t>(readLen));
+    offset += static_cast<uint32_t>(readLen);
+    fetched += static_cast<uint32_t>(readLen);
+    unsaved += static_cast<uint32_t>(readLen);
+    if (remain > 0) {
+      remain -= readLen;
+    }
+    lastDataMs = millis();
+
+    if (unsaved >= kPartialSaveBytes) {
+      file.flush();
+      partial.offset = offset;
+      savePartial(metaPath, partial);
+      unsaved = 0;
+    }
+    if (progress && lastDataMs - lastProgressMs >= kProgressIntervalMs) {
+      lastProgressMs = lastDataMs;
+      progress(offset, partial.total);
+    }
+    if (backgroundTick) {
+      backgroundTick();
+    }
+  }
+
+  file.close();
+  http.end();
+  partial.offset = offset;
+  savePartial(metaPath, partial);
+  return outcome;
+}
+
+}  // namespace
+
+bool fetchSha256(const String &assetUrl,
+                 const char *userAgent,
+                 String &hexOut,
+                 bool *found,
+                 String *error) {
+  hexOut = "";
+  if (found) {
+    *found = false;
+  }
+  WiFiClientSecure client;
+  HTTPClient http;
+  int code = -1;
+  if (!beginGet(http, client, assetUrl + ".sha256", userAgent, code, error)) {
+    return false;
+  }
+  if (code == 404) {
+    http.end();
+    return true;
+  }
+  if (code < 200 || code >= 300) {
+    http.end();
+    if (error) {
+      *error = "SHA-256 asset HTTP " + String(code);
+    }
+    return false;
+  }
+  String body = http.getString();
+  http.end();
+
+  // "<hex>  <file name>"
+  body.trim();
+  const int space = body.indexOf(' ');
+  String digest = space > 0 ? body.substring(0, static_cast<unsigned int>(space)) : body;
+  digest.toLowerCase();
+  if (!isHexDigest(digest)) {
+    if (error) {
+      *error = "SHA-256 asset malformed";
+    }
+    return false;
+  }
+  hexOut = digest;
+  if (found) {
+    *found = true;
+  }
+  return true;
+}
+
+bool installFromUrl(const String &url,
+                    const char *userAgent,
+                    const String &expectedSha256,
+                    const std::function<void()> &backgroundTick,
+                    const ProgressFn &progress,
+                    Result *result,
+                    String *error) {
+  if (result) {
+    *result = Result();
+  }
+  const unsigned long startMs = millis();
+  WiFiClientSecure client;
+  HTTPClient http;
+  int code = -1;
+  if (!beginGet(http, client, url, userAgent, code, error)) {
+    return false;
+  }
+  if (code < 200 || code >= 300) {
+    http.end();
+    if (error) {
+      *error = "HTTP " + String(code);
+    }
+    return false;
+  }
+
+  const int contentLength = http.getSize();
+  const uint32_t total = contentLength > 0 ? static_cast<uint32_t>(contentLength) : 0U;
+  if (!Update.begin(total > 0 ? total : UPDATE_SIZE_UNKNOWN, U_FLASH)) {
+    http.end();
+    if (error) {
+      *error = String("Update begin failed: ") + Update.errorString();
+    }
+    return false;
+  }
+
+  String failure;
+  Sha256Stream sha;
+  uint32_t received = 0;
+  {
+    FlashWriter writer;
+    if (writer.begin(&failure)) {
+      WiFiClient *stream = http.getStreamPtr();
+      int remain = contentLength;
+      unsigned long lastDataMs = millis();
+      unsigned long lastProgressMs = 0;
+      bool ended = false;
+      if (progress) {
+        progress(0, total);
+      }
+
+      while (!ended && failure.isEmpty() && !writer.failed()) {
+        uint8_t *buffer = writer.acquire(kBufferWaitMs);
+        if (!buffer) {
+          if (backgroundTick) {
+            backgroundTick();
+          }
+          continue;
+        }
+
+        size_t fill = 0;
+        while (fill < kBufferBytes) {
+          if (remain == 0) {
+            ended = true;
+            break;
+          }
+          const size_t available = stream->available();
+          if (available == 0) {
+            if (!http.connected()) {
+              ended = true;
+              break;
+            }
+            if (millis() - lastDataMs > kIdleTimeoutMs) {
+              failure = "Download timeout";
+              break;
+            }
+            delay(2);
+            if (backgroundTick) {
+              backgroundTick();
+            }
+            continue;
+          }
+          size_t toRead = std::min(available, kBufferBytes - fill);
+          if (remain > 0) {
+            toRead = std::min(toRead, static_cast<size_t>(remain));
+          }
+          const int readLen = stream->readBytes(buffer + fill, toRead);
+          if (readLen <= 0) {
+            continue;
+          }
+          fill += static_cast<size_t>(readLen);
+          if (remain > 0) {
+            remain -= readLen;
+          }
+          lastDataMs = millis();
+        }
+
+        // Hashed here, while the writer task flashes the other buffer.
+        sha.update(buffer, fill);
+        received += static_cast<uint32_t>(fill);
+        writer.submit(fill);
+
+        const unsigned long now = millis();
+        if (progress && now - lastProgressMs >= kProgressIntervalMs) {
+          lastProgressMs = now;
+          progress(received, total);
+        }
+        if (backgroundTick) {
+          backgroundTick();
+        }
+      }
+      writer.finish();
+      if (failure.isEmpty() && writer.failed()) {
+        failure = String("Update write failed: ") + Update.errorString();
+      }
+    }
+  }
+  http.end();
+
+  if (failure.isEmpty() && received == 0) {
+    failure = "Downloaded file is empty";
+  }
+  if (failure.isEmpty() && total > 0 && received != total) {
+    failure = "Download incomplete";
+  }
+  const String digest = sha.finishHex();
+  String expected = expectedSha256;
+  expected.trim();
+  expected.toLowerCase();
+  if (failure.isEmpty() && !expected.isEmpty() && digest != expected) {
+    failure = "SHA-256 mismatch";
+  }
+  if (!failure.isEmpty()) {
+    Update.abort();
+    if (error) {
+      *error = failure;
+    }
+    return false;
+  }
+
+  if (!Update.end(true)) {
+    if (error) {
+      *error = String("Update end failed: ") + Update.errorString();
+    }
+    return false;
+  }
+  if (!Update.isFinished()) {
+    if (error) {
+      *error = "Update not finished";
+    }
+    return false;
+  }
+
+  const uint32_t elapsedMs = static_cast<uint32_t>(millis() - startMs);
+  const uint32_t kbps = kilobytesPerSecond(received, elapsedMs);
+  if (progress) {
+    progress(received, total);
+  }
+  if (result) {
+    result->bytes = received;
+    result->sha256 = digest;
+    result->verified = !expected.isEmpty();
+    result->elapsedMs = elapsedMs;
+    result->kilobytesPerSecond = kbps;
+  }
+  return true;
+}
+
+bool downloadToSd(const String &url,
+                  const char *userAgent,
+                  const char *destPath,
+                  const String &expectedSha256,
+                  const std::function<void()> &backgroundTick,
+                  const ProgressFn &progress,
+                  Result *result,
+                  String *error) {
+  if (result) {
+    *result = Result();
+  }
+  const unsigned long startMs = millis();
+  const String tempPath = String(destPath) + ".tmp";
+  const String metaPath = String(destPath) + ".part";
+
+  // Resume only what the sidecar vouches for: same URL, a validator for
+  // If-Range, and a .tmp file of exactly the recorded length.
+  Partial partial;
+  Sha256Stream sha;
+  uint32_t offset = 0;
+  if (loadPartial(metaPath, partial) && partial.url == url && !partial.etag.isEmpty() &&
+      partial.offset > 0 && sdFileSize(tempPath) == partial.offset &&
+      hashFilePrefix(tempPath, partial.offset, sha, backgroundTick)) {
+    offset = partial.offset;
+  } else {
+    sha.reset();
+    removeIfExists(tempPath);
+    removeIfExists(metaPath);
+    partial = Partial();
+    partial.url = url;
+  }
+
+  uint32_t fetched = 0;
+  String failure;
+  bool complete = partial.total > 0 && offset == partial.total;
+  for (uint8_t attempt = 0; !complete && attempt < kDownloadAttempts; ++attempt) {
+    if (attempt > 0) {
+      const unsigned long waitStartMs = millis();
+      while (millis() - waitStartMs < kRetryDelayMs) {
+        if (backgroundTick) {
+          backgroundTick();
+        }
+        delay(20);
+      }
+    }
+    failure = "";
+    const Attempt outcome = fetchRemainder(url,
+                                           userAgent,
+                                           tempPath,
+                                           metaPath,
+                                           partial,
+                                           offset,
+                                           sha,
+                                           fetched,
+                                           backgroundTick,
+                                           progress,
+                                           failure);
+    if (outcome == Attempt::kComplete) {
+      complete = true;
+    } else if (outcome == Attempt::kFailed) {
+      break;
+    }
+  }
+
+  // The partial file stays for the next call unless it is known to be bad.
+  bool discard = offset == 0;
+  if (complete && offset == 0) {
+    failure = "Downloaded file is empty";
+    complete = false;
+  }
+  if (complete && partial.total > 0 && offset != partial.total) {
+    failure = "Download size mismatch";
+    complete = false;
+    discard = true;
+  }
+  if (!complete) {
+    if (discard) {
+      removeIfExists(tempPath);
+      removeIfExists(metaPath);
+    }
+    if (error) {
+      *error = failure;
+    }
+    return false;
+  }
+
+  const String digest = sha.finishHex();
+  String expected = expectedSha256;
+  expected.trim();
+  expected.toLowerCase();
+  if (!expected.isEmpty() && digest != expected) {
+    removeIfExists(tempPath);
+    removeIfExists(metaPath);
+    if (error) {
+      *error = "SHA-256 mismatch";
+    }
+    return false;
+  }
+
+  if (SD.exists(destPath)) {
+    SD.remove(destPath);
+  }
+  if (!SD.rename(tempPath.c_str(), destPath)) {
+    removeIfExists(tempPath);
+    removeIfExists(metaPath);
+    if (error) {
+      *error = "SD rename failed";
+    }
+    return false;
+  }
+  removeIfExists(metaPath);
+  dirlisting::noteChanged(String(destPath));
+
+  // Less than the starting offset when the server made us start over.
+  const uint32_t resumedFrom = offset > fetched ? offset - fetched : 0U;
+  const uint32_t elapsedMs = static_cast<uint32_t>(millis() - startMs);
+  const uint32_t kbps = kilobytesPerSecond(fetched, elapsedMs);
+  if (progress) {
+    progress(offset, partial.total > 0 ? partial.total : offset);
+  }
+  if (result) {
+    result->bytes = offset;
+    result->resumedFrom = resumedFrom;
+    result->sha256 = digest;
+    result->verified = !expected.isEmpty();
+    result->elapsedMs = elapsedMs;
+    result->kilobytesPerSecond = kbps;
+  }
+  return true;
+}
+
+}  // namespace fwfetch
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+
+// Firmware downloads shared by the firmware-update and APPMarket apps.
+//
+// installFromUrl() streams an HTTPS firmware image straight into the inactive
+// OTA partition, without staging it on SD. The caller's loop fills one buffer
+// from the socket while a writer task flashes the other, and SHA-256 is
+// computed over each buffer as it is handed over. The new image is only made
+// bootable when that hash matches the release's .sha256 asset.
+//
+// downloadToSd() saves a file to SD for later installs. It keeps the partial
+// "<dest>.tmp" plus a "<dest>.part" sidecar (URL, ETag, bytes written) when a
+// transfer stops, and continues from there with an If-Range request, both on
+// its own retries and on the next call for the same URL.
+namespace fwfetch {
+
+// Called with bytes done so far and the total (0 when the server sent no
+// Content-Length).
+using ProgressFn = std::function<void(uint32_t done, uint32_t total)>;
+
+struct Result {
+  uint32_t bytes = 0;
+  // Bytes already on SD from an earlier, interrupted download.
+  uint32_t resumedFrom = 0;
+  String sha256;
+  // False when there was no expected hash to compare with.
+  bool verified = false;
+  uint32_t elapsedMs = 0;
+  // Over the bytes actually transferred by this call.
+  uint32_t kilobytesPerSecond = 0;
+};
+
+// Reads "<assetUrl>.sha256" (sha256sum output, as published by
+// scripts/package_release_assets.sh) into lowercase hex. *found is false, and
+// the call succeeds, when the release has no such asset.
+bool fetchSha256(const String &assetUrl,
+                 const char *userAgent,
+                 String &hexOut,
+                 bool *found,
+                 String *error);
+
+// Flashes the image at url into the next OTA partition and marks it for the
+// next boot. expectedSha256 may be empty (no check). Nothing becomes bootable
+// on failure.
+bool installFromUrl(const String &url,
+                    const char *userAgent,
+                    const String &expectedSha256,
+                    const std::function<void()> &backgroundTick,
+                    const ProgressFn &progress,
+                    Result *result,
+                    String *error);
+
+// Downloads url to destPath on SD; the card must be mounted and the directory
+// present. destPath is only replaced once the whole file is there and matches
+// expectedSha256 (when not empty). Progress counts resumed bytes as done.
+bool downloadToSd(const String &url,
+                  const char *userAgent,
+                  const char *destPath,
+                  const String &expectedSha256,
+                  const std::function<void()> &backgroundTick,
+                  const ProgressFn &progress,
+                  Result *result,
+                  String *error);
+
+}  // namespace fwfetch
@@ -1,7 +1,6 @@
 #include "gateway_client.h"
 
 #include <Ed25519.h>
-#include <SHA256.h>
 #include <WiFi.h>
 #include <esp_heap_caps.h>
 #include <esp_system.h>
@@ -9,6 +8,7 @@
 #include <ctype.h>
 #include <time.h>
 
+#include "sha256_stream.h"
 #include "user_config.h"
 
 namespace {
@@ -196,6 +196,23 @@ void GatewayClient::setTelemetryBuilder(TelemetryBuilder builder) {
   telemetryBuilder_ = builder;
 }
 
+uint32_t GatewayClient::addResponseHandler(ResponseHandler handler) {
+  if (++nextResponseToken_ == 0) {
+    ++nextResponseToken_;
+  }
+  responseHandlers_.emplace_back(nextResponseToken_, handler);
+  return nextResponseToken_;
+}
+
+void GatewayClient::removeResponseHandler(uint32_t token) {
+  for (auto it = responseHandlers_.begin(); it != responseHandlers_.end(); ++it) {
+    if (it->first == token) {
+      responseHandlers_.erase(it);
+      return;
+    }
+  }
+}
+
 void GatewayClient::configure(const RuntimeConfig &config) {
   config_ = config;
 }
@@ -319,7 +336,9 @@ GatewayStatus GatewayClient::status() const {
   return s;
 }
 
-bool GatewayClient::sendNodeEvent(const char *eventName, JsonDocument &payloadDoc) {
+bool GatewayClient::sendNodeEvent(const char *eventName,
+                                  JsonDocument &payloadDoc,
+                                  String *requestIdOut) {
   if (!gatewayReady_) {
     return false;
   }
@@ -343,7 +362,14 @@ bool GatewayClient::sendNodeEvent(const char *eventName, JsonDocument &payloadDo
     lastError_ = "Gateway event payload too large";
     return false;
   }
-  return sendRequest("node.event", params, nullptr);
+  String requestId;
+  if (!sendRequest("node.event", params, &requestId)) {
+    return false;
+  }
+  if (requestIdOut) {
+    *requestIdOut = requestId;
+  }
+  return true;
 }
 
 bool GatewayClient::sendInvokeOk(const String &invokeId,
@@ -388,6 +414,11 @@ bool GatewayClient::inboxMessage(size_t index, GatewayInboxMessage &out) const {
 void GatewayClient::clearInbox() {
   inboxStart_ = 0;
   inboxCount_ = 0;
+  ++inboxRevision_;
+}
+
+uint32_t GatewayClient::inboxRevision() const {
+  return inboxRevision_;
 }
 
 void GatewayClient::onWsEvent(WStype_t type, uint8_t *payload, size_t length) {
@@ -661,6 +692,7 @@ void GatewayClient::sendConnectRequest() {
   JsonArray commands = params.createNestedArray("commands");
   commands.add("system.which");
   commands.add("system.run");
+  commands.add("system.perf");
   commands.add("cc1101.info");
   commands.add("cc1101.set_freq");
   commands.add("cc1101.tx");
@@ -793,6 +825,15 @@ void GatewayClient::handleGatewayFrame(const char *text, size_t len) {
 void GatewayClient::handleGatewayResponse(JsonObjectConst frame) {
   const String id = frame["id"].as<String>();
   if (id != connectRequestId_) {
+    if (!responseHandlers_.empty()) {
+      const bool ok = frame["ok"] | false;
+      const String error = String(static_cast<const char *>(frame["error"]["message"] | ""));
+      // A copy, so a handler may remove itself while being called.
+      const auto handlers = responseHandlers_;
+      for (const auto &entry : handlers) {
+        entry.second(id, ok, error);
+      }
+    }
     return;
   }
 
@@ -1075,21 +1116,7 @@ String GatewayClient::sha256Hex(const uint8_t *data, size_t len) const {
   if (!data || len == 0) {
     return "";
   }
-
-  SHA256 hash;
-  uint8_t digest[SHA256::HASH_SIZE] = {0};
-  hash.reset();
-  hash.update(data, len);
-  hash.finalize(digest, sizeof(digest));
-
-  static const char kHex[] = "0123456789abcdef";
-  char out[(SHA256::HASH_SIZE * 2) + 1] = {0};
-  for (size_t i = 0; i < sizeof(digest); ++i) {
-    out[i * 2] = kHex[(digest[i] >> 4) & 0x0F];
-    out[(i * 2) + 1] = kHex[digest[i] & 0x0F];
-  }
-  out[sizeof(out) - 1] = '\0';
-  return String(out);
+  return Sha256Stream::hex(data, len);
 }
 
 String GatewayClient::buildDeviceAuthPayload(uint64_t signedAtMs,
@@ -1291,6 +1318,7 @@ void GatewayClient::pushInboxMessage(const GatewayInboxMessage &message) {
           merged.text = inbox_[existingPos].text;
         }
         inbox_[existingPos] = merged;
+        ++inboxRevision_;
         return;
       }
     }
@@ -1306,6 +1334,7 @@ void GatewayClient::pushInboxMessage(const GatewayInboxMessage &message) {
   }
 
   inbox_[pos] = message;
+  ++inboxRevision_;
 }
 
 String GatewayClient::readMessageString(JsonObjectConst payload,
@@ -5,6 +5,8 @@
 #include <WebSocketsClient.h>
 
 #include <functional>
+#include <utility>
+#include <vector>
 
 #include "runtime_config.h"
 
@@ -39,9 +41,18 @@ class GatewayClient {
 
   using TelemetryBuilder = std::function<void(JsonObject payload)>;
 
+  // Gateway response to a request sent by this client (node.event etc.).
+  using ResponseHandler = std::function<void(const String &requestId,
+                                             bool ok,
+                                             const String &error)>;
+
   void begin();
   void setInvokeRequestHandler(InvokeRequestHandler handler);
   void setTelemetryBuilder(TelemetryBuilder builder);
+  // Every registered handler sees every response and ignores ids it did not
+  // send. Returns a token for removeResponseHandler().
+  uint32_t addResponseHandler(ResponseHandler handler);
+  void removeResponseHandler(uint32_t token);
 
   void configure(const RuntimeConfig &config);
 
@@ -54,7 +65,9 @@ class GatewayClient {
   String lastError() const;
   GatewayStatus status() const;
 
-  bool sendNodeEvent(const char *eventName, JsonDocument &payloadDoc);
+  bool sendNodeEvent(const char *eventName,
+                     JsonDocument &payloadDoc,
+                     String *requestIdOut = nullptr);
   bool sendInvokeOk(const String &invokeId,
                     const String &nodeId,
                     JsonDocument &payloadDoc);
@@ -66,6 +79,8 @@ class GatewayClient {
   size_t inboxCount() const;
   bool inboxMessage(size_t index, GatewayInboxMessage &out) const;
   void clearInbox();
+  // Bumped whenever a message is added, updated in place or cleared.
+  uint32_t inboxRevision() const;
 
  private:
   struct GatewayEndpoint {
@@ -96,6 +111,8 @@ class GatewayClient {
 
   InvokeRequestHandler invokeHandler_;
   TelemetryBuilder telemetryBuilder_;
+  std::vector<std::pair<uint32_t, ResponseHandler>> responseHandlers_;
+  uint32_t nextResponseToken_ = 0;
 
   void onWsEvent(WStype_t type, uint8_t *payload, size_t length);
   void startWebSocket();
@@ -131,6 +148,7 @@ class GatewayClient {
   GatewayInboxMessage inbox_[kInboxCapacity];
   size_t inboxStart_ = 0;
   size_t inboxCount_ = 0;
+  uint32_t inboxRevision_ = 0;
 
   String connectNonce_;
   uint64_t connectChallengeTsMs_ = 0;
@@ -0,0 +1,255 @@
+#include "github_release.h"
+
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+
+namespace ghrelease {
+namespace {
+
+constexpr uint32_t kHttpTimeoutMs = 12000;
+// Holds one filtered release (about 200 bytes per asset); reused for each
+// entry of a catalog.
+constexpr size_t kReleaseDocBytes = 12288;
+constexpr size_t kMaxAssetsPerRelease = 24;
+constexpr size_t kErrorDocBytes = 384;
+
+void buildReleaseFilter(JsonDocument &filter) {
+  filter["tag_name"] = true;
+  filter["name"] = true;
+  filter["draft"] = true;
+  filter["prerelease"] = true;
+  filter["assets"][0]["name"] = true;
+  filter["assets"][0]["size"] = true;
+  filter["assets"][0]["browser_download_url"] = true;
+}
+
+bool hasBinExtension(const String &nameRaw) {
+  String name = nameRaw;
+  name.toLowerCase();
+  return name.endsWith(".bin");
+}
+
+// Sends the GET and leaves the response body unread on success. HTTP/1.0
+// keeps GitHub from using chunked encoding, so the body can be handed to
+// ArduinoJson as a plain stream.
+bool beginApiGet(HTTPClient &http,
+                 WiFiClientSecure &client,
+                 const String &url,
+                 const char *userAgent,
+                 String *error) {
+  if (WiFi.status() != WL_CONNECTED) {
+    if (error) {
+      *error = "Wi-Fi is not connected";
+    }
+    return false;
+  }
+
+  client.setInsecure();
+  if (!http.begin(client, url)) {
+    if (error) {
+      *error = "HTTP begin failed";
+    }
+    return false;
+  }
+  http.useHTTP10(true);
+  http.setTimeout(kHttpTimeoutMs);
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  http.addHeader("User-Agent", userAgent ? userAgent : "AI-cc1101");
+  http.addHeader("Accept", "application/vnd.github+json");
+
+  const int code = http.GET();
+  if (code <= 0) {
+    http.end();
+    if (error) {
+      *error = "HTTP request failed";
+    }
+    return false;
+  }
+  if (code < 200 || code >= 300) {
+    String msg = "HTTP " + String(code);
+    StaticJsonDocument<32> filter;
+    filter["message"] = true;
+    DynamicJsonDocument doc(kErrorDocBytes);
+    const auto parseErr =
+        deserializeJson(doc, *http.getStreamPtr(), DeserializationOption::Filter(filter));
+    http.end();
+    if (!parseErr) {
+      const String detail = String(static_cast<const char *>(doc["message"] | ""));
+      if (!detail.isEmpty()) {
+        msg += ": " + detail;
+      }
+    }
+    if (error) {
+      *error = msg;
+    }
+    return false;
+  }
+  return true;
+}
+
+void readRelease(JsonObjectConst root, Release &out) {
+  out = Release();
+  out.tag = String(static_cast<const char *>(root["tag_name"] | ""));
+  if (out.tag.isEmpty()) {
+    out.tag = String(static_cast<const char *>(root["name"] | ""));
+  }
+  if (out.tag.isEmpty()) {
+    out.tag = "(unknown)";
+  }
+  out.prerelease = root["prerelease"] | false;
+
+  const JsonArrayConst assets = root["assets"].as<JsonArrayConst>();
+  for (JsonObjectConst assetRoot : assets) {
+    if (out.assets.size() >= kMaxAssetsPerRelease) {
+      break;
+    }
+    Asset asset;
+    asset.name = String(static_cast<const char *>(assetRoot["name"] | ""));
+    asset.downloadUrl = String(static_cast<const char *>(assetRoot["browser_download_url"] | ""));
+    asset.size = assetRoot["size"] | 0;
+    if (asset.name.isEmpty() || asset.downloadUrl.isEmpty()) {
+      continue;
+    }
+    out.assets.push_back(asset);
+  }
+}
+
+// The ',' or ']' that follows an array element; 0 when the stream ends (or
+// times out) first.
+char nextSeparator(WiFiClient &stream) {
+  char c = 0;
+  while (stream.readBytes(&c, 1) == 1) {
+    if (c == ',' || c == ']') {
+      return c;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+bool fetchLatest(const String &repo,
+                 const char *userAgent,
+                 Release &out,
+                 String *error) {
+  out = Release();
+  WiFiClientSecure client;
+  HTTPClient http;
+  if (!beginApiGet(http,
+                   client,
+                   "https://api.github.com/repos/" + repo + "/releases/latest",
+                   userAgent,
+                   error)) {
+    return false;
+  }
+
+  StaticJsonDocument<256> filter;
+  buildReleaseFilter(filter);
+  DynamicJsonDocument doc(kReleaseDocBytes);
+  const auto parseErr =
+      deserializeJson(doc, *http.getStreamPtr(), DeserializationOption::Filter(filter));
+  http.end();
+  if (parseErr || !doc.is<JsonObject>()) {
+    if (error) {
+      *error = parseErr == DeserializationError::NoMemory ? "Release JSON too large"
+                                                          : "Release JSON parse failed";
+    }
+    return false;
+  }
+
+  readRelease(doc.as<JsonObjectConst>(), out);
+  if (out.assets.empty()) {
+    if (error) {
+      *error = "Release has no assets";
+    }
+    return false;
+  }
+  return true;
+}
+
+bool fetchCatalog(const String &repo,
+                  const char *userAgent,
+                  size_t maxReleases,
+                  std::vector<Release> &out,
+                  String *error) {
+  out.clear();
+  WiFiClientSecure client;
+  HTTPClient http;
+  if (!beginApiGet(http,
+                   client,
+                   "https://api.github.com/repos/" + repo +
+                       "/releases?per_page=" + String(static_cast<unsigned int>(maxReleases)),
+                   userAgent,
+                   error)) {
+    return false;
+  }
+
+  StaticJsonDocument<256> filter;
+  buildReleaseFilter(filter);
+  DynamicJsonDocument doc(kReleaseDocBytes);
+  WiFiClient &stream = *http.getStreamPtr();
+
+  // Walk the top-level array one element at a time instead of loading it.
+  // A list cut short is an error rather than a shorter catalog.
+  const char *failure = stream.find("[") ? nullptr : "Release list parse failed";
+  size_t elements = 0;
+  while (!failure && out.size() < maxReleases) {
+    const auto parseErr = deserializeJson(doc, stream, DeserializationOption::Filter(filter));
+    if (parseErr) {
+      // "[]" ends up here too.
+      if (parseErr != DeserializationError::InvalidInput || elements > 0) {
+        failure = "Release list parse failed";
+      }
+      break;
+    }
+    ++elements;
+    const JsonObjectConst root = doc.as<JsonObjectConst>();
+    if (!root.isNull() && !(root["draft"] | false)) {
+      Release release;
+      readRelease(root, release);
+      if (!release.assets.empty()) {
+        out.push_back(release);
+      }
+    }
+    const char separator = nextSeparator(stream);
+    if (separator == ']') {
+      break;
+    }
+    if (separator != ',') {
+      failure = "Release list truncated";
+    }
+  }
+  http.end();
+
+  if (failure) {
+    out.clear();
+    if (error) {
+      *error = failure;
+    }
+    return false;
+  }
+  return true;
+}
+
+size_t preferredAssetIndex(const Release &release, const String &preferredNameRaw) {
+  String preferredName = preferredNameRaw;
+  preferredName.trim();
+  if (!preferredName.isEmpty()) {
+    for (size_t i = 0; i < release.assets.size(); ++i) {
+      if (release.assets[i].name == preferredName) {
+        return i;
+      }
+    }
+  }
+  for (size_t i = 0; i < release.assets.size(); ++i) {
+    if (hasBinExtension(release.assets[i].name)) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+}  // namespace ghrelease
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+// GitHub release metadata for the firmware-update and APPMarket apps.
+//
+// Responses are parsed straight off the HTTPS stream through an ArduinoJson
+// filter that keeps only the tag, draft/prerelease flags and each asset's
+// name, size and download URL; release notes, uploader objects and the rest
+// are skipped while reading. Catalogs are read one release at a time into a
+// single reused document, so memory stays bounded however long the list is.
+namespace ghrelease {
+
+struct Asset {
+  String name;
+  String downloadUrl;
+  uint32_t size = 0;
+};
+
+struct Release {
+  String tag;  // tag_name, else name, else "(unknown)"
+  bool prerelease = false;
+  std::vector<Asset> assets;
+};
+
+// GET /repos/<repo>/releases/latest.
+bool fetchLatest(const String &repo,
+                 const char *userAgent,
+                 Release &out,
+                 String *error);
+
+// GET /repos/<repo>/releases, newest first. Keeps up to maxReleases published
+// (non-draft) releases that have downloadable assets; succeeds with an empty
+// list when there are none. A list that is malformed or cut short part-way
+// fails (with *error set) rather than returning the releases read so far.
+bool fetchCatalog(const String &repo,
+                  const char *userAgent,
+                  size_t maxReleases,
+                  std::vector<Release> &out,
+                  String *error);
+
+// Index of the asset named preferredName, else of the first .bin, else 0.
+size_t preferredAssetIndex(const Release &release, const String &preferredName);
+
+}  // namespace ghrelease
@@ -0,0 +1,802 @@
+#include "message_outbox.h"
+
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <SD.h>
+
+#include <algorithm>
+
+#include "dir_listing.h"
+#include "gateway_client.h"
+#include "user_config.h"
+
+namespace outbox {
+namespace {
+
+constexpr const char *kLogDir = "/messenger";
+constexpr const char *kLogPath = "/messenger/outbox.jsonl";
+constexpr const char *kTmpPath = "/messenger/outbox.tmp";
+constexpr const char *kPrefsNamespace = "oc_outbox";
+constexpr const char *kPrefsLogKey = "log";
+// NVS strings top out just under 4000 bytes.
+constexpr size_t kNvsMaxBytes = 3800;
+// Past this size the SD log is rewritten with only the entries still shown.
+constexpr uint32_t kCompactBytes = 32768;
+// Sent and failed entries kept by a rewrite, so the messenger can still show
+// the state of recent messages.
+constexpr size_t kKeepHistory = 40;
+constexpr uint8_t kMaxAttempts = 5;
+constexpr uint32_t kAckTimeoutMs = 10000;
+constexpr uint32_t kRetryDelayMs = 3000;
+constexpr uint32_t kStorageCheckMs = 5000;
+
+enum class Storage : uint8_t {
+  None = 0,
+  Sd = 1,
+  Nvs = 2,
+};
+
+struct Slot {
+  String id;
+  uint32_t offset = 0;
+  Kind kind = Kind::Text;
+  State state = State::Queued;
+  uint8_t attempts = 0;
+  String error;
+};
+
+std::vector<Slot> gSlots;
+Storage gStorage = Storage::None;
+String gNvsLog;
+uint32_t gLogBytes = 0;
+bool gNeedsNewline = false;
+bool gBegun = false;
+uint32_t gLastStorageCheckMs = 0;
+uint32_t gRevision = 0;
+
+String gInflightId;
+String gInflightRequestId;
+uint32_t gInflightSentMs = 0;
+unsigned long gInflightConnectOkMs = 0;
+bool gInflightAnswered = false;
+bool gInflightOk = false;
+String gInflightError;
+uint32_t gResponseToken = 0;
+SettledFn gSettledListener = nullptr;
+// Set after a rejected or failed send; the drainer waits kRetryDelayMs.
+bool gBackingOff = false;
+uint32_t gBackoffStartMs = 0;
+
+Kind parseKind(const char *token) {
+  if (token && strcmp(token, "file") == 0) {
+    return Kind::File;
+  }
+  if (token && strcmp(token, "voice") == 0) {
+    return Kind::Voice;
+  }
+  return Kind::Text;
+}
+
+State parseState(const char *name) {
+  if (name && strcmp(name, "sent") == 0) {
+    return State::Sent;
+  }
+  if (name && strcmp(name, "failed") == 0) {
+    return State::Failed;
+  }
+  if (name && strcmp(name, "sending") == 0) {
+    return State::Sending;
+  }
+  return State::Queued;
+}
+
+bool isPending(State state) {
+  return state == State::Queued || state == State::Sending;
+}
+
+bool sdAvailable() {
+#if HAL_HAS_SD_CARD
+  return SD.cardType() != CARD_NONE;
+#else
+  return false;
+#endif
+}
+
+int findSlot(const std::vector<Slot> &slots, const String &id) {
+  for (size_t i = slots.size(); i-- > 0;) {
+    if (slots[i].id == id) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+String entryLine(const Entry &entry) {
+  DynamicJsonDocument doc(entry.text.length() + entry.path.length() + entry.error.length() + 768U);
+  doc["op"] = "add";
+  doc["id"] = entry.id;
+  doc["kind"] = kindToken(entry.kind);
+  doc["state"] = stateName(entry.state);
+  if (entry.attempts > 0) {
+    doc["attempts"] = entry.attempts;
+  }
+  doc["session"] = entry.sessionKey;
+  doc["to"] = entry.to;
+  doc["text"] = entry.text;
+  if (entry.kind != Kind::Text) {
+    doc["path"] = entry.path;
+    doc["name"] = entry.fileName;
+    doc["mime"] = entry.mimeType;
+    doc["bytes"] = entry.bytes;
+  }
+  doc["ts"] = entry.tsMs;
+  if (!entry.error.isEmpty()) {
+    doc["error"] = entry.error;
+  }
+  String line;
+  serializeJson(doc, line);
+  line += '\n';
+  return line;
+}
+
+String stateLine(const Slot &slot) {
+  DynamicJsonDocument doc(slot.error.length() + 384U);
+  doc["op"] = "state";
+  doc["id"] = slot.id;
+  doc["state"] = stateName(slot.state);
+  doc["attempts"] = slot.attempts;
+  if (!slot.error.isEmpty()) {
+    doc["error"] = slot.error;
+  }
+  String line;
+  serializeJson(doc, line);
+  line += '\n';
+  return line;
+}
+
+bool parseEntry(const String &line, Entry &out) {
+  DynamicJsonDocument doc(line.length() + 512U);
+  if (deserializeJson(doc, line) || strcmp(doc["op"] | "", "add") != 0) {
+    return false;
+  }
+  out.id = String(static_cast<const char *>(doc["id"] | ""));
+  out.kind = parseKind(doc["kind"] | "text");
+  out.state = parseState(doc["state"] | "queued");
+  out.attempts = doc["attempts"] | 0;
+  out.sessionKey = String(static_cast<const char *>(doc["session"] | ""));
+  out.to = String(static_cast<const char *>(doc["to"] | ""));
+  out.text = String(static_cast<const char *>(doc["text"] | ""));
+  out.path = String(static_cast<const char *>(doc["path"] | ""));
+  out.fileName = String(static_cast<const char *>(doc["name"] | ""));
+  out.mimeType = String(static_cast<const char *>(doc["mime"] | ""));
+  out.bytes = doc["bytes"] | 0U;
+  out.tsMs = doc["ts"] | 0ULL;
+  out.error = String(static_cast<const char *>(doc["error"] | ""));
+  return !out.id.isEmpty();
+}
+
+// Folds one log line into slots: "add" creates an entry, "state" updates it.
+void applyLine(std::vector<Slot> &slots, const String &line, uint32_t offset) {
+  DynamicJsonDocument doc(line.length() + 512U);
+  if (deserializeJson(doc, line)) {
+    return;
+  }
+  const String id = String(static_cast<const char *>(doc["id"] | ""));
+  if (id.isEmpty()) {
+    return;
+  }
+  const char *op = doc["op"] | "";
+  const int index = findSlot(slots, id);
+  if (strcmp(op, "add") == 0) {
+    if (index >= 0) {
+      return;
+    }
+    Slot slot;
+    slot.id = id;
+    slot.offset = offset;
+    slot.kind = parseKind(doc["kind"] | "text");
+    slot.state = parseState(doc["state"] | "queued");
+    slot.attempts = doc["attempts"] | 0;
+    slot.error = String(static_cast<const char *>(doc["error"] | ""));
+    slots.push_back(slot);
+    return;
+  }
+  if (strcmp(op, "state") == 0 && index >= 0) {
+    Slot &slot = slots[static_cast<size_t>(index)];
+    slot.state = parseState(doc["state"] | "queued");
+    slot.attempts = doc["attempts"] | slot.attempts;
+    slot.error = String(static_cast<const char *>(doc["error"] | ""));
+  }
+}
+
+void replayNvs(const String &log, std::vector<Slot> &slots) {
+  uint32_t offset = 0;
+  while (offset < log.length()) {
+    int end = log.indexOf('\n', offset);
+    if (end < 0) {
+      end = static_cast<int>(log.length());
+    }
+    applyLine(slots, log.substring(offset, static_cast<unsigned int>(end)), offset);
+    offset = static_cast<uint32_t>(end) + 1U;
+  }
+}
+
+void replaySd(std::vector<Slot> &slots) {
+  gLogBytes = 0;
+  gNeedsNewline = false;
+  File file = SD.open(kLogPath, FILE_READ);
+  if (!file || file.isDirectory()) {
+    if (file) {
+      file.close();
+    }
+    return;
+  }
+  uint32_t offset = 0;
+  const uint32_t size = static_cast<uint32_t>(file.size());
+  while (offset < size) {
+    const String line = file.readStringUntil('\n');
+    applyLine(slots, line, offset);
+    offset += static_cast<uint32_t>(line.length()) + 1U;
+  }
+  if (size > 0 && file.seek(size - 1U)) {
+    // A write cut short by power loss leaves the last line unterminated.
+    gNeedsNewline = file.read() != '\n';
+  }
+  gLogBytes = size;
+  file.close();
+}
+
+String lineAt(File *file, uint32_t offset) {
+  if (!file) {
+    if (offset >= gNvsLog.length()) {
+      return String();
+    }
+    int end = gNvsLog.indexOf('\n', offset);
+    if (end < 0) {
+      end = static_cast<int>(gNvsLog.length());
+    }
+    return gNvsLog.substring(offset, static_cast<unsigned int>(end));
+  }
+  if (!file->seek(offset)) {
+    return String();
+  }
+  return file->readStringUntil('\n');
+}
+
+bool readSlot(File *file, const Slot &slot, Entry &out) {
+  if (!parseEntry(lineAt(file, slot.offset), out)) {
+    return false;
+  }
+  out.state = slot.state;
+  out.attempts = slot.attempts;
+  out.error = slot.error;
+  return true;
+}
+
+bool saveNvs(const String &log) {
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, false)) {
+    return false;
+  }
+  bool ok = true;
+  if (log.isEmpty()) {
+    prefs.remove(kPrefsLogKey);
+  } else {
+    ok = prefs.putString(kPrefsLogKey, log) == log.length();
+  }
+  prefs.end();
+  return ok;
+}
+
+String loadNvs() {
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, false)) {
+    return String();
+  }
+  const String log = prefs.getString(kPrefsLogKey, "");
+  prefs.end();
+  return log;
+}
+
+// Rewrites the log with every pending entry and the newest keepHistory
+// others, each as one "add" line carrying its current state.
+bool compact(size_t keepHistory) {
+  size_t history = 0;
+  for (const Slot &slot : gSlots) {
+    if (!isPending(slot.state)) {
+      ++history;
+    }
+  }
+  size_t skipHistory = history > keepHistory ? history - keepHistory : 0;
+
+  std::vector<Slot> kept;
+  String nvsLog;
+  File src;
+  File dst;
+  if (gStorage == Storage::Sd) {
+    src = SD.open(kLogPath, FILE_READ);
+    dst = SD.open(kTmpPath, FILE_WRITE);
+    if (!src || !dst) {
+      if (src) {
+        src.close();
+      }
+      if (dst) {
+        dst.close();
+      }
+      return false;
+    }
+  }
+
+  uint32_t written = 0;
+  bool ok = true;
+  for (const Slot &slot : gSlots) {
+    if (!isPending(slot.state) && skipHistory > 0) {
+      --skipHistory;
+      continue;
+    }
+    Entry entry;
+    if (!readSlot(gStorage == Storage::Sd ? &src : nullptr, slot, entry)) {
+      continue;
+    }
+    const String line = entryLine(entry);
+    Slot moved = slot;
+    moved.offset = written;
+    if (gStorage == Storage::Sd) {
+      if (dst.write(reinterpret_cast<const uint8_t *>(line.c_str()), line.length()) !=
+          line.length()) {
+        ok = false;
+        break;
+      }
+    } else {
+      nvsLog += line;
+    }
+    written += static_cast<uint32_t>(line.length());
+    kept.push_back(moved);
+  }
+
+  if (gStorage == Storage::Sd) {
+    src.close();
+    dst.close();
+    if (!ok || !SD.remove(kLogPath) || !SD.rename(kTmpPath, kLogPath)) {
+      SD.remove(kTmpPath);
+      return false;
+    }
+    dirlisting::noteChanged(kLogPath);
+    gNeedsNewline = false;
+  } else {
+    if (!saveNvs(nvsLog)) {
+      return false;
+    }
+    gNvsLog = nvsLog;
+  }
+
+  gSlots = kept;
+  gLogBytes = written;
+  ++gRevision;
+  return true;
+}
+
+bool appendLine(const String &line, uint32_t *offsetOut, String *error) {
+  if (gStorage == Storage::Sd) {
+    if (!SD.exists(kLogDir)) {
+      SD.mkdir(kLogDir);
+    }
+    File file = SD.open(kLogPath, FILE_APPEND);
+    if (!file) {
+      if (error) {
+        *error = "Outbox log open failed";
+      }
+      return false;
+    }
+    uint32_t offset = static_cast<uint32_t>(file.size());
+    bool ok = true;
+    if (gNeedsNewline && offset > 0) {
+      ok = file.write('\n') == 1;
+      ++offset;
+    }
+    ok = ok && file.write(reinterpret_cast<const uint8_t *>(line.c_str()), line.length()) ==
+                   line.length();
+    file.close();
+    dirlisting::noteChanged(kLogPath);
+    if (!ok) {
+      if (error) {
+        *error = "Outbox log write failed";
+      }
+      return false;
+    }
+    gNeedsNewline = false;
+    gLogBytes = offset + static_cast<uint32_t>(line.length());
+    if (offsetOut) {
+      *offsetOut = offset;
+    }
+    return true;
+  }
+
+  if (gStorage != Storage::Nvs) {
+    if (error) {
+      *error = "Outbox not ready";
+    }
+    return false;
+  }
+  if (gNvsLog.length() + line.length() > kNvsMaxBytes) {
+    compact(0);
+  }
+  if (gNvsLog.length() + line.length() > kNvsMaxBytes) {
+    if (error) {
+      *error = "Outbox full (no SD card)";
+    }
+    return false;
+  }
+  const uint32_t offset = static_cast<uint32_t>(gNvsLog.length());
+  if (!saveNvs(gNvsLog + line)) {
+    if (error) {
+      *error = "Outbox NVS write failed";
+    }
+    return false;
+  }
+  gNvsLog += line;
+  gLogBytes = static_cast<uint32_t>(gNvsLog.length());
+  if (offsetOut) {
+    *offsetOut = offset;
+  }
+  return true;
+}
+
+bool anySending() {
+  for (const Slot &slot : gSlots) {
+    if (slot.state == State::Sending) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Picks the storage and rebuilds the index. Entries written to NVS while no
+// card was mounted are moved into the SD log.
+void load() {
+  gSlots.clear();
+  ++gRevision;
+  gNvsLog = loadNvs();
+  if (sdAvailable()) {
+    gStorage = Storage::Sd;
+    replaySd(gSlots);
+    if (!gNvsLog.isEmpty()) {
+      std::vector<Slot> nvsSlots;
+      replayNvs(gNvsLog, nvsSlots);
+      size_t moved = 0;
+      bool ok = true;
+      for (const Slot &slot : nvsSlots) {
+        Entry entry;
+        if (findSlot(gSlots, slot.id) >= 0 || !readSlot(nullptr, slot, entry)) {
+          continue;
+        }
+        Slot added = slot;
+        if (!appendLine(entryLine(entry), &added.offset, nullptr)) {
+          ok = false;
+          break;
+        }
+        gSlots.push_back(added);
+        ++moved;
+      }
+      if (ok) {
+        gNvsLog = "";
+        saveNvs(gNvsLog);
+      }
+    }
+  } else {
+    gStorage = Storage::Nvs;
+    replayNvs(gNvsLog, gSlots);
+    gLogBytes = static_cast<uint32_t>(gNvsLog.length());
+  }
+
+  // A request in flight when the device went down may or may not have been
+  // delivered; it is sent again.
+  for (Slot &slot : gSlots) {
+    if (slot.state == State::Sending) {
+      slot.state = State::Queued;
+    }
+  }
+  if (gStorage == Storage::Sd && gLogBytes > kCompactBytes) {
+    compact(kKeepHistory);
+  }
+}
+
+void checkStorage() {
+  const bool sd = sdAvailable();
+  if ((gStorage == Storage::Sd && sd) || (gStorage == Storage::Nvs && !sd)) {
+    return;
+  }
+  // Card inserted or remounted: merge NVS into it. Card gone: queue into NVS
+  // until it is back (entries on the card wait for it).
+  load();
+}
+
+void onResponse(const String &requestId, bool ok, const String &error) {
+  if (gInflightId.isEmpty() || requestId != gInflightRequestId) {
+    return;
+  }
+  gInflightAnswered = true;
+  gInflightOk = ok;
+  gInflightError = error;
+}
+
+void finishInflight(State state, const String &error) {
+  const String id = gInflightId;
+  gInflightId = "";
+  gInflightRequestId = "";
+  gInflightAnswered = false;
+  if (state == State::Queued) {
+    // Connection lost before the ack: nothing to record, just send again.
+    const int index = findSlot(gSlots, id);
+    if (index >= 0) {
+      gSlots[static_cast<size_t>(index)].state = State::Queued;
+      ++gRevision;
+    }
+    return;
+  }
+  setState(id, state, error);
+}
+
+}  // namespace
+
+void begin() {
+  load();
+  gLastStorageCheckMs = millis();
+  gBegun = true;
+}
+
+void tick(GatewayClient &gateway) {
+  if (!gBegun) {
+    return;
+  }
+
+  const uint32_t now = millis();
+  if (gResponseToken == 0) {
+    // Stays registered; onResponse ignores everything but the in-flight id.
+    gResponseToken = gateway.addResponseHandler(onResponse);
+  }
+  if (gInflightId.isEmpty() && !anySending() && now - gLastStorageCheckMs >= kStorageCheckMs) {
+    gLastStorageCheckMs = now;
+    checkStorage();
+  }
+
+  const GatewayStatus status = gateway.status();
+  if (!gInflightId.isEmpty()) {
+    if (gInflightAnswered) {
+      const int index = findSlot(gSlots, gInflightId);
+      const uint8_t attempts = index >= 0 ? gSlots[static_cast<size_t>(index)].attempts : 0;
+      if (gInflightOk) {
+        finishInflight(State::Sent, String());
+      } else {
+        finishInflight(attempts >= kMaxAttempts ? State::Failed : State::Queued, gInflightError);
+        gBackingOff = true;
+        gBackoffStartMs = now;
+      }
+    } else if (!status.gatewayReady || status.lastConnectOkMs != gInflightConnectOkMs) {
+      finishInflight(State::Queued, String());
+    } else if (now - gInflightSentMs >= kAckTimeoutMs) {
+      // Gateways that do not answer node.event: the socket stayed up, so the
+      // request went out.
+      finishInflight(State::Sent, String());
+    }
+    return;
+  }
+
+  if (!status.gatewayReady) {
+    return;
+  }
+  if (gBackingOff) {
+    if (now - gBackoffStartMs < kRetryDelayMs) {
+      return;
+    }
+    gBackingOff = false;
+  }
+
+  Slot *next = nullptr;
+  for (Slot &slot : gSlots) {
+    if (isPending(slot.state)) {
+      next = &slot;
+      break;
+    }
+  }
+  if (!next || next->kind != Kind::Text || next->state != State::Queued) {
+    return;
+  }
+
+  std::vector<Entry> entries;
+  const size_t index = static_cast<size_t>(next - gSlots.data());
+  if (read(index, 1, entries) != 1) {
+    setState(next->id, State::Failed, "Outbox entry unreadable");
+    return;
+  }
+  const Entry &entry = entries.front();
+
+  DynamicJsonDocument payload(entry.text.length() + entry.sessionKey.length() + 512U);
+  payload["message"] = entry.text;
+  payload["sessionKey"] = entry.sessionKey;
+  payload["deliver"] = false;
+
+  String requestId;
+  if (!gateway.sendNodeEvent("agent.request", payload, &requestId)) {
+    gBackingOff = true;
+    gBackoffStartMs = now;
+    return;
+  }
+  next->state = State::Sending;
+  ++gRevision;
+  if (next->attempts < 0xFF) {
+    ++next->attempts;
+  }
+  gInflightId = entry.id;
+  gInflightRequestId = requestId;
+  gInflightSentMs = now;
+  gInflightConnectOkMs = status.lastConnectOkMs;
+  gInflightAnswered = false;
+}
+
+bool add(const Entry &entry, String *error) {
+  if (entry.id.isEmpty()) {
+    if (error) {
+      *error = "Message id missing";
+    }
+    return false;
+  }
+  if (findSlot(gSlots, entry.id) >= 0) {
+    return true;
+  }
+  if (gStorage == Storage::Sd && gLogBytes > kCompactBytes && gInflightId.isEmpty() &&
+      !anySending()) {
+    compact(kKeepHistory);
+  }
+
+  Slot slot;
+  slot.id = entry.id;
+  slot.kind = entry.kind;
+  slot.state = entry.state;
+  slot.attempts = entry.attempts;
+  slot.error = entry.error;
+  if (!appendLine(entryLine(entry), &slot.offset, error)) {
+    return false;
+  }
+  gSlots.push_back(slot);
+  ++gRevision;
+  return true;
+}
+
+bool setState(const String &id, State state, const String &error) {
+  const int index = findSlot(gSlots, id);
+  if (index < 0) {
+    return false;
+  }
+  Slot &slot = gSlots[static_cast<size_t>(index)];
+  slot.state = state;
+  slot.error = error;
+  ++gRevision;
+  if (state == State::Sending) {
+    // Not logged: after a reboot an interrupted send is queued again anyway.
+    if (slot.attempts < 0xFF) {
+      ++slot.attempts;
+    }
+    return true;
+  }
+  const bool logged = appendLine(stateLine(slot), nullptr, nullptr);
+  if (gSettledListener && (state == State::Sent || state == State::Failed)) {
+    std::vector<Entry> entries;
+    if (read(static_cast<size_t>(index), 1, entries) == 1) {
+      gSettledListener(entries.front());
+    }
+  }
+  return logged;
+}
+
+bool stateOf(const String &id, State *state) {
+  const int index = findSlot(gSlots, id);
+  if (index < 0) {
+    return false;
+  }
+  if (state) {
+    *state = gSlots[static_cast<size_t>(index)].state;
+  }
+  return true;
+}
+
+void setSettledListener(SettledFn listener) {
+  gSettledListener = listener;
+}
+
+size_t count() {
+  return gSlots.size();
+}
+
+size_t pendingCount() {
+  size_t pending = 0;
+  for (const Slot &slot : gSlots) {
+    if (isPending(slot.state)) {
+      ++pending;
+    }
+  }
+  return pending;
+}
+
+size_t read(size_t first, size_t max, std::vector<Entry> &out) {
+  if (first >= gSlots.size() || max == 0) {
+    return 0;
+  }
+  const size_t last = std::min(gSlots.size(), first + max);
+  File file;
+  if (gStorage == Storage::Sd) {
+    file = SD.open(kLogPath, FILE_READ);
+    if (!file) {
+      return 0;
+    }
+  }
+  size_t added = 0;
+  for (size_t i = first; i < last; ++i) {
+    Entry entry;
+    if (readSlot(gStorage == Storage::Sd ? &file : nullptr, gSlots[i], entry)) {
+      out.push_back(entry);
+      ++added;
+    }
+  }
+  if (file) {
+    file.close();
+  }
+  return added;
+}
+
+bool head(Entry &out) {
+  for (size_t i = 0; i < gSlots.size(); ++i) {
+    if (!isPending(gSlots[i].state)) {
+      continue;
+    }
+    std::vector<Entry> entries;
+    if (read(i, 1, entries) != 1) {
+      return false;
+    }
+    out = entries.front();
+    return true;
+  }
+  return false;
+}
+
+uint32_t revision() {
+  return gRevision;
+}
+
+void clearHistory() {
+  if (gInflightId.isEmpty() && !anySending()) {
+    compact(0);
+  }
+}
+
+const char *storageName() {
+  return gStorage == Storage::Sd ? "sd" : "nvs";
+}
+
+const char *kindToken(Kind kind) {
+  switch (kind) {
+    case Kind::File:
+      return "file";
+    case Kind::Voice:
+      return "voice";
+    case Kind::Text:
+    default:
+      return "text";
+  }
+}
+
+const char *stateName(State state) {
+  switch (state) {
+    case State::Sending:
+      return "sending";
+    case State::Sent:
+      return "sent";
+    case State::Failed:
+      return "failed";
+    case State::Queued:
+    default:
+      return "queued";
+  }
+}
+
+}  // namespace outbox
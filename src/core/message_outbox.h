@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+class GatewayClient;
+
+// Durable messenger outbox. Every outgoing message is appended to a JSON-lines
+// log on SD (NVS when no card is mounted; moved to SD once one is) together
+// with its later state changes, so queued messages survive disconnects and
+// reboots. Only a small index (id, state, log offset) is kept in RAM; message
+// bodies are read back from the log when shown.
+//
+// tick() drains queued text messages in order once the gateway is ready and
+// marks them sent when the gateway acknowledges the request. Attachments need
+// the messenger UI (progress, SD reads), so the drain stops at a queued
+// attachment until the app sends it and reports the outcome via setState().
+namespace outbox {
+
+enum class Kind : uint8_t {
+  Text = 0,
+  File = 1,
+  Voice = 2,
+};
+
+enum class State : uint8_t {
+  Queued = 0,
+  Sending = 1,
+  Sent = 2,
+  Failed = 3,
+};
+
+struct Entry {
+  String id;
+  Kind kind = Kind::Text;
+  State state = State::Queued;
+  String sessionKey;
+  String to;
+  // Message text, or the attachment caption.
+  String text;
+  // Attachment path on SD.
+  String path;
+  String fileName;
+  String mimeType;
+  uint32_t bytes = 0;
+  uint64_t tsMs = 0;
+  uint8_t attempts = 0;
+  String error;
+};
+
+// Loads the log (SD when mounted, otherwise NVS). Call once SD has had its
+// chance to mount.
+void begin();
+void tick(GatewayClient &gateway);
+
+// Appends entry. An id that is already in the outbox is not queued twice.
+bool add(const Entry &entry, String *error = nullptr);
+bool setState(const String &id, State state, const String &error = String());
+bool stateOf(const String &id, State *state);
+// Called with the entry (read back from the log) each time one becomes Sent
+// or Failed, so the outcome can be kept after the entry is compacted away.
+using SettledFn = void (*)(const Entry &entry);
+void setSettledListener(SettledFn listener);
+
+// Entries oldest first.
+size_t count();
+size_t pendingCount();
+// Reads entries [first, first + max) back from the log.
+size_t read(size_t first, size_t max, std::vector<Entry> &out);
+// Oldest entry that is still queued or being sent.
+bool head(Entry &out);
+// Changes whenever an entry is added, dropped or changes state.
+uint32_t revision();
+// Drops sent and failed entries; queued ones stay.
+void clearHistory();
+
+// "sd" or "nvs".
+const char *storageName();
+const char *kindToken(Kind kind);
+const char *stateName(State state);
+
+}  // namespace outbox
@@ -5,6 +5,7 @@
 
 #include "cc1101_radio.h"
 #include "gateway_client.h"
+#include "perf_profiler.h"
 
 namespace {
 
@@ -214,6 +215,8 @@ String bytesToAscii(const std::vector<uint8_t> &bytes) {
 bool isSupportedBin(const String &bin) {
   return bin == "system.which" ||
          bin == "system.run" ||
+         bin == "system.perf" ||
+         bin == "sd.bench" ||
          bin == "cc1101.info" ||
          bin == "cc1101.set_freq" ||
          bin == "cc1101.tx" ||
@@ -238,6 +241,31 @@ void NodeCommandHandler::setGatewayClient(GatewayClient *gateway) {
   gateway_ = gateway;
 }
 
+void NodeCommandHandler::setBenchServiceTick(const std::function<void()> &tick) {
+  benchServiceTick_ = tick;
+}
+
+void NodeCommandHandler::setAtTopLevel(bool atTopLevel) {
+  atTopLevel_ = atTopLevel;
+}
+
+void NodeCommandHandler::tick() {
+  if (!benchPending_ || benchRunning_) {
+    return;
+  }
+  if (!atTopLevel_) {
+    benchPending_ = false;
+    if (gateway_) {
+      gateway_->sendInvokeError(benchInvokeId_,
+                                benchNodeId_,
+                                "UNAVAILABLE",
+                                "SD card in use; return to the launcher and retry");
+    }
+    return;
+  }
+  runPendingBench();
+}
+
 void NodeCommandHandler::handleInvoke(const String &invokeId,
                                       const String &nodeId,
                                       const String &command,
@@ -264,6 +292,16 @@ void NodeCommandHandler::handleInvoke(const String &invokeId,
     return;
   }
 
+  if (command == "system.perf") {
+    handleSystemPerf(invokeId, nodeId, params);
+    return;
+  }
+
+  if (command == "sd.bench") {
+    handleSdBench(invokeId, nodeId, params);
+    return;
+  }
+
   if (command.startsWith("cc1101.")) {
     if (handleCc1101Command(invokeId, nodeId, command, params)) {
       return;
@@ -303,6 +341,117 @@ bool NodeCommandHandler::handleSystemWhich(const String &invokeId,
   return true;
 }
 
+bool NodeCommandHandler::handleSystemPerf(const String &invokeId,
+                                          const String &nodeId,
+                                          JsonObjectConst params) {
+  bool resetAfter = false;
+  if (!params["reset"].isNull() && !readBoolFromJson(params["reset"], resetAfter)) {
+    gateway_->sendInvokeError(invokeId,
+                              nodeId,
+                              "INVALID_REQUEST",
+                              "reset must be a boolean");
+    return true;
+  }
+
+  DynamicJsonDocument payload(5120);
+  perf::appendJson(payload.to<JsonObject>());
+  if (resetAfter) {
+    perf::reset();
+  }
+
+  gateway_->sendInvokeOk(invokeId, nodeId, payload);
+  return true;
+}
+
+bool NodeCommandHandler::handleSdBench(const String &invokeId,
+                                       const String &nodeId,
+                                       JsonObjectConst params) {
+  if (benchPending_ || benchRunning_) {
+    gateway_->sendInvokeError(invokeId, nodeId, "UNAVAILABLE", "sd.bench already running");
+    return true;
+  }
+
+  sdbench::Options options;
+  if (!params["clocksMHz"].isNull()) {
+    if (!params["clocksMHz"].is<JsonArrayConst>()) {
+      gateway_->sendInvokeError(invokeId,
+                                nodeId,
+                                "INVALID_REQUEST",
+                                "clocksMHz must be an array");
+      return true;
+    }
+    for (JsonVariantConst v : params["clocksMHz"].as<JsonArrayConst>()) {
+      int mhz = 0;
+      if (!readIntFromJson(v, mhz) || mhz <= 0 ||
+          !sdbench::isSupportedClock(static_cast<uint32_t>(mhz) * 1000000U)) {
+        gateway_->sendInvokeError(invokeId,
+                                  nodeId,
+                                  "INVALID_REQUEST",
+                                  "clocksMHz: supported values are 4, 10, 20, 25, 40");
+        return true;
+      }
+      options.clocksHz.push_back(static_cast<uint32_t>(mhz) * 1000000U);
+    }
+  }
+  if (!params["fileKB"].isNull()) {
+    int fileKb = 0;
+    if (!readIntFromJson(params["fileKB"], fileKb) || fileKb < 64 || fileKb > 8192) {
+      gateway_->sendInvokeError(invokeId,
+                                nodeId,
+                                "INVALID_REQUEST",
+                                "fileKB must be 64..8192");
+      return true;
+    }
+    options.fileBytes = static_cast<uint32_t>(fileKb) * 1024U;
+  }
+  if (!params["save"].isNull() && !readBoolFromJson(params["save"], options.save)) {
+    gateway_->sendInvokeError(invokeId,
+                              nodeId,
+                              "INVALID_REQUEST",
+                              "save must be a boolean");
+    return true;
+  }
+
+  // The run takes tens of seconds; tick() starts it once this callback has
+  // returned (at the top level only) and replies when it is done.
+  benchInvokeId_ = invokeId;
+  benchNodeId_ = nodeId;
+  benchOptions_ = options;
+  benchPending_ = true;
+  return true;
+}
+
+void NodeCommandHandler::runPendingBench() {
+  benchPending_ = false;
+  benchRunning_ = true;
+
+  // Only the UI is serviced between phases. Ticking the gateway here would
+  // dispatch more commands while the card is unmounted.
+  const sdbench::ProgressFn progress = [this](const String &, uint8_t) {
+    if (benchServiceTick_) {
+      benchServiceTick_();
+    }
+    return true;
+  };
+
+  sdbench::Report report;
+  String err;
+  const bool ran = sdbench::run(benchOptions_, &report, progress, &err);
+  benchRunning_ = false;
+  if (!gateway_) {
+    return;
+  }
+  if (!ran) {
+    gateway_->sendInvokeError(benchInvokeId_, benchNodeId_, "UNAVAILABLE", err);
+    return;
+  }
+
+  DynamicJsonDocument payload(6144);
+  sdbench::appendJson(report, payload.to<JsonObject>());
+  payload["saved"] = report.saved;
+  gateway_->sendInvokeOk(benchInvokeId_, benchNodeId_, payload);
+}
+
 bool NodeCommandHandler::handleSystemRun(const String &invokeId,
                                          const String &nodeId,
                                          JsonObjectConst params) {
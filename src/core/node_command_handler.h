@@ -3,24 +3,56 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 
+#include <functional>
+
+#include "sd_bench.h"
+
 class GatewayClient;
 
 class NodeCommandHandler {
  public:
   void setGatewayClient(GatewayClient *gateway);
+  // Runs between sd.bench phases (UI tick). The gateway is not serviced
+  // during a run.
+  void setBenchServiceTick(const std::function<void()> &tick);
+  // Set while ticking from the top level (launcher menu or headless loop),
+  // where no app holds SD files open. sd.bench unmounts the card, so it only
+  // starts there and is refused anywhere else.
+  void setAtTopLevel(bool atTopLevel);
 
   void handleInvoke(const String &invokeId,
                     const String &nodeId,
                     const String &command,
                     JsonObjectConst params);
 
+  // Runs deferred work (a queued sd.bench) outside the gateway callback.
+  void tick();
+
  private:
   GatewayClient *gateway_ = nullptr;
+  std::function<void()> benchServiceTick_;
+  bool atTopLevel_ = false;
+
+  bool benchPending_ = false;
+  bool benchRunning_ = false;
+  String benchInvokeId_;
+  String benchNodeId_;
+  sdbench::Options benchOptions_;
+
+  void runPendingBench();
 
   bool handleSystemWhich(const String &invokeId,
                          const String &nodeId,
                          JsonObjectConst params);
 
+  bool handleSystemPerf(const String &invokeId,
+                        const String &nodeId,
+                        JsonObjectConst params);
+
+  bool handleSdBench(const String &invokeId,
+                     const String &nodeId,
+                     JsonObjectConst params);
+
   bool handleSystemRun(const String &invokeId,
                        const String &nodeId,
                        JsonObjectConst params);
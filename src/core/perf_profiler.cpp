@@ -0,0 +1,256 @@
+#include "perf_profiler.h"
+
+namespace {
+
+perf::ComponentStats gComponents[perf::kComponentCount];
+perf::FrameStats gFrames;
+perf::StallEvent gStalls[perf::kTopStalls];
+size_t gStallCount = 0;
+unsigned long gWindowStartMs = 0;
+bool gEnabled = USER_PERF_PROFILER_ENABLED != 0;
+
+const char *const kComponentNames[perf::kComponentCount] = {
+    "service",
+    "lvgl",
+    "flush",
+    "input",
+    "wifi",
+    "gateway",
+    "ble",
+    "ram_wd",
+    "ui_tick",
+    "font_io",
+};
+
+struct JsonSection {
+  const char *name = nullptr;
+  perf::JsonSectionFn fill = nullptr;
+};
+
+JsonSection gJsonSections[perf::kMaxJsonSections];
+size_t gJsonSectionCount = 0;
+
+size_t bucketFor(uint32_t elapsedUs) {
+  for (size_t i = 0; i < perf::kBucketCount - 1; ++i) {
+    if (elapsedUs < perf::kBucketBoundsUs[i]) {
+      return i;
+    }
+  }
+  return perf::kBucketCount - 1;
+}
+
+void noteStall(perf::Component component, uint32_t elapsedUs) {
+  size_t slot = gStallCount;
+  if (gStallCount >= perf::kTopStalls) {
+    // Replace the shortest kept stall if this one is longer.
+    slot = 0;
+    for (size_t i = 1; i < gStallCount; ++i) {
+      if (gStalls[i].durationUs < gStalls[slot].durationUs) {
+        slot = i;
+      }
+    }
+    if (gStalls[slot].durationUs >= elapsedUs) {
+      return;
+    }
+  } else {
+    ++gStallCount;
+  }
+
+  gStalls[slot].atMs = millis();
+  gStalls[slot].durationUs = elapsedUs;
+  gStalls[slot].component = component;
+}
+
+}  // namespace
+
+namespace perf {
+
+bool enabled() {
+#if USER_PERF_PROFILER_ENABLED
+  return gEnabled;
+#else
+  return false;
+#endif
+}
+
+void setEnabled(bool enabled) {
+  gEnabled = enabled;
+  if (enabled) {
+    reset();
+  }
+}
+
+void reset() {
+  for (size_t i = 0; i < kComponentCount; ++i) {
+    gComponents[i] = ComponentStats();
+  }
+  gFrames = FrameStats();
+  gStallCount = 0;
+  gWindowStartMs = millis();
+}
+
+unsigned long windowStartMs() {
+  return gWindowStartMs;
+}
+
+void record(Component component, uint32_t elapsedUs) {
+  if (!enabled() || component >= Component::Count) {
+    return;
+  }
+
+  ComponentStats &stats = gComponents[static_cast<size_t>(component)];
+  ++stats.count;
+  stats.totalUs += elapsedUs;
+  stats.lastUs = elapsedUs;
+  if (elapsedUs > stats.maxUs) {
+    stats.maxUs = elapsedUs;
+  }
+  ++stats.buckets[bucketFor(elapsedUs)];
+
+  if (elapsedUs >= kStallThresholdUs) {
+    noteStall(component, elapsedUs);
+  }
+}
+
+void recordFrame(uint32_t frameUs, uint32_t pixels) {
+  if (!enabled()) {
+    return;
+  }
+
+  ++gFrames.frames;
+  gFrames.totalUs += frameUs;
+  if (frameUs > gFrames.maxUs) {
+    gFrames.maxUs = frameUs;
+  }
+  gFrames.totalPixels += pixels;
+  if (pixels > gFrames.maxPixels) {
+    gFrames.maxPixels = pixels;
+  }
+}
+
+const char *componentName(Component component) {
+  if (component >= Component::Count) {
+    return "?";
+  }
+  return kComponentNames[static_cast<size_t>(component)];
+}
+
+const ComponentStats &componentStats(Component component) {
+  if (component >= Component::Count) {
+    component = Component::Service;
+  }
+  return gComponents[static_cast<size_t>(component)];
+}
+
+const FrameStats &frameStats() {
+  return gFrames;
+}
+
+size_t topStalls(StallEvent *out, size_t maxCount) {
+  const size_t count = gStallCount < maxCount ? gStallCount : maxCount;
+  StallEvent sorted[kTopStalls];
+  for (size_t i = 0; i < gStallCount; ++i) {
+    sorted[i] = gStalls[i];
+  }
+  // Insertion sort, longest first; kTopStalls is tiny.
+  for (size_t i = 1; i < gStallCount; ++i) {
+    const StallEvent item = sorted[i];
+    size_t j = i;
+    while (j > 0 && sorted[j - 1].durationUs < item.durationUs) {
+      sorted[j] = sorted[j - 1];
+      --j;
+    }
+    sorted[j] = item;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = sorted[i];
+  }
+  return count;
+}
+
+uint32_t percentileUs(const ComponentStats &stats, uint8_t percent) {
+  if (stats.count == 0) {
+    return 0;
+  }
+  if (percent > 100) {
+    percent = 100;
+  }
+
+  const uint64_t target =
+      (static_cast<uint64_t>(stats.count) * percent + 99U) / 100U;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketCount - 1; ++i) {
+    seen += stats.buckets[i];
+    if (seen >= target) {
+      return kBucketBoundsUs[i] < stats.maxUs ? kBucketBoundsUs[i] : stats.maxUs;
+    }
+  }
+  return stats.maxUs;
+}
+
+void appendJson(JsonObject obj) {
+  obj["enabled"] = enabled();
+  obj["windowMs"] = static_cast<uint32_t>(millis() - gWindowStartMs);
+  obj["stallThresholdUs"] = kStallThresholdUs;
+
+  JsonArray bounds = obj.createNestedArray("bucketBoundsUs");
+  for (size_t i = 0; i < kBucketCount - 1; ++i) {
+    bounds.add(kBucketBoundsUs[i]);
+  }
+
+  JsonObject frames = obj.createNestedObject("frames");
+  frames["count"] = gFrames.frames;
+  frames["avgUs"] = gFrames.frames > 0
+                        ? static_cast<uint32_t>(gFrames.totalUs / gFrames.frames)
+                        : 0U;
+  frames["maxUs"] = gFrames.maxUs;
+  frames["pixels"] = static_cast<uint32_t>(gFrames.totalPixels);
+  frames["avgPixels"] = gFrames.frames > 0
+                            ? static_cast<uint32_t>(gFrames.totalPixels / gFrames.frames)
+                            : 0U;
+  frames["maxPixels"] = gFrames.maxPixels;
+
+  JsonObject components = obj.createNestedObject("components");
+  for (size_t i = 0; i < kComponentCount; ++i) {
+    const ComponentStats &stats = gComponents[i];
+    if (stats.count == 0) {
+      continue;
+    }
+    JsonObject entry = components.createNestedObject(kComponentNames[i]);
+    entry["count"] = stats.count;
+    entry["avgUs"] = static_cast<uint32_t>(stats.totalUs / stats.count);
+    entry["p95Us"] = percentileUs(stats, 95);
+    entry["maxUs"] = stats.maxUs;
+    entry["totalMs"] = static_cast<uint32_t>(stats.totalUs / 1000ULL);
+    JsonArray hist = entry.createNestedArray("hist");
+    for (size_t b = 0; b < kBucketCount; ++b) {
+      hist.add(stats.buckets[b]);
+    }
+  }
+
+  StallEvent stalls[kTopStalls];
+  const size_t stallCount = topStalls(stalls, kTopStalls);
+  JsonArray stallsOut = obj.createNestedArray("stalls");
+  for (size_t i = 0; i < stallCount; ++i) {
+    JsonObject stall = stallsOut.createNestedObject();
+    stall["atMs"] = stalls[i].atMs;
+    stall["component"] = componentName(stalls[i].component);
+    stall["us"] = stalls[i].durationUs;
+  }
+
+  for (size_t i = 0; i < gJsonSectionCount; ++i) {
+    gJsonSections[i].fill(obj.createNestedObject(gJsonSections[i].name));
+  }
+}
+
+bool addJsonSection(const char *name, JsonSectionFn fill) {
+  if (gJsonSectionCount >= kMaxJsonSections) {
+    return false;
+  }
+  gJsonSections[gJsonSectionCount].name = name;
+  gJsonSections[gJsonSectionCount].fill = fill;
+  ++gJsonSectionCount;
+  return true;
+}
+
+}  // namespace perf
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "user_config.h"
+
+// Timing histograms for the UI loop and the background ticks it drives, plus
+// the longest stalls seen since the last reset. Everything is recorded from
+// the Arduino loop task (UI, LVGL and background ticks all run there), so no
+// locking is done.
+namespace perf {
+
+enum class Component : uint8_t {
+  Service = 0,  // one whole UiRuntime::service() pass
+  Lvgl,         // lv_timer_handler(): render plus flush start
+  Flush,        // waiting for the display bus
+  Input,
+  Wifi,
+  Gateway,
+  Ble,
+  RamWatchdog,
+  UiTick,
+  FontIo,       // font pack glyph reads from SD (inside Lvgl)
+  Count,
+};
+
+constexpr size_t kComponentCount = static_cast<size_t>(Component::Count);
+// Bucket i counts samples below kBucketBoundsUs[i]; the last one is open.
+constexpr size_t kBucketCount = 11;
+constexpr uint32_t kBucketBoundsUs[kBucketCount - 1] = {
+    250U, 500U, 1000U, 2000U, 4000U, 8000U, 16000U, 32000U, 64000U, 128000U};
+constexpr size_t kTopStalls = 8;
+constexpr uint32_t kStallThresholdUs = 40000U;
+
+struct ComponentStats {
+  uint32_t count = 0;
+  uint64_t totalUs = 0;
+  uint32_t lastUs = 0;
+  uint32_t maxUs = 0;
+  uint32_t buckets[kBucketCount] = {0};
+};
+
+struct FrameStats {
+  uint32_t frames = 0;
+  uint64_t totalUs = 0;
+  uint32_t maxUs = 0;
+  uint64_t totalPixels = 0;
+  uint32_t maxPixels = 0;
+};
+
+struct StallEvent {
+  uint32_t atMs = 0;
+  uint32_t durationUs = 0;
+  Component component = Component::Service;
+};
+
+bool enabled();
+void setEnabled(bool enabled);
+void reset();
+unsigned long windowStartMs();
+
+void record(Component component, uint32_t elapsedUs);
+void recordFrame(uint32_t frameUs, uint32_t pixels);
+
+const char *componentName(Component component);
+const ComponentStats &componentStats(Component component);
+const FrameStats &frameStats();
+// Longest first; returns the number of valid entries.
+size_t topStalls(StallEvent *out, size_t maxCount);
+// Upper bucket bound containing the given percentile (maxUs for the open
+// bucket), 0 when there are no samples.
+uint32_t percentileUs(const ComponentStats &stats, uint8_t percent);
+
+void appendJson(JsonObject obj);
+
+// Extra report objects from modules outside core: appendJson() adds obj[name]
+// and calls fill on it. Returns false when all slots are taken.
+using JsonSectionFn = void (*)(JsonObject obj);
+constexpr size_t kMaxJsonSections = 4;
+bool addJsonSection(const char *name, JsonSectionFn fill);
+
+// Times its own lifetime into one component; does nothing while disabled.
+class Scope {
+ public:
+  explicit Scope(Component component)
+      : component_(component), startUs_(enabled() ? micros() : 0U) {}
+  ~Scope() {
+    if (startUs_ != 0U) {
+      record(component_, micros() - startUs_);
+    }
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+ private:
+  Component component_;
+  uint32_t startUs_;
+};
+
+}  // namespace perf
+
+#if USER_PERF_PROFILER_ENABLED
+#define PERF_SCOPE(component) perf::Scope perfScope_(component)
+#define PERF_RECORD(component, elapsedUs) perf::record((component), (elapsedUs))
+#define PERF_FRAME(frameUs, pixels) perf::recordFrame((frameUs), (pixels))
+#else
+#define PERF_SCOPE(component) \
+  do {                        \
+  } while (0)
+#define PERF_RECORD(component, elapsedUs) \
+  do {                                    \
+  } while (0)
+#define PERF_FRAME(frameUs, pixels) \
+  do {                              \
+  } while (0)
+#endif
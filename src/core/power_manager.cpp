@@ -0,0 +1,113 @@
+#include "power_manager.h"
+
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <sdkconfig.h>
+#include <soc/soc_caps.h>
+
+#include "user_config.h"
+
+namespace {
+
+// APB stays at 80 MHz for any CPU clock >= 80 MHz, so SPI/I2C/UART timings
+// set up by the Arduino drivers stay valid when DFS lowers the CPU clock.
+constexpr int kMinCpuFreqMhz = 80;
+
+bool gBegun = false;
+bool gDfs = false;
+bool gLightSleep = false;
+
+#if CONFIG_PM_ENABLE
+esp_pm_lock_handle_t gCpuLock = nullptr;
+esp_pm_lock_handle_t gNoSleepLock = nullptr;
+bool gCpuLockHeld = false;
+bool gNoSleepLockHeld = false;
+
+void holdLock(esp_pm_lock_handle_t lock, bool *held, bool hold) {
+  if (!lock || *held == hold) {
+    return;
+  }
+  if (hold) {
+    esp_pm_lock_acquire(lock);
+  } else {
+    esp_pm_lock_release(lock);
+  }
+  *held = hold;
+}
+#endif
+
+}  // namespace
+
+namespace powermgr {
+
+void begin() {
+  if (gBegun) {
+    return;
+  }
+  gBegun = true;
+
+#if CONFIG_PM_ENABLE
+  bool wantLightSleep = false;
+#if USER_POWER_LIGHT_SLEEP && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  wantLightSleep = true;
+#if SOC_LEDC_SUPPORT_RC_FAST_CLOCK
+  // The default APB-clocked LEDC stops in light sleep and the backlight would
+  // flicker; RC_FAST keeps the PWM running while the chip sleeps.
+  if (ledcSetClockSource(LEDC_USE_RC_FAST_CLK)) {
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RC_FAST, ESP_PD_OPTION_ON);
+  } else {
+    wantLightSleep = false;
+  }
+#endif
+#endif
+
+  if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "ui_busy", &gCpuLock) != ESP_OK ||
+      esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "ui_awake", &gNoSleepLock) != ESP_OK) {
+    Serial.println("[power] pm lock create failed");
+    return;
+  }
+  holdLock(gCpuLock, &gCpuLockHeld, true);
+  holdLock(gNoSleepLock, &gNoSleepLockHeld, true);
+
+  esp_pm_config_t config = {};
+  config.max_freq_mhz = static_cast<int>(getCpuFrequencyMhz());
+  config.min_freq_mhz = kMinCpuFreqMhz;
+  config.light_sleep_enable = wantLightSleep;
+  const esp_err_t err = esp_pm_configure(&config);
+  if (err != ESP_OK) {
+    Serial.printf("[power] esp_pm_configure failed: %d\n", static_cast<int>(err));
+    return;
+  }
+  gDfs = true;
+  gLightSleep = wantLightSleep;
+  Serial.printf("[power] dfs %d-%d MHz, light sleep %s\n",
+                config.min_freq_mhz,
+                config.max_freq_mhz,
+                gLightSleep ? "on" : "off");
+#else
+  Serial.println("[power] power management disabled in this IDF build");
+#endif
+}
+
+bool dfsEnabled() {
+  return gDfs;
+}
+
+bool lightSleepEnabled() {
+  return gLightSleep;
+}
+
+void setUiIdle(bool idle, bool allowLightSleep) {
+#if CONFIG_PM_ENABLE
+  if (!gDfs) {
+    return;
+  }
+  holdLock(gCpuLock, &gCpuLockHeld, !idle);
+  holdLock(gNoSleepLock, &gNoSleepLockHeld, !(idle && allowLightSleep && gLightSleep));
+#else
+  (void)idle;
+  (void)allowLightSleep;
+#endif
+}
+
+}  // namespace powermgr
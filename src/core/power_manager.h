@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+
+// CPU clock / light-sleep policy. The firmware runs with PM locks held (full
+// clock, no light sleep); the UI loop drops them only while it is blocked
+// waiting for input, so audio, SD and radio loops are never slowed or put to
+// sleep underneath.
+namespace powermgr {
+
+// Configures DFS and, when enabled in user_config.h and the IDF build
+// supports tickless idle, automatic light sleep. Must run before the first
+// analogWrite() so the backlight PWM can be moved to a clock that keeps
+// running in light sleep.
+void begin();
+
+bool dfsEnabled();
+bool lightSleepEnabled();
+
+// Called around the UI wait. idle=true releases the full-clock lock; with
+// allowLightSleep the no-light-sleep lock is released too.
+void setUiIdle(bool idle, bool allowLightSleep);
+
+}  // namespace powermgr
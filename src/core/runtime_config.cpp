@@ -6,6 +6,7 @@
 #include <SPI.h>
 
 #include "board_pins.h"
+#include "dir_listing.h"
 #include "shared_spi_bus.h"
 #include "user_config.h"
 
@@ -434,6 +435,7 @@ bool writeConfigToSd(const String &blob, String *error = nullptr) {
     SD.remove(kSdConfigTempPath);
   }
 
+  dirlisting::noteChanged(kSdConfigTempPath);
   File temp = SD.open(kSdConfigTempPath, FILE_WRITE);
   if (!temp || temp.isDirectory()) {
     if (temp) {
@@ -573,6 +575,7 @@ void toJson(const RuntimeConfig &config, JsonObject obj) {
   obj["autoConnect"] = config.autoConnect;
   obj["bleDeviceAddress"] = config.bleDeviceAddress;
   obj["bleAutoConnect"] = config.bleAutoConnect;
+  obj["bleLowPowerLink"] = config.bleLowPowerLink;
   obj["appMarketGithubRepo"] = config.appMarketGithubRepo;
   obj["appMarketReleaseAsset"] = config.appMarketReleaseAsset;
   obj["uiLanguage"] = config.uiLanguage;
@@ -609,6 +612,7 @@ void fromJson(const JsonObjectConst &obj, RuntimeConfig &config) {
   config.autoConnect = obj["autoConnect"] | false;
   config.bleDeviceAddress = String(static_cast<const char *>(obj["bleDeviceAddress"] | ""));
   config.bleAutoConnect = obj["bleAutoConnect"] | false;
+  config.bleLowPowerLink = obj["bleLowPowerLink"] | false;
   config.appMarketGithubRepo =
       String(static_cast<const char *>(obj["appMarketGithubRepo"] |
                                        USER_APPMARKET_GITHUB_REPO));
@@ -922,6 +926,7 @@ bool resetConfig(String *error) {
     // SD card missing/unavailable: treat as reset complete for NVS.
     return true;
   }
+  dirlisting::noteChanged(kSdConfigPath);
 
   if (SD.exists(kSdConfigPath) && !SD.remove(kSdConfigPath)) {
     if (error) {
@@ -26,6 +26,7 @@ struct RuntimeConfig {
   bool autoConnect = false;
   String bleDeviceAddress;
   bool bleAutoConnect = false;
+  bool bleLowPowerLink = false;
   String appMarketGithubRepo;
   String appMarketReleaseAsset;
   String uiLanguage = "en";
@@ -0,0 +1,658 @@
+#include "sd_bench.h"
+
+#include <SD.h>
+#include <SPI.h>
+#include <esp_heap_caps.h>
+
+#include <algorithm>
+#include <string.h>
+#include <time.h>
+
+#include "board_pins.h"
+#include "dir_listing.h"
+#include "shared_spi_bus.h"
+#include "user_config.h"
+
+namespace sdbench {
+
+namespace {
+
+constexpr const char *kTestPath = "/.zxos-bench.bin";
+constexpr const char *kResultsDir = "/sdbench";
+constexpr uint32_t kMaxBlockBytes = 32768;
+constexpr uint32_t kRandomBlockBytes = 4096;
+constexpr uint32_t kMinFileBytes = 64U * 1024U;
+constexpr uint32_t kMaxFileBytes = 8U * 1024U * 1024U;
+constexpr size_t kStepsPerClock = kBlockSizeCount * 2U + 1U;
+constexpr size_t kJsonCapacity = 6144;
+
+// Raw CMD10 (SEND_CID) in SPI mode. The Arduino SD driver turns CRC checking
+// on, so the command carries a real CRC7 and the data block a CRC16.
+constexpr uint32_t kCidClockHz = 4000000;
+constexpr uint8_t kCmdSendCid = 10;
+constexpr uint8_t kDataStartToken = 0xFE;
+constexpr unsigned long kCardTimeoutMs = 300;
+
+std::function<void(bool)> gRemountHook;
+std::function<void()> gBeforePhaseHook;
+
+uint8_t *allocateBuffer(size_t bytes) {
+#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
+  if (psramFound()) {
+    return static_cast<uint8_t *>(ps_malloc(bytes));
+  }
+#endif
+  return static_cast<uint8_t *>(
+      heap_caps_malloc(bytes, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL));
+}
+
+// Test data is a function of the file offset, so any block read back (at any
+// size or position) can be checked without a second buffer.
+uint8_t patternByte(uint32_t offset) {
+  return static_cast<uint8_t>((offset * 2654435761U) >> 24);
+}
+
+void fillPattern(uint8_t *buffer, uint32_t offset, uint32_t len) {
+  for (uint32_t i = 0; i < len; ++i) {
+    buffer[i] = patternByte(offset + i);
+  }
+}
+
+bool matchesPattern(const uint8_t *buffer, uint32_t offset, uint32_t len) {
+  for (uint32_t i = 0; i < len; ++i) {
+    if (buffer[i] != patternByte(offset + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t kilobytesPerSecond(uint64_t bytes, uint64_t elapsedUs) {
+  if (elapsedUs == 0U) {
+    return 0;
+  }
+  return static_cast<uint32_t>((bytes * 1000000ULL) / (elapsedUs * 1024ULL));
+}
+
+Latency summarize(std::vector<uint32_t> &samples) {
+  Latency out;
+  if (samples.empty()) {
+    return out;
+  }
+  std::sort(samples.begin(), samples.end());
+  const size_t n = samples.size();
+  const auto at = [&](size_t percent) { return samples[std::min(n - 1U, (n * percent) / 100U)]; };
+  out.samples = static_cast<uint32_t>(n);
+  out.p50Us = at(50);
+  out.p95Us = at(95);
+  out.p99Us = at(99);
+  out.maxUs = samples.back();
+  return out;
+}
+
+String clockLabel(uint32_t hz) {
+  return String(hz / 1000000U) + " MHz";
+}
+
+String blockLabel(uint32_t bytes) {
+  return bytes >= 1024U ? String(bytes / 1024U) + " KB" : String(bytes) + " B";
+}
+
+uint8_t crc7(const uint8_t *data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; ++i) {
+    uint8_t d = data[i];
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc <<= 1;
+      if ((d ^ crc) & 0x80U) {
+        crc ^= 0x09U;
+      }
+      d <<= 1;
+    }
+  }
+  return crc & 0x7FU;
+}
+
+uint16_t crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= static_cast<uint16_t>(data[i]) << 8;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000U) ? static_cast<uint16_t>((crc << 1) ^ 0x1021U)
+                            : static_cast<uint16_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+bool waitCardReady(SPIClass *bus) {
+  const unsigned long startMs = millis();
+  while (bus->transfer(0xFF) != 0xFF) {
+    if (millis() - startMs > kCardTimeoutMs) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint8_t sendCommand(SPIClass *bus, uint8_t command, uint32_t arg) {
+  uint8_t frame[6] = {
+      static_cast<uint8_t>(0x40U | command),
+      static_cast<uint8_t>(arg >> 24),
+      static_cast<uint8_t>(arg >> 16),
+      static_cast<uint8_t>(arg >> 8),
+      static_cast<uint8_t>(arg),
+      0,
+  };
+  frame[5] = static_cast<uint8_t>((crc7(frame, 5) << 1) | 0x01U);
+  for (uint8_t b : frame) {
+    bus->transfer(b);
+  }
+  uint8_t r1 = 0xFF;
+  for (uint8_t i = 0; i < 8 && (r1 & 0x80U); ++i) {
+    r1 = bus->transfer(0xFF);
+  }
+  return r1;
+}
+
+void printableCopy(const uint8_t *src, size_t len, char *out) {
+  for (size_t i = 0; i < len; ++i) {
+    out[i] = (src[i] >= 32 && src[i] <= 126) ? static_cast<char>(src[i]) : '?';
+  }
+  out[len] = '\0';
+}
+
+// Needs the card initialised (it has been mounted once) and the SD driver
+// unmounted, so nothing else is talking to it.
+bool readCid(CardId *cid) {
+#if HAL_HAS_SD_CARD
+  SPIClass *bus = sharedspi::bus();
+  sharedspi::prepareChipSelects();
+  bus->beginTransaction(SPISettings(kCidClockHz, MSBFIRST, SPI_MODE0));
+  digitalWrite(boardpins::kSdCs, LOW);
+
+  uint8_t raw[16] = {};
+  bool ok = waitCardReady(bus) && sendCommand(bus, kCmdSendCid, 0) == 0x00;
+  if (ok) {
+    const unsigned long startMs = millis();
+    uint8_t token = 0xFF;
+    while ((token = bus->transfer(0xFF)) == 0xFF && millis() - startMs < kCardTimeoutMs) {
+    }
+    ok = token == kDataStartToken;
+  }
+  if (ok) {
+    for (uint8_t &b : raw) {
+      b = bus->transfer(0xFF);
+    }
+    uint16_t crc = static_cast<uint16_t>(bus->transfer(0xFF)) << 8;
+    crc |= bus->transfer(0xFF);
+    ok = crc == crc16(raw, sizeof(raw));
+  }
+
+  digitalWrite(boardpins::kSdCs, HIGH);
+  bus->transfer(0xFF);
+  bus->endTransaction();
+  if (!ok) {
+    return false;
+  }
+
+  memcpy(cid->raw, raw, sizeof(raw));
+  cid->manufacturerId = raw[0];
+  printableCopy(raw + 1, 2, cid->oemId);
+  printableCopy(raw + 3, 5, cid->productName);
+  cid->revisionMajor = raw[8] >> 4;
+  cid->revisionMinor = raw[8] & 0x0FU;
+  cid->serial = (static_cast<uint32_t>(raw[9]) << 24) | (static_cast<uint32_t>(raw[10]) << 16) |
+                (static_cast<uint32_t>(raw[11]) << 8) | raw[12];
+  cid->year = static_cast<uint16_t>(2000U + (((raw[13] & 0x0FU) << 4) | (raw[14] >> 4)));
+  cid->month = raw[14] & 0x0FU;
+  cid->valid = true;
+  return true;
+#else
+  (void)cid;
+  return false;
+#endif
+}
+
+bool mountAt(uint32_t hz) {
+#if HAL_HAS_SD_CARD
+  sharedspi::prepareChipSelects();
+  return SD.begin(boardpins::kSdCs, *sharedspi::bus(), hz, "/sd", 8, false);
+#else
+  (void)hz;
+  return false;
+#endif
+}
+
+struct Runner {
+  const ProgressFn *progress = nullptr;
+  uint8_t *buffer = nullptr;
+  uint32_t fileBytes = 0;
+  size_t step = 0;
+  size_t totalSteps = 1;
+
+  // False when the run was cancelled.
+  bool beginPhase(const String &stage) {
+    const uint8_t percent = static_cast<uint8_t>(std::min<size_t>(100U, (step * 100U) / totalSteps));
+    ++step;
+    if (*progress && !(*progress)(stage, percent)) {
+      return false;
+    }
+    if (gBeforePhaseHook) {
+      gBeforePhaseHook();
+    }
+    return true;
+  }
+
+  // Throughput counts only the time spent inside SD calls, so progress
+  // callbacks between phases do not skew it.
+  bool writePass(BlockResult &block,
+                 uint32_t &worstStallUs,
+                 std::vector<uint32_t> *samples,
+                 String *error) {
+    SD.remove(kTestPath);
+    File file = SD.open(kTestPath, FILE_WRITE);
+    if (!file) {
+      *error = "Test file open failed";
+      return false;
+    }
+    if (samples) {
+      samples->clear();
+      samples->reserve(fileBytes / block.blockBytes);
+    }
+
+    uint64_t totalUs = 0;
+    for (uint32_t offset = 0; offset < fileBytes; offset += block.blockBytes) {
+      fillPattern(buffer, offset, block.blockBytes);
+      const uint32_t startUs = micros();
+      const size_t written = file.write(buffer, block.blockBytes);
+      const uint32_t elapsedUs = micros() - startUs;
+      if (written != block.blockBytes) {
+        file.close();
+        *error = "Write failed at " + String(offset);
+        return false;
+      }
+      totalUs += elapsedUs;
+      block.maxWriteUs = std::max(block.maxWriteUs, elapsedUs);
+      if (samples) {
+        samples->push_back(elapsedUs);
+      }
+    }
+
+    const uint32_t startUs = micros();
+    file.flush();
+    file.close();
+    const uint32_t syncUs = micros() - startUs;
+    totalUs += syncUs;
+    block.maxWriteUs = std::max(block.maxWriteUs, syncUs);
+    worstStallUs = std::max(worstStallUs, block.maxWriteUs);
+    block.writeKBps = kilobytesPerSecond(fileBytes, totalUs);
+    return true;
+  }
+
+  bool readPass(BlockResult &block, uint32_t &verifyErrors, String *error) {
+    File file = SD.open(kTestPath, FILE_READ);
+    if (!file) {
+      *error = "Test file open failed";
+      return false;
+    }
+
+    uint64_t totalUs = 0;
+    for (uint32_t offset = 0; offset < fileBytes; offset += block.blockBytes) {
+      const uint32_t startUs = micros();
+      const size_t got = file.read(buffer, block.blockBytes);
+      const uint32_t elapsedUs = micros() - startUs;
+      if (got != block.blockBytes) {
+        file.close();
+        *error = "Read failed at " + String(offset);
+        return false;
+      }
+      totalUs += elapsedUs;
+      block.maxReadUs = std::max(block.maxReadUs, elapsedUs);
+      if (!matchesPattern(buffer, offset, block.blockBytes)) {
+        ++verifyErrors;
+      }
+    }
+    file.close();
+    block.readKBps = kilobytesPerSecond(fileBytes, totalUs);
+    return true;
+  }
+
+  bool randomPass(ClockResult &result, std::vector<uint32_t> &samples, String *error) {
+    File file = SD.open(kTestPath, FILE_READ);
+    if (!file) {
+      *error = "Test file open failed";
+      return false;
+    }
+
+    const uint32_t blocks = fileBytes / kRandomBlockBytes;
+    samples.clear();
+    samples.reserve(kRandomReads);
+    uint64_t totalUs = 0;
+    for (uint32_t i = 0; i < kRandomReads; ++i) {
+      const uint32_t offset = (esp_random() % blocks) * kRandomBlockBytes;
+      const uint32_t startUs = micros();
+      const bool ok = file.seek(offset) &&
+                      file.read(buffer, kRandomBlockBytes) == kRandomBlockBytes;
+      const uint32_t elapsedUs = micros() - startUs;
+      if (!ok) {
+        file.close();
+        *error = "Random read failed at " + String(offset);
+        return false;
+      }
+      totalUs += elapsedUs;
+      samples.push_back(elapsedUs);
+      if (!matchesPattern(buffer, offset, kRandomBlockBytes)) {
+        ++result.verifyErrors;
+      }
+    }
+    file.close();
+    result.randomReadIops =
+        totalUs > 0U ? static_cast<uint32_t>((kRandomReads * 1000000ULL) / totalUs) : 0U;
+    result.randomRead = summarize(samples);
+    return true;
+  }
+
+  // Runs every phase at the mounted clock. Returns false only when cancelled;
+  // a failed phase ends this clock with result.error set.
+  bool runClock(ClockResult &result) {
+    const String clock = clockLabel(result.clockHz);
+    const size_t lastStep = step + kStepsPerClock;
+    std::vector<uint32_t> samples;
+    String error;
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < kBlockSizeCount; ++i) {
+      BlockResult &block = result.blocks[i];
+      block.blockBytes = kBlockSizes[i];
+      const bool keepSamples = block.blockBytes == kRandomBlockBytes;
+      if (!beginPhase(clock + ": write " + blockLabel(block.blockBytes))) {
+        return false;
+      }
+      ok = writePass(block, result.worstWriteStallUs, keepSamples ? &samples : nullptr, &error);
+      if (ok && keepSamples) {
+        result.write4k = summarize(samples);
+      }
+      if (ok && !beginPhase(clock + ": read " + blockLabel(block.blockBytes))) {
+        return false;
+      }
+      ok = ok && readPass(block, result.verifyErrors, &error);
+    }
+    if (ok && !beginPhase(clock + ": random 4 KB reads")) {
+      return false;
+    }
+    ok = ok && randomPass(result, samples, &error);
+
+    result.complete = ok;
+    result.error = error;
+    step = lastStep;
+    return true;
+  }
+};
+
+void judge(Report *report) {
+  if (report->cancelled) {
+    report->verdict = "cancelled";
+    return;
+  }
+
+  // The normal clock is what the firmware runs at; otherwise the fastest
+  // clock that got through every phase.
+  const ClockResult *basis = nullptr;
+  for (size_t i = 0; i < report->clockCount; ++i) {
+    const ClockResult &result = report->clocks[i];
+    if (!result.complete) {
+      continue;
+    }
+    if (result.clockHz == kNormalClockHz) {
+      basis = &result;
+      break;
+    }
+    if (!basis || result.clockHz > basis->clockHz) {
+      basis = &result;
+    }
+  }
+  if (!basis) {
+    report->verdict = "failed";
+    report->reason = "No clock completed";
+    return;
+  }
+
+  const String at = " at " + clockLabel(basis->clockHz);
+  uint32_t write4kKBps = 0;
+  for (const BlockResult &block : basis->blocks) {
+    if (block.blockBytes == kRandomBlockBytes) {
+      write4kKBps = block.writeKBps;
+    }
+  }
+  if (basis->verifyErrors > 0U) {
+    report->verdict = "unreliable";
+    report->reason = String(basis->verifyErrors) + " bad blocks" + at;
+  } else if (basis->worstWriteStallUs > USER_SD_BENCH_MAX_STALL_MS * 1000U) {
+    report->verdict = "slow";
+    report->reason = "Write stall " + String(basis->worstWriteStallUs / 1000U) + " ms" + at;
+  } else if (write4kKBps < USER_SD_BENCH_MIN_WRITE_KBPS) {
+    report->verdict = "slow";
+    report->reason = "4 KB writes " + String(write4kKBps) + " KB/s" + at;
+  } else {
+    report->verdict = "ok";
+  }
+}
+
+bool save(const Report &report) {
+  if (!SD.exists(kResultsDir)) {
+    SD.mkdir(kResultsDir);
+  }
+  File file = SD.open(kResultsPath, FILE_APPEND);
+  if (!file) {
+    return false;
+  }
+
+  DynamicJsonDocument doc(kJsonCapacity);
+  JsonObject obj = doc.to<JsonObject>();
+  // Wall time only once NTP has set the clock.
+  const time_t now = time(nullptr);
+  if (now > 1600000000) {
+    obj["time"] = static_cast<uint32_t>(now);
+  }
+  appendJson(report, obj);
+  const bool ok = serializeJson(doc, file) > 0 && file.write('\n') == 1;
+  file.close();
+  dirlisting::noteChanged(kResultsPath);
+  return ok;
+}
+
+void appendLatency(const Latency &latency, JsonObject out) {
+  out["n"] = latency.samples;
+  out["p50"] = latency.p50Us;
+  out["p95"] = latency.p95Us;
+  out["p99"] = latency.p99Us;
+  out["max"] = latency.maxUs;
+}
+
+}  // namespace
+
+bool isSupportedClock(uint32_t hz) {
+  return std::find(std::begin(kClocksHz), std::end(kClocksHz), hz) != std::end(kClocksHz);
+}
+
+bool run(const Options &options, Report *report, const ProgressFn &progress, String *error) {
+#if !HAL_HAS_SD_CARD
+  (void)options;
+  (void)report;
+  (void)progress;
+  if (error) {
+    *error = "SD card not available";
+  }
+  return false;
+#else
+  std::vector<uint32_t> clocks = options.clocksHz;
+  if (clocks.empty()) {
+    clocks.assign(std::begin(kClocksHz), std::end(kClocksHz));
+  }
+  for (uint32_t hz : clocks) {
+    if (!isSupportedClock(hz)) {
+      if (error) {
+        *error = "Unsupported SPI clock " + String(hz);
+      }
+      return false;
+    }
+  }
+  if (clocks.size() > kClockCount) {
+    if (error) {
+      *error = "Too many clocks";
+    }
+    return false;
+  }
+
+  uint32_t fileBytes = options.fileBytes > 0U ? options.fileBytes : USER_SD_BENCH_FILE_KB * 1024U;
+  fileBytes = std::min(std::max(fileBytes, kMinFileBytes), kMaxFileBytes);
+  fileBytes = (fileBytes + kMaxBlockBytes - 1U) / kMaxBlockBytes * kMaxBlockBytes;
+
+  uint8_t *buffer = allocateBuffer(kMaxBlockBytes);
+  if (!buffer) {
+    if (error) {
+      *error = "Out of memory";
+    }
+    return false;
+  }
+
+  *report = Report();
+  report->fileBytes = fileBytes;
+  const unsigned long startedMs = millis();
+
+  Runner runner;
+  runner.progress = &progress;
+  runner.buffer = buffer;
+  runner.fileBytes = fileBytes;
+  runner.totalSteps = clocks.size() * kStepsPerClock;
+
+  if (gRemountHook) {
+    gRemountHook(false);
+  }
+  // A file browser may be showing a listing under this run (gateway
+  // sd.bench from a background tick); keep its memory valid.
+  dirlisting::invalidateAll();
+  SD.end();
+
+  for (uint32_t hz : clocks) {
+    ClockResult &result = report->clocks[report->clockCount++];
+    result.clockHz = hz;
+    result.mounted = mountAt(hz);
+    if (!result.mounted) {
+      result.error = "Mount failed";
+      runner.step += kStepsPerClock;
+      SD.end();
+      continue;
+    }
+    if (report->cardBytes == 0U) {
+      report->cardType = static_cast<uint8_t>(SD.cardType());
+      report->cardBytes = SD.cardSize();
+    }
+
+    const bool keepGoing = runner.runClock(result);
+    SD.remove(kTestPath);
+    SD.end();
+    if (!report->cid.valid) {
+      readCid(&report->cid);
+    }
+    if (!keepGoing) {
+      report->cancelled = true;
+      break;
+    }
+  }
+  heap_caps_free(buffer);
+
+  const bool remounted = mountAt(kNormalClockHz);
+  judge(report);
+  report->durationMs = millis() - startedMs;
+  if (remounted && options.save && !report->cancelled) {
+    report->saved = save(*report);
+  }
+  if (!remounted) {
+    Serial.println("[sdbench] remount at normal clock failed");
+  }
+  if (gRemountHook) {
+    gRemountHook(true);
+  }
+  return true;
+#endif  // HAL_HAS_SD_CARD
+}
+
+String cidHex(const CardId &cid) {
+  static const char kHex[] = "0123456789abcdef";
+  String out;
+  out.reserve(sizeof(cid.raw) * 2U);
+  for (uint8_t b : cid.raw) {
+    out += kHex[b >> 4];
+    out += kHex[b & 0x0F];
+  }
+  return out;
+}
+
+void appendJson(const Report &report, JsonObject out) {
+  if (report.cid.valid) {
+    const CardId &cid = report.cid;
+    out["cid"] = cidHex(cid);
+    out["mid"] = cid.manufacturerId;
+    out["oid"] = String(cid.oemId);
+    out["pnm"] = String(cid.productName);
+    out["prv"] = String(cid.revisionMajor) + "." + String(cid.revisionMinor);
+    out["psn"] = cid.serial;
+    char made[12];
+    snprintf(made, sizeof(made), "%04u-%02u", cid.year, cid.month);
+    out["mdt"] = String(made);
+  } else {
+    out["cid"] = nullptr;
+  }
+  out["cardType"] = report.cardType;
+  out["cardMB"] = static_cast<uint32_t>(report.cardBytes / (1024ULL * 1024ULL));
+  out["fileKB"] = report.fileBytes / 1024U;
+  out["verdict"] = report.verdict;
+  if (!report.reason.isEmpty()) {
+    out["reason"] = report.reason;
+  }
+  out["durationMs"] = report.durationMs;
+
+  JsonArray clocks = out.createNestedArray("clocks");
+  for (size_t i = 0; i < report.clockCount; ++i) {
+    const ClockResult &result = report.clocks[i];
+    JsonObject clock = clocks.createNestedObject();
+    clock["mhz"] = result.clockHz / 1000000U;
+    clock["mounted"] = result.mounted;
+    if (!result.error.isEmpty()) {
+      clock["error"] = result.error;
+    }
+    if (!result.mounted) {
+      continue;
+    }
+    clock["complete"] = result.complete;
+    clock["verifyErrors"] = result.verifyErrors;
+    JsonArray seq = clock.createNestedArray("seq");
+    for (const BlockResult &block : result.blocks) {
+      if (block.blockBytes == 0U) {
+        continue;
+      }
+      JsonObject row = seq.createNestedObject();
+      row["block"] = block.blockBytes;
+      row["writeKBps"] = block.writeKBps;
+      row["readKBps"] = block.readKBps;
+      row["maxWriteUs"] = block.maxWriteUs;
+      row["maxReadUs"] = block.maxReadUs;
+    }
+    clock["randomReadIops"] = result.randomReadIops;
+    clock["worstWriteStallUs"] = result.worstWriteStallUs;
+    appendLatency(result.write4k, clock.createNestedObject("write4kUs"));
+    appendLatency(result.randomRead, clock.createNestedObject("randomReadUs"));
+  }
+}
+
+void setRemountHook(const std::function<void(bool mounted)> &hook) {
+  gRemountHook = hook;
+}
+
+void setBeforePhaseHook(const std::function<void()> &hook) {
+  gBeforePhaseHook = hook;
+}
+
+}  // namespace sdbench
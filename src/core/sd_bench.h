@@ -0,0 +1,117 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <functional>
+#include <vector>
+
+// SD card benchmark. Remounts the card at each SPI clock and measures
+// sequential write/read throughput at several block sizes, random 4 KB read
+// IOPS and per-operation latency, including the worst write stall (flush and
+// close count as writes). The card's CID is read with a raw CMD10 while it is
+// unmounted, and each run is appended with it to kResultsPath so slow cards
+// can be told apart. Loop task only; a full run blocks for tens of seconds.
+namespace sdbench {
+
+constexpr uint32_t kClocksHz[] = {4000000, 10000000, 20000000, 25000000, 40000000};
+constexpr size_t kClockCount = sizeof(kClocksHz) / sizeof(kClocksHz[0]);
+// Clock the rest of the firmware mounts the card at; restored after a run.
+constexpr uint32_t kNormalClockHz = 25000000;
+constexpr uint32_t kBlockSizes[] = {512, 4096, 32768};
+constexpr size_t kBlockSizeCount = sizeof(kBlockSizes) / sizeof(kBlockSizes[0]);
+constexpr uint32_t kRandomReads = 256;
+constexpr const char *kResultsPath = "/sdbench/results.jsonl";
+
+struct CardId {
+  bool valid = false;
+  uint8_t raw[16] = {};
+  uint8_t manufacturerId = 0;
+  char oemId[3] = {};
+  char productName[6] = {};
+  uint8_t revisionMajor = 0;
+  uint8_t revisionMinor = 0;
+  uint32_t serial = 0;
+  uint16_t year = 0;
+  uint8_t month = 0;
+};
+
+struct Latency {
+  uint32_t samples = 0;
+  uint32_t p50Us = 0;
+  uint32_t p95Us = 0;
+  uint32_t p99Us = 0;
+  uint32_t maxUs = 0;
+};
+
+struct BlockResult {
+  uint32_t blockBytes = 0;
+  uint32_t writeKBps = 0;
+  uint32_t readKBps = 0;
+  uint32_t maxWriteUs = 0;
+  uint32_t maxReadUs = 0;
+};
+
+struct ClockResult {
+  uint32_t clockHz = 0;
+  bool mounted = false;
+  bool complete = false;
+  // Blocks that read back different from what was written.
+  uint32_t verifyErrors = 0;
+  BlockResult blocks[kBlockSizeCount];
+  uint32_t randomReadIops = 0;
+  Latency write4k;
+  Latency randomRead;
+  uint32_t worstWriteStallUs = 0;
+  String error;
+};
+
+struct Report {
+  CardId cid;
+  uint8_t cardType = 0;
+  uint64_t cardBytes = 0;
+  uint32_t fileBytes = 0;
+  ClockResult clocks[kClockCount];
+  size_t clockCount = 0;
+  bool cancelled = false;
+  bool saved = false;
+  // "ok", "slow", "unreliable", "failed" or "cancelled", judged at
+  // kNormalClockHz (or the fastest clock that completed when it was skipped).
+  String verdict;
+  String reason;
+  uint32_t durationMs = 0;
+};
+
+struct Options {
+  // Subset of kClocksHz; empty runs all of them.
+  std::vector<uint32_t> clocksHz;
+  // Test file size; 0 uses USER_SD_BENCH_FILE_KB.
+  uint32_t fileBytes = 0;
+  bool save = true;
+};
+
+// Called before each phase with the overall progress 0..100. Returning false
+// cancels the run (the card is still remounted at the normal clock).
+using ProgressFn = std::function<bool(const String &stage, uint8_t percent)>;
+
+bool isSupportedClock(uint32_t hz);
+
+// Runs the benchmark. Returns false with *error set when it could not start
+// (no SD support, out of memory); per-clock failures are in the report.
+bool run(const Options &options,
+         Report *report,
+         const ProgressFn &progress = ProgressFn(),
+         String *error = nullptr);
+
+String cidHex(const CardId &cid);
+void appendJson(const Report &report, JsonObject out);
+
+// Runs with false before the card is unmounted and with true once it is
+// mounted again at kNormalClockHz. Files held open on SD (the font pack) must
+// be closed and reopened here.
+void setRemountHook(const std::function<void(bool mounted)> &hook);
+// Runs before every timed phase. A display flush still holding the shared SPI
+// bus must finish here, or it is counted as card latency.
+void setBeforePhaseHook(const std::function<void()> &hook);
+
+}  // namespace sdbench
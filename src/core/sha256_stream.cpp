@@ -0,0 +1,134 @@
+#include "sha256_stream.h"
+
+#include "perf_profiler.h"
+
+namespace {
+
+// Short inputs (hex() of a token) would only drown out the file hashes.
+constexpr uint32_t kReportMinBytes = 4096;
+
+// Hashing cost of finished streams, reported under system.perf "sha256".
+struct HashCost {
+  uint32_t streams = 0;
+  uint32_t lastBytes = 0;
+  uint32_t lastBusyUs = 0;
+  uint64_t totalBytes = 0;
+  uint64_t totalBusyUs = 0;
+};
+
+HashCost gHashCost;
+
+uint32_t kilobytesPerSecondOf(uint64_t bytes, uint64_t busyUs) {
+  return busyUs > 0 ? static_cast<uint32_t>((bytes * 1000000ULL) / (busyUs * 1024ULL)) : 0U;
+}
+
+void appendHashCostJson(JsonObject obj) {
+  obj["backend"] = Sha256Stream::backend();
+  obj["streams"] = gHashCost.streams;
+  obj["lastBytes"] = gHashCost.lastBytes;
+  obj["lastBusyUs"] = gHashCost.lastBusyUs;
+  obj["lastKBps"] = kilobytesPerSecondOf(gHashCost.lastBytes, gHashCost.lastBusyUs);
+  obj["avgKBps"] = kilobytesPerSecondOf(gHashCost.totalBytes, gHashCost.totalBusyUs);
+}
+
+void noteHashCost(uint32_t bytes, uint32_t busyUs) {
+  static bool reportRegistered = false;
+  if (!reportRegistered) {
+    reportRegistered = perf::addJsonSection("sha256", appendHashCostJson);
+  }
+  gHashCost.streams++;
+  gHashCost.lastBytes = bytes;
+  gHashCost.lastBusyUs = busyUs;
+  gHashCost.totalBytes += bytes;
+  gHashCost.totalBusyUs += busyUs;
+}
+
+}  // namespace
+
+Sha256Stream::Sha256Stream() {
+#if USER_SHA256_HARDWARE
+  mbedtls_sha256_init(&ctx_);
+#endif
+  reset();
+}
+
+Sha256Stream::~Sha256Stream() {
+#if USER_SHA256_HARDWARE
+  mbedtls_sha256_free(&ctx_);
+#endif
+}
+
+void Sha256Stream::reset() {
+#if USER_SHA256_HARDWARE
+  mbedtls_sha256_starts(&ctx_, 0);
+#else
+  ctx_.reset();
+#endif
+  bytes_ = 0;
+  busyUs_ = 0;
+}
+
+void Sha256Stream::update(const uint8_t *data, size_t len) {
+  if (!data || len == 0) {
+    return;
+  }
+  const uint32_t startUs = micros();
+#if USER_SHA256_HARDWARE
+  mbedtls_sha256_update(&ctx_, data, len);
+#else
+  ctx_.update(data, len);
+#endif
+  busyUs_ += micros() - startUs;
+  bytes_ += static_cast<uint32_t>(len);
+}
+
+void Sha256Stream::finish(uint8_t digest[kDigestBytes]) {
+  const uint32_t startUs = micros();
+#if USER_SHA256_HARDWARE
+  mbedtls_sha256_finish(&ctx_, digest);
+#else
+  ctx_.finalize(digest, kDigestBytes);
+#endif
+  busyUs_ += micros() - startUs;
+  if (bytes_ >= kReportMinBytes) {
+    noteHashCost(bytes_, busyUs_);
+  }
+}
+
+String Sha256Stream::finishHex() {
+  uint8_t digest[kDigestBytes] = {0};
+  finish(digest);
+  return toHex(digest);
+}
+
+uint32_t Sha256Stream::bytes() const {
+  return bytes_;
+}
+
+uint32_t Sha256Stream::busyUs() const {
+  return busyUs_;
+}
+
+uint32_t Sha256Stream::kilobytesPerSecond() const {
+  return kilobytesPerSecondOf(bytes_, busyUs_);
+}
+
+const char *Sha256Stream::backend() {
+  return USER_SHA256_HARDWARE ? "hw" : "sw";
+}
+
+String Sha256Stream::hex(const uint8_t *data, size_t len) {
+  Sha256Stream hash;
+  hash.update(data, len);
+  return hash.finishHex();
+}
+
+String Sha256Stream::toHex(const uint8_t digest[kDigestBytes]) {
+  static const char kHex[] = "0123456789abcdef";
+  char out[(kDigestBytes * 2U) + 1U] = {0};
+  for (size_t i = 0; i < kDigestBytes; ++i) {
+    out[i * 2U] = kHex[(digest[i] >> 4) & 0x0F];
+    out[(i * 2U) + 1U] = kHex[digest[i] & 0x0F];
+  }
+  return String(out);
+}
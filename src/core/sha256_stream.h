@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "user_config.h"
+
+#if USER_SHA256_HARDWARE
+#include <mbedtls/sha256.h>
+#else
+#include <SHA256.h>
+#endif
+
+// Incremental SHA-256, so data can be hashed as it is read or sent instead of
+// in a separate pass. Backed by mbedTLS, which ESP-IDF runs on the SHA
+// peripheral (CONFIG_MBEDTLS_HARDWARE_SHA); USER_SHA256_HARDWARE 0 selects the
+// rweather software implementation instead. Time spent inside update() and
+// finish() is counted; streams of 4 KB or more add it to the "sha256" section
+// of the system.perf report, so both backends can be compared on a device.
+class Sha256Stream {
+ public:
+  static constexpr size_t kDigestBytes = 32;
+
+  Sha256Stream();
+  ~Sha256Stream();
+  Sha256Stream(const Sha256Stream &) = delete;
+  Sha256Stream &operator=(const Sha256Stream &) = delete;
+
+  void reset();
+  void update(const uint8_t *data, size_t len);
+  // Ends the hash; call reset() before reusing.
+  void finish(uint8_t digest[kDigestBytes]);
+  String finishHex();
+
+  uint32_t bytes() const;
+  uint32_t busyUs() const;
+  // Hashing speed so far in KB/s (0 before any data).
+  uint32_t kilobytesPerSecond() const;
+
+  // "hw" or "sw".
+  static const char *backend();
+  static String hex(const uint8_t *data, size_t len);
+  static String toHex(const uint8_t digest[kDigestBytes]);
+
+ private:
+#if USER_SHA256_HARDWARE
+  mbedtls_sha256_context ctx_;
+#else
+  SHA256 ctx_;
+#endif
+  uint32_t bytes_ = 0;
+  uint32_t busyUs_ = 0;
+};
@@ -0,0 +1,34 @@
+#include "shared_i2c_bus.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace {
+
+SemaphoreHandle_t busMutex() {
+  // Recursive so a helper can take it again under a caller's Guard.
+  static SemaphoreHandle_t mutex = xSemaphoreCreateRecursiveMutex();
+  return mutex;
+}
+
+}  // namespace
+
+namespace sharedi2c {
+
+bool lock(uint32_t timeoutMs) {
+  SemaphoreHandle_t mutex = busMutex();
+  if (!mutex) {
+    return false;
+  }
+  const TickType_t ticks = timeoutMs == kWaitForever ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+  return xSemaphoreTakeRecursive(mutex, ticks) == pdTRUE;
+}
+
+void unlock() {
+  SemaphoreHandle_t mutex = busMutex();
+  if (mutex) {
+    xSemaphoreGiveRecursive(mutex);
+  }
+}
+
+}  // namespace sharedi2c
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Wire is used from the status task (battery gauge, charger) and from the
+// foreground (PMU setup, NFC). Every transaction takes this lock first.
+namespace sharedi2c {
+
+constexpr uint32_t kWaitForever = 0xFFFFFFFFUL;
+
+bool lock(uint32_t timeoutMs = kWaitForever);
+void unlock();
+
+// Holds the lock for its scope; check locked() when a timeout was given.
+class Guard {
+ public:
+  explicit Guard(uint32_t timeoutMs = kWaitForever) : locked_(lock(timeoutMs)) {}
+  ~Guard() {
+    if (locked_) {
+      unlock();
+    }
+  }
+  Guard(const Guard &) = delete;
+  Guard &operator=(const Guard &) = delete;
+
+  bool locked() const { return locked_; }
+
+ private:
+  bool locked_;
+};
+
+}  // namespace sharedi2c
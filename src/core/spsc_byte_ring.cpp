@@ -0,0 +1,148 @@
+#include "spsc_byte_ring.h"
+
+#include <esp_heap_caps.h>
+
+#include <cstring>
+
+namespace {
+
+size_t roundUpPow2(size_t value) {
+  size_t out = 1;
+  while (out < value) {
+    out <<= 1U;
+  }
+  return out;
+}
+
+}  // namespace
+
+SpscByteRing::~SpscByteRing() {
+  release();
+}
+
+bool SpscByteRing::allocate(size_t capacity) {
+  const size_t want = roundUpPow2(capacity < 256U ? 256U : capacity);
+  if (!buffer_ || capacity_ != want) {
+    release();
+    uint8_t *ptr = nullptr;
+    bool psram = false;
+#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
+    ptr = static_cast<uint8_t *>(ps_malloc(want));
+    psram = ptr != nullptr;
+#endif
+    if (!ptr) {
+      ptr = static_cast<uint8_t *>(
+          heap_caps_malloc(want, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL));
+    }
+    if (!ptr) {
+      return false;
+    }
+    buffer_ = ptr;
+    capacity_ = want;
+    inPsram_ = psram;
+  }
+
+  head_.store(0, std::memory_order_relaxed);
+  tail_.store(0, std::memory_order_relaxed);
+  highWater_.store(0, std::memory_order_relaxed);
+  overrunBytes_.store(0, std::memory_order_relaxed);
+  overrunEvents_.store(0, std::memory_order_release);
+  return true;
+}
+
+void SpscByteRing::release() {
+  if (buffer_) {
+    free(buffer_);
+  }
+  buffer_ = nullptr;
+  capacity_ = 0;
+  inPsram_ = false;
+  head_.store(0, std::memory_order_relaxed);
+  tail_.store(0, std::memory_order_relaxed);
+}
+
+bool SpscByteRing::allocated() const {
+  return buffer_ != nullptr;
+}
+
+bool SpscByteRing::inPsram() const {
+  return inPsram_;
+}
+
+size_t SpscByteRing::push(const uint8_t *data, size_t length) {
+  if (!buffer_ || !data || length == 0) {
+    return 0;
+  }
+
+  const uint32_t head = head_.load(std::memory_order_relaxed);
+  const uint32_t tail = tail_.load(std::memory_order_acquire);
+  const size_t used = static_cast<size_t>(head - tail);
+  const size_t freeBytes = capacity_ - used;
+  const size_t count = length < freeBytes ? length : freeBytes;
+
+  if (count > 0) {
+    const size_t mask = capacity_ - 1U;
+    const size_t start = static_cast<size_t>(head) & mask;
+    const size_t first = count < capacity_ - start ? count : capacity_ - start;
+    memcpy(buffer_ + start, data, first);
+    if (count > first) {
+      memcpy(buffer_, data + first, count - first);
+    }
+    head_.store(head + static_cast<uint32_t>(count), std::memory_order_release);
+  }
+
+  const uint32_t level = static_cast<uint32_t>(used + count);
+  if (level > highWater_.load(std::memory_order_relaxed)) {
+    highWater_.store(level, std::memory_order_relaxed);
+  }
+  if (count < length) {
+    overrunBytes_.fetch_add(static_cast<uint32_t>(length - count), std::memory_order_relaxed);
+    overrunEvents_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return count;
+}
+
+size_t SpscByteRing::pop(uint8_t *out, size_t maxLen) {
+  if (!buffer_ || !out || maxLen == 0) {
+    return 0;
+  }
+
+  const uint32_t tail = tail_.load(std::memory_order_relaxed);
+  const uint32_t head = head_.load(std::memory_order_acquire);
+  const size_t available = static_cast<size_t>(head - tail);
+  const size_t count = maxLen < available ? maxLen : available;
+  if (count == 0) {
+    return 0;
+  }
+
+  const size_t mask = capacity_ - 1U;
+  const size_t start = static_cast<size_t>(tail) & mask;
+  const size_t first = count < capacity_ - start ? count : capacity_ - start;
+  memcpy(out, buffer_ + start, first);
+  if (count > first) {
+    memcpy(out + first, buffer_, count - first);
+  }
+  tail_.store(tail + static_cast<uint32_t>(count), std::memory_order_release);
+  return count;
+}
+
+size_t SpscByteRing::capacity() const {
+  return capacity_;
+}
+
+size_t SpscByteRing::size() const {
+  return static_cast<size_t>(head_.load(std::memory_order_acquire) -
+                             tail_.load(std::memory_order_acquire));
+}
+
+size_t SpscByteRing::highWater() const {
+  return highWater_.load(std::memory_order_relaxed);
+}
+
+uint32_t SpscByteRing::overrunBytes() const {
+  return overrunBytes_.load(std::memory_order_relaxed);
+}
+
+uint32_t SpscByteRing::overrunEvents() const {
+  return overrunEvents_.load(std::memory_order_relaxed);
+}
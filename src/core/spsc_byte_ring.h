@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <atomic>
+
+// Single-producer/single-consumer byte ring. The producer (e.g. a BLE
+// notification callback) and the consumer (the recording loop) each own one
+// index, so neither side needs a critical section. Capacity is rounded up to
+// a power of two; indices run freely and are masked on access.
+class SpscByteRing {
+ public:
+  SpscByteRing() = default;
+  ~SpscByteRing();
+  SpscByteRing(const SpscByteRing &) = delete;
+  SpscByteRing &operator=(const SpscByteRing &) = delete;
+
+  // Allocates storage (PSRAM first) and clears indices and stats. Call only
+  // while no producer is running.
+  bool allocate(size_t capacity);
+  void release();
+  bool allocated() const;
+  bool inPsram() const;
+
+  // Producer side. Copies as much as fits; the rest is counted as overrun.
+  size_t push(const uint8_t *data, size_t length);
+  // Consumer side.
+  size_t pop(uint8_t *out, size_t maxLen);
+
+  size_t capacity() const;
+  size_t size() const;
+  size_t highWater() const;
+  uint32_t overrunBytes() const;
+  uint32_t overrunEvents() const;
+
+ private:
+  uint8_t *buffer_ = nullptr;
+  size_t capacity_ = 0;
+  bool inPsram_ = false;
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  std::atomic<uint32_t> highWater_{0};
+  std::atomic<uint32_t> overrunBytes_{0};
+  std::atomic<uint32_t> overrunEvents_{0};
+};
@@ -0,0 +1,441 @@
+#include "system_status.h"
+
+#include <WiFi.h>
+#include <Wire.h>
+#include <HTTPClient.h>
+#include <esp_heap_caps.h>
+
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "shared_i2c_bus.h"
+#include "user_config.h"
+
+namespace {
+
+constexpr uint32_t kTaskStackBytes = 6144U;
+constexpr UBaseType_t kTaskPriority = 1;
+constexpr unsigned long kTaskPeriodMs = 250UL;
+constexpr unsigned long kRssiPollMs = 1000UL;
+constexpr unsigned long kBatteryPollMs = 5000UL;
+// Skip a battery poll rather than wait out a long NFC transaction.
+constexpr uint32_t kI2cWaitMs = 50U;
+constexpr unsigned long kNtpRetryMs = 30000UL;
+constexpr unsigned long kUnixSyncRetryMs = 30000UL;
+constexpr unsigned long kUnixSyncRefreshMs = 15UL * 60UL * 1000UL;
+constexpr uint32_t kSyncMinInternalFreeBytes = 36000U;
+constexpr uint32_t kSyncMinInternalLargestBytes = 18000U;
+constexpr time_t kMinValidUnixTimeSec = 946684800;  // 2000-01-01T00:00:00Z
+constexpr uint64_t kWindowsEpochOffset100Ns = 116444736000000000ULL;
+constexpr uint64_t kHundredNsPerSecond = 10000000ULL;
+
+bool isValidUnixTime(time_t unixSec) {
+  return unixSec >= kMinValidUnixTimeSec;
+}
+
+bool hasSyncHeapHeadroom() {
+  const uint32_t freeBytes = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  const uint32_t largest =
+      heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  return freeBytes >= kSyncMinInternalFreeBytes &&
+         largest >= kSyncMinInternalLargestBytes;
+}
+
+void copyTz(char *dst, size_t dstLen, const char *src) {
+  if (!src || src[0] == '\0') {
+    src = USER_TIMEZONE_TZ;
+  }
+  strncpy(dst, src, dstLen - 1);
+  dst[dstLen - 1] = '\0';
+}
+
+bool extractUint64JsonField(const String &json, const char *key, uint64_t *valueOut) {
+  if (!key || !valueOut) {
+    return false;
+  }
+
+  String token = "\"";
+  token += key;
+  token += "\":";
+
+  int idx = json.indexOf(token);
+  if (idx < 0) {
+    return false;
+  }
+  idx += token.length();
+
+  while (idx < static_cast<int>(json.length())) {
+    const char c = json[static_cast<unsigned int>(idx)];
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+      ++idx;
+      continue;
+    }
+    break;
+  }
+
+  uint64_t value = 0;
+  bool hasDigit = false;
+  constexpr uint64_t kMaxBeforeMul10 = UINT64_MAX / 10ULL;
+  constexpr uint64_t kMaxLastDigit = UINT64_MAX % 10ULL;
+
+  while (idx < static_cast<int>(json.length())) {
+    const char c = json[static_cast<unsigned int>(idx)];
+    if (c < '0' || c > '9') {
+      break;
+    }
+    hasDigit = true;
+    const uint64_t digit = static_cast<uint64_t>(c - '0');
+    if (value > kMaxBeforeMul10 || (value == kMaxBeforeMul10 && digit > kMaxLastDigit)) {
+      return false;
+    }
+    value = value * 10ULL + digit;
+    ++idx;
+  }
+
+  if (!hasDigit) {
+    return false;
+  }
+
+  *valueOut = value;
+  return true;
+}
+
+}  // namespace
+
+bool SystemStatusService::begin() {
+  if (task_) {
+    return true;
+  }
+
+  portENTER_CRITICAL(&lock_);
+  if (pendingTz_[0] == '\0') {
+    copyTz(pendingTz_, sizeof(pendingTz_), USER_TIMEZONE_TZ);
+  }
+  tzDirty_ = true;
+  portEXIT_CRITICAL(&lock_);
+
+  if (xTaskCreate(&SystemStatusService::taskEntry,
+                  "sys_status",
+                  kTaskStackBytes,
+                  this,
+                  kTaskPriority,
+                  &task_) != pdPASS) {
+    task_ = nullptr;
+    Serial.println("[status] task create failed");
+    return false;
+  }
+  return true;
+}
+
+bool SystemStatusService::running() const {
+  return task_ != nullptr;
+}
+
+SystemStatusSnapshot SystemStatusService::snapshot() const {
+  portENTER_CRITICAL(&lock_);
+  const SystemStatusSnapshot copy = published_;
+  portEXIT_CRITICAL(&lock_);
+  return copy;
+}
+
+void SystemStatusService::setTimezone(const String &posixTz) {
+  portENTER_CRITICAL(&lock_);
+  copyTz(pendingTz_, sizeof(pendingTz_), posixTz.c_str());
+  tzDirty_ = true;
+  portEXIT_CRITICAL(&lock_);
+  wake();
+}
+
+void SystemStatusService::requestTimeSync() {
+  portENTER_CRITICAL(&lock_);
+  syncRequested_ = true;
+  portEXIT_CRITICAL(&lock_);
+  wake();
+}
+
+void SystemStatusService::applyTimeConfig() {
+  char tz[sizeof(pendingTz_)];
+  portENTER_CRITICAL(&lock_);
+  const bool start = ntpStartRequested_;
+  ntpStartRequested_ = false;
+  memcpy(tz, pendingTz_, sizeof(tz));
+  portEXIT_CRITICAL(&lock_);
+
+  if (start) {
+    configTzTime(tz, USER_NTP_SERVER_1, USER_NTP_SERVER_2);
+  }
+}
+
+void SystemStatusService::wake() {
+  if (task_) {
+    xTaskNotifyGive(task_);
+  }
+}
+
+void SystemStatusService::taskEntry(void *arg) {
+  static_cast<SystemStatusService *>(arg)->run();
+}
+
+void SystemStatusService::run() {
+  for (;;) {
+    poll();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(kTaskPeriodMs));
+  }
+}
+
+void SystemStatusService::poll() {
+  bool tzChanged = false;
+  bool forceSync = false;
+  portENTER_CRITICAL(&lock_);
+  if (tzDirty_) {
+    tzDirty_ = false;
+    tzChanged = true;
+  }
+  forceSync = syncRequested_;
+  syncRequested_ = false;
+  portEXIT_CRITICAL(&lock_);
+
+  if (tzChanged) {
+    ntpStarted_ = false;
+    lastNtpAttemptMs_ = 0;
+    lastUnixSyncAttemptMs_ = 0;
+    lastUnixSyncSuccessMs_ = 0;
+  }
+
+  unsigned long now = millis();
+  const bool wifiConnected = WiFi.status() == WL_CONNECTED;
+  bool changed = wifiConnected != state_.wifiConnected;
+  state_.wifiConnected = wifiConnected;
+  if (!wifiConnected) {
+    state_.wifiRssi = 0;
+  } else if (changed || now - lastRssiPollMs_ >= kRssiPollMs) {
+    lastRssiPollMs_ = now;
+    const int32_t rssi = WiFi.RSSI();
+    changed = changed || rssi != state_.wifiRssi;
+    state_.wifiRssi = rssi;
+  }
+
+  // SNTP itself is started by applyTimeConfig() on the UI thread.
+  bool unixValid = isValidUnixTime(time(nullptr));
+  if (wifiConnected && (!ntpStarted_ || (!unixValid && now - lastNtpAttemptMs_ >= kNtpRetryMs))) {
+    portENTER_CRITICAL(&lock_);
+    ntpStartRequested_ = true;
+    portEXIT_CRITICAL(&lock_);
+    ntpStarted_ = true;
+    lastNtpAttemptMs_ = now;
+  }
+
+  const bool unixSyncDue =
+      wifiConnected &&
+      (forceSync || lastUnixSyncAttemptMs_ == 0 ||
+       (!unixValid && (now - lastUnixSyncAttemptMs_ >= kUnixSyncRetryMs)) ||
+       (unixValid && (lastUnixSyncSuccessMs_ == 0 ||
+                      now - lastUnixSyncSuccessMs_ >= kUnixSyncRefreshMs)));
+  if (unixSyncDue) {
+    lastUnixSyncAttemptMs_ = now;
+    if (syncUnixTimeFromServer(nullptr)) {
+      now = millis();
+      lastUnixSyncSuccessMs_ = now;
+      state_.lastTimeSyncMs = now;
+      unixValid = isValidUnixTime(time(nullptr));
+      changed = true;
+    }
+  }
+  if (unixValid != state_.timeValid) {
+    state_.timeValid = unixValid;
+    changed = true;
+  }
+
+  if (now - lastBatteryPollMs_ >= kBatteryPollMs || lastBatteryPollMs_ == 0) {
+    sharedi2c::Guard i2c(kI2cWaitMs);
+    if (i2c.locked()) {
+      lastBatteryPollMs_ = now;
+      const int pct = readBatteryPercent();
+      bool chargingKnown = false;
+      const bool charging = readBatteryCharging(&chargingKnown);
+      changed = changed || pct != state_.batteryPct || charging != state_.batteryCharging ||
+                chargingKnown != state_.batteryChargingKnown;
+      state_.batteryPct = pct;
+      state_.batteryCharging = charging;
+      state_.batteryChargingKnown = chargingKnown;
+    }
+  }
+
+  state_.updatedMs = now;
+  if (changed) {
+    ++state_.sequence;
+  }
+
+  portENTER_CRITICAL(&lock_);
+  published_ = state_;
+  portEXIT_CRITICAL(&lock_);
+}
+
+bool SystemStatusService::ensureBatteryI2cReady() {
+#if USER_BATTERY_GAUGE_ENABLED
+  if (!batteryWireReady_) {
+    Wire.begin(USER_BATTERY_GAUGE_SDA, USER_BATTERY_GAUGE_SCL);
+    Wire.setTimeOut(5);
+    batteryWireReady_ = true;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+int SystemStatusService::readBatteryPercent() {
+#if USER_BATTERY_GAUGE_ENABLED
+  if (!ensureBatteryI2cReady()) {
+    return -1;
+  }
+
+  Wire.beginTransmission(USER_BATTERY_GAUGE_ADDR);
+  Wire.write(USER_BATTERY_GAUGE_SOC_REG);
+  if (Wire.endTransmission(false) != 0) {
+    return -1;
+  }
+
+  const int readCount = Wire.requestFrom(static_cast<int>(USER_BATTERY_GAUGE_ADDR), 2);
+  if (readCount < 2) {
+    return -1;
+  }
+
+  const uint8_t lo = static_cast<uint8_t>(Wire.read());
+  const uint8_t hi = static_cast<uint8_t>(Wire.read());
+  const int pct = (static_cast<int>(hi) << 8) | static_cast<int>(lo);
+  if (pct < 0 || pct > 100) {
+    return -1;
+  }
+  return pct;
+#else
+  return -1;
+#endif
+}
+
+bool SystemStatusService::readBatteryCharging(bool *known) {
+  if (known) {
+    *known = false;
+  }
+#if USER_BATTERY_GAUGE_ENABLED
+  if (!ensureBatteryI2cReady()) {
+    return false;
+  }
+
+  constexpr uint8_t kPmuAddr = 0x6B;   // BQ25896
+  constexpr uint8_t kStatusReg = 0x0B; // CHRG_STAT[4:3]
+
+  Wire.beginTransmission(kPmuAddr);
+  Wire.write(kStatusReg);
+  if (Wire.endTransmission(false) != 0) {
+    return false;
+  }
+
+  const int readCount = Wire.requestFrom(static_cast<int>(kPmuAddr), 1);
+  if (readCount < 1) {
+    return false;
+  }
+
+  const uint8_t status = static_cast<uint8_t>(Wire.read());
+  const uint8_t chargeState = static_cast<uint8_t>((status >> 3) & 0x03);
+  if (known) {
+    *known = true;
+  }
+  return chargeState == 1U || chargeState == 2U;
+#else
+  return false;
+#endif
+}
+
+bool SystemStatusService::syncUnixTimeFromServer(String *error) {
+  if (error) {
+    error->clear();
+  }
+
+  if (WiFi.status() != WL_CONNECTED) {
+    if (error) {
+      *error = "Wi-Fi not connected";
+    }
+    return false;
+  }
+  if (!hasSyncHeapHeadroom()) {
+    if (error) {
+      *error = "Low heap (skip time sync)";
+    }
+    return false;
+  }
+
+  // The endpoint is always fetched over plain HTTP, so a TLS client is not
+  // needed here.
+  WiFiClient client;
+
+  HTTPClient http;
+  http.setConnectTimeout(1800);
+  http.setTimeout(2200);
+  http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
+
+  String url = USER_UNIX_TIME_SERVER_URL;
+  if (url.startsWith("https://")) {
+    url.remove(0, 8);
+    url = "http://" + url;
+  }
+
+  if (!http.begin(client, url)) {
+    if (error) {
+      *error = "Time server begin failed";
+    }
+    return false;
+  }
+
+  const int statusCode = http.GET();
+  if (statusCode != HTTP_CODE_OK) {
+    if (error) {
+      *error = "Time server failed (" + String(statusCode) + ")";
+    }
+    http.end();
+    return false;
+  }
+
+  const String payload = http.getString();
+  http.end();
+
+  uint64_t unixSec64 = 0;
+  uint64_t fileTime100Ns = 0;
+  if (extractUint64JsonField(payload, "currentFileTime", &fileTime100Ns)) {
+    if (fileTime100Ns <= kWindowsEpochOffset100Ns) {
+      if (error) {
+        *error = "Time field invalid";
+      }
+      return false;
+    }
+    unixSec64 = (fileTime100Ns - kWindowsEpochOffset100Ns) / kHundredNsPerSecond;
+  } else if (!extractUint64JsonField(payload, "unixtime", &unixSec64) &&
+             !extractUint64JsonField(payload, "unixTime", &unixSec64) &&
+             !extractUint64JsonField(payload, "unix", &unixSec64)) {
+    if (error) {
+      *error = "Time field missing";
+    }
+    return false;
+  }
+
+  const time_t unixSec = static_cast<time_t>(unixSec64);
+  if (!isValidUnixTime(unixSec)) {
+    if (error) {
+      *error = "Unix time invalid";
+    }
+    return false;
+  }
+
+  timeval tv;
+  tv.tv_sec = unixSec;
+  tv.tv_usec = 0;
+  if (settimeofday(&tv, nullptr) != 0) {
+    if (error) {
+      *error = "settimeofday failed";
+    }
+    return false;
+  }
+
+  return true;
+}
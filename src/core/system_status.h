@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Last values published by SystemStatusService. Plain data so readers can
+// copy it without touching Wi-Fi, I2C or the network.
+struct SystemStatusSnapshot {
+  bool wifiConnected = false;
+  int32_t wifiRssi = 0;
+  int batteryPct = -1;
+  bool batteryCharging = false;
+  bool batteryChargingKnown = false;
+  bool timeValid = false;
+  unsigned long lastTimeSyncMs = 0;
+  unsigned long updatedMs = 0;
+  uint32_t sequence = 0;
+};
+
+// Background task that owns NTP/HTTP time sync, battery/charger polling and
+// Wi-Fi RSSI sampling on its own schedule, so screen rendering only reads the
+// cached snapshot and never blocks on I/O.
+class SystemStatusService {
+ public:
+  SystemStatusService() = default;
+  SystemStatusService(const SystemStatusService &) = delete;
+  SystemStatusService &operator=(const SystemStatusService &) = delete;
+
+  bool begin();
+  bool running() const;
+
+  SystemStatusSnapshot snapshot() const;
+
+  // Restarts NTP with the given POSIX TZ and schedules an HTTP time resync.
+  // Safe to call before begin().
+  void setTimezone(const String &posixTz);
+  void requestTimeSync();
+
+  // Starts SNTP once the task has asked for it. Must be called from the UI
+  // thread: configTzTime() rewrites TZ, which would race localtime_r() there.
+  void applyTimeConfig();
+
+ private:
+  static void taskEntry(void *arg);
+  void run();
+  void poll();
+  void wake();
+
+  bool ensureBatteryI2cReady();
+  int readBatteryPercent();
+  bool readBatteryCharging(bool *known);
+  bool syncUnixTimeFromServer(String *error);
+
+  mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+  TaskHandle_t task_ = nullptr;
+  SystemStatusSnapshot published_;
+
+  // Shared with callers under lock_.
+  char pendingTz_[64] = {0};
+  bool tzDirty_ = false;
+  bool syncRequested_ = false;
+  bool ntpStartRequested_ = false;
+
+  // Owned by the service task.
+  SystemStatusSnapshot state_;
+  bool batteryWireReady_ = false;
+  bool ntpStarted_ = false;
+  unsigned long lastNtpAttemptMs_ = 0;
+  unsigned long lastUnixSyncAttemptMs_ = 0;
+  unsigned long lastUnixSyncSuccessMs_ = 0;
+  unsigned long lastBatteryPollMs_ = 0;
+  unsigned long lastRssiPollMs_ = 0;
+};
@@ -0,0 +1,379 @@
+#include "text_pager.h"
+
+#include <SD.h>
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+char foldAscii(uint8_t c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A'))
+                                : static_cast<char>(c);
+}
+
+}  // namespace
+
+TextPager::~TextPager() {
+  close();
+}
+
+bool TextPager::open(const String &path, String *error) {
+  close();
+
+  file_ = SD.open(path.c_str(), FILE_READ);
+  if (!file_ || file_.isDirectory()) {
+    if (file_) {
+      file_.close();
+    }
+    if (error) {
+      *error = "File open failed";
+    }
+    return false;
+  }
+
+  block_ = static_cast<uint8_t *>(malloc(kBlockBytes));
+  if (!block_) {
+    file_.close();
+    if (error) {
+      *error = "Out of memory";
+    }
+    return false;
+  }
+
+  size_ = static_cast<uint32_t>(file_.size());
+  checkpoints_.reserve(64);
+  if (size_ > 0U) {
+    addLineStart(0U);
+  }
+  return true;
+}
+
+void TextPager::close() {
+  if (file_) {
+    file_.close();
+  }
+  free(block_);
+  block_ = nullptr;
+  blockStart_ = UINT32_MAX;
+  blockLen_ = 0;
+  std::vector<uint32_t>().swap(checkpoints_);
+  stride_ = kInitialStride;
+  size_ = 0;
+  lines_ = 0;
+  indexedTo_ = 0;
+}
+
+bool TextPager::isOpen() const {
+  return block_ != nullptr;
+}
+
+uint32_t TextPager::fileSize() const {
+  return size_;
+}
+
+uint32_t TextPager::lineCount() const {
+  return lines_;
+}
+
+bool TextPager::indexComplete() const {
+  return indexedTo_ >= size_;
+}
+
+uint8_t TextPager::indexedPercent() const {
+  if (size_ == 0U || indexedTo_ >= size_) {
+    return 100;
+  }
+  return static_cast<uint8_t>((static_cast<uint64_t>(indexedTo_) * 100ULL) / size_);
+}
+
+size_t TextPager::memoryBytes() const {
+  return (block_ ? kBlockBytes : 0U) + checkpoints_.capacity() * sizeof(uint32_t);
+}
+
+uint32_t TextPager::stride() const {
+  return stride_;
+}
+
+bool TextPager::loadBlock(uint32_t offset) {
+  if (!block_ || offset >= size_) {
+    return false;
+  }
+  const uint32_t start = offset & ~static_cast<uint32_t>(kBlockBytes - 1U);
+  if (start == blockStart_) {
+    return true;
+  }
+  const uint32_t len = std::min<uint32_t>(kBlockBytes, size_ - start);
+  if (!file_.seek(start) || file_.read(block_, len) != len) {
+    blockStart_ = UINT32_MAX;
+    blockLen_ = 0;
+    return false;
+  }
+  blockStart_ = start;
+  blockLen_ = len;
+  return true;
+}
+
+void TextPager::addLineStart(uint32_t offset) {
+  if (lines_ % stride_ == 0U && checkpoints_.size() == kMaxCheckpoints) {
+    // Keep every other checkpoint so the index stays the same size for any
+    // file; lookups then skip at most twice as many lines.
+    size_t kept = 0;
+    for (size_t i = 0; i < checkpoints_.size(); i += 2) {
+      checkpoints_[kept++] = checkpoints_[i];
+    }
+    checkpoints_.resize(kept);
+    stride_ *= 2U;
+  }
+  if (lines_ % stride_ == 0U) {
+    checkpoints_.push_back(offset);
+  }
+  ++lines_;
+}
+
+bool TextPager::indexBlock() {
+  if (indexComplete()) {
+    return true;
+  }
+  if (!loadBlock(indexedTo_)) {
+    return false;
+  }
+  const uint32_t end = blockStart_ + blockLen_;
+  for (uint32_t pos = indexedTo_; pos < end; ++pos) {
+    if (block_[pos - blockStart_] == '\n' && pos + 1U < size_) {
+      addLineStart(pos + 1U);
+    }
+  }
+  indexedTo_ = end;
+  return true;
+}
+
+bool TextPager::indexStep(size_t budgetBytes) {
+  const uint32_t target =
+      static_cast<uint32_t>(std::min<uint64_t>(size_, static_cast<uint64_t>(indexedTo_) + budgetBytes));
+  while (indexedTo_ < target) {
+    if (!indexBlock()) {
+      return false;
+    }
+  }
+  return indexComplete();
+}
+
+bool TextPager::indexTo(uint32_t offset, const ProgressFn &progress) {
+  while (indexedTo_ < offset && !indexComplete()) {
+    if (!indexBlock()) {
+      return false;
+    }
+    if (progress && !progress(indexedPercent())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TextPager::indexLines(uint32_t line, const ProgressFn &progress) {
+  while (lines_ <= line && !indexComplete()) {
+    if (!indexBlock()) {
+      return false;
+    }
+    if (progress && !progress(indexedPercent())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TextPager::nextLineStart(uint32_t offset, uint32_t *next) {
+  while (offset < size_) {
+    if (!loadBlock(offset)) {
+      return false;
+    }
+    const uint8_t *from = block_ + (offset - blockStart_);
+    const size_t len = blockStart_ + blockLen_ - offset;
+    const void *hit = memchr(from, '\n', len);
+    if (hit) {
+      *next = offset + static_cast<uint32_t>(static_cast<const uint8_t *>(hit) - from) + 1U;
+      return true;
+    }
+    offset += static_cast<uint32_t>(len);
+  }
+  *next = size_;
+  return true;
+}
+
+bool TextPager::lineOffset(uint32_t line, uint32_t *offset) {
+  if (line >= lines_) {
+    return false;
+  }
+  uint32_t pos = checkpoints_[line / stride_];
+  for (uint32_t skip = line % stride_; skip > 0U; --skip) {
+    if (!nextLineStart(pos, &pos)) {
+      return false;
+    }
+  }
+  *offset = pos;
+  return true;
+}
+
+bool TextPager::readLines(uint32_t firstLine,
+                          size_t maxLines,
+                          size_t maxChars,
+                          std::vector<String> &out,
+                          const ProgressFn &progress) {
+  out.clear();
+  if (!isOpen()) {
+    return false;
+  }
+  if (!indexLines(firstLine, progress)) {
+    return false;
+  }
+  uint32_t pos = 0;
+  if (firstLine >= lines_) {
+    return true;
+  }
+  if (!lineOffset(firstLine, &pos)) {
+    return false;
+  }
+
+  maxChars = std::max<size_t>(maxChars, 4);
+  while (out.size() < maxLines && pos < size_) {
+    String line;
+    line.reserve(maxChars + 1U);
+    bool cut = false;
+    while (pos < size_) {
+      if (!loadBlock(pos)) {
+        return false;
+      }
+      const uint8_t c = block_[pos - blockStart_];
+      ++pos;
+      if (c == '\n') {
+        break;
+      }
+      if (c == '\r') {
+        continue;
+      }
+      if (line.length() >= maxChars) {
+        cut = true;
+        // Skip the rest of a long line a block at a time.
+        if (!nextLineStart(pos, &pos)) {
+          return false;
+        }
+        break;
+      }
+      if (c == '\t') {
+        line += ' ';
+      } else if (c >= 32 && c <= 126) {
+        line += static_cast<char>(c);
+      } else {
+        line += '.';
+      }
+    }
+    if (cut) {
+      line = line.substring(0, maxChars - 3U) + "...";
+    }
+    out.push_back(line);
+  }
+  return true;
+}
+
+bool TextPager::lineAtPercent(uint8_t percent, uint32_t *line, const ProgressFn &progress) {
+  if (!isOpen() || size_ == 0U) {
+    *line = 0;
+    return isOpen();
+  }
+  const uint32_t target = static_cast<uint32_t>(
+      (static_cast<uint64_t>(size_) * std::min<uint8_t>(percent, 100)) / 100ULL);
+  if (!indexTo(std::min(size_, target + 1U), progress)) {
+    return false;
+  }
+  if (target >= size_) {
+    *line = lines_ > 0U ? lines_ - 1U : 0U;
+    return true;
+  }
+
+  // Last checkpoint at or before the target, then walk line by line.
+  const auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), target);
+  const size_t index = static_cast<size_t>(it - checkpoints_.begin()) - 1U;
+  uint32_t current = static_cast<uint32_t>(index) * stride_;
+  uint32_t pos = checkpoints_[index];
+  while (true) {
+    uint32_t next = 0;
+    if (!nextLineStart(pos, &next)) {
+      return false;
+    }
+    if (next > target || next >= size_) {
+      break;
+    }
+    ++current;
+    pos = next;
+  }
+  *line = current;
+  return true;
+}
+
+bool TextPager::find(const String &needle,
+                     uint32_t fromLine,
+                     uint32_t *foundLine,
+                     const ProgressFn &progress) {
+  if (!isOpen() || needle.isEmpty()) {
+    return false;
+  }
+  if (!indexLines(fromLine, progress) || fromLine >= lines_) {
+    return false;
+  }
+  uint32_t pos = 0;
+  if (!lineOffset(fromLine, &pos)) {
+    return false;
+  }
+
+  // Streaming KMP over case-folded bytes, so matches may span blocks.
+  const size_t n = needle.length();
+  std::vector<char> pattern(n);
+  std::vector<uint16_t> fail(n, 0);
+  for (size_t i = 0; i < n; ++i) {
+    pattern[i] = foldAscii(static_cast<uint8_t>(needle[static_cast<unsigned int>(i)]));
+  }
+  for (size_t i = 1, k = 0; i < n; ++i) {
+    while (k > 0 && pattern[i] != pattern[k]) {
+      k = fail[k - 1];
+    }
+    if (pattern[i] == pattern[k]) {
+      ++k;
+    }
+    fail[i] = static_cast<uint16_t>(k);
+  }
+
+  uint32_t line = fromLine;
+  size_t matched = 0;
+  while (pos < size_) {
+    // Index the block being searched too; it is already in the buffer.
+    if (indexedTo_ <= pos && !indexBlock()) {
+      return false;
+    }
+    if (!loadBlock(pos)) {
+      return false;
+    }
+    const uint32_t end = blockStart_ + blockLen_;
+    for (; pos < end; ++pos) {
+      const char c = foldAscii(block_[pos - blockStart_]);
+      while (matched > 0 && c != pattern[matched]) {
+        matched = fail[matched - 1];
+      }
+      if (c == pattern[matched]) {
+        ++matched;
+        if (matched == n) {
+          *foundLine = line;
+          return true;
+        }
+      }
+      if (c == '\n') {
+        ++line;
+      }
+    }
+    if (progress &&
+        !progress(static_cast<uint8_t>((static_cast<uint64_t>(pos) * 100ULL) / size_))) {
+      return false;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include <functional>
+#include <vector>
+
+// Pages through a text file of any size with bounded memory. A sparse index
+// keeps the byte offset of every Nth line; it is built incrementally (a slice
+// per indexStep() call, or on demand when a later line is requested) and the
+// stride doubles whenever it fills up, so it never grows past kMaxCheckpoints.
+// All reads go through one block-aligned buffer.
+class TextPager {
+ public:
+  static constexpr size_t kBlockBytes = 4096;
+  static constexpr size_t kMaxCheckpoints = 4096;
+  static constexpr uint32_t kInitialStride = 32;
+
+  // Called every block during long scans with progress 0..100. Returning
+  // false cancels the scan.
+  using ProgressFn = std::function<bool(uint8_t percent)>;
+
+  TextPager() = default;
+  ~TextPager();
+  TextPager(const TextPager &) = delete;
+  TextPager &operator=(const TextPager &) = delete;
+
+  bool open(const String &path, String *error = nullptr);
+  void close();
+  bool isOpen() const;
+
+  uint32_t fileSize() const;
+  // Lines found so far; exact once indexComplete().
+  uint32_t lineCount() const;
+  bool indexComplete() const;
+  // Share of the file the index covers, 0..100.
+  uint8_t indexedPercent() const;
+  // Indexes up to budgetBytes more. Returns true once the whole file is indexed.
+  bool indexStep(size_t budgetBytes);
+
+  // Reads up to maxLines lines starting at firstLine. Non-printable bytes are
+  // shown as '.', and lines longer than maxChars are cut with "...".
+  bool readLines(uint32_t firstLine,
+                 size_t maxLines,
+                 size_t maxChars,
+                 std::vector<String> &out,
+                 const ProgressFn &progress = ProgressFn());
+  // Line that contains the byte at percent of the file size.
+  bool lineAtPercent(uint8_t percent,
+                     uint32_t *line,
+                     const ProgressFn &progress = ProgressFn());
+  // First line at or after fromLine containing needle (ASCII case-insensitive).
+  bool find(const String &needle,
+            uint32_t fromLine,
+            uint32_t *foundLine,
+            const ProgressFn &progress = ProgressFn());
+
+  size_t memoryBytes() const;
+  uint32_t stride() const;
+
+ private:
+  bool loadBlock(uint32_t offset);
+  bool indexBlock();
+  void addLineStart(uint32_t offset);
+  bool indexTo(uint32_t offset, const ProgressFn &progress);
+  bool indexLines(uint32_t line, const ProgressFn &progress);
+  bool nextLineStart(uint32_t offset, uint32_t *next);
+  bool lineOffset(uint32_t line, uint32_t *offset);
+
+  File file_;
+  uint32_t size_ = 0;
+  uint8_t *block_ = nullptr;
+  uint32_t blockStart_ = UINT32_MAX;
+  uint32_t blockLen_ = 0;
+  // checkpoints_[i] is the offset of line i * stride_.
+  std::vector<uint32_t> checkpoints_;
+  uint32_t stride_ = kInitialStride;
+  uint32_t lines_ = 0;
+  uint32_t indexedTo_ = 0;
+};
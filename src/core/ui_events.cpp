@@ -0,0 +1,62 @@
+#include "ui_events.h"
+
+#include <freertos/event_groups.h>
+
+namespace {
+
+EventGroupHandle_t gGroup = nullptr;
+volatile uint32_t gFirstInputEdgeUs = 0;
+
+}  // namespace
+
+namespace uievents {
+
+bool begin() {
+  if (!gGroup) {
+    gGroup = xEventGroupCreate();
+  }
+  return gGroup != nullptr;
+}
+
+void post(uint32_t bits) {
+  if (gGroup) {
+    xEventGroupSetBits(gGroup, bits & kAll);
+  }
+}
+
+void IRAM_ATTR postFromIsr(uint32_t bits) {
+  if ((bits & kInput) != 0) {
+    // 0 means "no edge pending", so a timestamp that lands on 0 becomes 1.
+    uint32_t expected = 0;
+    const uint32_t nowUs = static_cast<uint32_t>(micros()) | 1UL;
+    __atomic_compare_exchange_n(&gFirstInputEdgeUs, &expected, nowUs, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  }
+  if (!gGroup) {
+    return;
+  }
+  BaseType_t woken = pdFALSE;
+  xEventGroupSetBitsFromISR(gGroup, bits & kAll, &woken);
+  if (woken == pdTRUE) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+uint32_t wait(uint32_t timeoutMs) {
+  if (!gGroup) {
+    delay(timeoutMs);
+    return 0;
+  }
+  const EventBits_t bits = xEventGroupWaitBits(gGroup,
+                                               kAll,
+                                               pdTRUE,
+                                               pdFALSE,
+                                               pdMS_TO_TICKS(timeoutMs));
+  return static_cast<uint32_t>(bits) & kAll;
+}
+
+uint32_t takeInputEdgeUs() {
+  return __atomic_exchange_n(&gFirstInputEdgeUs, 0U, __ATOMIC_RELAXED);
+}
+
+}  // namespace uievents
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Wake-up bits for the UI loop. Input ISRs and network callbacks post here so
+// the loop can block until something happens instead of polling on a delay.
+namespace uievents {
+
+constexpr uint32_t kInput = 1UL << 0;
+constexpr uint32_t kNetwork = 1UL << 1;
+constexpr uint32_t kApp = 1UL << 2;
+constexpr uint32_t kAll = kInput | kNetwork | kApp;
+
+bool begin();
+void post(uint32_t bits);
+// ISR-safe. kInput also records the edge time for wake-to-render latency.
+void postFromIsr(uint32_t bits);
+
+// Blocks up to timeoutMs for any bit; returns (and clears) the bits that woke
+// the caller, 0 on timeout.
+uint32_t wait(uint32_t timeoutMs);
+
+// micros() of the first input edge since the previous call, 0 if none.
+uint32_t takeInputEdgeUs();
+
+}  // namespace uievents
@@ -0,0 +1,604 @@
+#include "voice_codec.h"
+
+#include <SD.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "dir_listing.h"
+
+namespace {
+
+constexpr uint16_t kPcmWavHeaderBytes = 44;
+constexpr uint16_t kImaAdpcmWavHeaderBytes = 60;
+constexpr uint32_t kStreamingSizePlaceholder = 0xFFFFFFFFUL;
+constexpr size_t kOutputBufferBytes = 8192;
+
+constexpr int16_t kImaStepTable[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+constexpr int8_t kImaIndexTable[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+void writeLe16(uint8_t *out, uint16_t value) {
+  out[0] = static_cast<uint8_t>(value & 0xFFU);
+  out[1] = static_cast<uint8_t>((value >> 8) & 0xFFU);
+}
+
+void writeLe32(uint8_t *out, uint32_t value) {
+  out[0] = static_cast<uint8_t>(value & 0xFFU);
+  out[1] = static_cast<uint8_t>((value >> 8) & 0xFFU);
+  out[2] = static_cast<uint8_t>((value >> 16) & 0xFFU);
+  out[3] = static_cast<uint8_t>((value >> 24) & 0xFFU);
+}
+
+uint16_t readLe16(const uint8_t *in) {
+  return static_cast<uint16_t>(in[0]) | (static_cast<uint16_t>(in[1]) << 8);
+}
+
+uint32_t readLe32(const uint8_t *in) {
+  return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+         (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+void writeTag(uint8_t *out, const char *tag) {
+  memcpy(out, tag, 4);
+}
+
+inline int32_t clampSample(int32_t value) {
+  return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+}
+
+inline uint8_t encodeNibble(int16_t sample, ImaAdpcmState &state) {
+  int32_t step = kImaStepTable[state.index];
+  int32_t diff = static_cast<int32_t>(sample) - state.predictor;
+  uint8_t nibble = 0;
+  if (diff < 0) {
+    nibble = 8;
+    diff = -diff;
+  }
+
+  int32_t delta = step >> 3;
+  if (diff >= step) {
+    nibble |= 4;
+    diff -= step;
+    delta += step;
+  }
+  step >>= 1;
+  if (diff >= step) {
+    nibble |= 2;
+    diff -= step;
+    delta += step;
+  }
+  step >>= 1;
+  if (diff >= step) {
+    nibble |= 1;
+    delta += step;
+  }
+
+  const int32_t predicted = (nibble & 8) ? state.predictor - delta : state.predictor + delta;
+  state.predictor = static_cast<int16_t>(clampSample(predicted));
+  const int32_t index = static_cast<int32_t>(state.index) + kImaIndexTable[nibble & 7];
+  state.index = static_cast<uint8_t>(index < 0 ? 0 : (index > 88 ? 88 : index));
+  return nibble;
+}
+
+inline int16_t decodeNibble(uint8_t nibble, ImaAdpcmState &state) {
+  const int32_t step = kImaStepTable[state.index];
+  int32_t delta = step >> 3;
+  if (nibble & 4) {
+    delta += step;
+  }
+  if (nibble & 2) {
+    delta += step >> 1;
+  }
+  if (nibble & 1) {
+    delta += step >> 2;
+  }
+
+  const int32_t predicted = (nibble & 8) ? state.predictor - delta : state.predictor + delta;
+  state.predictor = static_cast<int16_t>(clampSample(predicted));
+  const int32_t index = static_cast<int32_t>(state.index) + kImaIndexTable[nibble & 7];
+  state.index = static_cast<uint8_t>(index < 0 ? 0 : (index > 88 ? 88 : index));
+  return state.predictor;
+}
+
+void setError(String *error, const String &value) {
+  if (error) {
+    *error = value;
+  }
+}
+
+}  // namespace
+
+const char *voiceEncodingName(VoiceEncoding encoding) {
+  return encoding == VoiceEncoding::ImaAdpcm ? "IMA-ADPCM" : "PCM16";
+}
+
+uint16_t imaAdpcmBlockAlign(uint32_t sampleRate) {
+  // Same block sizes as the Microsoft encoder so any WAV reader accepts them.
+  if (sampleRate <= 11025U) {
+    return 256;
+  }
+  if (sampleRate <= 22050U) {
+    return 512;
+  }
+  return 1024;
+}
+
+uint16_t imaAdpcmSamplesPerBlock(uint16_t blockAlign) {
+  if (blockAlign <= 4U) {
+    return 0;
+  }
+  return static_cast<uint16_t>((blockAlign - 4U) * 2U + 1U);
+}
+
+size_t imaAdpcmEncodeBlock(const int16_t *pcm,
+                           size_t count,
+                           ImaAdpcmState &state,
+                           uint8_t *out) {
+  if (!pcm || !out || count == 0) {
+    return 0;
+  }
+
+  // The block header carries the first sample verbatim; the step index keeps
+  // running across blocks so the encoder adapts continuously.
+  state.predictor = pcm[0];
+  writeLe16(out, static_cast<uint16_t>(state.predictor));
+  out[2] = state.index;
+  out[3] = 0;
+
+  size_t outLen = 4;
+  for (size_t i = 1; i < count; i += 2) {
+    const uint8_t lo = encodeNibble(pcm[i], state);
+    const uint8_t hi = (i + 1 < count) ? encodeNibble(pcm[i + 1], state) : 0;
+    out[outLen++] = static_cast<uint8_t>(lo | (hi << 4));
+  }
+  return outLen;
+}
+
+size_t imaAdpcmDecodeBlock(const uint8_t *block,
+                           size_t blockBytes,
+                           int16_t *pcm,
+                           size_t maxSamples) {
+  if (!block || !pcm || blockBytes < 4 || maxSamples == 0) {
+    return 0;
+  }
+
+  ImaAdpcmState state;
+  state.predictor = static_cast<int16_t>(readLe16(block));
+  state.index = std::min<uint8_t>(block[2], 88);
+
+  size_t produced = 0;
+  pcm[produced++] = state.predictor;
+  for (size_t i = 4; i < blockBytes && produced < maxSamples; ++i) {
+    pcm[produced++] = decodeNibble(block[i] & 0x0F, state);
+    if (produced < maxSamples) {
+      pcm[produced++] = decodeNibble((block[i] >> 4) & 0x0F, state);
+    }
+  }
+  return produced;
+}
+
+uint16_t VoiceWavWriter::headerBytes(VoiceEncoding encoding) {
+  return encoding == VoiceEncoding::ImaAdpcm ? kImaAdpcmWavHeaderBytes : kPcmWavHeaderBytes;
+}
+
+bool VoiceWavWriter::begin(File &file, uint32_t sampleRate, VoiceEncoding encoding) {
+  return begin(&file, sampleRate, encoding, nullptr);
+}
+
+bool VoiceWavWriter::begin(File *file,
+                           uint32_t sampleRate,
+                           VoiceEncoding encoding,
+                           const VoiceWavStreamSink *sink) {
+  if (!file && !(sink && sink->onData)) {
+    return false;
+  }
+  file_ = file;
+  sink_ = sink;
+  encoding_ = encoding;
+  sampleRate_ = sampleRate;
+  adpcm_ = ImaAdpcmState();
+  pendingCount_ = 0;
+  outFill_ = 0;
+  hasCarryByte_ = false;
+  samples_ = 0;
+  dataBytes_ = 0;
+  encodeMicros_ = 0;
+
+  if (encoding_ == VoiceEncoding::ImaAdpcm) {
+    blockAlign_ = imaAdpcmBlockAlign(sampleRate_);
+    samplesPerBlock_ = imaAdpcmSamplesPerBlock(blockAlign_);
+    pendingPcm_.assign(samplesPerBlock_, 0);
+    blockBuf_.assign(blockAlign_, 0);
+  } else {
+    blockAlign_ = 2;
+    samplesPerBlock_ = 1;
+    pendingPcm_.clear();
+    blockBuf_.clear();
+  }
+  out_.assign(kOutputBufferBytes, 0);
+
+  const size_t headerLen = headerBytes(encoding_);
+  if (file_) {
+    uint8_t blank[kImaAdpcmWavHeaderBytes] = {0};
+    if (file_->write(blank, headerLen) != headerLen) {
+      return false;
+    }
+  }
+  if (sink_) {
+    uint8_t header[kImaAdpcmWavHeaderBytes] = {0};
+    buildHeader(header, true);
+    if (!sink_->onData(header, headerLen)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool VoiceWavWriter::writeSamples(const int16_t *samples, size_t count) {
+  if ((!file_ && !sink_) || !samples) {
+    return false;
+  }
+
+  if (encoding_ == VoiceEncoding::Pcm16) {
+    samples_ += static_cast<uint32_t>(count);
+    return emit(reinterpret_cast<const uint8_t *>(samples), count * sizeof(int16_t));
+  }
+
+  while (count > 0) {
+    const size_t take = std::min<size_t>(count, samplesPerBlock_ - pendingCount_);
+    memcpy(pendingPcm_.data() + pendingCount_, samples, take * sizeof(int16_t));
+    pendingCount_ += take;
+    samples += take;
+    count -= take;
+    samples_ += static_cast<uint32_t>(take);
+    if (pendingCount_ == samplesPerBlock_ && !encodePendingBlock()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool VoiceWavWriter::writeSampleBytes(const uint8_t *data, size_t length) {
+  if (!data || length == 0) {
+    return true;
+  }
+
+  if (hasCarryByte_) {
+    const uint8_t pair[2] = {carryByte_, data[0]};
+    int16_t sample = 0;
+    memcpy(&sample, pair, sizeof(sample));
+    hasCarryByte_ = false;
+    if (!writeSamples(&sample, 1)) {
+      return false;
+    }
+    ++data;
+    --length;
+  }
+
+  const size_t whole = length / 2U;
+  if (whole > 0) {
+    if (reinterpret_cast<uintptr_t>(data) % alignof(int16_t) == 0) {
+      if (!writeSamples(reinterpret_cast<const int16_t *>(data), whole)) {
+        return false;
+      }
+    } else {
+      int16_t bounce[64];
+      size_t done = 0;
+      while (done < whole) {
+        const size_t take = std::min<size_t>(whole - done, 64);
+        memcpy(bounce, data + done * 2U, take * sizeof(int16_t));
+        if (!writeSamples(bounce, take)) {
+          return false;
+        }
+        done += take;
+      }
+    }
+  }
+
+  if (length & 1U) {
+    carryByte_ = data[length - 1];
+    hasCarryByte_ = true;
+  }
+  return true;
+}
+
+bool VoiceWavWriter::finish() {
+  if (!file_ && !sink_) {
+    return false;
+  }
+  if (encoding_ == VoiceEncoding::ImaAdpcm && pendingCount_ > 0 && !encodePendingBlock()) {
+    return false;
+  }
+  if (!flushOutput()) {
+    return false;
+  }
+  if (!writeHeader()) {
+    return false;
+  }
+  if (sink_ && sink_->onFinish) {
+    uint8_t header[kImaAdpcmWavHeaderBytes] = {0};
+    const size_t headerLen = buildHeader(header, false);
+    if (!sink_->onFinish(header, headerLen)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+VoiceEncoding VoiceWavWriter::encoding() const {
+  return encoding_;
+}
+
+uint32_t VoiceWavWriter::sampleRate() const {
+  return sampleRate_;
+}
+
+uint32_t VoiceWavWriter::sampleCount() const {
+  return samples_;
+}
+
+uint32_t VoiceWavWriter::dataBytes() const {
+  return dataBytes_ + static_cast<uint32_t>(outFill_);
+}
+
+uint32_t VoiceWavWriter::totalBytes() const {
+  return dataBytes() + headerBytes(encoding_);
+}
+
+uint32_t VoiceWavWriter::encodeMicros() const {
+  return encodeMicros_;
+}
+
+bool VoiceWavWriter::encodePendingBlock() {
+  const uint32_t startUs = micros();
+  const size_t blockLen =
+      imaAdpcmEncodeBlock(pendingPcm_.data(), pendingCount_, adpcm_, blockBuf_.data());
+  encodeMicros_ += micros() - startUs;
+  pendingCount_ = 0;
+  return emit(blockBuf_.data(), blockLen);
+}
+
+bool VoiceWavWriter::emit(const uint8_t *data, size_t length) {
+  while (length > 0) {
+    const size_t take = std::min<size_t>(length, out_.size() - outFill_);
+    memcpy(out_.data() + outFill_, data, take);
+    outFill_ += take;
+    data += take;
+    length -= take;
+    if (outFill_ == out_.size() && !flushOutput()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool VoiceWavWriter::flushOutput() {
+  if (outFill_ == 0) {
+    return true;
+  }
+  if (file_ && file_->write(out_.data(), outFill_) != outFill_) {
+    return false;
+  }
+  if (sink_ && !sink_->onData(out_.data(), outFill_)) {
+    return false;
+  }
+  dataBytes_ += static_cast<uint32_t>(outFill_);
+  outFill_ = 0;
+  return true;
+}
+
+bool VoiceWavWriter::writeHeader() {
+  if (!file_) {
+    return true;
+  }
+  uint8_t header[kImaAdpcmWavHeaderBytes] = {0};
+  const size_t headerLen = buildHeader(header, false);
+  if (!file_->seek(0) || file_->write(header, headerLen) != headerLen) {
+    return false;
+  }
+  file_->flush();
+  return true;
+}
+
+size_t VoiceWavWriter::buildHeader(uint8_t *header, bool streaming) const {
+  const uint16_t headerLen = headerBytes(encoding_);
+  const uint16_t channels = 1;
+  const uint32_t riffBytes = streaming ? kStreamingSizePlaceholder
+                                       : static_cast<uint32_t>(headerLen - 8U) + dataBytes_;
+  const uint32_t dataBytes = streaming ? kStreamingSizePlaceholder : dataBytes_;
+  const uint32_t samples = streaming ? kStreamingSizePlaceholder : samples_;
+
+  writeTag(header, "RIFF");
+  writeLe32(header + 4, riffBytes);
+  writeTag(header + 8, "WAVE");
+  writeTag(header + 12, "fmt ");
+
+  if (encoding_ == VoiceEncoding::ImaAdpcm) {
+    const uint32_t byteRate = static_cast<uint32_t>(
+        (static_cast<uint64_t>(sampleRate_) * blockAlign_) / samplesPerBlock_);
+    writeLe32(header + 16, 20);
+    writeLe16(header + 20, kWavFormatImaAdpcm);
+    writeLe16(header + 22, channels);
+    writeLe32(header + 24, sampleRate_);
+    writeLe32(header + 28, byteRate);
+    writeLe16(header + 32, blockAlign_);
+    writeLe16(header + 34, 4);
+    writeLe16(header + 36, 2);  // cbSize
+    writeLe16(header + 38, samplesPerBlock_);
+    // Non-PCM WAV requires a fact chunk with the decoded sample count.
+    writeTag(header + 40, "fact");
+    writeLe32(header + 44, 4);
+    writeLe32(header + 48, samples);
+    writeTag(header + 52, "data");
+    writeLe32(header + 56, dataBytes);
+  } else {
+    writeLe32(header + 16, 16);
+    writeLe16(header + 20, kWavFormatPcm);
+    writeLe16(header + 22, channels);
+    writeLe32(header + 24, sampleRate_);
+    writeLe32(header + 28, sampleRate_ * 2U);
+    writeLe16(header + 32, 2);
+    writeLe16(header + 34, 16);
+    writeTag(header + 36, "data");
+    writeLe32(header + 40, dataBytes);
+  }
+
+  return headerLen;
+}
+
+bool readWavInfo(File &file, WavInfo &out) {
+  out = WavInfo();
+  uint8_t riff[12] = {0};
+  if (!file.seek(0) || file.read(riff, sizeof(riff)) != sizeof(riff)) {
+    return false;
+  }
+  if (memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+    return false;
+  }
+
+  bool haveFmt = false;
+  uint32_t offset = sizeof(riff);
+  const uint32_t fileSize = static_cast<uint32_t>(file.size());
+  while (offset + 8U <= fileSize) {
+    uint8_t chunk[8] = {0};
+    if (!file.seek(offset) || file.read(chunk, sizeof(chunk)) != sizeof(chunk)) {
+      return false;
+    }
+    const uint32_t chunkSize = readLe32(chunk + 4);
+    const uint32_t body = offset + 8U;
+
+    if (memcmp(chunk, "fmt ", 4) == 0) {
+      uint8_t fmt[20] = {0};
+      const size_t fmtLen = std::min<size_t>(chunkSize, sizeof(fmt));
+      if (fmtLen < 16 || file.read(fmt, fmtLen) != fmtLen) {
+        return false;
+      }
+      out.formatTag = readLe16(fmt);
+      out.channels = readLe16(fmt + 2);
+      out.sampleRate = readLe32(fmt + 4);
+      out.blockAlign = readLe16(fmt + 12);
+      out.bitsPerSample = readLe16(fmt + 14);
+      if (fmtLen >= 20) {
+        out.samplesPerBlock = readLe16(fmt + 18);
+      }
+      haveFmt = true;
+    } else if (memcmp(chunk, "data", 4) == 0) {
+      out.dataOffset = body;
+      out.dataBytes = std::min<uint32_t>(chunkSize, fileSize - body);
+      return haveFmt;
+    }
+
+    // A size past the end would wrap offset around and loop forever.
+    if (chunkSize > fileSize - body) {
+      return false;
+    }
+    offset = body + chunkSize + (chunkSize & 1U);
+  }
+  return false;
+}
+
+bool readWavInfo(const String &path, WavInfo &out) {
+  File file = SD.open(path.c_str(), FILE_READ);
+  if (!file || file.isDirectory()) {
+    if (file) {
+      file.close();
+    }
+    return false;
+  }
+  const bool ok = readWavInfo(file, out);
+  file.close();
+  return ok;
+}
+
+bool isImaAdpcmWavFile(const String &path) {
+  WavInfo info;
+  return readWavInfo(path, info) && info.formatTag == kWavFormatImaAdpcm;
+}
+
+bool decodeImaAdpcmWavToPcm(const String &srcPath,
+                            const String &dstPath,
+                            const std::function<void()> &backgroundTick,
+                            String *error) {
+  File src = SD.open(srcPath.c_str(), FILE_READ);
+  if (!src || src.isDirectory()) {
+    if (src) {
+      src.close();
+    }
+    setError(error, "Audio open failed");
+    return false;
+  }
+
+  WavInfo info;
+  if (!readWavInfo(src, info) || info.formatTag != kWavFormatImaAdpcm) {
+    src.close();
+    setError(error, "Not an IMA-ADPCM WAV");
+    return false;
+  }
+  if (info.channels != 1 || info.blockAlign <= 4U) {
+    src.close();
+    setError(error, "Unsupported ADPCM layout");
+    return false;
+  }
+  const uint16_t samplesPerBlock = info.samplesPerBlock > 0
+                                       ? info.samplesPerBlock
+                                       : imaAdpcmSamplesPerBlock(info.blockAlign);
+
+  if (SD.exists(dstPath.c_str())) {
+    SD.remove(dstPath.c_str());
+  }
+  dirlisting::noteChanged(dstPath);
+  File dst = SD.open(dstPath.c_str(), FILE_WRITE);
+  if (!dst || dst.isDirectory()) {
+    if (dst) {
+      dst.close();
+    }
+    src.close();
+    setError(error, "Decode target open failed");
+    return false;
+  }
+
+  VoiceWavWriter writer;
+  std::vector<uint8_t> block(info.blockAlign, 0);
+  std::vector<int16_t> pcm(samplesPerBlock, 0);
+  bool ok = writer.begin(dst, info.sampleRate, VoiceEncoding::Pcm16) &&
+            src.seek(info.dataOffset);
+
+  uint32_t remaining = info.dataBytes;
+  uint16_t blocksSinceTick = 0;
+  while (ok && remaining > 0) {
+    const size_t want = std::min<uint32_t>(remaining, info.blockAlign);
+    const size_t got = src.read(block.data(), want);
+    if (got < 4) {
+      break;
+    }
+    remaining -= static_cast<uint32_t>(got);
+    const size_t samples = imaAdpcmDecodeBlock(block.data(), got, pcm.data(), pcm.size());
+    ok = writer.writeSamples(pcm.data(), samples);
+
+    if (backgroundTick && ++blocksSinceTick >= 32U) {
+      blocksSinceTick = 0;
+      backgroundTick();
+    }
+  }
+  src.close();
+
+  ok = ok && writer.finish();
+  dst.close();
+  if (!ok) {
+    SD.remove(dstPath.c_str());
+    setError(error, "ADPCM decode failed");
+    return false;
+  }
+  setError(error, "");
+  return true;
+}
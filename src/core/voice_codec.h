@@ -0,0 +1,124 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include <functional>
+#include <vector>
+
+enum class VoiceEncoding : uint8_t {
+  Pcm16 = 0,
+  ImaAdpcm = 1,
+};
+
+constexpr uint16_t kWavFormatPcm = 0x0001;
+constexpr uint16_t kWavFormatImaAdpcm = 0x0011;
+
+const char *voiceEncodingName(VoiceEncoding encoding);
+
+// IMA/DVI ADPCM (WAVE_FORMAT_IMA_ADPCM) mono codec, 4 bits per sample.
+struct ImaAdpcmState {
+  int16_t predictor = 0;
+  uint8_t index = 0;
+};
+
+uint16_t imaAdpcmBlockAlign(uint32_t sampleRate);
+uint16_t imaAdpcmSamplesPerBlock(uint16_t blockAlign);
+
+// Encodes up to samplesPerBlock samples into one WAV block (4-byte header +
+// packed nibbles). Returns the block size in bytes; a short final block is
+// padded to a whole byte.
+size_t imaAdpcmEncodeBlock(const int16_t *pcm,
+                           size_t count,
+                           ImaAdpcmState &state,
+                           uint8_t *out);
+
+// Decodes one WAV block. Returns the number of samples written to pcm.
+size_t imaAdpcmDecodeBlock(const uint8_t *block,
+                           size_t blockBytes,
+                           int16_t *pcm,
+                           size_t maxSamples);
+
+// Receives encoded WAV bytes as the writer flushes them, so a recording can
+// be uploaded while capture is still running. The streamed header carries
+// placeholder sizes (0xFFFFFFFF); onFinish gets the final header.
+struct VoiceWavStreamSink {
+  std::function<bool(const uint8_t *data, size_t length)> onData;
+  std::function<bool(const uint8_t *header, size_t length)> onFinish;
+};
+
+// Streams mono 16-bit samples into a WAV file, either as raw PCM or as
+// IMA-ADPCM encoded inline. Output goes to SD in large buffered writes and
+// the header is patched with final sizes by finish(). The file may be null
+// when a stream sink is given (stream-only recording).
+class VoiceWavWriter {
+ public:
+  static constexpr size_t kMaxHeaderBytes = 60;
+
+  bool begin(File &file, uint32_t sampleRate, VoiceEncoding encoding);
+  bool begin(File *file,
+             uint32_t sampleRate,
+             VoiceEncoding encoding,
+             const VoiceWavStreamSink *sink);
+  bool writeSamples(const int16_t *samples, size_t count);
+  // Accepts little-endian PCM16 bytes; an odd trailing byte is carried over
+  // to the next call.
+  bool writeSampleBytes(const uint8_t *data, size_t length);
+  bool finish();
+
+  VoiceEncoding encoding() const;
+  uint32_t sampleRate() const;
+  uint32_t sampleCount() const;
+  uint32_t dataBytes() const;
+  uint32_t totalBytes() const;
+  uint32_t encodeMicros() const;
+
+  static uint16_t headerBytes(VoiceEncoding encoding);
+
+ private:
+  bool encodePendingBlock();
+  bool emit(const uint8_t *data, size_t length);
+  bool flushOutput();
+  bool writeHeader();
+  size_t buildHeader(uint8_t *header, bool streaming) const;
+
+  File *file_ = nullptr;
+  const VoiceWavStreamSink *sink_ = nullptr;
+  VoiceEncoding encoding_ = VoiceEncoding::Pcm16;
+  uint32_t sampleRate_ = 0;
+  uint16_t blockAlign_ = 0;
+  uint16_t samplesPerBlock_ = 0;
+  ImaAdpcmState adpcm_;
+  std::vector<int16_t> pendingPcm_;
+  size_t pendingCount_ = 0;
+  std::vector<uint8_t> blockBuf_;
+  std::vector<uint8_t> out_;
+  size_t outFill_ = 0;
+  uint8_t carryByte_ = 0;
+  bool hasCarryByte_ = false;
+  uint32_t samples_ = 0;
+  uint32_t dataBytes_ = 0;
+  uint32_t encodeMicros_ = 0;
+};
+
+struct WavInfo {
+  uint16_t formatTag = 0;
+  uint16_t channels = 0;
+  uint32_t sampleRate = 0;
+  uint16_t blockAlign = 0;
+  uint16_t bitsPerSample = 0;
+  uint16_t samplesPerBlock = 0;
+  uint32_t dataOffset = 0;
+  uint32_t dataBytes = 0;
+};
+
+bool readWavInfo(File &file, WavInfo &out);
+bool readWavInfo(const String &path, WavInfo &out);
+bool isImaAdpcmWavFile(const String &path);
+
+// Expands a mono IMA-ADPCM WAV into a PCM16 WAV (for players that only
+// understand PCM).
+bool decodeImaAdpcmWavToPcm(const String &srcPath,
+                            const String &dstPath,
+                            const std::function<void()> &backgroundTick,
+                            String *error = nullptr);
@@ -4,6 +4,8 @@
 
 #include <algorithm>
 
+#include "user_config.h"
+
 namespace {
 
 constexpr unsigned long kConnectRetryMs = 3500UL;
@@ -24,7 +26,7 @@ void WifiManager::begin() {
   WiFi.persistent(false);
   WiFi.mode(WIFI_STA);
   WiFi.setAutoReconnect(true);
-  WiFi.setSleep(false);
+  WiFi.setSleep(USER_WIFI_MODEM_SLEEP ? true : false);
   connectInProgress_ = false;
   connectStartedMs_ = 0;
   lastError_ = "";
@@ -94,6 +94,15 @@
 #ifndef HAL_DISPLAY_ROTATION
   #define HAL_DISPLAY_ROTATION 3
 #endif
+// LVGL partial draw buffer height in lines (two buffers are allocated).
+#ifndef HAL_DISPLAY_BUFFER_LINES
+  #define HAL_DISPLAY_BUFFER_LINES 24
+#endif
+// Flush through TFT_eSPI DMA so LVGL renders the next band while the
+// previous one is on the bus. Buffers then come from internal DMA memory.
+#ifndef HAL_DISPLAY_DMA
+  #define HAL_DISPLAY_DMA 1
+#endif
 
 // SPI bus defaults (board must override if it has SPI peripherals)
 #ifndef HAL_SPI_SCK
@@ -29,6 +29,7 @@
 #define HAL_DISPLAY_WIDTH     240
 #define HAL_DISPLAY_HEIGHT    135
 #define HAL_DISPLAY_ROTATION  1
+#define HAL_DISPLAY_BUFFER_LINES 27
 #define HAL_PIN_TFT_CS        37
 #define HAL_PIN_TFT_DC        34
 #define HAL_PIN_TFT_RST       33
@@ -28,6 +28,7 @@
 #define HAL_DISPLAY_WIDTH     320
 #define HAL_DISPLAY_HEIGHT    240
 #define HAL_DISPLAY_ROTATION  1
+#define HAL_DISPLAY_BUFFER_LINES 20
 #define HAL_PIN_TFT_CS        15
 #define HAL_PIN_TFT_DC        2
 #define HAL_PIN_TFT_RST       -1
@@ -33,6 +33,7 @@
 #define HAL_DISPLAY_WIDTH     320
 #define HAL_DISPLAY_HEIGHT    240
 #define HAL_DISPLAY_ROTATION  1
+#define HAL_DISPLAY_BUFFER_LINES 24
 #define HAL_PIN_TFT_CS        12
 #define HAL_PIN_TFT_DC        11
 #define HAL_PIN_TFT_RST       -1
@@ -30,6 +30,7 @@
 #define HAL_DISPLAY_WIDTH     170
 #define HAL_DISPLAY_HEIGHT    320
 #define HAL_DISPLAY_ROTATION  3
+#define HAL_DISPLAY_BUFFER_LINES 24
 #define HAL_PIN_TFT_CS        41
 #define HAL_PIN_TFT_DC        16
 #define HAL_PIN_TFT_RST       40
@@ -18,9 +18,15 @@
 #include "core/cc1101_radio.h"
 #include "core/ble_manager.h"
 #include "core/board_pins.h"
+#include "core/chat_history.h"
 #include "core/gateway_client.h"
+#include "core/message_outbox.h"
 #include "core/node_command_handler.h"
+#include "core/perf_profiler.h"
+#include "core/power_manager.h"
 #include "core/runtime_config.h"
+#include "core/sd_bench.h"
+#include "core/shared_i2c_bus.h"
 #include "core/wifi_manager.h"
 #include "ui/i18n.h"
 #include "ui/ui_navigator.h"
@@ -225,15 +231,42 @@ void tickDeepSleepButton() {}
 
 void runBackgroundTick() {
   tickDeepSleepButton();
-  tickRamWatchdog();
-  gWifi.tick();
-  gGateway.tick();
-  gBle.tick();
+  {
+    PERF_SCOPE(perf::Component::RamWatchdog);
+    tickRamWatchdog();
+  }
+  {
+    PERF_SCOPE(perf::Component::Wifi);
+    gWifi.tick();
+  }
+  {
+    PERF_SCOPE(perf::Component::Gateway);
+    gGateway.tick();
+    outbox::tick(gGateway);
+    chathistory::tick(gGateway);
+  }
+  // Deferred node commands (sd.bench); see runTopLevelTick().
+  gNodeHandler.tick();
+  {
+    PERF_SCOPE(perf::Component::Ble);
+    gBle.tick();
+  }
 #if HAL_HAS_DISPLAY
-  gUiRuntime.tick();
+  {
+    PERF_SCOPE(perf::Component::UiTick);
+    gUiRuntime.tick();
+  }
 #endif
 }
 
+// Background tick for the launcher menu and the headless loop. No app is
+// running there, so no SD file is held open and sd.bench may remount the card.
+void runTopLevelTick() {
+  gNodeHandler.setAtTopLevel(true);
+  runBackgroundTick();
+  gNodeHandler.setAtTopLevel(false);
+}
+
 void configureGatewayCallbacks() {
   gGateway.setInvokeRequestHandler([](const String &invokeId,
                                       const String &nodeId,
@@ -266,6 +299,7 @@ void initBoardPower() {
 #endif
 
 #if HAL_HAS_PMU && defined(HAL_I2C_SDA) && HAL_I2C_SDA >= 0
+  sharedi2c::Guard i2c;
   Wire.begin(HAL_I2C_SDA, HAL_I2C_SCL);
   if (gPmu.init(Wire, HAL_I2C_SDA, HAL_I2C_SCL, BQ25896_SLAVE_ADDRESS)) {
     gPmu.resetDefault();
@@ -320,6 +354,8 @@ void setup() {
   digitalWrite(boardpins::kCc1101Cs, HIGH);
 #endif
 
+  // Before initBoardPower(): the backlight LEDC clock is chosen on first use.
+  powermgr::begin();
   initBoardPower();
 
 #if HAL_HAS_DISPLAY
@@ -379,11 +415,29 @@ void setup() {
   gGateway.begin();
   gGateway.configure(gAppContext.config);
   configureGatewayCallbacks();
+  outbox::begin();
+  outbox::setSettledListener([](const outbox::Entry &entry) {
+    chathistory::setDelivery(entry.sessionKey,
+                             entry.id,
+                             entry.state == outbox::State::Sent ? chathistory::Delivery::Sent
+                                                                : chathistory::Delivery::Failed);
+  });
 
   gBle.configure(gAppContext.config);
   gBle.begin();
 
   gNodeHandler.setGatewayClient(&gGateway);
+#if HAL_HAS_DISPLAY
+  gNodeHandler.setBenchServiceTick([]() { gUiRuntime.tick(); });
+  sdbench::setRemountHook([](bool mounted) {
+    if (mounted) {
+      gUiRuntime.reloadSdFont();
+    } else {
+      gUiRuntime.releaseSdFont();
+    }
+  });
+  sdbench::setBeforePhaseHook([]() { gUiRuntime.finishPendingFlush(); });
+#endif
 
   gAppContext.wifi = &gWifi;
   gAppContext.gateway = &gGateway;
@@ -414,10 +468,10 @@ void setup() {
 
 void loop() {
 #if HAL_HAS_DISPLAY
-  gUiNav.runLauncher(gAppContext, runBackgroundTick);
+  gUiNav.runLauncher(gAppContext, runBackgroundTick, runTopLevelTick);
 #else
   // Headless mode: just run background services.
-  runBackgroundTick();
+  runTopLevelTick();
   delay(10);
 #endif
 }
@@ -0,0 +1,464 @@
+#include "image_cache.h"
+
+#include <SD.h>
+#include <esp_heap_caps.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+#if LV_USE_TJPGD
+#include <src/libs/tjpgd/tjpgd.h>
+#endif
+
+#include "user_config.h"
+
+namespace {
+
+// TJpgDec pool; 3100 B is the documented minimum, LVGL's decoder uses 4 KB.
+constexpr size_t kJpegWorkBytes = 4096;
+constexpr size_t kCacheEntries = USER_IMAGE_VIEWER_CACHE_ENTRIES;
+#if LV_USE_TJPGD && JD_USE_SCALE
+constexpr uint8_t kMaxJpegScale = 3;  // 1/8
+#else
+constexpr uint8_t kMaxJpegScale = 0;
+#endif
+
+struct Entry {
+  String path;
+  time_t mtime = 0;
+  size_t fileSize = 0;
+  uint16_t fitW = 0;
+  uint16_t fitH = 0;
+  lv_image_dsc_t image = {};
+  uint16_t *pixels = nullptr;
+  imagecache::DecodeInfo info;
+  uint32_t lastUse = 0;
+};
+
+Entry gEntries[kCacheEntries];
+uint32_t gUseCounter = 0;
+
+// Lowest free heap seen while one decode runs.
+class PeakTracker {
+ public:
+  PeakTracker() : startFree_(freeBytes()), minFree_(startFree_) {}
+
+  void sample() {
+    const size_t now = freeBytes();
+    if (now < minFree_) {
+      minFree_ = now;
+    }
+  }
+
+  uint32_t peakBytes() const {
+    return static_cast<uint32_t>(startFree_ - minFree_);
+  }
+
+ private:
+  static size_t freeBytes() {
+    return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  }
+
+  size_t startFree_;
+  size_t minFree_;
+};
+
+// Where decoded pixels go: every step-th source pixel of every step-th row.
+struct Target {
+  File *file = nullptr;
+  uint16_t *pixels = nullptr;
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint16_t step = 1;
+  bool inPsram = false;
+  PeakTracker *peak = nullptr;
+};
+
+bool psramAvailable() {
+#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
+  return psramFound();
+#else
+  return false;
+#endif
+}
+
+void releaseEntry(Entry &entry) {
+  if (entry.pixels) {
+    lv_image_cache_drop(&entry.image);
+    heap_caps_free(entry.pixels);
+  }
+  entry = Entry();
+}
+
+uint16_t *allocatePixels(size_t pixels, bool *inPsram) {
+  void *ptr = nullptr;
+#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
+  if (psramAvailable()) {
+    ptr = ps_malloc(pixels * sizeof(uint16_t));
+  }
+#endif
+  *inPsram = ptr != nullptr;
+  if (!ptr) {
+    ptr = heap_caps_malloc(pixels * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  return static_cast<uint16_t *>(ptr);
+}
+
+// Retries once after dropping every other cached image.
+uint16_t *allocatePixelsEvicting(size_t pixels, const Entry &keep, bool *inPsram) {
+  uint16_t *ptr = allocatePixels(pixels, inPsram);
+  if (ptr) {
+    return ptr;
+  }
+  for (Entry &entry : gEntries) {
+    if (&entry != &keep) {
+      releaseEntry(entry);
+    }
+  }
+  return allocatePixels(pixels, inPsram);
+}
+
+uint16_t toRgb565(uint8_t r, uint8_t g, uint8_t b) {
+  return static_cast<uint16_t>(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+// Smallest subsampling step that brings w x h within maxPixels.
+uint16_t stepFor(uint32_t w, uint32_t h, uint32_t maxPixels) {
+  uint16_t step = 1;
+  while (((w + step - 1) / step) * ((h + step - 1) / step) > maxPixels) {
+    ++step;
+  }
+  return step;
+}
+
+uint32_t maxDecodedPixels(uint16_t fitW, uint16_t fitH) {
+  // Without PSRAM the decoded image comes out of internal RAM, so it is kept
+  // to about one screen.
+  return psramAvailable() ? USER_IMAGE_VIEWER_MAX_PIXELS
+                          : static_cast<uint32_t>(fitW) * fitH;
+}
+
+bool allocateTarget(Target &target,
+                    uint32_t srcW,
+                    uint32_t srcH,
+                    uint32_t maxPixels,
+                    const Entry &slot,
+                    String *error) {
+  target.step = stepFor(srcW, srcH, maxPixels);
+  target.width = static_cast<uint16_t>((srcW + target.step - 1) / target.step);
+  target.height = static_cast<uint16_t>((srcH + target.step - 1) / target.step);
+  const size_t pixels = static_cast<size_t>(target.width) * target.height;
+  target.pixels = allocatePixelsEvicting(pixels, slot, &target.inPsram);
+  if (!target.pixels) {
+    if (error) {
+      *error = "Out of memory for image";
+    }
+    return false;
+  }
+  memset(target.pixels, 0, pixels * sizeof(uint16_t));
+  return true;
+}
+
+#if LV_USE_TJPGD
+size_t jpegInput(JDEC *jd, uint8_t *buf, size_t len) {
+  Target *target = static_cast<Target *>(jd->device);
+  if (!buf) {
+    return target->file->seek(target->file->position() + len) ? len : 0;
+  }
+  return target->file->read(buf, len);
+}
+
+int jpegOutput(JDEC *jd, void *bitmap, JRECT *rect) {
+  Target *target = static_cast<Target *>(jd->device);
+  const uint16_t step = target->step;
+  const uint32_t rectW = static_cast<uint32_t>(rect->right - rect->left + 1);
+  const uint16_t firstX = static_cast<uint16_t>(rect->left + (step - rect->left % step) % step);
+  for (uint16_t y = rect->top; y <= rect->bottom; ++y) {
+    const uint16_t outY = y / step;
+    if (y % step != 0 || outY >= target->height) {
+      continue;
+    }
+    uint16_t *out = target->pixels + static_cast<size_t>(outY) * target->width;
+    const uint32_t rowStart = static_cast<uint32_t>(y - rect->top) * rectW;
+    for (uint16_t x = firstX; x <= rect->right; x += step) {
+      const uint16_t outX = x / step;
+      if (outX >= target->width) {
+        break;
+      }
+      const uint32_t i = rowStart + (x - rect->left);
+#if JD_FORMAT == 1
+      out[outX] = static_cast<const uint16_t *>(bitmap)[i];
+#elif JD_FORMAT == 2
+      const uint8_t l = static_cast<const uint8_t *>(bitmap)[i];
+      out[outX] = toRgb565(l, l, l);
+#else
+      const uint8_t *px = static_cast<const uint8_t *>(bitmap) + i * 3U;
+      out[outX] = toRgb565(px[0], px[1], px[2]);
+#endif
+    }
+  }
+  if (rect->left == 0) {
+    target->peak->sample();
+  }
+  return 1;
+}
+#endif  // LV_USE_TJPGD
+
+bool decodeJpeg(File &file,
+                Entry &slot,
+                uint16_t fitW,
+                uint16_t fitH,
+                Target &target,
+                String *error) {
+#if LV_USE_TJPGD
+  target.file = &file;
+  void *work = heap_caps_malloc(kJpegWorkBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!work) {
+    if (error) {
+      *error = "Out of memory for JPEG decoder";
+    }
+    return false;
+  }
+
+  JDEC jd;
+  JRESULT res = jd_prepare(&jd, jpegInput, work, kJpegWorkBytes, &target);
+  if (res != JDR_OK) {
+    heap_caps_free(work);
+    if (error) {
+      // JDR_FMT3 is what progressive and arithmetic-coded files give.
+      *error = res == JDR_FMT3 ? "Progressive JPEG not supported" : "JPEG decode failed";
+    }
+    return false;
+  }
+  slot.info.sourceW = jd.width;
+  slot.info.sourceH = jd.height;
+
+  // Largest TJpgDec reduction that still covers the viewport, so 1:1 view
+  // has detail to pan over and fit view only ever scales down.
+  uint8_t scale = kMaxJpegScale;
+  while (scale > 0 && ((jd.width >> scale) < fitW || (jd.height >> scale) < fitH)) {
+    --scale;
+  }
+  const uint32_t scaledW = std::max<uint32_t>(1U, jd.width >> scale);
+  const uint32_t scaledH = std::max<uint32_t>(1U, jd.height >> scale);
+  if (!allocateTarget(target, scaledW, scaledH, maxDecodedPixels(fitW, fitH), slot, error)) {
+    heap_caps_free(work);
+    return false;
+  }
+  target.peak->sample();
+
+  res = jd_decomp(&jd, jpegOutput, scale);
+  heap_caps_free(work);
+  if (res != JDR_OK) {
+    heap_caps_free(target.pixels);
+    target.pixels = nullptr;
+    if (error) {
+      *error = "JPEG decode failed";
+    }
+    return false;
+  }
+  slot.info.reduction = static_cast<uint16_t>((1U << scale) * target.step);
+  return true;
+#else
+  (void)file;
+  (void)slot;
+  (void)fitW;
+  (void)fitH;
+  (void)target;
+  if (error) {
+    *error = "JPEG support disabled";
+  }
+  return false;
+#endif  // LV_USE_TJPGD
+}
+
+// Any other format LVGL can decode into one buffer (PNG). Formats LVGL only
+// decodes line by line (BMP) are reported as unsupported here.
+bool decodeWithLvgl(const String &sdPath,
+                    Entry &slot,
+                    uint16_t fitW,
+                    uint16_t fitH,
+                    Target &target,
+                    String *error) {
+  const String lvPath = String("S:") + (sdPath.startsWith("/") ? "" : "/") + sdPath;
+  lv_image_decoder_args_t args;
+  memset(&args, 0, sizeof(args));
+  args.no_cache = true;
+  lv_image_decoder_dsc_t dsc;
+  if (lv_image_decoder_open(&dsc, lvPath.c_str(), &args) != LV_RESULT_OK) {
+    if (error) {
+      *error = "Unsupported image format";
+    }
+    return false;
+  }
+  target.peak->sample();
+
+  const lv_draw_buf_t *decoded = dsc.decoded;
+  const lv_color_format_t cf = decoded ? static_cast<lv_color_format_t>(decoded->header.cf)
+                                       : LV_COLOR_FORMAT_UNKNOWN;
+  if (!decoded || (cf != LV_COLOR_FORMAT_ARGB8888 && cf != LV_COLOR_FORMAT_XRGB8888 &&
+                   cf != LV_COLOR_FORMAT_RGB888 && cf != LV_COLOR_FORMAT_RGB565)) {
+    lv_image_decoder_close(&dsc);
+    if (error) {
+      *error = "Format needs streaming decode";
+    }
+    return false;
+  }
+
+  const uint32_t srcW = decoded->header.w;
+  const uint32_t srcH = decoded->header.h;
+  slot.info.sourceW = srcW;
+  slot.info.sourceH = srcH;
+  if (!allocateTarget(target, srcW, srcH, maxDecodedPixels(fitW, fitH), slot, error)) {
+    lv_image_decoder_close(&dsc);
+    return false;
+  }
+  target.peak->sample();
+
+  const uint32_t bpp = lv_color_format_get_size(cf);
+  for (uint16_t outY = 0; outY < target.height; ++outY) {
+    const uint8_t *row = decoded->data +
+                         static_cast<size_t>(outY) * target.step * decoded->header.stride;
+    uint16_t *out = target.pixels + static_cast<size_t>(outY) * target.width;
+    for (uint16_t outX = 0; outX < target.width; ++outX) {
+      const uint8_t *px = row + static_cast<size_t>(outX) * target.step * bpp;
+      if (cf == LV_COLOR_FORMAT_RGB565) {
+        out[outX] = *reinterpret_cast<const uint16_t *>(px);
+      } else if (cf == LV_COLOR_FORMAT_ARGB8888) {
+        // B, G, R, A; blended onto the viewer's black background.
+        const uint16_t a = px[3];
+        out[outX] = toRgb565(static_cast<uint8_t>(px[2] * a / 255U),
+                             static_cast<uint8_t>(px[1] * a / 255U),
+                             static_cast<uint8_t>(px[0] * a / 255U));
+      } else {
+        out[outX] = toRgb565(px[2], px[1], px[0]);
+      }
+    }
+  }
+  lv_image_decoder_close(&dsc);
+  slot.info.reduction = target.step;
+  return true;
+}
+
+bool isJpeg(File &file) {
+  uint8_t magic[2] = {0, 0};
+  const bool ok = file.read(magic, sizeof(magic)) == sizeof(magic) && file.seek(0);
+  return ok && magic[0] == 0xFF && magic[1] == 0xD8;
+}
+
+Entry &slotFor(const String &path) {
+  // A stale copy of the same file is replaced first, then an empty slot,
+  // then the least recently used one.
+  for (Entry &entry : gEntries) {
+    if (entry.pixels && entry.path == path) {
+      return entry;
+    }
+  }
+  Entry *oldest = &gEntries[0];
+  for (Entry &entry : gEntries) {
+    if (!entry.pixels) {
+      return entry;
+    }
+    if (entry.lastUse < oldest->lastUse) {
+      oldest = &entry;
+    }
+  }
+  return *oldest;
+}
+
+}  // namespace
+
+namespace imagecache {
+
+const lv_image_dsc_t *load(const String &sdPath,
+                           uint16_t fitW,
+                           uint16_t fitH,
+                           DecodeInfo *info,
+                           String *error) {
+  const uint32_t startMs = millis();
+  File file = SD.open(sdPath.c_str(), FILE_READ);
+  if (!file || file.isDirectory()) {
+    if (file) {
+      file.close();
+    }
+    if (error) {
+      *error = "File open failed";
+    }
+    return nullptr;
+  }
+  const time_t mtime = file.getLastWrite();
+  const size_t fileSize = file.size();
+
+  for (Entry &entry : gEntries) {
+    if (entry.pixels && entry.path == sdPath && entry.mtime == mtime &&
+        entry.fileSize == fileSize && entry.fitW == fitW && entry.fitH == fitH) {
+      file.close();
+      entry.lastUse = ++gUseCounter;
+      if (info) {
+        *info = entry.info;
+        info->cacheHit = true;
+        info->openMs = millis() - startMs;
+      }
+      return &entry.image;
+    }
+  }
+
+  if (!persistent()) {
+    // Internal RAM only holds the image being shown.
+    clear();
+  }
+  Entry &slot = slotFor(sdPath);
+  releaseEntry(slot);
+
+  PeakTracker peak;
+  Target target;
+  target.peak = &peak;
+  const bool ok = isJpeg(file) ? decodeJpeg(file, slot, fitW, fitH, target, error)
+                               : decodeWithLvgl(sdPath, slot, fitW, fitH, target, error);
+  file.close();
+  if (!ok) {
+    slot = Entry();
+    return nullptr;
+  }
+
+  slot.path = sdPath;
+  slot.mtime = mtime;
+  slot.fileSize = fileSize;
+  slot.fitW = fitW;
+  slot.fitH = fitH;
+  slot.pixels = target.pixels;
+  slot.lastUse = ++gUseCounter;
+
+  slot.image.header.magic = LV_IMAGE_HEADER_MAGIC;
+  slot.image.header.cf = LV_COLOR_FORMAT_RGB565;
+  slot.image.header.w = target.width;
+  slot.image.header.h = target.height;
+  slot.image.header.stride = static_cast<uint32_t>(target.width) * 2U;
+  slot.image.data_size = static_cast<uint32_t>(target.width) * target.height * 2U;
+  slot.image.data = reinterpret_cast<const uint8_t *>(target.pixels);
+
+  slot.info.width = target.width;
+  slot.info.height = target.height;
+  slot.info.openMs = millis() - startMs;
+  slot.info.peakBytes = peak.peakBytes();
+  slot.info.cachedBytes = slot.image.data_size;
+  slot.info.cacheHit = false;
+  slot.info.inPsram = target.inPsram;
+  if (info) {
+    *info = slot.info;
+  }
+  return &slot.image;
+}
+
+void clear() {
+  for (Entry &entry : gEntries) {
+    releaseEntry(entry);
+  }
+}
+
+bool persistent() {
+  return psramAvailable();
+}
+
+}  // namespace imagecache
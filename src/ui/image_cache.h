@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+// Decodes SD images once into RGB565 buffers sized for the screen and keeps
+// the last few (keyed by path and mtime) for instant reopening. JPEGs are
+// scaled by TJpgDec while decoding (1/2, 1/4, 1/8); other formats go through
+// the LVGL decoder at full size and are downsampled afterwards.
+namespace imagecache {
+
+struct DecodeInfo {
+  uint32_t sourceW = 0;
+  uint32_t sourceH = 0;
+  uint16_t width = 0;  // cached image
+  uint16_t height = 0;
+  // Source pixels per cached pixel (TJpgDec scale times subsampling step).
+  uint16_t reduction = 1;
+  uint32_t openMs = 0;
+  // Heap drop at the worst point of decoding (work buffers, LVGL decoder
+  // output and the cached image itself).
+  uint32_t peakBytes = 0;
+  uint32_t cachedBytes = 0;
+  bool cacheHit = false;
+  bool inPsram = false;
+};
+
+// Cached image for an SD path, decoded so it still covers fitW x fitH at 1:1
+// where the source allows. The pointer stays valid until the next load() or
+// clear(). Returns nullptr with *error set when the file cannot be decoded.
+const lv_image_dsc_t *load(const String &sdPath,
+                           uint16_t fitW,
+                           uint16_t fitH,
+                           DecodeInfo *info,
+                           String *error = nullptr);
+// Frees every cached image.
+void clear();
+// True when images are cached in PSRAM and worth keeping between views.
+bool persistent();
+
+}  // namespace imagecache
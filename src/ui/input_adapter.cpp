@@ -1,6 +1,10 @@
 #include "input_adapter.h"
 
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+
 #include "../core/board_pins.h"
+#include "../core/ui_events.h"
 #include "../hal/board_config.h"
 #include "user_config.h"
 
@@ -23,6 +27,36 @@ constexpr unsigned long kLongPressMs = 750UL;
 constexpr unsigned long kPinRefreshMs = 1000UL;
 constexpr unsigned long kTraceHeartbeatMs = 1500UL;
 
+// PCNT decodes every quadrature edge (x4); the encoder latches every second
+// transition, matching RotaryEncoder::LatchMode::TWO03.
+constexpr int kPcntCountsPerStep = 2;
+constexpr int kPcntLimit = 10000;
+// Pulses shorter than this are dropped by the PCNT input filter (the filter
+// tops out at 1023 APB cycles, ~12.7 us at 80 MHz).
+constexpr uint32_t kEncoderGlitchNs = 10000U;
+
+// Calls fn(pin) once for every GPIO the adapter reads.
+template <typename Fn>
+void forEachInputPin(Fn fn) {
+  (void)fn;
+#if HAL_HAS_ENCODER
+  fn(kPinEncoderA);
+  fn(kPinEncoderB);
+#endif
+#if defined(HAL_PIN_BTN_OK) && HAL_PIN_BTN_OK >= 0
+  fn(kPinOk);
+#elif defined(HAL_HAS_TRACKBALL) && HAL_HAS_TRACKBALL
+  fn(boardpins::kTrackballClick);
+#endif
+#if defined(HAL_PIN_BTN_BACK) && HAL_PIN_BTN_BACK >= 0
+  fn(kPinBack);
+#endif
+#if !HAL_HAS_ENCODER && defined(HAL_HAS_TRACKBALL) && HAL_HAS_TRACKBALL
+  fn(boardpins::kTrackballUp);
+  fn(boardpins::kTrackballDown);
+#endif
+}
+
 uint8_t saturatingInc(uint8_t value) {
   if (value == 0xFFU) {
     return value;
@@ -42,17 +76,11 @@ InputAdapter::InputAdapter()
 #endif
 
 void InputAdapter::begin(lv_display_t *display) {
-#if HAL_HAS_ENCODER
-  pinMode(kPinEncoderA, INPUT_PULLUP);
-  pinMode(kPinEncoderB, INPUT_PULLUP);
-#endif
-#if defined(HAL_PIN_BTN_OK) && HAL_PIN_BTN_OK >= 0
-  pinMode(kPinOk, INPUT_PULLUP);
-#endif
-#if defined(HAL_PIN_BTN_BACK) && HAL_PIN_BTN_BACK >= 0
-  pinMode(kPinBack, INPUT_PULLUP);
-#endif
+  forEachInputPin([](uint8_t pin) {
+    pinMode(pin, INPUT_PULLUP);
+  });
   lastPinRefreshAt_ = millis();
+  lastActivityMs_ = lastPinRefreshAt_;
   lastTraceAt_ = 0;
   lastTraceA_ = -1;
   lastTraceB_ = -1;
@@ -62,9 +90,26 @@ void InputAdapter::begin(lv_display_t *display) {
   lastTraceEncDiff_ = 0;
   lastTraceQ_ = 0;
 
+  buttonPinCount_ = 0;
+#if defined(HAL_PIN_BTN_OK) && HAL_PIN_BTN_OK >= 0
+  addButtonPin(kPinOk, kButtonOk);
+#elif defined(HAL_HAS_TRACKBALL) && HAL_HAS_TRACKBALL
+  addButtonPin(boardpins::kTrackballClick, kButtonOk);
+#endif
+#if defined(HAL_PIN_BTN_BACK) && HAL_PIN_BTN_BACK >= 0
+  addButtonPin(kPinBack, kButtonBack);
+#endif
+#if !HAL_HAS_ENCODER && defined(HAL_HAS_TRACKBALL) && HAL_HAS_TRACKBALL
+  addButtonPin(boardpins::kTrackballUp, kButtonTrackUp);
+  addButtonPin(boardpins::kTrackballDown, kButtonTrackDown);
+#endif
+
 #if HAL_HAS_ENCODER
-  encoder_.tick();
-  encoder_.setPosition(0);
+  if (!beginPcnt()) {
+    Serial.println("[input] PCNT unavailable, polling encoder");
+    encoder_.tick();
+    encoder_.setPosition(0);
+  }
 #endif
   lastEncoderPos_ = 0;
   pendingEncDiff_ = 0;
@@ -74,6 +119,137 @@ void InputAdapter::begin(lv_display_t *display) {
   lv_indev_set_display(indev_, display);
   lv_indev_set_read_cb(indev_, readCb);
   lv_indev_set_user_data(indev_, this);
+  // Read on demand from tick() instead of on a 30 ms LVGL timer, so an idle
+  // screen has no periodic timer keeping the UI loop awake.
+  lv_indev_set_mode(indev_, LV_INDEV_MODE_EVENT);
+
+  // PCNT channel setup reconfigures the encoder GPIOs, so interrupts go last.
+  resetState();
+  attachEdgeInterrupts();
+}
+
+void InputAdapter::addButtonPin(uint8_t pin, Button button) {
+  if (buttonPinCount_ >= kButtonCount) {
+    return;
+  }
+  ButtonPin &entry = buttonPins_[buttonPinCount_++];
+  entry.self = this;
+  entry.pin = pin;
+  entry.button = button;
+}
+
+bool InputAdapter::readButtonLevel(uint8_t button) const {
+  for (uint8_t i = 0; i < buttonPinCount_; ++i) {
+    if (buttonPins_[i].button == button) {
+      return digitalRead(buttonPins_[i].pin) == LOW;
+    }
+  }
+  return false;
+}
+
+bool InputAdapter::beginPcnt() {
+#if HAL_HAS_ENCODER
+  pcnt_unit_config_t unitConfig = {};
+  unitConfig.high_limit = kPcntLimit;
+  unitConfig.low_limit = -kPcntLimit;
+  // Fold limit crossings back into the count instead of wrapping to zero.
+  unitConfig.flags.accum_count = 1;
+  if (pcnt_new_unit(&unitConfig, &pcntUnit_) != ESP_OK) {
+    pcntUnit_ = nullptr;
+    return false;
+  }
+
+  pcnt_glitch_filter_config_t filterConfig = {};
+  filterConfig.max_glitch_ns = kEncoderGlitchNs;
+
+  pcnt_chan_config_t chanAConfig = {};
+  chanAConfig.edge_gpio_num = kPinEncoderA;
+  chanAConfig.level_gpio_num = kPinEncoderB;
+  pcnt_chan_config_t chanBConfig = {};
+  chanBConfig.edge_gpio_num = kPinEncoderB;
+  chanBConfig.level_gpio_num = kPinEncoderA;
+
+  // Standard x4 quadrature decode. With this wiring a positive count is the
+  // direction RotaryEncoder reported as negative, i.e. "next item".
+  const bool ok =
+      pcnt_unit_set_glitch_filter(pcntUnit_, &filterConfig) == ESP_OK &&
+      pcnt_new_channel(pcntUnit_, &chanAConfig, &pcntChanA_) == ESP_OK &&
+      pcnt_new_channel(pcntUnit_, &chanBConfig, &pcntChanB_) == ESP_OK &&
+      pcnt_channel_set_edge_action(pcntChanA_,
+                                   PCNT_CHANNEL_EDGE_ACTION_DECREASE,
+                                   PCNT_CHANNEL_EDGE_ACTION_INCREASE) == ESP_OK &&
+      pcnt_channel_set_level_action(pcntChanA_,
+                                    PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+                                    PCNT_CHANNEL_LEVEL_ACTION_INVERSE) == ESP_OK &&
+      pcnt_channel_set_edge_action(pcntChanB_,
+                                   PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                   PCNT_CHANNEL_EDGE_ACTION_DECREASE) == ESP_OK &&
+      pcnt_channel_set_level_action(pcntChanB_,
+                                    PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+                                    PCNT_CHANNEL_LEVEL_ACTION_INVERSE) == ESP_OK &&
+      pcnt_unit_add_watch_point(pcntUnit_, kPcntLimit) == ESP_OK &&
+      pcnt_unit_add_watch_point(pcntUnit_, -kPcntLimit) == ESP_OK &&
+      pcnt_unit_enable(pcntUnit_) == ESP_OK &&
+      pcnt_unit_clear_count(pcntUnit_) == ESP_OK &&
+      pcnt_unit_start(pcntUnit_) == ESP_OK;
+  if (!ok) {
+    releasePcnt();
+    return false;
+  }
+
+  // The channel setup leaves the pulls alone on some IDF versions.
+  pinMode(kPinEncoderA, INPUT_PULLUP);
+  pinMode(kPinEncoderB, INPUT_PULLUP);
+  lastPcntCount_ = 0;
+  pcntResidual_ = 0;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void InputAdapter::releasePcnt() {
+  if (!pcntUnit_) {
+    return;
+  }
+  pcnt_unit_stop(pcntUnit_);
+  pcnt_unit_disable(pcntUnit_);
+  if (pcntChanA_) {
+    pcnt_del_channel(pcntChanA_);
+    pcntChanA_ = nullptr;
+  }
+  if (pcntChanB_) {
+    pcnt_del_channel(pcntChanB_);
+    pcntChanB_ = nullptr;
+  }
+  pcnt_del_unit(pcntUnit_);
+  pcntUnit_ = nullptr;
+}
+
+void InputAdapter::pollEncoder() {
+#if HAL_HAS_ENCODER
+  int steps = 0;
+  if (pcntUnit_) {
+    int count = 0;
+    if (pcnt_unit_get_count(pcntUnit_, &count) != ESP_OK) {
+      return;
+    }
+    pcntResidual_ += count - lastPcntCount_;
+    lastPcntCount_ = count;
+    steps = pcntResidual_ / kPcntCountsPerStep;
+    pcntResidual_ -= steps * kPcntCountsPerStep;
+  } else {
+    encoder_.tick();
+    // RotaryEncoder counts the other way round.
+    steps = static_cast<int>(-encoder_.getPosition() - lastEncoderPos_);
+  }
+  if (steps == 0) {
+    return;
+  }
+  lastEncoderPos_ += steps;
+  pendingEncDiff_ = static_cast<int16_t>(pendingEncDiff_ + steps);
+  pendingEvent_.delta += steps;
+#endif
 }
 
 void InputAdapter::setGroup(lv_group_t *group) {
@@ -87,6 +263,84 @@ lv_indev_t *InputAdapter::indev() const {
   return indev_;
 }
 
+void IRAM_ATTR InputAdapter::edgeIsr(void *arg) {
+  (void)arg;
+  uievents::postFromIsr(uievents::kInput);
+}
+
+void IRAM_ATTR InputAdapter::buttonIsr(void *arg) {
+  const ButtonPin *entry = static_cast<const ButtonPin *>(arg);
+  InputAdapter *self = entry->self;
+  // GPIO interrupts are dispatched on one core, so this is the only producer
+  // and tick() the only consumer.
+  const uint8_t tail = self->edgeTail_;
+  const uint8_t next = static_cast<uint8_t>((tail + 1U) & (kEdgeQueueSize - 1U));
+  if (next == __atomic_load_n(&self->edgeHead_, __ATOMIC_ACQUIRE)) {
+    // Full: reconcileButtons() settles on the pin level instead.
+    self->edgesDropped_ = self->edgesDropped_ + 1U;
+  } else {
+    PinEdge &edge = self->edgeQueue_[tail];
+    edge.atMs = millis();
+    edge.button = entry->button;
+    edge.pressed = gpio_get_level(static_cast<gpio_num_t>(entry->pin)) == 0;
+    __atomic_store_n(&self->edgeTail_, next, __ATOMIC_RELEASE);
+  }
+  uievents::postFromIsr(uievents::kInput);
+}
+
+void InputAdapter::attachEdgeInterrupts() {
+#if HAL_HAS_ENCODER
+  // PCNT counts the encoder; these only wake the UI loop.
+  attachInterruptArg(kPinEncoderA, edgeIsr, this, CHANGE);
+  attachInterruptArg(kPinEncoderB, edgeIsr, this, CHANGE);
+#endif
+  for (uint8_t i = 0; i < buttonPinCount_; ++i) {
+    attachInterruptArg(buttonPins_[i].pin, buttonIsr, &buttonPins_[i], CHANGE);
+  }
+}
+
+void InputAdapter::detachEdgeInterrupts() {
+  forEachInputPin([](uint8_t pin) {
+    detachInterrupt(pin);
+  });
+}
+
+bool InputAdapter::armSleepWake() {
+  bool hasPins = false;
+  forEachInputPin([&hasPins](uint8_t) {
+    hasPins = true;
+  });
+  if (!hasPins) {
+    return false;
+  }
+  if (sleepWakeArmed_) {
+    return true;
+  }
+
+  detachEdgeInterrupts();
+  forEachInputPin([](uint8_t pin) {
+    // Wake on the opposite of the current level so any change wakes the chip.
+    const gpio_int_type_t level =
+        digitalRead(pin) == LOW ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL;
+    gpio_wakeup_enable(static_cast<gpio_num_t>(pin), level);
+  });
+  esp_sleep_enable_gpio_wakeup();
+  sleepWakeArmed_ = true;
+  return true;
+}
+
+void InputAdapter::disarmSleepWake() {
+  if (!sleepWakeArmed_) {
+    return;
+  }
+
+  forEachInputPin([](uint8_t pin) {
+    gpio_wakeup_disable(static_cast<gpio_num_t>(pin));
+  });
+  sleepWakeArmed_ = false;
+  attachEdgeInterrupts();
+}
+
 void InputAdapter::enqueueKey(uint32_t key, lv_indev_state_t state) {
   if (keyCount_ >= kQueueSize) {
     keyHead_ = static_cast<uint8_t>((keyHead_ + 1U) % kQueueSize);
@@ -116,107 +370,135 @@ bool InputAdapter::dequeueKey(uint32_t &key, lv_indev_state_t &state) {
   return true;
 }
 
-void InputAdapter::tick() {
-  const unsigned long now = millis();
-  if (now - lastPinRefreshAt_ >= kPinRefreshMs) {
-#if HAL_HAS_ENCODER
-    pinMode(kPinEncoderA, INPUT_PULLUP);
-    pinMode(kPinEncoderB, INPUT_PULLUP);
-#endif
-#if defined(HAL_PIN_BTN_OK) && HAL_PIN_BTN_OK >= 0
-    pinMode(kPinOk, INPUT_PULLUP);
-#endif
-#if defined(HAL_PIN_BTN_BACK) && HAL_PIN_BTN_BACK >= 0
-    pinMode(kPinBack, INPUT_PULLUP);
-#endif
-    lastPinRefreshAt_ = now;
+void InputAdapter::emitClick(uint8_t button) {
+  if (button == kButtonOk) {
+    pendingEvent_.ok = true;
+    pendingEvent_.okCount = saturatingInc(pendingEvent_.okCount);
+    enqueueKeyPressRelease(LV_KEY_ENTER);
+  } else if (button == kButtonBack) {
+    pendingEvent_.back = true;
+    pendingEvent_.backCount = saturatingInc(pendingEvent_.backCount);
+    enqueueKeyPressRelease(LV_KEY_ESC);
   }
+}
 
-#if HAL_HAS_ENCODER
-  encoder_.tick();
-  const int32_t pos = encoder_.getPosition();
-  const int32_t rawDelta = pos - lastEncoderPos_;
-  if (rawDelta != 0) {
-    const int16_t mapped = static_cast<int16_t>(-rawDelta);
-    pendingEncDiff_ = static_cast<int16_t>(pendingEncDiff_ + mapped);
-    pendingEvent_.delta += mapped;
-    lastEncoderPos_ = pos;
-  }
-#elif defined(HAL_HAS_TRACKBALL) && HAL_HAS_TRACKBALL
-  // Trackball navigation: read directional pins as scroll events.
-  if (digitalRead(boardpins::kTrackballUp) == LOW) {
-    pendingEncDiff_ = static_cast<int16_t>(pendingEncDiff_ - 1);
-    pendingEvent_.delta -= 1;
+void InputAdapter::emitLongPress(uint8_t button) {
+  if (button != kButtonOk) {
+    return;
   }
-  if (digitalRead(boardpins::kTrackballDown) == LOW) {
-    pendingEncDiff_ = static_cast<int16_t>(pendingEncDiff_ + 1);
-    pendingEvent_.delta += 1;
+  pendingEvent_.back = true;
+  pendingEvent_.okLong = true;
+  pendingEvent_.backCount = saturatingInc(pendingEvent_.backCount);
+  pendingEvent_.okLongCount = saturatingInc(pendingEvent_.okLongCount);
+  enqueueKeyPressRelease(LV_KEY_ESC);
+  buttons_[button].longFired = true;
+}
+
+void InputAdapter::drainEdges() {
+  uint8_t head = edgeHead_;
+  const uint8_t tail = __atomic_load_n(&edgeTail_, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    const PinEdge edge = edgeQueue_[head];
+    head = static_cast<uint8_t>((head + 1U) & (kEdgeQueueSize - 1U));
+    __atomic_store_n(&edgeHead_, head, __ATOMIC_RELEASE);
+    handleButtonEdge(edge.button, edge.pressed, edge.atMs);
   }
-#endif
+}
 
-  if (!okBackBlocked_) {
-#if defined(HAL_PIN_BTN_OK) && HAL_PIN_BTN_OK >= 0
-    const bool okPressed = digitalRead(kPinOk) == LOW;
-#elif defined(HAL_HAS_TRACKBALL) && HAL_HAS_TRACKBALL
-    const bool okPressed = digitalRead(boardpins::kTrackballClick) == LOW;
-#else
-    const bool okPressed = false;
-#endif
-    if (okPressed && !okPrev_) {
-      okPressedAt_ = now;
-      okLongFired_ = false;
-    }
-    if (!okPressed && okPrev_) {
-      if (!okLongFired_ && now - okPressedAt_ >= kDebounceMs) {
-        pendingEvent_.ok = true;
-        pendingEvent_.okCount = saturatingInc(pendingEvent_.okCount);
-        enqueueKeyPressRelease(LV_KEY_ENTER);
-      }
-      okPressedAt_ = 0;
-      okLongFired_ = false;
+void InputAdapter::handleButtonEdge(uint8_t button, bool pressed, uint32_t atMs) {
+  ButtonState &state = buttons_[button];
+  state.lastRawEdgeMs = atMs;
+
+  if (button == kButtonTrackUp || button == kButtonTrackDown) {
+    // Trackball hall sensors give one clean pulse per step; count every
+    // second edge rather than trusting the level sampled in the ISR.
+    state.pressed = !state.pressed;
+    if (state.pressed) {
+      const int step = button == kButtonTrackUp ? -1 : 1;
+      pendingEncDiff_ = static_cast<int16_t>(pendingEncDiff_ + step);
+      pendingEvent_.delta += step;
     }
-    if (okPressed && !okLongFired_ && okPressedAt_ > 0 &&
-        now - okPressedAt_ >= kLongPressMs) {
-      pendingEvent_.back = true;
-      pendingEvent_.okLong = true;
-      pendingEvent_.backCount = saturatingInc(pendingEvent_.backCount);
-      pendingEvent_.okLongCount = saturatingInc(pendingEvent_.okLongCount);
-      enqueueKeyPressRelease(LV_KEY_ESC);
-      okLongFired_ = true;
+    return;
+  }
+
+  if (pressed == state.pressed || atMs - state.lastAcceptedMs < kDebounceMs) {
+    return;
+  }
+  applyButtonState(button, pressed, atMs);
+}
+
+void InputAdapter::applyButtonState(uint8_t button, bool pressed, uint32_t atMs) {
+  ButtonState &state = buttons_[button];
+  state.pressed = pressed;
+  state.lastAcceptedMs = atMs;
+  if (pressed) {
+    // Presses that start while OK/BACK are blocked never fire.
+    state.pressedAtMs = okBackBlocked_ ? 0 : atMs;
+    state.longFired = false;
+    return;
+  }
+
+  if (state.pressedAtMs != 0 && !state.longFired) {
+    const uint32_t heldMs = atMs - state.pressedAtMs;
+    if (button == kButtonOk && heldMs >= kLongPressMs) {
+      emitLongPress(button);
+    } else if (heldMs >= kDebounceMs) {
+      emitClick(button);
     }
-    okPrev_ = okPressed;
+  }
+  state.pressedAtMs = 0;
+  state.longFired = false;
+}
 
-#if defined(HAL_PIN_BTN_BACK) && HAL_PIN_BTN_BACK >= 0
-    const bool backPressed = digitalRead(kPinBack) == LOW;
-    if (backPressed && !backPrev_) {
-      backPressedAt_ = now;
+void InputAdapter::reconcileButtons(uint32_t now) {
+  for (uint8_t i = 0; i < buttonPinCount_; ++i) {
+    const uint8_t button = buttonPins_[i].button;
+    if (button != kButtonOk && button != kButtonBack) {
+      continue;
     }
-    if (!backPressed && backPrev_) {
-      if (now - backPressedAt_ >= kDebounceMs) {
-        pendingEvent_.back = true;
-        pendingEvent_.backCount = saturatingInc(pendingEvent_.backCount);
-        enqueueKeyPressRelease(LV_KEY_ESC);
-      }
-      backPressedAt_ = 0;
+    ButtonState &state = buttons_[button];
+    const bool level = digitalRead(buttonPins_[i].pin) == LOW;
+    if (level == state.pressed || now - state.lastRawEdgeMs < kDebounceMs) {
+      continue;
     }
-    backPrev_ = backPressed;
-#endif
-  } else {
-#if defined(HAL_PIN_BTN_OK) && HAL_PIN_BTN_OK >= 0
-    okPrev_ = digitalRead(kPinOk) == LOW;
-#elif defined(HAL_HAS_TRACKBALL) && HAL_HAS_TRACKBALL
-    okPrev_ = digitalRead(boardpins::kTrackballClick) == LOW;
-#endif
-#if defined(HAL_PIN_BTN_BACK) && HAL_PIN_BTN_BACK >= 0
-    backPrev_ = digitalRead(kPinBack) == LOW;
-#endif
-    okPressedAt_ = 0;
-    backPressedAt_ = 0;
-    okLongFired_ = false;
+    // The settling edge was filtered as bounce or dropped from a full queue:
+    // settle on the pin level, timed at the last edge that was seen.
+    const bool edgeAfterAccepted =
+        static_cast<int32_t>(state.lastRawEdgeMs - state.lastAcceptedMs) > 0;
+    applyButtonState(button, level, edgeAfterAccepted ? state.lastRawEdgeMs : now);
+  }
+}
+
+void InputAdapter::tick() {
+  const unsigned long now = millis();
+  if (now - lastPinRefreshAt_ >= kPinRefreshMs) {
+    // pinMode() keeps the pin's interrupt type, so the edge ISRs stay attached.
+    forEachInputPin([](uint8_t pin) {
+      pinMode(pin, INPUT_PULLUP);
+    });
+    lastPinRefreshAt_ = now;
+  }
+
+  pollEncoder();
+  drainEdges();
+  reconcileButtons(now);
+
+  ButtonState &ok = buttons_[kButtonOk];
+  if (ok.pressed && ok.pressedAtMs != 0 && !ok.longFired &&
+      now - ok.pressedAtMs >= kLongPressMs) {
+    emitLongPress(kButtonOk);
+  }
+
+  if (ok.pressed || buttons_[kButtonBack].pressed || pendingEvent_.delta != 0 ||
+      keyCount_ > 0) {
+    lastActivityMs_ = now;
+  }
+  if (indev_ && (pendingEncDiff_ != 0 || keyCount_ > 0)) {
+    lv_indev_read(indev_);
   }
 
 #if USER_INPUT_TRACE_ENABLED && HAL_HAS_ENCODER
-  const int32_t pos_trace = encoder_.getPosition();
+  const int32_t pos_trace = lastEncoderPos_;
   const int a = digitalRead(kPinEncoderA);
   const int b = digitalRead(kPinEncoderB);
 #if defined(HAL_PIN_BTN_OK) && HAL_PIN_BTN_OK >= 0
@@ -263,27 +545,28 @@ void InputAdapter::resetState() {
   keyHead_ = 0;
   keyTail_ = 0;
   keyCount_ = 0;
-
-  const unsigned long now = millis();
-#if defined(HAL_PIN_BTN_OK) && HAL_PIN_BTN_OK >= 0
-  okPrev_ = digitalRead(kPinOk) == LOW;
-#elif defined(HAL_HAS_TRACKBALL) && HAL_HAS_TRACKBALL
-  okPrev_ = digitalRead(boardpins::kTrackballClick) == LOW;
-#else
-  okPrev_ = false;
-#endif
-#if defined(HAL_PIN_BTN_BACK) && HAL_PIN_BTN_BACK >= 0
-  backPrev_ = digitalRead(kPinBack) == LOW;
-#else
-  backPrev_ = false;
-#endif
-  okPressedAt_ = okPrev_ ? now : 0;
-  backPressedAt_ = backPrev_ ? now : 0;
-  okLongFired_ = false;
+  __atomic_store_n(&edgeHead_, __atomic_load_n(&edgeTail_, __ATOMIC_ACQUIRE),
+                   __ATOMIC_RELEASE);
+
+  const uint32_t now = millis();
+  for (uint8_t button = 0; button < kButtonCount; ++button) {
+    ButtonState &state = buttons_[button];
+    state = ButtonState{};
+    state.pressed = readButtonLevel(button);
+    if (button == kButtonOk || button == kButtonBack) {
+      state.pressedAtMs = state.pressed ? now : 0;
+    }
+  }
 
 #if HAL_HAS_ENCODER
-  const int32_t pos = encoder_.getPosition();
-  lastEncoderPos_ = pos;
+  if (pcntUnit_) {
+    int count = 0;
+    if (pcnt_unit_get_count(pcntUnit_, &count) == ESP_OK) {
+      lastPcntCount_ = count;
+    }
+  } else {
+    lastEncoderPos_ = -encoder_.getPosition();
+  }
 #endif
 }
 
@@ -302,9 +585,10 @@ void InputAdapter::setOkBackBlocked(bool blocked) {
   keyHead_ = 0;
   keyTail_ = 0;
   keyCount_ = 0;
-  okPressedAt_ = 0;
-  backPressedAt_ = 0;
-  okLongFired_ = false;
+  buttons_[kButtonOk].pressedAtMs = 0;
+  buttons_[kButtonOk].longFired = false;
+  buttons_[kButtonBack].pressedAtMs = 0;
+  buttons_[kButtonBack].longFired = false;
 }
 
 InputEvent InputAdapter::pollEvent() {
@@ -313,6 +597,18 @@ InputEvent InputAdapter::pollEvent() {
   return out;
 }
 
+bool InputAdapter::hasPendingInput() const {
+  return pendingEvent_.delta != 0 || pendingEvent_.ok || pendingEvent_.back ||
+         pendingEncDiff_ != 0 || keyCount_ > 0 || edgeHead_ != edgeTail_;
+}
+
+bool InputAdapter::idleFor(unsigned long ms) const {
+  if (buttons_[kButtonOk].pressed || buttons_[kButtonBack].pressed) {
+    return false;
+  }
+  return millis() - lastActivityMs_ >= ms;
+}
+
 void InputAdapter::readCb(lv_indev_t *indev, lv_indev_data_t *data) {
   InputAdapter *self = static_cast<InputAdapter *>(lv_indev_get_user_data(indev));
   if (!self) {
@@ -334,4 +630,7 @@ void InputAdapter::readCb(lv_indev_t *indev, lv_indev_data_t *data) {
     data->key = LV_KEY_ENTER;
     data->state = LV_INDEV_STATE_RELEASED;
   }
+  // Event mode reads once per lv_indev_read(); drain queued press/release
+  // pairs in the same call.
+  data->continue_reading = self->keyCount_ > 0;
 }
@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 #include <RotaryEncoder.h>
+#include <driver/pulse_cnt.h>
 #include <lvgl.h>
 
 struct InputEvent {
@@ -24,6 +25,15 @@ class InputAdapter {
   void setOkBackBlocked(bool blocked);
 
   InputEvent pollEvent();
+  bool hasPendingInput() const;
+  // True when no pin has changed and nothing is held for at least ms.
+  bool idleFor(unsigned long ms) const;
+
+  // Light sleep gates the GPIO edge interrupts, so while armed the input pins
+  // are switched to level wake-up sources instead. Returns false when the
+  // board has no pins that could wake it.
+  bool armSleepWake();
+  void disarmSleepWake();
 
   void setGroup(lv_group_t *group);
   lv_indev_t *indev() const;
@@ -34,23 +44,85 @@ class InputAdapter {
     lv_indev_state_t state = LV_INDEV_STATE_RELEASED;
   };
 
+  enum Button : uint8_t {
+    kButtonOk = 0,
+    kButtonBack,
+    kButtonTrackUp,
+    kButtonTrackDown,
+    kButtonCount,
+  };
+
+  // One entry per GPIO edge, written by buttonIsr and drained by tick().
+  struct PinEdge {
+    uint32_t atMs = 0;
+    uint8_t button = 0;
+    bool pressed = false;
+  };
+
+  struct ButtonPin {
+    InputAdapter *self = nullptr;
+    uint8_t pin = 0;
+    uint8_t button = 0;
+  };
+
+  // Debounced button state rebuilt from edge timestamps, so presses are
+  // judged by when they happened rather than when tick() got to run.
+  struct ButtonState {
+    bool pressed = false;
+    uint32_t pressedAtMs = 0;
+    uint32_t lastAcceptedMs = 0;
+    uint32_t lastRawEdgeMs = 0;
+    bool longFired = false;
+  };
+
   static void readCb(lv_indev_t *indev, lv_indev_data_t *data);
+  static void edgeIsr(void *arg);
+  static void buttonIsr(void *arg);
+  void attachEdgeInterrupts();
+  void detachEdgeInterrupts();
+  void addButtonPin(uint8_t pin, Button button);
+  bool readButtonLevel(uint8_t button) const;
+
+  bool beginPcnt();
+  void releasePcnt();
+  void pollEncoder();
+
+  void drainEdges();
+  void handleButtonEdge(uint8_t button, bool pressed, uint32_t atMs);
+  void applyButtonState(uint8_t button, bool pressed, uint32_t atMs);
+  void reconcileButtons(uint32_t now);
+  void emitClick(uint8_t button);
+  void emitLongPress(uint8_t button);
+
   void enqueueKey(uint32_t key, lv_indev_state_t state);
   void enqueueKeyPressRelease(uint32_t key);
   bool dequeueKey(uint32_t &key, lv_indev_state_t &state);
 
+  // Fallback when no PCNT unit could be claimed.
   RotaryEncoder encoder_;
   lv_indev_t *indev_ = nullptr;
 
+  pcnt_unit_handle_t pcntUnit_ = nullptr;
+  pcnt_channel_handle_t pcntChanA_ = nullptr;
+  pcnt_channel_handle_t pcntChanB_ = nullptr;
+  int lastPcntCount_ = 0;
+  int pcntResidual_ = 0;
+
   int32_t lastEncoderPos_ = 0;
   int16_t pendingEncDiff_ = 0;
 
-  bool okPrev_ = false;
-  bool backPrev_ = false;
+  ButtonPin buttonPins_[kButtonCount];
+  uint8_t buttonPinCount_ = 0;
+  ButtonState buttons_[kButtonCount];
   bool okBackBlocked_ = false;
-  unsigned long okPressedAt_ = 0;
-  unsigned long backPressedAt_ = 0;
-  bool okLongFired_ = false;
+  bool sleepWakeArmed_ = false;
+  unsigned long lastActivityMs_ = 0;
+
+  static constexpr uint8_t kEdgeQueueSize = 32;  // power of two
+  PinEdge edgeQueue_[kEdgeQueueSize];
+  volatile uint8_t edgeHead_ = 0;
+  volatile uint8_t edgeTail_ = 0;
+  volatile uint32_t edgesDropped_ = 0;
 
   InputEvent pendingEvent_;
 
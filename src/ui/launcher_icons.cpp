@@ -1,14 +1,34 @@
 #include "launcher_icons.h"
 
+#include <esp_heap_caps.h>
+#include <string.h>
+
 namespace {
 
 constexpr int kDesignSize = 46;
 constexpr int kMainRenderSize = 69;
 constexpr int kSideRenderSize = 36;
 constexpr int kIconCount = 4;
+constexpr int kVariantCount = 2;
+// Without PSRAM a raster only goes to internal RAM if this much stays free
+// afterwards (TLS handshakes need it); otherwise the icon keeps drawing from
+// vectors.
+constexpr size_t kMinInternalFreeAfterRaster = 64U * 1024U;
 
 bool gInitialized = false;
 
+// One icon pre-rendered at one size: an RGB565A8 image (color plane, then
+// alpha plane) that the draw event blits instead of re-running the vector
+// primitives every frame.
+struct IconRaster {
+  lv_image_dsc_t image = {};
+  uint8_t *data = nullptr;
+  lv_color_t color = {};
+  bool failed = false;
+};
+
+IconRaster gRasters[kIconCount][kVariantCount];
+
 constexpr LauncherIconId kIconUserData[kIconCount] = {
     LauncherIconId::AppMarket,
     LauncherIconId::Settings,
@@ -222,6 +242,131 @@ void drawById(const DrawCtx &ctx, LauncherIconId id) {
   }
 }
 
+int renderSizeFor(LauncherIconVariant variant) {
+  return variant == LauncherIconVariant::Side ? kSideRenderSize : kMainRenderSize;
+}
+
+void *allocateIconMemory(size_t bytes) {
+  void *ptr = nullptr;
+#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
+  ptr = ps_malloc(bytes);
+#endif
+  if (!ptr &&
+      heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) >=
+          bytes + kMinInternalFreeAfterRaster) {
+    ptr = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  return ptr;
+}
+
+void fillColorPlane(IconRaster &raster, lv_color_t color) {
+  const uint32_t pixels = raster.image.header.w * raster.image.header.h;
+  const uint16_t rgb565 = lv_color_to_u16(color);
+  uint16_t *plane = reinterpret_cast<uint16_t *>(raster.data);
+  for (uint32_t i = 0; i < pixels; ++i) {
+    plane[i] = rgb565;
+  }
+  raster.color = color;
+}
+
+// Renders the vector icon once into an ARGB8888 scratch canvas and keeps only
+// its coverage as the alpha plane; the icon is a single color, so the color
+// plane is a flat fill.
+bool rasterizeIcon(LauncherIconId id, LauncherIconVariant variant, lv_color_t color) {
+  IconRaster &raster = gRasters[static_cast<int>(id)][static_cast<int>(variant)];
+  if (raster.data) {
+    if (!lv_color_eq(raster.color, color)) {
+      fillColorPlane(raster, color);
+      lv_image_cache_drop(&raster.image);
+    }
+    return true;
+  }
+  if (raster.failed) {
+    return false;
+  }
+
+  const int size = renderSizeFor(variant);
+  const uint32_t pixels = static_cast<uint32_t>(size * size);
+  const uint32_t scratchStride = lv_draw_buf_width_to_stride(size, LV_COLOR_FORMAT_ARGB8888);
+  const uint32_t scratchBytes = scratchStride * static_cast<uint32_t>(size);
+  uint8_t *scratch = static_cast<uint8_t *>(allocateIconMemory(scratchBytes));
+  raster.data = static_cast<uint8_t *>(allocateIconMemory(pixels * 3U));
+  if (!scratch || !raster.data) {
+    heap_caps_free(scratch);
+    heap_caps_free(raster.data);
+    raster.data = nullptr;
+    raster.failed = true;
+    Serial.printf("[ui] launcher icon %d/%d raster alloc failed, drawing vectors\n",
+                  static_cast<int>(id),
+                  size);
+    return false;
+  }
+
+  memset(scratch, 0, scratchBytes);
+  lv_draw_buf_t scratchBuf;
+  lv_draw_buf_init(&scratchBuf,
+                   static_cast<uint32_t>(size),
+                   static_cast<uint32_t>(size),
+                   LV_COLOR_FORMAT_ARGB8888,
+                   scratchStride,
+                   scratch,
+                   scratchBytes);
+
+  lv_obj_t *canvas = lv_canvas_create(lv_layer_top());
+  lv_obj_add_flag(canvas, LV_OBJ_FLAG_HIDDEN);
+  lv_canvas_set_draw_buf(canvas, &scratchBuf);
+  lv_layer_t layer;
+  lv_canvas_init_layer(canvas, &layer);
+
+  DrawCtx ctx;
+  ctx.layer = &layer;
+  ctx.area.x1 = 0;
+  ctx.area.y1 = 0;
+  ctx.area.x2 = size - 1;
+  ctx.area.y2 = size - 1;
+  ctx.color = lv_color_white();
+  ctx.w = size;
+  ctx.h = size;
+  ctx.minSide = size;
+  drawById(ctx, id);
+
+  lv_canvas_finish_layer(canvas, &layer);
+  lv_obj_delete(canvas);
+
+  uint8_t *alpha = raster.data + pixels * 2U;
+  for (int y = 0; y < size; ++y) {
+    const uint8_t *row = scratch + static_cast<uint32_t>(y) * scratchStride;
+    for (int x = 0; x < size; ++x) {
+      // lv_color32_t is stored B, G, R, A.
+      alpha[y * size + x] = row[x * 4 + 3];
+    }
+  }
+  heap_caps_free(scratch);
+
+  raster.image.header.magic = LV_IMAGE_HEADER_MAGIC;
+  raster.image.header.cf = LV_COLOR_FORMAT_RGB565A8;
+  raster.image.header.w = static_cast<uint32_t>(size);
+  raster.image.header.h = static_cast<uint32_t>(size);
+  raster.image.header.stride = static_cast<uint32_t>(size * 2);
+  raster.image.data_size = pixels * 3U;
+  raster.image.data = raster.data;
+  fillColorPlane(raster, color);
+  return true;
+}
+
+// Raster matching the object's current size and color, nullptr if it has to
+// be drawn from vectors.
+const IconRaster *rasterFor(LauncherIconId id, int32_t w, int32_t h, lv_color_t color) {
+  for (int variant = 0; variant < kVariantCount; ++variant) {
+    const IconRaster &raster = gRasters[static_cast<int>(id)][variant];
+    if (raster.data && static_cast<int32_t>(raster.image.header.w) == w &&
+        static_cast<int32_t>(raster.image.header.h) == h && lv_color_eq(raster.color, color)) {
+      return &raster;
+    }
+  }
+  return nullptr;
+}
+
 void launcherIconEvent(lv_event_t *e) {
   const lv_event_code_t code = lv_event_get_code(e);
   if (code == LV_EVENT_REFR_EXT_DRAW_SIZE) {
@@ -236,17 +381,19 @@ void launcherIconEvent(lv_event_t *e) {
     return;
   }
 
-  const LauncherIconId *id = static_cast<const LauncherIconId *>(lv_event_get_user_data(e));
-  if (!id) {
-    return;
-  }
-
   lv_obj_t *obj = static_cast<lv_obj_t *>(lv_event_get_current_target(e));
   lv_layer_t *layer = lv_event_get_layer(e);
   if (!obj || !layer) {
     return;
   }
 
+  // The icon id lives in the object's user data so setLauncherIcon() can
+  // retarget an existing icon without recreating it.
+  const LauncherIconId *id = static_cast<const LauncherIconId *>(lv_obj_get_user_data(obj));
+  if (!id) {
+    return;
+  }
+
   lv_area_t coords;
   lv_obj_get_coords(obj, &coords);
 
@@ -262,6 +409,15 @@ void launcherIconEvent(lv_event_t *e) {
     return;
   }
 
+  const IconRaster *raster = rasterFor(*id, ctx.w, ctx.h, ctx.color);
+  if (raster) {
+    lv_draw_image_dsc_t image;
+    lv_draw_image_dsc_init(&image);
+    image.src = &raster->image;
+    lv_draw_image(layer, &image, &coords);
+    return;
+  }
+
   drawById(ctx, *id);
 }
 
@@ -277,10 +433,7 @@ bool launcherIconsReady() {
 }
 
 int launcherIconRenderSize(LauncherIconVariant variant) {
-  if (variant == LauncherIconVariant::Side) {
-    return kSideRenderSize;
-  }
-  return kMainRenderSize;
+  return renderSizeFor(variant);
 }
 
 lv_obj_t *createLauncherIcon(lv_obj_t *parent,
@@ -314,6 +467,32 @@ lv_obj_t *createLauncherIcon(lv_obj_t *parent,
   lv_obj_clear_flag(icon, LV_OBJ_FLAG_SCROLLABLE);
   lv_obj_clear_flag(icon, LV_OBJ_FLAG_CLICKABLE);
 
-  lv_obj_add_event_cb(icon, launcherIconEvent, LV_EVENT_ALL, (void *)&kIconUserData[idx]);
+  lv_obj_set_user_data(icon, (void *)&kIconUserData[idx]);
+  lv_obj_add_event_cb(icon, launcherIconEvent, LV_EVENT_ALL, nullptr);
+  // Rasterize here rather than in the draw event: the canvas is an object and
+  // must not be created while LVGL is rendering.
+  rasterizeIcon(id, variant, color);
   return icon;
 }
+
+bool setLauncherIcon(lv_obj_t *icon, LauncherIconId id) {
+  if (!icon) {
+    return false;
+  }
+
+  const int idx = static_cast<int>(id);
+  if (idx < 0 || idx >= kIconCount) {
+    return false;
+  }
+
+  void *next = (void *)&kIconUserData[idx];
+  const int32_t size = lv_obj_get_style_width(icon, LV_PART_MAIN);
+  const LauncherIconVariant variant =
+      size == kSideRenderSize ? LauncherIconVariant::Side : LauncherIconVariant::Main;
+  rasterizeIcon(id, variant, lv_obj_get_style_text_color(icon, LV_PART_MAIN));
+  if (lv_obj_get_user_data(icon) != next) {
+    lv_obj_set_user_data(icon, next);
+    lv_obj_invalidate(icon);
+  }
+  return true;
+}
@@ -15,6 +15,9 @@ enum class LauncherIconVariant : uint8_t {
   Side = 1,
 };
 
+// Icons are vector drawings rasterized once per id and size (into PSRAM when
+// available) the first time they are created; later frames blit the cached
+// image.
 bool initLauncherIcons();
 bool launcherIconsReady();
 int launcherIconRenderSize(LauncherIconVariant variant);
@@ -22,3 +25,5 @@ lv_obj_t *createLauncherIcon(lv_obj_t *parent,
                              LauncherIconId id,
                              LauncherIconVariant variant,
                              lv_color_t color);
+// Switches an icon created by createLauncherIcon() to another id in place.
+bool setLauncherIcon(lv_obj_t *icon, LauncherIconId id);
@@ -3,22 +3,38 @@
 #include <esp_heap_caps.h>
 
 #include "../core/board_pins.h"
+#include "../core/perf_profiler.h"
 #include "../core/shared_spi_bus.h"
 #include "../hal/board_config.h"
+#include "user_config.h"
 
 namespace {
 
-constexpr uint16_t kBufferLines = 24;
+constexpr uint16_t kBufferLines = HAL_DISPLAY_BUFFER_LINES;
 constexpr uint8_t kBacklightFullDuty = 254;
+constexpr uint32_t kStatsLogIntervalMs = 5000U;
 
 }  // namespace
 
 LvglPort::LvglPort() = default;
 
-void *LvglPort::allocateBuffer(size_t bytes) {
+void *LvglPort::allocateBuffer(size_t bytes, bool dmaCapable, bool *inPsram) {
+  if (inPsram) {
+    *inPsram = false;
+  }
+  // The SPI master DMA cannot read PSRAM directly (the driver would bounce
+  // every band through a temporary internal copy), so DMA flushes need
+  // internal DMA-capable memory.
+  if (dmaCapable) {
+    return heap_caps_malloc(bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+  }
+
   void *ptr = nullptr;
 #if CONFIG_SPIRAM || BOARD_HAS_PSRAM
   ptr = ps_malloc(bytes);
+  if (ptr && inPsram) {
+    *inPsram = true;
+  }
 #endif
   if (!ptr) {
     ptr = heap_caps_malloc(bytes, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
@@ -29,6 +45,32 @@ void *LvglPort::allocateBuffer(size_t bytes) {
   return ptr;
 }
 
+bool LvglPort::allocateBuffers(size_t bytes, bool dmaCapable) {
+  bool firstInPsram = false;
+  bool secondInPsram = false;
+  buf1_ = static_cast<lv_color_t *>(allocateBuffer(bytes, dmaCapable, &firstInPsram));
+  buf2_ = static_cast<lv_color_t *>(allocateBuffer(bytes, dmaCapable, &secondInPsram));
+  if (dmaCapable && (!buf1_ || !buf2_)) {
+    // DMA only pays off with two buffers; let the caller fall back.
+    releaseBuffers();
+    return false;
+  }
+  buffersInPsram_ = firstInPsram || secondInPsram;
+  return buf1_ != nullptr;
+}
+
+void LvglPort::releaseBuffers() {
+  if (buf1_) {
+    heap_caps_free(buf1_);
+    buf1_ = nullptr;
+  }
+  if (buf2_) {
+    heap_caps_free(buf2_);
+    buf2_ = nullptr;
+  }
+  buffersInPsram_ = false;
+}
+
 bool LvglPort::begin() {
   if (initialized_) {
     return true;
@@ -63,10 +105,26 @@ bool LvglPort::begin() {
   const uint32_t width = static_cast<uint32_t>(tft_.width());
   const uint32_t height = static_cast<uint32_t>(tft_.height());
   const size_t bufPixels = static_cast<size_t>(width) * kBufferLines;
-  const size_t bufBytes = bufPixels * sizeof(lv_color_t);
+  // lv_color_t is 24-bit in LVGL 9; size the RGB565 buffers exactly so the
+  // DMA buffers do not waste internal RAM.
+  const size_t bufBytes =
+      bufPixels * lv_color_format_get_size(LV_COLOR_FORMAT_RGB565);
+  bufferLines_ = kBufferLines;
 
-  buf1_ = static_cast<lv_color_t *>(allocateBuffer(bufBytes));
-  buf2_ = static_cast<lv_color_t *>(allocateBuffer(bufBytes));
+#if HAL_DISPLAY_DMA
+  if (allocateBuffers(bufBytes, true)) {
+    dmaEnabled_ = tft_.initDMA();
+    if (!dmaEnabled_) {
+      Serial.println("[ui] TFT DMA init failed, using blocking flush");
+      releaseBuffers();
+    }
+  } else {
+    Serial.println("[ui] DMA draw buffer alloc failed, using blocking flush");
+  }
+#endif
+  if (!dmaEnabled_) {
+    allocateBuffers(bufBytes, false);
+  }
   if (!buf1_) {
     Serial.println("[ui] LVGL draw buffer alloc failed");
     showFatal("LVGL buf1 alloc failed");
@@ -86,6 +144,11 @@ bool LvglPort::begin() {
   lv_display_set_user_data(display_, this);
   lv_display_set_color_format(display_, LV_COLOR_FORMAT_RGB565);
   lv_display_set_flush_cb(display_, flushCb);
+  if (dmaEnabled_) {
+    lv_display_set_flush_wait_cb(display_, flushWaitCb);
+  }
+  lv_display_add_event_cb(display_, refreshEventCb, LV_EVENT_REFR_START, this);
+  lv_display_add_event_cb(display_, refreshEventCb, LV_EVENT_REFR_READY, this);
   lv_display_set_buffers(display_,
                          reinterpret_cast<void *>(buf1_),
                          reinterpret_cast<void *>(buf2_),
@@ -93,14 +156,21 @@ bool LvglPort::begin() {
                          LV_DISPLAY_RENDER_MODE_PARTIAL);
   lv_display_set_default(display_);
 
+  Serial.printf("[ui] LVGL buffers: 2x%u lines (%u B) %s, flush=%s\n",
+                static_cast<unsigned>(bufferLines_),
+                static_cast<unsigned>(bufBytes),
+                buffersInPsram_ ? "PSRAM" : "internal",
+                dmaEnabled_ ? "DMA" : "blocking");
+
   lastTickMs_ = millis();
+  lastStatsLogMs_ = lastTickMs_;
   initialized_ = true;
   return true;
 }
 
-void LvglPort::pump() {
+uint32_t LvglPort::pump() {
   if (!initialized_) {
-    return;
+    return LV_NO_TIMER_READY;
   }
 
   const uint32_t now = millis();
@@ -113,7 +183,18 @@ void LvglPort::pump() {
     lastTickMs_ = now;
   }
 
-  lv_timer_handler();
+  const uint32_t nextTimerMs = lv_timer_handler();
+  // Release the shared SPI bus before SD/radio code runs between pumps.
+  completeFlush();
+
+#if USER_UI_FRAME_TRACE_ENABLED
+  if (now - lastStatsLogMs_ >= kStatsLogIntervalMs) {
+    lastStatsLogMs_ = now;
+    logStats();
+    resetStats();
+  }
+#endif
+  return nextTimerMs;
 }
 
 lv_display_t *LvglPort::display() const {
@@ -128,6 +209,117 @@ bool LvglPort::ready() const {
   return initialized_ && display_ != nullptr;
 }
 
+LvglPortStats LvglPort::stats() const {
+  LvglPortStats out;
+  out.frames = frames_;
+  out.lastFrameUs = lastFrameUs_;
+  out.avgFrameUs = frames_ > 0 ? static_cast<uint32_t>(totalFrameUs_ / frames_) : 0U;
+  out.maxFrameUs = maxFrameUs_;
+  out.lastFramePixels = lastFramePixels_;
+  out.avgFramePixels =
+      frames_ > 0 ? static_cast<uint32_t>(totalFramePixels_ / frames_) : 0U;
+  out.maxFramePixels = maxFramePixels_;
+  out.flushes = flushes_;
+  out.flushWaitUs = flushWaitUs_;
+  out.bufferLines = bufferLines_;
+  out.dma = dmaEnabled_;
+  out.buffersInPsram = buffersInPsram_;
+  return out;
+}
+
+void LvglPort::resetStats() {
+  frames_ = 0;
+  totalFrameUs_ = 0;
+  lastFrameUs_ = 0;
+  maxFrameUs_ = 0;
+  totalFramePixels_ = 0;
+  lastFramePixels_ = 0;
+  maxFramePixels_ = 0;
+  flushes_ = 0;
+  flushWaitUs_ = 0;
+}
+
+uint32_t LvglPort::frameSequence() const {
+  return frameSequence_;
+}
+
+void LvglPort::finishPendingFlush() {
+  completeFlush();
+}
+
+void LvglPort::logStats() {
+  const LvglPortStats s = stats();
+  if (s.frames == 0) {
+    return;
+  }
+  Serial.printf("[ui] frames=%lu avg=%luus max=%luus last=%luus px(avg/max)=%lu/%lu "
+                "flushes=%lu wait=%luus %s\n",
+                static_cast<unsigned long>(s.frames),
+                static_cast<unsigned long>(s.avgFrameUs),
+                static_cast<unsigned long>(s.maxFrameUs),
+                static_cast<unsigned long>(s.lastFrameUs),
+                static_cast<unsigned long>(s.avgFramePixels),
+                static_cast<unsigned long>(s.maxFramePixels),
+                static_cast<unsigned long>(s.flushes),
+                static_cast<unsigned long>(s.flushWaitUs),
+                s.dma ? "dma" : "blocking");
+}
+
+void LvglPort::refreshEventCb(lv_event_t *e) {
+  LvglPort *self = static_cast<LvglPort *>(lv_event_get_user_data(e));
+  if (!self) {
+    return;
+  }
+
+  if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+    self->frameStartUs_ = micros();
+    self->frameFlushes_ = self->flushes_;
+    self->framePixels_ = 0;
+    return;
+  }
+
+  // Refresh passes with nothing invalidated do not count as frames.
+  if (self->flushes_ == self->frameFlushes_) {
+    return;
+  }
+  const uint32_t elapsed = micros() - self->frameStartUs_;
+  self->lastFrameUs_ = elapsed;
+  self->totalFrameUs_ += elapsed;
+  if (elapsed > self->maxFrameUs_) {
+    self->maxFrameUs_ = elapsed;
+  }
+  ++self->frames_;
+  ++self->frameSequence_;
+  PERF_FRAME(elapsed, self->framePixels_);
+  self->lastFramePixels_ = self->framePixels_;
+  self->totalFramePixels_ += self->framePixels_;
+  if (self->framePixels_ > self->maxFramePixels_) {
+    self->maxFramePixels_ = self->framePixels_;
+  }
+}
+
+void LvglPort::completeFlush() {
+  if (!flushPending_) {
+    return;
+  }
+
+  const uint32_t startUs = micros();
+  tft_.dmaWait();
+  tft_.endWrite();
+  const uint32_t waitUs = micros() - startUs;
+  flushWaitUs_ += waitUs;
+  PERF_RECORD(perf::Component::Flush, waitUs);
+  flushPending_ = false;
+  lv_display_flush_ready(display_);
+}
+
+void LvglPort::flushWaitCb(lv_display_t *disp) {
+  LvglPort *self = static_cast<LvglPort *>(lv_display_get_user_data(disp));
+  if (self) {
+    self->completeFlush();
+  }
+}
+
 void LvglPort::flushCb(lv_display_t *disp, const lv_area_t *area, uint8_t *pxMap) {
   LvglPort *self = static_cast<LvglPort *>(lv_display_get_user_data(disp));
   if (!self) {
@@ -137,11 +329,29 @@ void LvglPort::flushCb(lv_display_t *disp, const lv_area_t *area, uint8_t *pxMap
 
   const uint32_t width = static_cast<uint32_t>(area->x2 - area->x1 + 1);
   const uint32_t height = static_cast<uint32_t>(area->y2 - area->y1 + 1);
+  ++self->flushes_;
+  self->framePixels_ += width * height;
+
+  if (self->dmaEnabled_) {
+    // Queue the band and return; LVGL renders the next band into the other
+    // buffer and calls flushWaitCb before it needs this one back. The bus
+    // stays claimed until the transfer completes.
+    self->completeFlush();
+    self->tft_.startWrite();
+    self->tft_.setAddrWindow(area->x1, area->y1, width, height);
+    self->tft_.pushPixelsDMA(reinterpret_cast<uint16_t *>(pxMap), width * height);
+    self->flushPending_ = true;
+    return;
+  }
 
+  const uint32_t startUs = micros();
   self->tft_.startWrite();
   self->tft_.setAddrWindow(area->x1, area->y1, width, height);
   self->tft_.pushColors(reinterpret_cast<uint16_t *>(pxMap), width * height, true);
   self->tft_.endWrite();
+  const uint32_t waitUs = micros() - startUs;
+  self->flushWaitUs_ += waitUs;
+  PERF_RECORD(perf::Component::Flush, waitUs);
 
   lv_display_flush_ready(disp);
 }
@@ -4,26 +4,79 @@
 #include <TFT_eSPI.h>
 #include <lvgl.h>
 
+// Rolling LVGL refresh timings. flushWaitUs is CPU time spent blocked on the
+// display bus (the whole transfer for a blocking flush, only the tail for DMA).
+// Pixel counts are the invalidated area actually redrawn and flushed.
+struct LvglPortStats {
+  uint32_t frames = 0;
+  uint32_t lastFrameUs = 0;
+  uint32_t avgFrameUs = 0;
+  uint32_t maxFrameUs = 0;
+  uint32_t lastFramePixels = 0;
+  uint32_t avgFramePixels = 0;
+  uint32_t maxFramePixels = 0;
+  uint32_t flushes = 0;
+  uint32_t flushWaitUs = 0;
+  uint16_t bufferLines = 0;
+  bool dma = false;
+  bool buffersInPsram = false;
+};
+
 class LvglPort {
  public:
   LvglPort();
 
   bool begin();
-  void pump();
+  // Runs LVGL timers; returns ms until the next LVGL timer is due
+  // (LV_NO_TIMER_READY when nothing is scheduled).
+  uint32_t pump();
 
   lv_display_t *display() const;
   TFT_eSPI &tft();
   bool ready() const;
 
+  LvglPortStats stats() const;
+  void resetStats();
+  // Frames completed since begin(); never reset by resetStats().
+  uint32_t frameSequence() const;
+  // Waits out an in-flight DMA flush and releases the display bus, so another
+  // device on the shared SPI bus can be used while LVGL is rendering.
+  void finishPendingFlush();
+
  private:
   static void flushCb(lv_display_t *disp, const lv_area_t *area, uint8_t *pxMap);
-  static void *allocateBuffer(size_t bytes);
+  static void flushWaitCb(lv_display_t *disp);
+  static void refreshEventCb(lv_event_t *e);
+  static void *allocateBuffer(size_t bytes, bool dmaCapable, bool *inPsram);
+  bool allocateBuffers(size_t bytes, bool dmaCapable);
+  void releaseBuffers();
+  void completeFlush();
+  void logStats();
 
   TFT_eSPI tft_;
   lv_display_t *display_ = nullptr;
   lv_color_t *buf1_ = nullptr;
   lv_color_t *buf2_ = nullptr;
   uint32_t lastTickMs_ = 0;
+  uint16_t bufferLines_ = 0;
+  bool buffersInPsram_ = false;
+  bool dmaEnabled_ = false;
+  bool flushPending_ = false;
   bool initialized_ = false;
+
+  uint32_t frameStartUs_ = 0;
+  uint32_t frameFlushes_ = 0;
+  uint32_t frames_ = 0;
+  uint32_t frameSequence_ = 0;
+  uint64_t totalFrameUs_ = 0;
+  uint32_t lastFrameUs_ = 0;
+  uint32_t maxFrameUs_ = 0;
+  uint32_t framePixels_ = 0;
+  uint64_t totalFramePixels_ = 0;
+  uint32_t lastFramePixels_ = 0;
+  uint32_t maxFramePixels_ = 0;
+  uint32_t flushes_ = 0;
+  uint32_t flushWaitUs_ = 0;
+  uint32_t lastStatsLogMs_ = 0;
 };
 
@@ -0,0 +1,557 @@
+#include "sd_font.h"
+
+#include <SD.h>
+#include <SPI.h>
+#include <esp_heap_caps.h>
+
+#include <string.h>
+
+#include "../core/board_pins.h"
+#include "../core/perf_profiler.h"
+#include "../core/shared_spi_bus.h"
+#include "user_config.h"
+
+namespace {
+
+constexpr uint32_t kSdSpiFrequencyHz = 25000000UL;
+constexpr char kMagic[4] = {'Z', 'X', 'F', '1'};
+constexpr uint16_t kVersion = 1;
+constexpr size_t kHeaderBytes = 32;
+constexpr size_t kRangeBytes = 12;
+constexpr size_t kGlyphBytes = 12;
+constexpr uint16_t kNone = 0xFFFF;
+constexpr uint16_t kMinCapacity = 16;
+
+struct Range {
+  uint32_t first = 0;
+  uint32_t length = 0;
+  uint32_t firstGlyph = 0;
+};
+
+struct GlyphRecord {
+  uint32_t bitmapOffset = 0;
+  uint16_t advW = 0;  // 1/16 px
+  uint8_t boxW = 0;
+  uint8_t boxH = 0;
+  int8_t ofsX = 0;
+  int8_t ofsY = 0;
+};
+
+// One cache slot; its bitmap lives at gBitmaps + index * gSlotBytes.
+struct Entry {
+  uint32_t codepoint = 0;
+  GlyphRecord glyph;
+  uint16_t prev = kNone;  // LRU list, head is most recent
+  uint16_t next = kNone;
+  uint16_t hashNext = kNone;
+  bool used = false;
+};
+
+File gFile;
+lv_font_t gFont = {};
+bool gReady = false;
+std::function<void()> gBeforeRead;
+
+uint32_t gGlyphCount = 0;
+uint32_t gGlyphsOffset = 0;
+uint32_t gBitmapsOffset = 0;
+uint32_t gFullBitmapBytes = 0;
+uint16_t gSlotBytes = 0;
+
+Range *gRanges = nullptr;
+uint16_t gRangeCount = 0;
+
+Entry *gEntries = nullptr;
+uint8_t *gBitmaps = nullptr;
+uint16_t *gBuckets = nullptr;
+uint16_t gCapacity = 0;
+uint16_t gBucketCount = 0;
+uint16_t gUsed = 0;
+uint16_t gLruHead = kNone;
+uint16_t gLruTail = kNone;
+bool gCacheInPsram = false;
+
+sdfont::CacheStats gStats;
+
+uint16_t readU16(const uint8_t *p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readU32(const uint8_t *p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool ensureSdMounted(String *error) {
+  if (SD.cardType() != CARD_NONE) {
+    return true;
+  }
+
+  if (boardpins::kTftCs >= 0) {
+    pinMode(boardpins::kTftCs, OUTPUT);
+    digitalWrite(boardpins::kTftCs, HIGH);
+  }
+  if (boardpins::kCc1101Cs >= 0) {
+    pinMode(boardpins::kCc1101Cs, OUTPUT);
+    digitalWrite(boardpins::kCc1101Cs, HIGH);
+  }
+  if (boardpins::kSdCs >= 0) {
+    pinMode(boardpins::kSdCs, OUTPUT);
+    digitalWrite(boardpins::kSdCs, HIGH);
+  }
+
+#if !HAL_HAS_SD_CARD
+  if (error) {
+    *error = "No SD card support on this board";
+  }
+  return false;
+#else
+  const bool mounted = SD.begin(boardpins::kSdCs,
+                                *sharedspi::bus(),
+                                kSdSpiFrequencyHz,
+                                "/sd",
+                                8,
+                                false);
+  if (!mounted && error) {
+    *error = "SD mount failed";
+  }
+  return mounted;
+#endif  // HAL_HAS_SD_CARD
+}
+
+bool psramAvailable() {
+#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
+  return psramFound();
+#else
+  return false;
+#endif
+}
+
+void *allocateCacheMemory(size_t bytes) {
+#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
+  if (gCacheInPsram) {
+    return ps_malloc(bytes);
+  }
+#endif
+  return heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void releaseAll() {
+  if (gFile) {
+    gFile.close();
+  }
+  heap_caps_free(gRanges);
+  heap_caps_free(gEntries);
+  heap_caps_free(gBitmaps);
+  heap_caps_free(gBuckets);
+  gRanges = nullptr;
+  gEntries = nullptr;
+  gBitmaps = nullptr;
+  gBuckets = nullptr;
+  gRangeCount = 0;
+  gCapacity = 0;
+  gBucketCount = 0;
+  gUsed = 0;
+  gLruHead = kNone;
+  gLruTail = kNone;
+  gReady = false;
+}
+
+// Reads len bytes at offset; the SD time is accounted in the stats.
+bool readAt(uint32_t offset, uint8_t *out, size_t len) {
+  if (gBeforeRead) {
+    gBeforeRead();
+  }
+
+  const uint32_t startUs = micros();
+  const bool ok = gFile.seek(offset) && gFile.read(out, len) == len;
+  const uint32_t elapsedUs = micros() - startUs;
+  PERF_RECORD(perf::Component::FontIo, elapsedUs);
+  ++gStats.sdReads;
+  gStats.sdReadUs += elapsedUs;
+  if (elapsedUs > gStats.maxSdReadUs) {
+    gStats.maxSdReadUs = elapsedUs;
+  }
+  if (!ok) {
+    ++gStats.sdReadErrors;
+  }
+  return ok;
+}
+
+bool glyphIdFor(uint32_t codepoint, uint32_t *glyphId) {
+  for (uint16_t i = 0; i < gRangeCount; ++i) {
+    const Range &range = gRanges[i];
+    if (codepoint >= range.first && codepoint - range.first < range.length) {
+      *glyphId = range.firstGlyph + (codepoint - range.first);
+      return *glyphId < gGlyphCount;
+    }
+  }
+  return false;
+}
+
+uint16_t bucketFor(uint32_t codepoint) {
+  return static_cast<uint16_t>((codepoint * 2654435761UL) >> 16) & (gBucketCount - 1U);
+}
+
+uint16_t findEntry(uint32_t codepoint) {
+  for (uint16_t i = gBuckets[bucketFor(codepoint)]; i != kNone; i = gEntries[i].hashNext) {
+    if (gEntries[i].codepoint == codepoint) {
+      return i;
+    }
+  }
+  return kNone;
+}
+
+void lruUnlink(uint16_t index) {
+  Entry &entry = gEntries[index];
+  if (entry.prev != kNone) {
+    gEntries[entry.prev].next = entry.next;
+  } else {
+    gLruHead = entry.next;
+  }
+  if (entry.next != kNone) {
+    gEntries[entry.next].prev = entry.prev;
+  } else {
+    gLruTail = entry.prev;
+  }
+  entry.prev = kNone;
+  entry.next = kNone;
+}
+
+void lruPushFront(uint16_t index) {
+  Entry &entry = gEntries[index];
+  entry.prev = kNone;
+  entry.next = gLruHead;
+  if (gLruHead != kNone) {
+    gEntries[gLruHead].prev = index;
+  }
+  gLruHead = index;
+  if (gLruTail == kNone) {
+    gLruTail = index;
+  }
+}
+
+void lruPushBack(uint16_t index) {
+  Entry &entry = gEntries[index];
+  entry.next = kNone;
+  entry.prev = gLruTail;
+  if (gLruTail != kNone) {
+    gEntries[gLruTail].next = index;
+  }
+  gLruTail = index;
+  if (gLruHead == kNone) {
+    gLruHead = index;
+  }
+}
+
+void hashRemove(uint16_t index) {
+  uint16_t *link = &gBuckets[bucketFor(gEntries[index].codepoint)];
+  while (*link != kNone) {
+    if (*link == index) {
+      *link = gEntries[index].hashNext;
+      break;
+    }
+    link = &gEntries[*link].hashNext;
+  }
+  gEntries[index].hashNext = kNone;
+}
+
+void hashInsert(uint16_t index) {
+  uint16_t &head = gBuckets[bucketFor(gEntries[index].codepoint)];
+  gEntries[index].hashNext = head;
+  head = index;
+}
+
+// Free slot, or the least recently used one once the cache is full.
+uint16_t takeSlot() {
+  if (gUsed < gCapacity) {
+    return gUsed++;
+  }
+
+  const uint16_t victim = gLruTail;
+  lruUnlink(victim);
+  if (gEntries[victim].used) {
+    hashRemove(victim);
+    gEntries[victim].used = false;
+    ++gStats.evictions;
+  }
+  return victim;
+}
+
+// Cached entry for the code point, loading it from SD on a miss. kNone when
+// the pack has no such glyph or the read failed.
+uint16_t lookup(uint32_t codepoint) {
+  const uint16_t cached = findEntry(codepoint);
+  if (cached != kNone) {
+    ++gStats.hits;
+    if (gLruHead != cached) {
+      lruUnlink(cached);
+      lruPushFront(cached);
+    }
+    return cached;
+  }
+
+  uint32_t glyphId = 0;
+  if (!glyphIdFor(codepoint, &glyphId)) {
+    return kNone;
+  }
+  ++gStats.misses;
+
+  uint8_t raw[kGlyphBytes];
+  if (!readAt(gGlyphsOffset + glyphId * kGlyphBytes, raw, sizeof(raw))) {
+    return kNone;
+  }
+  GlyphRecord glyph;
+  glyph.bitmapOffset = readU32(raw);
+  glyph.advW = readU16(raw + 4);
+  glyph.boxW = raw[6];
+  glyph.boxH = raw[7];
+  glyph.ofsX = static_cast<int8_t>(raw[8]);
+  glyph.ofsY = static_cast<int8_t>(raw[9]);
+  const size_t bitmapBytes = static_cast<size_t>(glyph.boxW) * glyph.boxH;
+  if (bitmapBytes > gSlotBytes) {
+    ++gStats.sdReadErrors;
+    return kNone;
+  }
+
+  const uint16_t slot = takeSlot();
+  uint8_t *bitmap = gBitmaps + static_cast<size_t>(slot) * gSlotBytes;
+  if (bitmapBytes > 0 && !readAt(gBitmapsOffset + glyph.bitmapOffset, bitmap, bitmapBytes)) {
+    // Park the empty slot at the LRU tail so it is the next one reused.
+    lruPushBack(slot);
+    return kNone;
+  }
+
+  Entry &entry = gEntries[slot];
+  entry.codepoint = codepoint;
+  entry.glyph = glyph;
+  entry.used = true;
+  hashInsert(slot);
+  lruPushFront(slot);
+  return slot;
+}
+
+bool getGlyphDsc(const lv_font_t *font,
+                 lv_font_glyph_dsc_t *dsc,
+                 uint32_t letter,
+                 uint32_t letterNext) {
+  (void)font;
+  (void)letterNext;
+  if (!gReady) {
+    return false;
+  }
+
+  const uint16_t index = lookup(letter);
+  if (index == kNone) {
+    return false;
+  }
+
+  const GlyphRecord &glyph = gEntries[index].glyph;
+  dsc->adv_w = static_cast<uint16_t>((glyph.advW + 8U) >> 4);
+  dsc->box_w = glyph.boxW;
+  dsc->box_h = glyph.boxH;
+  dsc->ofs_x = glyph.ofsX;
+  dsc->ofs_y = glyph.ofsY;
+  dsc->format = LV_FONT_GLYPH_FORMAT_A8;
+  dsc->is_placeholder = false;
+  // The code point, not the slot: the slot may be recycled before the bitmap
+  // is asked for.
+  dsc->gid.index = letter;
+  return true;
+}
+
+const void *getGlyphBitmap(lv_font_glyph_dsc_t *dsc, lv_draw_buf_t *drawBuf) {
+  if (!gReady || !drawBuf) {
+    return nullptr;
+  }
+
+  const uint16_t index = lookup(dsc->gid.index);
+  if (index == kNone) {
+    return nullptr;
+  }
+
+  const GlyphRecord &glyph = gEntries[index].glyph;
+  const uint8_t *src = gBitmaps + static_cast<size_t>(index) * gSlotBytes;
+  uint8_t *dst = static_cast<uint8_t *>(drawBuf->data);
+  const uint32_t stride = drawBuf->header.stride;
+  for (uint8_t y = 0; y < glyph.boxH; ++y) {
+    memcpy(dst + y * stride, src + y * glyph.boxW, glyph.boxW);
+  }
+  return drawBuf;
+}
+
+void appendStatsJson(JsonObject obj) {
+  const sdfont::CacheStats stats = sdfont::stats();
+  obj["ready"] = gReady;
+  obj["hits"] = stats.hits;
+  obj["misses"] = stats.misses;
+  const uint32_t lookups = stats.hits + stats.misses;
+  obj["hitRatePct"] =
+      lookups > 0 ? static_cast<uint32_t>((stats.hits * 100ULL) / lookups) : 0U;
+  obj["evictions"] = stats.evictions;
+  obj["sdReads"] = stats.sdReads;
+  obj["sdReadErrors"] = stats.sdReadErrors;
+  obj["avgSdReadUs"] =
+      stats.sdReads > 0 ? static_cast<uint32_t>(stats.sdReadUs / stats.sdReads) : 0U;
+  obj["maxSdReadUs"] = stats.maxSdReadUs;
+  obj["cachedGlyphs"] = stats.cachedGlyphs;
+  obj["capacityGlyphs"] = stats.capacityGlyphs;
+  obj["glyphCount"] = stats.glyphCount;
+  obj["residentBytes"] = stats.residentBytes;
+  obj["fullBitmapBytes"] = stats.fullBitmapBytes;
+  obj["psram"] = stats.cacheInPsram;
+}
+
+bool fail(const String &message, String *error) {
+  releaseAll();
+  if (error) {
+    *error = message;
+  }
+  return false;
+}
+
+}  // namespace
+
+namespace sdfont {
+
+bool open(const char *path, const lv_font_t *fallback, String *error) {
+  close();
+
+  if (!ensureSdMounted(error)) {
+    return false;
+  }
+
+  gFile = SD.open(path, FILE_READ);
+  if (!gFile) {
+    return fail(String("Font pack not found: ") + path, error);
+  }
+
+  uint8_t header[kHeaderBytes];
+  if (gFile.read(header, sizeof(header)) != sizeof(header) ||
+      memcmp(header, kMagic, sizeof(kMagic)) != 0 || readU16(header + 4) != kVersion) {
+    return fail("Not a ZXF1 font pack", error);
+  }
+
+  const uint16_t headerBytes = readU16(header + 6);
+  const uint8_t lineHeight = header[8];
+  const uint8_t baseLine = header[9];
+  const int8_t underlinePosition = static_cast<int8_t>(header[10]);
+  const uint8_t underlineThickness = header[11];
+  gSlotBytes = readU16(header + 12);
+  gRangeCount = readU16(header + 14);
+  gGlyphCount = readU32(header + 16);
+  const uint32_t rangesOffset = readU32(header + 20);
+  gGlyphsOffset = readU32(header + 24);
+  gBitmapsOffset = readU32(header + 28);
+  const uint32_t fileBytes = gFile.size();
+  if (headerBytes < kHeaderBytes || gRangeCount == 0 || gSlotBytes == 0 ||
+      rangesOffset + gRangeCount * kRangeBytes > gGlyphsOffset ||
+      gGlyphsOffset + gGlyphCount * kGlyphBytes > gBitmapsOffset ||
+      gBitmapsOffset > fileBytes) {
+    return fail("Font pack header is corrupt", error);
+  }
+  gFullBitmapBytes = fileBytes - gBitmapsOffset;
+
+  // Ranges are searched on every lookup, so they stay in internal RAM.
+  gRanges = static_cast<Range *>(
+      heap_caps_malloc(gRangeCount * sizeof(Range), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  if (!gRanges) {
+    return fail("Out of memory for font ranges", error);
+  }
+  for (uint16_t i = 0; i < gRangeCount; ++i) {
+    uint8_t raw[kRangeBytes];
+    if (!readAt(rangesOffset + i * kRangeBytes, raw, sizeof(raw))) {
+      return fail("Font pack read failed", error);
+    }
+    gRanges[i].first = readU32(raw);
+    gRanges[i].length = readU32(raw + 4);
+    gRanges[i].firstGlyph = readU32(raw + 8);
+  }
+
+  gCacheInPsram = psramAvailable();
+  const size_t budget = gCacheInPsram ? USER_KOREAN_FONT_CACHE_BYTES
+                                      : USER_KOREAN_FONT_CACHE_INTERNAL_BYTES;
+  size_t capacity = budget / (gSlotBytes + sizeof(Entry));
+  if (capacity < kMinCapacity) {
+    capacity = kMinCapacity;
+  }
+  if (capacity > kNone - 1U) {
+    capacity = kNone - 1U;
+  }
+  gCapacity = static_cast<uint16_t>(capacity);
+  gBucketCount = 1;
+  while (gBucketCount < gCapacity) {
+    gBucketCount <<= 1;
+  }
+
+  gBitmaps = static_cast<uint8_t *>(
+      allocateCacheMemory(static_cast<size_t>(gCapacity) * gSlotBytes));
+  gEntries = static_cast<Entry *>(allocateCacheMemory(gCapacity * sizeof(Entry)));
+  gBuckets = static_cast<uint16_t *>(heap_caps_malloc(gBucketCount * sizeof(uint16_t),
+                                                      MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  if (!gBitmaps || !gEntries || !gBuckets) {
+    return fail("Out of memory for glyph cache", error);
+  }
+  for (uint16_t i = 0; i < gCapacity; ++i) {
+    gEntries[i] = Entry();
+  }
+  for (uint16_t i = 0; i < gBucketCount; ++i) {
+    gBuckets[i] = kNone;
+  }
+
+  gFont = lv_font_t();
+  gFont.get_glyph_dsc = getGlyphDsc;
+  gFont.get_glyph_bitmap = getGlyphBitmap;
+  gFont.line_height = lineHeight;
+  gFont.base_line = baseLine;
+  gFont.subpx = LV_FONT_SUBPX_NONE;
+  gFont.underline_position = underlinePosition;
+  gFont.underline_thickness = underlineThickness;
+  gFont.fallback = fallback;
+  gReady = true;
+  gStats = sdfont::CacheStats();
+
+  static bool reportRegistered = false;
+  if (!reportRegistered) {
+    reportRegistered = perf::addJsonSection("fontCache", appendStatsJson);
+  }
+
+  Serial.printf("[font] %s: %lu glyphs, cache %u x %u B in %s\n",
+                path,
+                static_cast<unsigned long>(gGlyphCount),
+                static_cast<unsigned>(gCapacity),
+                static_cast<unsigned>(gSlotBytes),
+                gCacheInPsram ? "PSRAM" : "internal RAM");
+  return true;
+}
+
+void close() {
+  releaseAll();
+}
+
+bool ready() {
+  return gReady;
+}
+
+const lv_font_t *font() {
+  return gReady ? &gFont : nullptr;
+}
+
+CacheStats stats() {
+  CacheStats out = gStats;
+  out.cachedGlyphs = gUsed;
+  out.capacityGlyphs = gCapacity;
+  out.residentBytes = static_cast<uint32_t>(gCapacity) * (gSlotBytes + sizeof(Entry)) +
+                      gBucketCount * sizeof(uint16_t) +
+                      gRangeCount * sizeof(Range);
+  out.fullBitmapBytes = gFullBitmapBytes;
+  out.glyphCount = gGlyphCount;
+  out.cacheInPsram = gCacheInPsram;
+  return out;
+}
+
+void setBeforeReadHook(const std::function<void()> &hook) {
+  gBeforeRead = hook;
+}
+
+}  // namespace sdfont
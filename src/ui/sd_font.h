@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+#include <functional>
+
+// LVGL font served from a ZXF1 font pack on SD (scripts/make_font_pack.py).
+// Only the range table stays resident; glyph metrics and A8 bitmaps are read
+// on first use and kept in a fixed-size LRU cache (PSRAM when available).
+// Used from the loop task only. The cache also reports as "fontCache" in the
+// profiler JSON (system.perf).
+namespace sdfont {
+
+// Counters run from the last successful open().
+struct CacheStats {
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  uint32_t evictions = 0;
+  uint32_t sdReads = 0;
+  uint32_t sdReadErrors = 0;
+  uint64_t sdReadUs = 0;
+  uint32_t maxSdReadUs = 0;
+  uint16_t cachedGlyphs = 0;
+  uint16_t capacityGlyphs = 0;
+  // RAM held by the cache, its index and the range table.
+  uint32_t residentBytes = 0;
+  // What the same glyphs would take fully decompressed in RAM.
+  uint32_t fullBitmapBytes = 0;
+  uint32_t glyphCount = 0;
+  bool cacheInPsram = false;
+};
+
+// Mounts SD if needed and opens the pack. Glyphs missing from the pack are
+// looked up in fallback.
+bool open(const char *path, const lv_font_t *fallback, String *error = nullptr);
+void close();
+bool ready();
+// nullptr until open() succeeds.
+const lv_font_t *font();
+
+CacheStats stats();
+
+// Runs before every SD access. Glyphs can be fetched mid-render, while a DMA
+// flush may still hold the shared SPI bus; the hook must release it.
+void setBeforeReadHook(const std::function<void()> &hook);
+
+}  // namespace sdfont
@@ -9,7 +9,8 @@
 #include "ui_runtime.h"
 
 void UiNavigator::runLauncher(AppContext &ctx,
-                              const std::function<void()> &backgroundTick) {
+                              const std::function<void()> &backgroundTick,
+                              const std::function<void()> &launcherTick) {
   if (!ctx.uiRuntime) {
     return;
   }
@@ -26,7 +27,7 @@ void UiNavigator::runLauncher(AppContext &ctx,
   const int choice = ctx.uiRuntime->launcherLoop(uiText(lang, UiTextKey::Launcher),
                                                  items,
                                                  selected_,
-                                                 backgroundTick);
+                                                 launcherTick ? launcherTick : backgroundTick);
   if (choice < 0) {
     return;
   }
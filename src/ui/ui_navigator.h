@@ -6,7 +6,11 @@
 
 class UiNavigator {
  public:
-  void runLauncher(AppContext &ctx, const std::function<void()> &backgroundTick);
+  // Apps get backgroundTick; the launcher menu itself runs launcherTick,
+  // or backgroundTick when none is given.
+  void runLauncher(AppContext &ctx,
+                   const std::function<void()> &backgroundTick,
+                   const std::function<void()> &launcherTick = std::function<void()>());
 
  private:
   int selected_ = 0;
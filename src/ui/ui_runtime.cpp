@@ -1,8 +1,6 @@
 #include "ui_runtime.h"
 
 #include <WiFi.h>
-#include <WiFiClientSecure.h>
-#include <Wire.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <lvgl.h>
@@ -11,13 +9,17 @@
 #include <time.h>
 #include <string.h>
 #include <stdlib.h>
-#include <sys/time.h>
 
 #include "../core/board_pins.h"
+#include "../core/perf_profiler.h"
+#include "../core/power_manager.h"
+#include "../core/system_status.h"
+#include "../core/ui_events.h"
 #include "fonts/lv_font_korean_ui_14.h"
 #include "input_adapter.h"
 #include "launcher_icons.h"
 #include "lvgl_port.h"
+#include "sd_font.h"
 #include "user_config.h"
 
 namespace {
@@ -46,17 +48,16 @@ constexpr lv_opa_t kOpa90 = static_cast<lv_opa_t>(230);
 constexpr lv_opa_t kOpa92 = static_cast<lv_opa_t>(235);
 
 constexpr unsigned long kHeaderRefreshMs = 1000UL;
-constexpr unsigned long kBatteryPollMs = 5000UL;
-constexpr unsigned long kNtpRetryMs = 30000UL;
-constexpr unsigned long kUnixSyncRetryMs = 30000UL;
-constexpr unsigned long kUnixSyncRefreshMs = 15UL * 60UL * 1000UL;
-constexpr unsigned long kUiLoopDelayMs = 2UL;
 constexpr unsigned long kBackgroundTickMinIntervalMs = 20UL;
+// With no input for kInputIdleMs the UI wait stretches to kIdleWaitMs and may
+// light-sleep; background ticks then run at that cadence.
+constexpr unsigned long kInputIdleMs = 3000UL;
+constexpr unsigned long kIdleWaitMs = 100UL;
+constexpr uint32_t kWakeToRenderTimeoutUs = 1000000UL;
+constexpr unsigned long kRenderStatsLogIntervalMs = 5000UL;
 constexpr uint32_t kTlsMinInternalFreeBytesUi = 36000U;
 constexpr uint32_t kTlsMinInternalLargestBytesUi = 18000U;
 constexpr time_t kMinValidUnixTimeSec = 946684800;  // 2000-01-01T00:00:00Z
-constexpr uint64_t kWindowsEpochOffset100Ns = 116444736000000000ULL;
-constexpr uint64_t kHundredNsPerSecond = 10000000ULL;
 
 constexpr uint32_t kLauncherBg = kClrBg;
 constexpr uint32_t kLauncherPrimary = 0xEAF6FF;
@@ -244,55 +245,15 @@ String normalizeTimezoneForPosix(const String &tz) {
   return trimmed;
 }
 
-bool extractUint64JsonField(const String &json, const char *key, uint64_t *valueOut) {
-  if (!key || !valueOut) {
-    return false;
-  }
-
-  String token = "\"";
-  token += key;
-  token += "\":";
-
-  int idx = json.indexOf(token);
-  if (idx < 0) {
-    return false;
-  }
-  idx += token.length();
-
-  while (idx < static_cast<int>(json.length())) {
-    const char c = json[static_cast<unsigned int>(idx)];
-    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
-      ++idx;
-      continue;
-    }
-    break;
-  }
-
-  uint64_t value = 0;
-  bool hasDigit = false;
-  constexpr uint64_t kMaxBeforeMul10 = UINT64_MAX / 10ULL;
-  constexpr uint64_t kMaxLastDigit = UINT64_MAX % 10ULL;
-
-  while (idx < static_cast<int>(json.length())) {
-    const char c = json[static_cast<unsigned int>(idx)];
-    if (c < '0' || c > '9') {
-      break;
-    }
-    hasDigit = true;
-    const uint64_t digit = static_cast<uint64_t>(c - '0');
-    if (value > kMaxBeforeMul10 || (value == kMaxBeforeMul10 && digit > kMaxLastDigit)) {
-      return false;
+// Letters (code points) in a UTF-8 string; LVGL indexes label text by them.
+uint32_t utf8Letters(const String &text) {
+  uint32_t letters = 0;
+  for (size_t i = 0; i < text.length(); ++i) {
+    if ((static_cast<uint8_t>(text[static_cast<unsigned int>(i)]) & 0xC0U) != 0x80U) {
+      ++letters;
     }
-    value = value * 10ULL + digit;
-    ++idx;
-  }
-
-  if (!hasDigit) {
-    return false;
   }
-
-  *valueOut = value;
-  return true;
+  return letters;
 }
 
 String ellipsize(const String &text, size_t maxLen) {
@@ -346,6 +307,26 @@ LauncherIconId iconIdFromLauncherIndex(int index) {
   }
 }
 
+// Screens whose widgets are kept between renders and updated in place.
+enum class RetainedView : uint8_t {
+  None = 0,
+  Menu = 1,
+  Info = 2,
+  Launcher = 3,
+};
+
+uint32_t countObjects(lv_obj_t *obj) {
+  if (!obj) {
+    return 0;
+  }
+  uint32_t total = 0;
+  const uint32_t childCount = lv_obj_get_child_count(obj);
+  for (uint32_t i = 0; i < childCount; ++i) {
+    total += 1U + countObjects(lv_obj_get_child(obj, static_cast<int32_t>(i)));
+  }
+  return total;
+}
+
 }  // namespace
 
 class UiRuntime::Impl {
@@ -358,20 +339,15 @@ class UiRuntime::Impl {
   bool koreanFontInstalled = false;
   String timezoneTz = USER_TIMEZONE_TZ;
   String timezonePosixTz = USER_TIMEZONE_TZ;
+  SystemStatusService systemStatus;
 
   String headerTime;
   String headerStatus;
   int batteryPct = -1;
   bool batteryCharging = false;
   bool batteryChargingKnown = false;
-  bool batteryWireReady = false;
   uint8_t displayBrightnessPercent = clampBrightnessPercent(USER_DISPLAY_BRIGHTNESS_PERCENT);
-  bool ntpStarted = false;
   bool launcherIconsAvailable = false;
-  unsigned long lastNtpAttemptMs = 0;
-  unsigned long lastUnixSyncAttemptMs = 0;
-  unsigned long lastUnixSyncSuccessMs = 0;
-  unsigned long lastBatteryPollMs = 0;
   unsigned long lastHeaderUpdateMs = 0;
 
   lv_obj_t *progressOverlay = nullptr;
@@ -390,18 +366,66 @@ class UiRuntime::Impl {
   int textInputCacheSelected = -1;
   int textInputCacheCapsIndex = -1;
   unsigned long textInputLastFullRenderMs = 0;
+
+  // Retained menu/info/launcher widgets. All of them die with the header (or
+  // launcher top bar) anchor, whose delete event clears these handles.
+  RetainedView retainedView = RetainedView::None;
+  String retainedTitle;
+  String retainedSubtitle;
+  String retainedFooter;
+  std::vector<String> retainedItems;
+  // Set instead of retainedItems while a list-source menu is shown.
+  const UiListSource *retainedSource = nullptr;
+  size_t retainedSourceCount = 0;
+  // Rows that fit on the menu screen; fewer are built for short lists.
+  size_t retainedRowCapacity = 0;
+  std::vector<lv_obj_t *> retainedRows;
+  std::vector<lv_obj_t *> retainedLabels;
+  lv_obj_t *retainedMarker = nullptr;
+  int retainedStart = -1;
+  int retainedSelected = -1;
+  lv_obj_t *launcherIcons[3] = {nullptr, nullptr, nullptr};
+  lv_obj_t *launcherNameLabel = nullptr;
+  lv_obj_t *launcherFallbackLabel = nullptr;
+  lv_obj_t *launcherSideLabel = nullptr;
+  int launcherNameY = 0;
+  int launcherBatteryKey = -1;
+  lv_obj_t *headerTimeLabel = nullptr;
+  String headerTimeShown;
+  // Messenger message label, the letter index each chat line starts at and
+  // the current scroll, so a line can be kept in place when the chat window
+  // gains or drops lines.
+  lv_obj_t *messengerLabel = nullptr;
+  std::vector<uint32_t> messengerLineStarts;
+  int messengerScrollPx = 0;
+
+  UiRenderStats stats;
+  bool buildPending = false;
+  unsigned long lastRenderStatsLogMs = 0;
+
   bool serviceActive = false;
   unsigned long lastBackgroundTickMs = 0;
+  uint32_t lvglNextTimerMs = 0;
+  uint32_t inputEdgeUs = 0;
+  uint32_t inputEdgeFrame = 0;
+  uint64_t waitUs = 0;
 
   bool begin() {
+    uievents::begin();
     if (!port.begin()) {
       return false;
     }
 
     applyBacklight();
     input.begin(port.display());
+    sdfont::setBeforeReadHook([this]() { port.finishPendingFlush(); });
     applyTheme();
     launcherIconsAvailable = initLauncherIcons();
+    systemStatus.setTimezone(timezonePosixTz);
+    systemStatus.begin();
+    WiFi.onEvent([](arduino_event_id_t, arduino_event_info_t) {
+      uievents::post(uievents::kNetwork);
+    });
     return true;
   }
 
@@ -430,20 +454,56 @@ class UiRuntime::Impl {
 
   const lv_font_t *font() const {
     if (koreanFontInstalled) {
+      if (sdfont::ready()) {
+        return sdfont::font();
+      }
+#if USER_KOREAN_FONT_BUILTIN
       return &lv_font_korean_ui_14;
+#endif
     }
     return &lv_font_montserrat_14;
   }
 
+  void setKoreanFontInstalled(bool installed) {
+    koreanFontInstalled = installed;
+    if (!installed) {
+      sdfont::close();
+    } else if (!sdfont::ready()) {
+      String err;
+      if (!sdfont::open(USER_KOREAN_FONT_PACK_PATH, &lv_font_montserrat_14, &err)) {
+        Serial.printf("[ui] Korean font pack unavailable (%s), using %s\n",
+                      err.c_str(),
+                      USER_KOREAN_FONT_BUILTIN ? "built-in font" : "Latin font");
+      }
+    }
+    if (port.ready()) {
+      applyTheme();
+    }
+  }
+
   void service(const std::function<void()> *backgroundTick = nullptr) {
     if (serviceActive) {
       return;
     }
 
     serviceActive = true;
+    PERF_SCOPE(perf::Component::Service);
+    if (buildPending) {
+      finishBuild();
+    }
+    if (inputEdgeUs == 0) {
+      inputEdgeUs = uievents::takeInputEdgeUs();
+      inputEdgeFrame = port.frameSequence();
+    }
     const unsigned long startMs = millis();
-    input.tick();
-    port.pump();
+    {
+      PERF_SCOPE(perf::Component::Input);
+      input.tick();
+    }
+    {
+      PERF_SCOPE(perf::Component::Lvgl);
+      port.pump();
+    }
     const unsigned long now = millis();
     if (backgroundTick && *backgroundTick &&
         (lastBackgroundTickMs == 0 ||
@@ -451,112 +511,297 @@ class UiRuntime::Impl {
       lastBackgroundTickMs = now;
       (*backgroundTick)();
     }
-    // Poll once more after background work so short pulses are less likely
-    // to be missed when Wi-Fi/gateway ticks temporarily block.
-    input.tick();
-    port.pump();
+    // Edges and encoder counts are captured in hardware/ISRs while background
+    // work runs; collect them so this pump already draws the result.
+    {
+      PERF_SCOPE(perf::Component::Input);
+      input.tick();
+    }
+    {
+      PERF_SCOPE(perf::Component::Lvgl);
+      lvglNextTimerMs = port.pump();
+    }
+    trackWakeToRender();
 #if USER_INPUT_TRACE_ENABLED
     const unsigned long elapsedMs = millis() - startMs;
     if (elapsedMs >= 40UL) {
       Serial.printf("[ui] service stall: %lu ms\n", elapsedMs);
     }
+#endif
+#if USER_UI_FRAME_TRACE_ENABLED
+    if (now - lastRenderStatsLogMs >= kRenderStatsLogIntervalMs) {
+      lastRenderStatsLogMs = now;
+      Serial.printf("[ui] builds=%lu objs=%lu (last %lu) in-place=%lu "
+                    "wake->render last=%luus max=%luus wait=%lums sleeps=%lu\n",
+                    static_cast<unsigned long>(stats.fullBuilds),
+                    static_cast<unsigned long>(stats.objectsCreated),
+                    static_cast<unsigned long>(stats.lastBuildObjects),
+                    static_cast<unsigned long>(stats.inPlaceUpdates),
+                    static_cast<unsigned long>(stats.lastWakeToRenderUs),
+                    static_cast<unsigned long>(stats.maxWakeToRenderUs),
+                    static_cast<unsigned long>(waitUs / 1000ULL),
+                    static_cast<unsigned long>(stats.lightSleepWaits));
+    }
 #endif
     serviceActive = false;
   }
 
-  UiEvent pollInput() {
-    const InputEvent ev = input.pollEvent();
-    UiEvent out;
-    out.delta = ev.delta;
-    out.ok = ev.ok || ev.okCount > 0;
-    out.back = ev.back || ev.backCount > 0;
-    out.okLong = ev.okLong || ev.okLongCount > 0;
-    out.okCount = ev.okCount;
-    out.backCount = ev.backCount;
-    out.okLongCount = ev.okLongCount;
-    return out;
-  }
-
-  bool ensureBatteryI2cReady() {
-#if USER_BATTERY_GAUGE_ENABLED
-    if (!batteryWireReady) {
-      Wire.begin(USER_BATTERY_GAUGE_SDA, USER_BATTERY_GAUGE_SCL);
-      Wire.setTimeOut(5);
-      batteryWireReady = true;
+  void trackWakeToRender() {
+    if (inputEdgeUs == 0) {
+      return;
+    }
+    const uint32_t elapsedUs = micros() - inputEdgeUs;
+    if (port.frameSequence() != inputEdgeFrame) {
+      stats.lastWakeToRenderUs = elapsedUs;
+      if (elapsedUs > stats.maxWakeToRenderUs) {
+        stats.maxWakeToRenderUs = elapsedUs;
+      }
+      inputEdgeUs = 0;
+    } else if (elapsedUs >= kWakeToRenderTimeoutUs) {
+      // The edge changed nothing on screen (contact bounce, blocked keys).
+      inputEdgeUs = 0;
     }
-    return true;
-#else
-    return false;
-#endif
   }
 
-  int readBatteryPercent() {
-#if USER_BATTERY_GAUGE_ENABLED
-    if (!ensureBatteryI2cReady()) {
-      return -1;
+  // Replaces the fixed loop delay: blocks until input, a Wi-Fi event, the
+  // next LVGL timer or the background tick is due. After kInputIdleMs without
+  // input the wait also lets the chip light-sleep, woken by the input pins.
+  void waitForEvents() {
+    if (input.hasPendingInput()) {
+      return;
     }
 
-    Wire.beginTransmission(USER_BATTERY_GAUGE_ADDR);
-    Wire.write(USER_BATTERY_GAUGE_SOC_REG);
-    if (Wire.endTransmission(false) != 0) {
-      return -1;
+    const bool idle = input.idleFor(kInputIdleMs);
+    uint32_t timeoutMs = idle ? kIdleWaitMs : kBackgroundTickMinIntervalMs;
+    if (lvglNextTimerMs < timeoutMs) {
+      timeoutMs = lvglNextTimerMs;
     }
-
-    const int readCount = Wire.requestFrom(static_cast<int>(USER_BATTERY_GAUGE_ADDR), 2);
-    if (readCount < 2) {
-      return -1;
+    if (timeoutMs == 0) {
+      // Still block one tick so the idle task can run and feed the watchdog.
+      timeoutMs = 1;
     }
 
-    const uint8_t lo = static_cast<uint8_t>(Wire.read());
-    const uint8_t hi = static_cast<uint8_t>(Wire.read());
-    const int pct = (static_cast<int>(hi) << 8) | static_cast<int>(lo);
-    if (pct < 0 || pct > 100) {
-      return -1;
+    const bool lightSleep =
+        idle && powermgr::lightSleepEnabled() && input.armSleepWake();
+    powermgr::setUiIdle(true, lightSleep);
+    const uint32_t startUs = micros();
+    uievents::wait(timeoutMs);
+    waitUs += micros() - startUs;
+    powermgr::setUiIdle(false, false);
+    if (lightSleep) {
+      input.disarmSleepWake();
+      ++stats.lightSleepWaits;
     }
-    return pct;
-#else
-    return -1;
-#endif
   }
 
-  bool readBatteryCharging(bool *known = nullptr) {
-#if USER_BATTERY_GAUGE_ENABLED
-    if (known) {
-      *known = false;
+  // A full build frees every object on the screen and allocates a new set,
+  // so the object count after the build is the allocation count.
+  void beginBuild() {
+    clearRetainedHandles();
+    buildPending = true;
+  }
+
+  void finishBuild() {
+    buildPending = false;
+    const uint32_t objects = countObjects(lv_screen_active());
+    ++stats.fullBuilds;
+    stats.objectsCreated += objects;
+    stats.lastBuildObjects = objects;
+  }
+
+  UiRenderStats renderStats() const {
+    UiRenderStats out = stats;
+    const LvglPortStats frame = port.stats();
+    out.frames = frame.frames;
+    out.avgFrameUs = frame.avgFrameUs;
+    out.maxFrameUs = frame.maxFrameUs;
+    out.lastFramePixels = frame.lastFramePixels;
+    out.avgFramePixels = frame.avgFramePixels;
+    out.maxFramePixels = frame.maxFramePixels;
+    out.waitMs = static_cast<uint32_t>(waitUs / 1000ULL);
+    return out;
+  }
+
+  void resetRenderStats() {
+    stats = UiRenderStats();
+    waitUs = 0;
+    port.resetStats();
+  }
+
+  void clearRetainedHandles() {
+    retainedView = RetainedView::None;
+    retainedTitle = "";
+    retainedSubtitle = "";
+    retainedFooter = "";
+    retainedItems.clear();
+    retainedSource = nullptr;
+    retainedSourceCount = 0;
+    retainedRowCapacity = 0;
+    retainedRows.clear();
+    retainedLabels.clear();
+    retainedMarker = nullptr;
+    retainedStart = -1;
+    retainedSelected = -1;
+    for (lv_obj_t *&icon : launcherIcons) {
+      icon = nullptr;
+    }
+    launcherNameLabel = nullptr;
+    launcherFallbackLabel = nullptr;
+    launcherSideLabel = nullptr;
+    launcherBatteryKey = -1;
+    headerTimeLabel = nullptr;
+    headerTimeShown = "";
+    messengerLabel = nullptr;
+    messengerLineStarts.clear();
+    messengerScrollPx = 0;
+  }
+
+  static void onRetainedAnchorDeleted(lv_event_t *e) {
+    Impl *self = static_cast<Impl *>(lv_event_get_user_data(e));
+    if (self) {
+      self->clearRetainedHandles();
+    }
+  }
+
+  void anchorRetained(lv_obj_t *anchor) {
+    lv_obj_add_event_cb(anchor, onRetainedAnchorDeleted, LV_EVENT_DELETE, this);
+  }
+
+  bool retainedListMatches(RetainedView view,
+                           const String &title,
+                           const String &subtitle,
+                           const String &footer,
+                           const std::vector<String> &items) const {
+    return retainedView == view &&
+           !retainedRows.empty() &&
+           retainedTitle == title &&
+           retainedSubtitle == subtitle &&
+           retainedFooter == footer &&
+           retainedItems == items;
+  }
+
+  void styleMenuRow(lv_obj_t *row, bool isSelected) const {
+    lv_obj_set_style_bg_color(row,
+                              isSelected ? lv_color_hex(kClrAccentSoft) : lv_color_hex(kClrPanel),
+                              kStyleAny);
+    lv_obj_set_style_border_color(row,
+                                  isSelected ? lv_color_hex(kClrAccent) : lv_color_hex(kClrBorder),
+                                  kStyleAny);
+  }
+
+  int retainedItemCount() const {
+    return retainedSource ? static_cast<int>(retainedSourceCount)
+                          : static_cast<int>(retainedItems.size());
+  }
+
+  // Points the retained rows at items[start..]. Labels are rewritten only when
+  // the window scrolls; otherwise just the old and new selected rows change.
+  void applyListWindow(int start, int selected) {
+    const bool scrolled = start != retainedStart;
+    const bool menu = retainedView == RetainedView::Menu;
+    const int itemCount = retainedItemCount();
+    lv_obj_t *markerRow = nullptr;
+
+    for (size_t row = 0; row < retainedRows.size(); ++row) {
+      lv_obj_t *holder = retainedRows[row];
+      const int index = start + static_cast<int>(row);
+      const bool visible = index >= 0 && index < itemCount;
+      if (scrolled) {
+        if (visible && retainedSource) {
+          // Source rows may be relabelled on every pass while a list loads;
+          // unchanged text is left alone so it is not redrawn.
+          const String text = retainedSource->label(static_cast<size_t>(index));
+          if (strcmp(lv_label_get_text(retainedLabels[row]), text.c_str()) != 0) {
+            lv_label_set_text(retainedLabels[row], text.c_str());
+          }
+          lv_obj_clear_flag(holder, LV_OBJ_FLAG_HIDDEN);
+        } else if (visible) {
+          lv_label_set_text(retainedLabels[row],
+                            retainedItems[static_cast<size_t>(index)].c_str());
+          lv_obj_clear_flag(holder, LV_OBJ_FLAG_HIDDEN);
+        } else {
+          lv_obj_add_flag(holder, LV_OBJ_FLAG_HIDDEN);
+        }
+      }
+      if (!menu || !visible) {
+        continue;
+      }
+
+      const bool isSelected = index == selected;
+      const bool wasSelected =
+          retainedStart >= 0 && retainedStart + static_cast<int>(row) == retainedSelected;
+      if (scrolled || isSelected != wasSelected) {
+        styleMenuRow(holder, isSelected);
+      }
+      if (isSelected) {
+        markerRow = holder;
+      }
     }
 
-    if (!ensureBatteryI2cReady()) {
-      return false;
+    if (retainedMarker) {
+      if (markerRow) {
+        if (lv_obj_get_parent(retainedMarker) != markerRow) {
+          lv_obj_set_parent(retainedMarker, markerRow);
+        }
+        lv_obj_clear_flag(retainedMarker, LV_OBJ_FLAG_HIDDEN);
+      } else {
+        lv_obj_add_flag(retainedMarker, LV_OBJ_FLAG_HIDDEN);
+      }
     }
 
-    constexpr uint8_t kPmuAddr = 0x6B;   // BQ25896
-    constexpr uint8_t kStatusReg = 0x0B; // CHRG_STAT[4:3]
+    retainedStart = start;
+    retainedSelected = selected;
+  }
 
-    Wire.beginTransmission(kPmuAddr);
-    Wire.write(kStatusReg);
-    if (Wire.endTransmission(false) != 0) {
-      return false;
+  int batteryIconKey() const {
+    int filled = -1;
+    if (batteryPct >= 0) {
+      filled = (batteryPct + 24) / 25;
     }
+    const bool charging = batteryChargingKnown && batteryCharging;
+    return (filled + 1) * 2 + (charging ? 1 : 0);
+  }
 
-    const int readCount = Wire.requestFrom(static_cast<int>(kPmuAddr), 1);
-    if (readCount < 1) {
-      return false;
+  // Periodic header refresh for retained screens: updates the clock label in
+  // place and only rebuilds the launcher when its battery icon changes.
+  void refreshHeader() {
+    updateHeaderIndicators();
+
+    if (retainedView == RetainedView::Launcher && batteryIconKey() != launcherBatteryKey) {
+      const String title = retainedTitle;
+      const std::vector<String> items = retainedItems;
+      const int selected = retainedSelected;
+      renderLauncher(title, items, selected);
+      return;
     }
 
-    const uint8_t status = static_cast<uint8_t>(Wire.read());
-    const uint8_t chargeState = static_cast<uint8_t>((status >> 3) & 0x03);
-    if (known) {
-      *known = true;
+    if (!headerTimeLabel) {
+      return;
     }
-    return chargeState == 1U || chargeState == 2U;
-#else
-    if (known) {
-      *known = false;
+    const String timeText = headerTime.length() > 0 ? headerTime : String("--:--");
+    if (timeText != headerTimeShown) {
+      lv_label_set_text(headerTimeLabel, timeText.c_str());
+      headerTimeShown = timeText;
+      ++stats.inPlaceUpdates;
     }
-    return false;
-#endif
   }
 
+  UiEvent pollInput() {
+    const InputEvent ev = input.pollEvent();
+    UiEvent out;
+    out.delta = ev.delta;
+    out.ok = ev.ok || ev.okCount > 0;
+    out.back = ev.back || ev.backCount > 0;
+    out.okLong = ev.okLong || ev.okLongCount > 0;
+    out.okCount = ev.okCount;
+    out.backCount = ev.backCount;
+    out.okLongCount = ev.okLongCount;
+    return out;
+  }
+
+  // Rendering only reads the snapshot published by SystemStatusService;
+  // time sync, I2C and Wi-Fi queries all happen on its task. Only the SNTP
+  // start comes back here, since it rewrites TZ under localtime_r().
   void updateHeaderIndicators() {
     const unsigned long now = millis();
     if (now - lastHeaderUpdateMs < kHeaderRefreshMs) {
@@ -564,39 +809,11 @@ class UiRuntime::Impl {
     }
     lastHeaderUpdateMs = now;
 
-    const bool wifiConnected = WiFi.status() == WL_CONNECTED;
-    if (wifiConnected && !ntpStarted) {
-      const char *tz = timezonePosixTz.isEmpty() ? USER_TIMEZONE_TZ : timezonePosixTz.c_str();
-      configTzTime(tz, USER_NTP_SERVER_1, USER_NTP_SERVER_2);
-      ntpStarted = true;
-      lastNtpAttemptMs = now;
-    }
-
-    time_t unixNow = time(nullptr);
-    bool unixValid = isValidUnixTime(unixNow);
-    if (wifiConnected && ntpStarted && !unixValid &&
-        now - lastNtpAttemptMs >= kNtpRetryMs) {
-      const char *tz = timezonePosixTz.isEmpty() ? USER_TIMEZONE_TZ : timezonePosixTz.c_str();
-      configTzTime(tz, USER_NTP_SERVER_1, USER_NTP_SERVER_2);
-      lastNtpAttemptMs = now;
-    }
-
-    const bool unixSyncDue =
-        wifiConnected &&
-        (lastUnixSyncAttemptMs == 0 ||
-         (!unixValid && (now - lastUnixSyncAttemptMs >= kUnixSyncRetryMs)) ||
-         (unixValid && (lastUnixSyncSuccessMs == 0 ||
-                        now - lastUnixSyncSuccessMs >= kUnixSyncRefreshMs)));
-    if (unixSyncDue) {
-      lastUnixSyncAttemptMs = now;
-      if (syncUnixTimeFromServer(nullptr)) {
-        lastUnixSyncSuccessMs = now;
-        unixNow = time(nullptr);
-        unixValid = isValidUnixTime(unixNow);
-      }
-    }
+    const SystemStatusSnapshot status = systemStatus.snapshot();
+    systemStatus.applyTimeConfig();
 
-    if (unixValid) {
+    const time_t unixNow = time(nullptr);
+    if (isValidUnixTime(unixNow)) {
       struct tm timeInfo;
       if (localtime_r(&unixNow, &timeInfo) != nullptr) {
         char buf[6];
@@ -609,26 +826,24 @@ class UiRuntime::Impl {
       headerTime = "--:--";
     }
 
-    if (now - lastBatteryPollMs >= kBatteryPollMs || batteryPct < 0) {
-      lastBatteryPollMs = now;
-      batteryPct = readBatteryPercent();
-      batteryCharging = readBatteryCharging(&batteryChargingKnown);
-    }
+    batteryPct = status.batteryPct;
+    batteryCharging = status.batteryCharging;
+    batteryChargingKnown = status.batteryChargingKnown;
 
-    String status = "W:";
-    if (WiFi.status() == WL_CONNECTED) {
-      status += String(WiFi.RSSI());
+    String text = "W:";
+    if (status.wifiConnected) {
+      text += String(status.wifiRssi);
     } else {
-      status += "--";
+      text += "--";
     }
-    status += " B:";
+    text += " B:";
     if (batteryPct >= 0) {
-      status += String(batteryPct);
-      status += "%";
+      text += String(batteryPct);
+      text += "%";
     } else {
-      status += "--";
+      text += "--";
     }
-    headerStatus = status;
+    headerStatus = text;
   }
 
   void setTimezone(const String &tz) {
@@ -641,10 +856,7 @@ class UiRuntime::Impl {
     timezonePosixTz = normalizeTimezoneForPosix(next);
     setenv("TZ", timezonePosixTz.c_str(), 1);
     tzset();
-    ntpStarted = false;
-    lastNtpAttemptMs = 0;
-    lastUnixSyncAttemptMs = 0;
-    lastUnixSyncSuccessMs = 0;
+    systemStatus.setTimezone(timezonePosixTz);
   }
 
   String timezone() const {
@@ -733,9 +945,6 @@ class UiRuntime::Impl {
     }
 
     setTimezone(tz);
-    configTzTime(timezonePosixTz.c_str(), USER_NTP_SERVER_1, USER_NTP_SERVER_2);
-    ntpStarted = true;
-    lastNtpAttemptMs = millis();
 
     if (resolvedTz) {
       *resolvedTz = timezoneTz;
@@ -743,97 +952,6 @@ class UiRuntime::Impl {
     return true;
   }
 
-  bool syncUnixTimeFromServer(String *error) {
-    if (error) {
-      error->clear();
-    }
-
-    if (WiFi.status() != WL_CONNECTED) {
-      if (error) {
-        *error = "Wi-Fi not connected";
-      }
-      return false;
-    }
-    if (!hasTlsHeapHeadroomUi()) {
-      if (error) {
-        *error = "Low heap (skip time sync)";
-      }
-      return false;
-    }
-
-    WiFiClientSecure client;
-    client.setInsecure();
-
-    HTTPClient http;
-    http.setConnectTimeout(1800);
-    http.setTimeout(2200);
-    http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
-
-    String url = USER_UNIX_TIME_SERVER_URL;
-    if (url.startsWith("https://")) {
-      url.remove(0, 8);
-      url = "http://" + url;
-    }
-
-    if (!http.begin(client, url)) {
-      if (error) {
-        *error = "Time server begin failed";
-      }
-      return false;
-    }
-
-    const int statusCode = http.GET();
-    if (statusCode != HTTP_CODE_OK) {
-      if (error) {
-        *error = "Time server failed (" + String(statusCode) + ")";
-      }
-      http.end();
-      return false;
-    }
-
-    const String payload = http.getString();
-    http.end();
-
-    uint64_t unixSec64 = 0;
-    uint64_t fileTime100Ns = 0;
-    if (extractUint64JsonField(payload, "currentFileTime", &fileTime100Ns)) {
-      if (fileTime100Ns <= kWindowsEpochOffset100Ns) {
-        if (error) {
-          *error = "Time field invalid";
-        }
-        return false;
-      }
-      unixSec64 = (fileTime100Ns - kWindowsEpochOffset100Ns) / kHundredNsPerSecond;
-    } else if (!extractUint64JsonField(payload, "unixtime", &unixSec64) &&
-               !extractUint64JsonField(payload, "unixTime", &unixSec64) &&
-               !extractUint64JsonField(payload, "unix", &unixSec64)) {
-      if (error) {
-        *error = "Time field missing";
-      }
-      return false;
-    }
-
-    const time_t unixSec = static_cast<time_t>(unixSec64);
-    if (!isValidUnixTime(unixSec)) {
-      if (error) {
-        *error = "Unix time invalid";
-      }
-      return false;
-    }
-
-    timeval tv;
-    tv.tv_sec = unixSec;
-    tv.tv_usec = 0;
-    if (settimeofday(&tv, nullptr) != 0) {
-      if (error) {
-        *error = "settimeofday failed";
-      }
-      return false;
-    }
-
-    return true;
-  }
-
   void drawBatteryIcon(lv_obj_t *parent, int x, int y) const {
     constexpr int bodyW = 18;
     constexpr int bodyH = 9;
@@ -1008,6 +1126,7 @@ class UiRuntime::Impl {
     clearProgressHandles();
     clearTextInputHandles();
     lv_obj_clean(screen);
+    beginBuild();
     disableScroll(screen);
     lv_obj_set_style_bg_color(screen, lv_color_hex(kClrBg), 0);
     lv_obj_set_style_text_color(screen, lv_color_hex(kClrTextPrimary), 0);
@@ -1031,6 +1150,7 @@ class UiRuntime::Impl {
     lv_obj_set_style_border_width(header, 1, 0);
     lv_obj_set_style_border_color(header, lv_color_hex(kClrBorder), 0);
     lv_obj_set_style_pad_all(header, 0, 0);
+    anchorRetained(header);
 
     int timeWidth = 54;
     if (timeWidth > innerW - 24) {
@@ -1052,9 +1172,11 @@ class UiRuntime::Impl {
 
     lv_obj_t *timeLabel = lv_label_create(header);
     setSingleLineLabel(timeLabel, timeWidth, LV_TEXT_ALIGN_RIGHT);
-    lv_label_set_text(timeLabel, headerTime.length() > 0 ? headerTime.c_str() : "--:--");
+    headerTimeShown = headerTime.length() > 0 ? headerTime : String("--:--");
+    lv_label_set_text(timeLabel, headerTimeShown.c_str());
     lv_obj_set_style_text_color(timeLabel, lv_color_hex(kClrTextMuted), 0);
     lv_obj_set_pos(timeLabel, frameW - kSidePadding - timeWidth, 4);
+    headerTimeLabel = timeLabel;
 
     int y = 4 + kHeaderHeight + 4;
     if (subtitle.length() > 0) {
@@ -1122,11 +1244,92 @@ class UiRuntime::Impl {
     }
   }
 
+  int listRowHeight(int usableHeight) const {
+    int rowHeight = kRowHeight;
+    if (usableHeight < rowHeight) {
+      rowHeight = usableHeight;
+    }
+    if (rowHeight < 18 && usableHeight >= 18) {
+      rowHeight = 18;
+    }
+    return rowHeight;
+  }
+
+  int menuWindowStart(int selected) const {
+    const int maxRows = static_cast<int>(retainedRows.size());
+    const int itemCount = retainedItemCount();
+    int start = selected - (maxRows / 2);
+    if (start < 0) {
+      start = 0;
+    }
+    if (start + maxRows > itemCount) {
+      start = itemCount - maxRows;
+      if (start < 0) {
+        start = 0;
+      }
+    }
+    return start;
+  }
+
   void renderMenu(const String &title,
                   const std::vector<String> &items,
                   int selected,
                   const String &subtitle,
                   const String &footer) {
+    if (retainedListMatches(RetainedView::Menu, title, subtitle, footer, items)) {
+      if (selected != retainedSelected) {
+        applyListWindow(menuWindowStart(selected), selected);
+        ++stats.inPlaceUpdates;
+      }
+      service(nullptr);
+      return;
+    }
+
+    buildMenuRows(title, subtitle, footer, static_cast<int>(items.size()));
+    retainedItems = items;
+    applyListWindow(menuWindowStart(selected), selected);
+
+    service(nullptr);
+  }
+
+  void renderMenuSource(const String &title,
+                        const UiListSource &source,
+                        size_t count,
+                        int selected,
+                        const String &subtitle,
+                        const String &footer) {
+    if (retainedView == RetainedView::Menu && retainedSource == &source &&
+        !retainedRows.empty() && retainedTitle == title &&
+        retainedSubtitle == subtitle && retainedFooter == footer &&
+        (count == retainedSourceCount ||
+         (retainedRows.size() == retainedRowCapacity && count >= retainedRowCapacity))) {
+      if (count != retainedSourceCount) {
+        // Rows arrived while the page stays full: relabel the window.
+        retainedSourceCount = count;
+        retainedStart = -1;
+      }
+      if (retainedStart < 0 || selected != retainedSelected) {
+        applyListWindow(menuWindowStart(selected), selected);
+        ++stats.inPlaceUpdates;
+      }
+      service(nullptr);
+      return;
+    }
+
+    buildMenuRows(title, subtitle, footer, static_cast<int>(count));
+    retainedSource = &source;
+    retainedSourceCount = count;
+    applyListWindow(menuWindowStart(selected), selected);
+
+    service(nullptr);
+  }
+
+  // Full build of a menu screen with one retained row per visible item; the
+  // caller points the rows at its items.
+  void buildMenuRows(const String &title,
+                     const String &subtitle,
+                     const String &footer,
+                     int itemCount) {
     int contentTop = 0;
     int contentBottom = 0;
     renderBase(title, subtitle, footer, contentTop, contentBottom);
@@ -1136,45 +1339,29 @@ class UiRuntime::Impl {
     if (usableHeight < 1) {
       usableHeight = 1;
     }
-    int rowHeight = kRowHeight;
-    if (usableHeight < rowHeight) {
-      rowHeight = usableHeight;
-    }
-    if (rowHeight < 18 && usableHeight >= 18) {
-      rowHeight = 18;
-    }
+    const int rowHeight = listRowHeight(usableHeight);
 
     int maxRows = usableHeight / rowHeight;
     if (maxRows < 1) {
       maxRows = 1;
     }
-
-    int start = selected - (maxRows / 2);
-    if (start < 0) {
-      start = 0;
+    retainedRowCapacity = static_cast<size_t>(maxRows);
+    if (maxRows > itemCount) {
+      maxRows = itemCount;
     }
-    if (start + maxRows > static_cast<int>(items.size())) {
-      start = static_cast<int>(items.size()) - maxRows;
-      if (start < 0) {
-        start = 0;
-      }
+
+    const int btnW = w - 20;
+    int btnH = rowHeight - 2;
+    if (btnH < 1) {
+      btnH = 1;
     }
 
     for (int row = 0; row < maxRows; ++row) {
-      const int index = start + row;
       const int y = contentTop + row * rowHeight;
-      if (index < 0 || index >= static_cast<int>(items.size())) {
-        continue;
-      }
 
       lv_obj_t *btn = lv_obj_create(lv_screen_active());
       disableScroll(btn);
       lv_obj_remove_style_all(btn);
-      const int btnW = w - 20;
-      int btnH = rowHeight - 2;
-      if (btnH < 1) {
-        btnH = 1;
-      }
       lv_obj_set_pos(btn, 10, y);
       lv_obj_set_size(btn, btnW, btnH);
       lv_obj_set_style_radius(btn, 8, kStyleAny);
@@ -1182,42 +1369,41 @@ class UiRuntime::Impl {
       lv_obj_set_style_pad_all(btn, 0, kStyleAny);
       lv_obj_set_style_bg_opa(btn, LV_OPA_COVER, kStyleAny);
 
-      const bool isSelected = index == selected;
-      lv_obj_set_style_bg_color(btn,
-                                isSelected ? lv_color_hex(kClrAccentSoft) : lv_color_hex(kClrPanel),
-                                kStyleAny);
-      lv_obj_set_style_border_color(btn,
-                                    isSelected ? lv_color_hex(kClrAccent) : lv_color_hex(kClrBorder),
-                                kStyleAny);
-
       lv_obj_t *label = lv_label_create(btn);
       setSingleLineLabel(label, btnW - 14, LV_TEXT_ALIGN_LEFT);
-      lv_label_set_text(label, items[static_cast<size_t>(index)].c_str());
-      lv_obj_set_style_text_color(label,
-                                  isSelected ? lv_color_hex(kClrTextPrimary)
-                                             : lv_color_hex(kClrTextPrimary),
-                                  kStyleAny);
+      lv_obj_set_style_text_color(label, lv_color_hex(kClrTextPrimary), kStyleAny);
       lv_obj_align(label, LV_ALIGN_LEFT_MID, 10, 0);
 
-      if (isSelected) {
-        lv_obj_t *marker = lv_obj_create(btn);
-        disableScroll(marker);
-        lv_obj_remove_style_all(marker);
-        lv_obj_set_size(marker, 3, btnH - 8);
-        lv_obj_set_pos(marker, 4, 4);
-        lv_obj_set_style_radius(marker, LV_RADIUS_CIRCLE, 0);
-        lv_obj_set_style_bg_color(marker, lv_color_hex(kClrAccent), 0);
-        lv_obj_set_style_bg_opa(marker, LV_OPA_COVER, 0);
-      }
+      retainedRows.push_back(btn);
+      retainedLabels.push_back(label);
     }
 
-    service(nullptr);
+    if (!retainedRows.empty()) {
+      lv_obj_t *marker = lv_obj_create(retainedRows.front());
+      disableScroll(marker);
+      lv_obj_remove_style_all(marker);
+      lv_obj_set_size(marker, 3, btnH - 8);
+      lv_obj_set_pos(marker, 4, 4);
+      lv_obj_set_style_radius(marker, LV_RADIUS_CIRCLE, 0);
+      lv_obj_set_style_bg_color(marker, lv_color_hex(kClrAccent), 0);
+      lv_obj_set_style_bg_opa(marker, LV_OPA_COVER, 0);
+      retainedMarker = marker;
+    }
+
+    retainedView = RetainedView::Menu;
+    retainedTitle = title;
+    retainedSubtitle = subtitle;
+    retainedFooter = footer;
   }
 
+  // Returns the largest scroll offset. With anchorLine >= 0 the offset is
+  // chosen so that line sits anchorPx below the top of the message view.
   int renderMessengerHome(const std::vector<String> &previewLines,
                           int focus,
                           bool scrollMode,
-                          int scrollOffsetLines) {
+                          int &scrollOffsetLines,
+                          int anchorLine = -1,
+                          int anchorPx = 0) {
     int contentTop = 0;
     int contentBottom = 0;
     const String footer = scrollMode
@@ -1285,13 +1471,18 @@ class UiRuntime::Impl {
     lv_obj_set_style_pad_all(box, 0, 0);
 
     String messageText;
+    messengerLineStarts.clear();
     if (previewLines.empty()) {
       messageText = "(no messages)";
     } else {
+      uint32_t letters = 0;
       for (size_t i = 0; i < previewLines.size(); ++i) {
         if (i > 0) {
           messageText += "\n";
+          ++letters;
         }
+        messengerLineStarts.push_back(letters);
+        letters += utf8Letters(previewLines[i]);
         messageText += previewLines[i];
       }
     }
@@ -1320,6 +1511,14 @@ class UiRuntime::Impl {
     if (maxScrollPx > 0) {
       maxScrollLines = (maxScrollPx + lineStep - 1) / lineStep;
     }
+    if (anchorLine >= 0 && static_cast<size_t>(anchorLine) < messengerLineStarts.size()) {
+      lv_point_t pos;
+      lv_label_get_letter_pos(messageLabel,
+                              messengerLineStarts[static_cast<size_t>(anchorLine)],
+                              &pos);
+      const int anchorScrollPx = pos.y - anchorPx;
+      scrollOffsetLines = anchorScrollPx > 0 ? (anchorScrollPx + lineStep / 2) / lineStep : 0;
+    }
     int clampedScrollLines = scrollOffsetLines;
     if (clampedScrollLines < 0) {
       clampedScrollLines = 0;
@@ -1327,11 +1526,14 @@ class UiRuntime::Impl {
     if (clampedScrollLines > maxScrollLines) {
       clampedScrollLines = maxScrollLines;
     }
+    scrollOffsetLines = clampedScrollLines;
     int scrollPx = clampedScrollLines * lineStep;
     if (scrollPx > maxScrollPx) {
       scrollPx = maxScrollPx;
     }
     lv_obj_set_pos(messageLabel, 6, 6 - scrollPx);
+    messengerLabel = messageLabel;
+    messengerScrollPx = scrollPx;
 
     if (boxSelected && scrollMode) {
       lv_obj_t *modeLabel = lv_label_create(box);
@@ -1396,14 +1598,64 @@ class UiRuntime::Impl {
     return maxScrollLines;
   }
 
+  // Distance from the top of the message view to the top of a chat line as
+  // last rendered (negative when scrolled above it).
+  int messengerLineOffsetPx(size_t line) const {
+    if (!messengerLabel || line >= messengerLineStarts.size()) {
+      return 0;
+    }
+    lv_point_t pos;
+    lv_label_get_letter_pos(messengerLabel, messengerLineStarts[line], &pos);
+    return pos.y - messengerScrollPx;
+  }
+
+  void updateLauncherSelection(int selected) {
+    const int count = static_cast<int>(retainedItems.size());
+    const int safeSelected = wrapIndex(selected, count);
+    const int prevIndex = wrapIndex(safeSelected - 1, count);
+    const int nextIndex = wrapIndex(safeSelected + 1, count);
+    const String selectedName = ellipsize(retainedItems[static_cast<size_t>(safeSelected)], 18);
+
+    if (launcherIcons[0]) {
+      setLauncherIcon(launcherIcons[0], iconIdFromLauncherIndex(safeSelected));
+      setLauncherIcon(launcherIcons[1], iconIdFromLauncherIndex(prevIndex));
+      setLauncherIcon(launcherIcons[2], iconIdFromLauncherIndex(nextIndex));
+    }
+    if (launcherFallbackLabel) {
+      const String prevName = ellipsize(retainedItems[static_cast<size_t>(prevIndex)], 10);
+      const String nextName = ellipsize(retainedItems[static_cast<size_t>(nextIndex)], 10);
+      lv_label_set_text(launcherFallbackLabel, selectedName.c_str());
+      lv_label_set_text(launcherSideLabel, (prevName + "   |   " + nextName).c_str());
+    }
+    if (launcherNameLabel) {
+      lv_label_set_text(launcherNameLabel, selectedName.c_str());
+      lv_obj_align(launcherNameLabel, LV_ALIGN_TOP_MID, 0, launcherNameY);
+    }
+    retainedSelected = safeSelected;
+  }
+
   void renderLauncher(const String &title,
                       const std::vector<String> &items,
                       int selected) {
     updateHeaderIndicators();
 
+    if (retainedView == RetainedView::Launcher &&
+        retainedTitle == title &&
+        retainedItems == items &&
+        launcherBatteryKey == batteryIconKey()) {
+      if (wrapIndex(selected, static_cast<int>(items.size())) != retainedSelected) {
+        updateLauncherSelection(selected);
+        ++stats.inPlaceUpdates;
+      }
+      service(nullptr);
+      return;
+    }
+
     lv_obj_t *screen = lv_screen_active();
     clearProgressHandles();
+    clearTextInputHandles();
     lv_obj_clean(screen);
+    beginBuild();
     disableScroll(screen);
     lv_obj_set_style_bg_color(screen, lv_color_hex(kLauncherBg), 0);
     lv_obj_set_style_text_color(screen, lv_color_hex(kLauncherPrimary), 0);
@@ -1442,6 +1694,7 @@ class UiRuntime::Impl {
     lv_obj_set_style_bg_opa(topBar, LV_OPA_TRANSP, 0);
     lv_obj_set_style_border_width(topBar, 1, 0);
     lv_obj_set_style_border_color(topBar, lv_color_hex(kLauncherLine), 0);
+    anchorRetained(topBar);
 
     constexpr int kBatteryBodyW = 18;
     constexpr int kBatteryCapW = 2;
@@ -1473,6 +1726,8 @@ class UiRuntime::Impl {
     lv_label_set_text(timeLabel, timeText.c_str());
     lv_obj_set_style_text_color(timeLabel, lv_color_hex(kLauncherPrimary), 0);
     lv_obj_set_pos(timeLabel, timeX, labelY);
+    headerTimeLabel = timeLabel;
+    headerTimeShown = timeText;
 
     drawBatteryIcon(topBar, batteryX, batteryY);
 
@@ -1505,6 +1760,10 @@ class UiRuntime::Impl {
 
         disableScroll(rightIcon);
         lv_obj_align(rightIcon, LV_ALIGN_CENTER, 92, kMainIconOffsetY);
+
+        launcherIcons[0] = centerIcon;
+        launcherIcons[1] = leftIcon;
+        launcherIcons[2] = rightIcon;
       }
     }
 
@@ -1520,6 +1779,10 @@ class UiRuntime::Impl {
       lv_label_set_text(sideNames, (prevName + "   |   " + nextName).c_str());
       lv_obj_set_style_text_color(sideNames, lv_color_hex(kLauncherMuted), 0);
       lv_obj_align(sideNames, LV_ALIGN_CENTER, 0, 16);
+
+      launcherIcons[0] = nullptr;
+      launcherFallbackLabel = fallback;
+      launcherSideLabel = sideNames;
     }
 
     lv_obj_t *nameLabel = lv_label_create(screen);
@@ -1540,6 +1803,14 @@ class UiRuntime::Impl {
     }
     lv_obj_align(nameLabel, LV_ALIGN_TOP_MID, 0, nameY);
 
+    retainedView = RetainedView::Launcher;
+    retainedTitle = title;
+    retainedItems = items;
+    retainedSelected = safeSelected;
+    launcherNameLabel = nameLabel;
+    launcherNameY = nameY;
+    launcherBatteryKey = batteryIconKey();
+
     service(nullptr);
   }
 
@@ -1547,6 +1818,15 @@ class UiRuntime::Impl {
                   const std::vector<String> &lines,
                   int start,
                   const String &footer) {
+    if (retainedListMatches(RetainedView::Info, title, "", footer, lines)) {
+      if (start != retainedStart) {
+        applyListWindow(start, -1);
+        ++stats.inPlaceUpdates;
+      }
+      service(nullptr);
+      return;
+    }
+
     int contentTop = 0;
     int contentBottom = 0;
     renderBase(title, "", footer, contentTop, contentBottom);
@@ -1556,34 +1836,28 @@ class UiRuntime::Impl {
     if (usableHeight < 1) {
       usableHeight = 1;
     }
-    int rowHeight = kRowHeight;
-    if (usableHeight < rowHeight) {
-      rowHeight = usableHeight;
-    }
-    if (rowHeight < 18 && usableHeight >= 18) {
-      rowHeight = 18;
-    }
+    const int rowHeight = listRowHeight(usableHeight);
 
     int maxRows = usableHeight / rowHeight;
     if (maxRows < 1) {
       maxRows = 1;
     }
+    if (maxRows > static_cast<int>(lines.size())) {
+      maxRows = static_cast<int>(lines.size());
+    }
+
+    const int holderW = w - 20;
+    int holderH = rowHeight - 1;
+    if (holderH < 1) {
+      holderH = 1;
+    }
 
     for (int row = 0; row < maxRows; ++row) {
-      const int lineIndex = start + row;
       const int y = contentTop + row * rowHeight;
-      if (lineIndex < 0 || lineIndex >= static_cast<int>(lines.size())) {
-        continue;
-      }
 
       lv_obj_t *holder = lv_obj_create(lv_screen_active());
       disableScroll(holder);
       lv_obj_remove_style_all(holder);
-      const int holderW = w - 20;
-      int holderH = rowHeight - 1;
-      if (holderH < 1) {
-        holderH = 1;
-      }
       lv_obj_set_pos(holder, 10, y);
       lv_obj_set_size(holder, holderW, holderH);
       lv_obj_set_style_bg_color(holder, lv_color_hex(kClrPanel), kStyleAny);
@@ -1595,11 +1869,19 @@ class UiRuntime::Impl {
 
       lv_obj_t *label = lv_label_create(holder);
       setSingleLineLabel(label, holderW - 14, LV_TEXT_ALIGN_LEFT);
-      lv_label_set_text(label, lines[static_cast<size_t>(lineIndex)].c_str());
       lv_obj_set_style_text_color(label, lv_color_hex(kClrTextPrimary), kStyleAny);
       lv_obj_align(label, LV_ALIGN_LEFT_MID, 10, 0);
+
+      retainedRows.push_back(holder);
+      retainedLabels.push_back(label);
     }
 
+    retainedView = RetainedView::Info;
+    retainedTitle = title;
+    retainedFooter = footer;
+    retainedItems = lines;
+    applyListWindow(start, -1);
+
     service(nullptr);
   }
 
@@ -2150,6 +2432,7 @@ class UiRuntime::Impl {
     clearProgressHandles();
     clearTextInputHandles();
     lv_obj_clean(screen);
+    beginBuild();
     disableScroll(screen);
     lv_obj_set_style_bg_color(screen, lv_color_hex(kClrBg), 0);
     lv_obj_set_style_bg_opa(screen, LV_OPA_COVER, 0);
@@ -2252,16 +2535,28 @@ UiLanguage UiRuntime::language() const {
 }
 
 void UiRuntime::setKoreanFontInstalled(bool installed) {
-  impl_->koreanFontInstalled = installed;
-  if (impl_->port.ready()) {
-    impl_->applyTheme();
-  }
+  impl_->setKoreanFontInstalled(installed);
 }
 
 bool UiRuntime::isKoreanFontInstalled() const {
   return impl_->koreanFontInstalled;
 }
 
+void UiRuntime::finishPendingFlush() {
+  impl_->port.finishPendingFlush();
+}
+
+void UiRuntime::releaseSdFont() {
+  impl_->port.finishPendingFlush();
+  sdfont::close();
+}
+
+void UiRuntime::reloadSdFont() {
+  if (impl_->koreanFontInstalled) {
+    impl_->setKoreanFontInstalled(true);
+  }
+}
+
 void UiRuntime::setTimezone(const String &tz) {
   impl_->setTimezone(tz);
 }
@@ -2270,6 +2565,18 @@ String UiRuntime::timezone() const {
   return impl_->timezone();
 }
 
+SystemStatusSnapshot UiRuntime::systemStatus() const {
+  return impl_->systemStatus.snapshot();
+}
+
+UiRenderStats UiRuntime::renderStats() const {
+  return impl_->renderStats();
+}
+
+void UiRuntime::resetRenderStats() {
+  impl_->resetRenderStats();
+}
+
 bool UiRuntime::syncTimezoneFromIp(String *resolvedTz, String *error) {
   return impl_->syncTimezoneFromIp(resolvedTz, error);
 }
@@ -2292,11 +2599,17 @@ int UiRuntime::launcherLoop(const String &title,
 
   int selected = wrapIndex(selectedIndex, static_cast<int>(items.size()));
   bool redraw = true;
+  unsigned long lastRefreshMs = millis();
 
   while (true) {
+    const unsigned long now = millis();
     if (redraw) {
       impl_->renderLauncher(title, items, selected);
       redraw = false;
+      lastRefreshMs = now;
+    } else if (now - lastRefreshMs >= kHeaderRefreshMs) {
+      impl_->refreshHeader();
+      lastRefreshMs = now;
     }
 
     impl_->service(&backgroundTick);
@@ -2314,7 +2627,7 @@ int UiRuntime::launcherLoop(const String &title,
       return -1;
     }
 
-    delay(kUiLoopDelayMs);
+    impl_->waitForEvents();
   }
 }
 
@@ -2334,10 +2647,13 @@ int UiRuntime::menuLoop(const String &title,
 
   while (true) {
     const unsigned long now = millis();
-    if (redraw || now - lastRefreshMs >= kHeaderRefreshMs) {
+    if (redraw) {
       impl_->renderMenu(title, items, selected, subtitle, footer);
       redraw = false;
       lastRefreshMs = now;
+    } else if (now - lastRefreshMs >= kHeaderRefreshMs) {
+      impl_->refreshHeader();
+      lastRefreshMs = now;
     }
 
     impl_->service(&backgroundTick);
@@ -2355,35 +2671,182 @@ int UiRuntime::menuLoop(const String &title,
       return -1;
     }
 
-    delay(kUiLoopDelayMs);
+    impl_->waitForEvents();
+  }
+}
+
+int UiRuntime::menuLoop(const String &title,
+                        const UiListSource &source,
+                        int selectedIndex,
+                        const std::function<void()> &backgroundTick,
+                        const String &footer,
+                        const String &subtitle) {
+  if (!source.count || !source.label) {
+    return -1;
+  }
+
+  int selected = selectedIndex < 0 ? 0 : selectedIndex;
+  int result = -1;
+  bool redraw = true;
+  size_t shownCount = 0;
+  unsigned long lastRefreshMs = millis();
+  const bool keyed = source.key && source.find;
+  bool haveKey = false;
+  uint32_t selectedKey = 0;
+
+  while (true) {
+    const bool loading = source.loadStep && source.loadStep();
+    const size_t count = source.count();
+    if (count == 0 && !loading) {
+      break;
+    }
+
+    if (haveKey && count != shownCount) {
+      const int row = source.find(selectedKey);
+      if (row >= 0) {
+        selected = row;
+      }
+    }
+
+    const unsigned long now = millis();
+    if (count > 0 && (redraw || count != shownCount)) {
+      if (selected >= static_cast<int>(count)) {
+        selected = static_cast<int>(count) - 1;
+      }
+      if (keyed) {
+        selectedKey = source.key(static_cast<size_t>(selected));
+        haveKey = true;
+      }
+      impl_->renderMenuSource(title, source, count, selected, subtitle, footer);
+      shownCount = count;
+      redraw = false;
+      lastRefreshMs = now;
+    } else if (now - lastRefreshMs >= kHeaderRefreshMs) {
+      impl_->refreshHeader();
+      lastRefreshMs = now;
+    }
+
+    impl_->service(&backgroundTick);
+    UiEvent ev = pollInput();
+
+    if (ev.delta != 0 && count > 0) {
+      selected = wrapIndex(selected + ev.delta, static_cast<int>(count));
+      if (keyed) {
+        selectedKey = source.key(static_cast<size_t>(selected));
+      }
+      redraw = true;
+    }
+    if (ev.ok && count > 0) {
+      result = selected;
+      break;
+    }
+    if (ev.back) {
+      break;
+    }
+
+    if (!loading) {
+      impl_->waitForEvents();
+    }
   }
+
+  // The source usually lives on the caller's stack; the rows left on screen
+  // are rebuilt by the next render.
+  impl_->retainedView = RetainedView::None;
+  impl_->retainedSource = nullptr;
+  impl_->retainedSourceCount = 0;
+  return result;
 }
 
-MessengerAction UiRuntime::messengerHomeLoop(const std::vector<String> &previewLines,
+MessengerAction UiRuntime::messengerHomeLoop(const UiChatSource &source,
                                              int selectedIndex,
                                              const std::function<void()> &backgroundTick) {
   constexpr int kButtonCount = 3;
   constexpr int kSelectableCount = kButtonCount + 1;  // + message box
   constexpr unsigned long kMessageRefreshMs = 5000;
   constexpr int kInitialBottomScrollLines = 1000000;
+  // Chat lines held at once, lines shown on entry, and lines read per page
+  // when scrolling past either end of the window.
+  constexpr size_t kWindowLines = 48;
+  constexpr size_t kInitialLines = 32;
+  constexpr size_t kPageLines = 16;
   int focus = wrapIndex(selectedIndex + 1, kSelectableCount);
   bool scrollMode = false;
   int scrollOffsetLines = kInitialBottomScrollLines;  // Clamp to bottom on first render.
   int maxScrollLines = 0;
+  int anchorLine = -1;
+  int anchorPx = 0;
   bool redraw = true;
   unsigned long lastRefreshMs = millis();
   unsigned long lastMessageRefreshMs = lastRefreshMs;
 
+  // Always yields exactly n lines, so the window stays aligned with count().
+  auto readLines = [&source](size_t first, size_t n, std::vector<String> &out) {
+    std::vector<String> lines;
+    if (n > 0 && source.lines) {
+      source.lines(first, n, lines);
+    }
+    lines.resize(n);
+    out.insert(out.end(), lines.begin(), lines.end());
+  };
+
+  std::vector<String> window;
+  size_t total = source.count ? source.count() : 0;
+  uint32_t revision = source.revision ? source.revision() : 0;
+  size_t first = total > kInitialLines ? total - kInitialLines : 0;
+  readLines(first, total - first, window);
+
+  // Picks up appended or changed lines. Appended lines join the window only
+  // while it ends at the newest line; the view stays at the bottom if it was.
+  auto pollSource = [&]() {
+    const size_t nowTotal = source.count ? source.count() : 0;
+    const uint32_t nowRevision = source.revision ? source.revision() : 0;
+    if (nowTotal == total && nowRevision == revision) {
+      return;
+    }
+    const bool atNewest = first + window.size() >= total;
+    const bool atBottom = scrollOffsetLines >= maxScrollLines;
+    if (nowRevision != revision || nowTotal < total || nowTotal - total > kWindowLines) {
+      size_t keep = window.size() > kInitialLines ? window.size() : kInitialLines;
+      if (atNewest || first >= nowTotal) {
+        first = nowTotal > keep ? nowTotal - keep : 0;
+      }
+      keep = nowTotal - first < keep ? nowTotal - first : keep;
+      window.clear();
+      readLines(first, keep, window);
+    } else if (atNewest) {
+      readLines(total, nowTotal - total, window);
+      if (window.size() > kWindowLines) {
+        const size_t drop = window.size() - kWindowLines;
+        if (!atBottom) {
+          anchorLine = 0;
+          anchorPx = impl_->messengerLineOffsetPx(drop);
+        }
+        window.erase(window.begin(), window.begin() + static_cast<long>(drop));
+        first += drop;
+      }
+    }
+    total = nowTotal;
+    revision = nowRevision;
+    if (atBottom) {
+      scrollOffsetLines = kInitialBottomScrollLines;
+      anchorLine = -1;
+    }
+    redraw = true;
+  };
+
   while (true) {
     const unsigned long now = millis();
+    if (now - lastRefreshMs >= kHeaderRefreshMs) {
+      pollSource();
+    }
     if (redraw || now - lastRefreshMs >= kHeaderRefreshMs) {
-      maxScrollLines = impl_->renderMessengerHome(previewLines,
+      maxScrollLines = impl_->renderMessengerHome(window,
                                                   focus,
                                                   scrollMode,
-                                                  scrollOffsetLines);
-      if (scrollOffsetLines > maxScrollLines) {
-        scrollOffsetLines = maxScrollLines;
-      }
+                                                  scrollOffsetLines,
+                                                  anchorLine,
+                                                  anchorPx);
+      anchorLine = -1;
       redraw = false;
       lastRefreshMs = now;
     }
@@ -2399,16 +2862,41 @@ MessengerAction UiRuntime::messengerHomeLoop(const std::vector<String> &previewL
 
     if (scrollMode) {
       if (ev.delta != 0) {
-        int nextOffset = scrollOffsetLines + ev.delta;
-        if (nextOffset < 0) {
-          nextOffset = 0;
-        }
-        if (nextOffset > maxScrollLines) {
-          nextOffset = maxScrollLines;
-        }
-        if (nextOffset != scrollOffsetLines) {
-          scrollOffsetLines = nextOffset;
+        const int nextOffset = scrollOffsetLines + ev.delta;
+        const size_t windowEnd = first + window.size();
+        if (nextOffset < 0 && first > 0) {
+          // Past the top: read the previous page, keep the current top line
+          // where it is, and drop lines from the bottom.
+          const size_t n = first < kPageLines ? first : kPageLines;
+          anchorLine = static_cast<int>(n);
+          anchorPx = impl_->messengerLineOffsetPx(0);
+          std::vector<String> older;
+          readLines(first - n, n, older);
+          window.insert(window.begin(), older.begin(), older.end());
+          first -= n;
+          if (window.size() > kWindowLines) {
+            window.resize(kWindowLines);
+          }
           redraw = true;
+        } else if (nextOffset > maxScrollLines && windowEnd < total) {
+          // Past the bottom: read the next page and drop lines from the top.
+          const size_t n = total - windowEnd < kPageLines ? total - windowEnd : kPageLines;
+          readLines(windowEnd, n, window);
+          if (window.size() > kWindowLines) {
+            const size_t drop = window.size() - kWindowLines;
+            anchorLine = 0;
+            anchorPx = impl_->messengerLineOffsetPx(drop);
+            window.erase(window.begin(), window.begin() + static_cast<long>(drop));
+            first += drop;
+          }
+          redraw = true;
+        } else {
+          const int clampedOffset =
+              nextOffset < 0 ? 0 : (nextOffset > maxScrollLines ? maxScrollLines : nextOffset);
+          if (clampedOffset != scrollOffsetLines) {
+            scrollOffsetLines = clampedOffset;
+            redraw = true;
+          }
         }
       }
 
@@ -2417,7 +2905,7 @@ MessengerAction UiRuntime::messengerHomeLoop(const std::vector<String> &previewL
         redraw = true;
       }
 
-      delay(kUiLoopDelayMs);
+      impl_->waitForEvents();
       continue;
     }
 
@@ -2453,7 +2941,7 @@ MessengerAction UiRuntime::messengerHomeLoop(const std::vector<String> &previewL
       return MessengerAction::Refresh;
     }
 
-    delay(kUiLoopDelayMs);
+    impl_->waitForEvents();
   }
 }
 
@@ -2467,10 +2955,13 @@ void UiRuntime::showInfo(const String &title,
 
   while (true) {
     const unsigned long now = millis();
-    if (redraw || now - lastRefreshMs >= kHeaderRefreshMs) {
+    if (redraw) {
       impl_->renderInfo(title, lines, startIndex, footer);
       redraw = false;
       lastRefreshMs = now;
+    } else if (now - lastRefreshMs >= kHeaderRefreshMs) {
+      impl_->refreshHeader();
+      lastRefreshMs = now;
     }
 
     impl_->service(&backgroundTick);
@@ -2497,7 +2988,7 @@ void UiRuntime::showInfo(const String &title,
       return;
     }
 
-    delay(kUiLoopDelayMs);
+    impl_->waitForEvents();
   }
 }
 
@@ -2593,7 +3084,7 @@ bool UiRuntime::numberWheelInput(const String &title,
       return false;
     }
 
-    delay(kUiLoopDelayMs);
+    impl_->waitForEvents();
   }
 }
 
@@ -2874,7 +3365,7 @@ bool UiRuntime::textInput(const String &title,
       }
     }
 
-    delay(kUiLoopDelayMs);
+    impl_->waitForEvents();
   }
 }
 
@@ -2908,7 +3399,7 @@ void UiRuntime::showToast(const String &title,
       return;
     }
 
-    delay(kUiLoopDelayMs);
+    impl_->waitForEvents();
   }
 }
 
@@ -2930,6 +3421,6 @@ void UiRuntime::showBootSplash(const String &subtitle,
       return;
     }
 
-    delay(kUiLoopDelayMs);
+    impl_->waitForEvents();
   }
 }
@@ -5,6 +5,7 @@
 #include <functional>
 #include <vector>
 
+#include "../core/system_status.h"
 #include "i18n.h"
 
 struct UiEvent {
@@ -26,6 +27,56 @@ enum class MessengerAction : uint8_t {
   Refresh = 5,
 };
 
+// Rows for the list form of menuLoop. label() is only asked for the rows on
+// screen, and count() is read again every pass, so a list may keep growing
+// (or reorder) while it is shown. loadStep, when set, runs once per pass and
+// returns true while it has more work; the loop does not idle until then.
+// key and find, when both set, keep the selection on the same item as rows
+// are inserted above it: key(row) identifies the row's item and find(key)
+// returns its current row, or -1 once it is gone.
+struct UiListSource {
+  std::function<size_t()> count;
+  std::function<String(size_t)> label;
+  std::function<bool()> loadStep;
+  std::function<uint32_t(size_t)> key;
+  std::function<int(uint32_t)> find;
+};
+
+// Chat lines for messengerHomeLoop, oldest first. The loop keeps a window of
+// a few dozen lines and reads lines() only for ranges it is about to show:
+// the newest lines on entry, older or newer pages as the view is scrolled
+// past either end. count() and revision() are polled while the loop runs; a
+// higher count under the same revision means lines were appended, a new
+// revision means lines already read changed and the window is read again.
+struct UiChatSource {
+  std::function<size_t()> count;
+  std::function<void(size_t first, size_t max, std::vector<String> &out)> lines;
+  std::function<uint32_t()> revision;
+};
+
+// Rendering cost counters. fullBuilds/objectsCreated count screens rebuilt
+// from scratch; inPlaceUpdates count retained views that were only
+// restyled or relabelled. Frame numbers come from the display port.
+struct UiRenderStats {
+  uint32_t fullBuilds = 0;
+  uint32_t inPlaceUpdates = 0;
+  uint32_t objectsCreated = 0;
+  uint32_t lastBuildObjects = 0;
+  uint32_t frames = 0;
+  uint32_t avgFrameUs = 0;
+  uint32_t maxFrameUs = 0;
+  uint32_t lastFramePixels = 0;
+  uint32_t avgFramePixels = 0;
+  uint32_t maxFramePixels = 0;
+  // Input edge (GPIO interrupt) to the end of the first frame drawn after it.
+  uint32_t lastWakeToRenderUs = 0;
+  uint32_t maxWakeToRenderUs = 0;
+  // Time the UI loop spent blocked waiting for events, and how many of those
+  // waits allowed light sleep.
+  uint32_t waitMs = 0;
+  uint32_t lightSleepWaits = 0;
+};
+
 class UiRuntime {
  public:
   UiRuntime();
@@ -43,10 +94,19 @@ class UiRuntime {
 
   void setKoreanFontInstalled(bool installed);
   bool isKoreanFontInstalled() const;
+  // For code that takes the SD card away from under the UI (remounts, SPI
+  // clock changes): wait out the display DMA on the shared bus, and close or
+  // reopen the SD font pack. Labels use the Latin font while it is closed.
+  void finishPendingFlush();
+  void releaseSdFont();
+  void reloadSdFont();
 
   void setTimezone(const String &tz);
   String timezone() const;
   bool syncTimezoneFromIp(String *resolvedTz = nullptr, String *error = nullptr);
+  SystemStatusSnapshot systemStatus() const;
+  UiRenderStats renderStats() const;
+  void resetRenderStats();
   void setDisplayBrightnessPercent(uint8_t percent);
   uint8_t displayBrightnessPercent() const;
 
@@ -61,8 +121,14 @@ class UiRuntime {
                const std::function<void()> &backgroundTick,
                const String &footer = "OK Select  BACK Exit",
                const String &subtitle = "");
+  int menuLoop(const String &title,
+               const UiListSource &source,
+               int selectedIndex,
+               const std::function<void()> &backgroundTick,
+               const String &footer = "OK Select  BACK Exit",
+               const String &subtitle = "");
 
-  MessengerAction messengerHomeLoop(const std::vector<String> &previewLines,
+  MessengerAction messengerHomeLoop(const UiChatSource &source,
                                     int selectedIndex,
                                     const std::function<void()> &backgroundTick);
 